@@ -2,11 +2,17 @@
 
 #include "Minimap2Index.h"
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <optional>
 #include <sstream>
 
 namespace dorado::alignment {
 
+IndexFileAccess::IndexFileAccess(size_t max_loaded_indices)
+        : m_max_loaded_indices(max_loaded_indices) {}
+
 const Minimap2Index* IndexFileAccess::get_compatible_index(
         const std::string& file,
         const Minimap2IndexOptions& indexing_options) {
@@ -66,17 +72,64 @@ std::shared_ptr<Minimap2Index> IndexFileAccess::get_or_load_compatible_index(
     return new_index;
 }
 
-bool IndexFileAccess::try_load_compatible_index(const std::string& file,
-                                                const Minimap2Options& options) {
+std::shared_ptr<Minimap2Index> IndexFileAccess::try_load_compatible_index(
+        const std::string& file,
+        const Minimap2Options& options) {
     std::lock_guard<std::mutex> lock(m_mutex);
     auto index = get_or_load_compatible_index(file, options);
-    return index != nullptr;
+    if (index) {
+        record_load_and_evict({file, options});
+    }
+    return index;
+}
+
+void IndexFileAccess::record_load_and_evict(const IndexKey& loaded) {
+    m_last_loaded[loaded] = ++m_num_loads;
+    if (m_max_loaded_indices == 0) {
+        return;
+    }
+    while (true) {
+        size_t num_loaded = 0;
+        std::optional<IndexKey> least_recently_used;
+        uint64_t least_recent_load = std::numeric_limits<uint64_t>::max();
+        for (const auto& [key, compatible_indices] : m_index_lut) {
+            if (compatible_indices.empty()) {
+                continue;
+            }
+            ++num_loaded;
+            const bool in_use = std::any_of(compatible_indices.begin(), compatible_indices.end(),
+                                            [](const auto& compatible_index) {
+                                                return compatible_index.second.use_count() > 1;
+                                            });
+            const auto last_loaded = m_last_loaded.find(key);
+            const uint64_t last_load = last_loaded == m_last_loaded.end() ? 0 : last_loaded->second;
+            if (key != loaded && !in_use && last_load < least_recent_load) {
+                least_recently_used = key;
+                least_recent_load = last_load;
+            }
+        }
+        if (num_loaded <= m_max_loaded_indices || !least_recently_used) {
+            return;
+        }
+        m_index_lut.erase(*least_recently_used);
+        m_last_loaded.erase(*least_recently_used);
+    }
 }
 
 IndexLoadResult IndexFileAccess::load_index(const std::string& file,
                                             const Minimap2Options& options,
                                             int num_threads) {
-    if (try_load_compatible_index(file, options)) {
+    std::shared_ptr<const Minimap2Index> loaded_index;
+    return load_index(file, options, num_threads, loaded_index);
+}
+
+IndexLoadResult IndexFileAccess::load_index(const std::string& file,
+                                            const Minimap2Options& options,
+                                            int num_threads,
+                                            std::shared_ptr<const Minimap2Index>& loaded_index) {
+    // Holding the index keeps record_load_and_evict from unloading it once the lock is released.
+    loaded_index = try_load_compatible_index(file, options);
+    if (loaded_index) {
         return IndexLoadResult::success;
     }
 
@@ -91,7 +144,9 @@ IndexLoadResult IndexFileAccess::load_index(const std::string& file,
     }
 
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_index_lut[{file, options}][options] = std::move(new_index);
+    m_index_lut[{file, options}][options] = new_index;
+    loaded_index = std::move(new_index);
+    record_load_and_evict({file, options});
     return IndexLoadResult::success;
 }
 
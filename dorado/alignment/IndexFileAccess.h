@@ -3,6 +3,8 @@
 #include "Minimap2IndexSupportTypes.h"
 #include "Minimap2Options.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -17,10 +19,16 @@ class IndexFileAccess {
     using CompatibleIndicesLut = std::map<Minimap2MappingOptions, std::shared_ptr<Minimap2Index>>;
     using IndexKey = std::pair<std::string, Minimap2IndexOptions>;
     std::map<IndexKey, CompatibleIndicesLut> m_index_lut;
+    // The most indexes, by file and indexing options, to keep loaded.  0 means there's no limit.
+    const size_t m_max_loaded_indices{0};
+    // When each index was last requested by load_index, for unloading the least recently used.
+    std::map<IndexKey, uint64_t> m_last_loaded;
+    uint64_t m_num_loads{0};
 
-    // Returns true if the index is loaded, will also create the index if a compatible
-    // one is already loaded and return true.
-    bool try_load_compatible_index(const std::string& file, const Minimap2Options& options);
+    // Returns the index if it's loaded, will also create the index if a compatible
+    // one is already loaded and return it.  Returns nullptr otherwise.
+    std::shared_ptr<Minimap2Index> try_load_compatible_index(const std::string& file,
+                                                             const Minimap2Options& options);
 
     // By contract the index must be loaded (else assertion failure)
     std::shared_ptr<Minimap2Index> get_exact_index(const std::string& file,
@@ -41,11 +49,27 @@ class IndexFileAccess {
     std::shared_ptr<Minimap2Index> get_or_load_compatible_index(const std::string& file,
                                                                 const Minimap2Options& options);
 
+    // Marks the index as the most recently used, then unloads the least recently used indexes
+    // until no more than m_max_loaded_indices are loaded.  Indexes which are still referenced
+    // outside this class are in use, so are kept even if that leaves the limit exceeded.
+    // Requires the mutex to be locked before calling.
+    void record_load_and_evict(const IndexKey& loaded);
+
 public:
+    IndexFileAccess() = default;
+    explicit IndexFileAccess(size_t max_loaded_indices);
+
     IndexLoadResult load_index(const std::string& file,
                                const Minimap2Options& options,
                                int num_threads);
 
+    // As load_index, also setting loaded_index to the index on success.  The index is fetched
+    // under the same lock as it's loaded, so loading another index can't unload it in between.
+    IndexLoadResult load_index(const std::string& file,
+                               const Minimap2Options& options,
+                               int num_threads,
+                               std::shared_ptr<const Minimap2Index>& loaded_index);
+
     // Returns the index if already loaded, if not loaded will create an index from an
     // existing compatible one.
     // By contract there must be a loaded index for the file with matching indexing
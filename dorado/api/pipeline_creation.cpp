@@ -11,9 +11,12 @@
 #include "read_pipeline/StereoDuplexEncoderNode.h"
 #include "splitter/DuplexReadSplitter.h"
 #include "splitter/RNAReadSplitter.h"
+#include "splitter/SignalReadSplitter.h"
 
 #include <spdlog/spdlog.h>
 
+#include <stdexcept>
+
 namespace dorado::pipelines {
 
 void create_simplex_pipeline(PipelineDescriptor& pipeline_desc,
@@ -22,8 +25,12 @@ void create_simplex_pipeline(PipelineDescriptor& pipeline_desc,
                              size_t overlap,
                              uint32_t mean_qscore_start_pos,
                              bool trim_adapter,
+                             bool trim_open_pore,
+                             std::shared_ptr<SignalCache> signal_cache,
+                             std::shared_ptr<utils::SignalBufferPool> signal_pool,
                              int scaler_node_threads,
                              bool enable_read_splitter,
+                             bool enable_signal_splitter,
                              int splitter_node_threads,
                              int modbase_node_threads,
                              NodeHandle sink_node_handle,
@@ -58,9 +65,27 @@ void create_simplex_pipeline(PipelineDescriptor& pipeline_desc,
         current_node_handle = rna_splitter_node;
     }
 
-    auto scaler_node = pipeline_desc.add_node<ScalerNode>({}, model_config.signal_norm_params,
-                                                          model_config.sample_type, trim_adapter,
-                                                          scaler_node_threads, 1000);
+    // For DNA, open-pore signal can optionally be cut out before basecalling so that it
+    // isn't chunked and called only to be split off afterwards.
+    if (enable_read_splitter && enable_signal_splitter && !is_rna) {
+        splitter::SignalSplitSettings signal_splitter_settings;
+        auto signal_splitter =
+                std::make_unique<const splitter::SignalReadSplitter>(signal_splitter_settings);
+        auto signal_splitter_node = pipeline_desc.add_node<ReadSplitNode>(
+                {}, std::move(signal_splitter), splitter_node_threads, 1000);
+        first_node_handle = signal_splitter_node;
+        current_node_handle = signal_splitter_node;
+    }
+
+    // Cached reads skip straight past splitting of unscaled signal.
+    if (signal_cache && current_node_handle != PipelineDescriptor::InvalidNodeHandle) {
+        throw std::runtime_error("Signal caching can't be used with splitting before basecalling");
+    }
+
+    auto scaler_node = pipeline_desc.add_node<ScalerNode>(
+            {}, model_config.signal_norm_params, model_config.sample_type, trim_adapter,
+            trim_open_pore, scaler_node_threads, 1000, std::move(signal_cache),
+            std::move(signal_pool));
     if (current_node_handle != PipelineDescriptor::InvalidNodeHandle) {
         pipeline_desc.add_node_sink(current_node_handle, scaler_node);
     } else {
@@ -69,7 +94,7 @@ void create_simplex_pipeline(PipelineDescriptor& pipeline_desc,
     current_node_handle = scaler_node;
     auto basecaller_node = pipeline_desc.add_node<BasecallerNode>(
             {}, std::move(runners), overlap, kBatchTimeoutMS, model_name, 1000, "BasecallerNode",
-            mean_qscore_start_pos);
+            mean_qscore_start_pos, false);
     pipeline_desc.add_node_sink(current_node_handle, basecaller_node);
     current_node_handle = basecaller_node;
     last_node_handle = basecaller_node;
@@ -131,7 +156,7 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
 
     auto stereo_basecaller_node = pipeline_desc.add_node<BasecallerNode>(
             {}, std::move(stereo_runners), adjusted_stereo_overlap, kStereoBatchTimeoutMS,
-            duplex_rg_name, 1000, "StereoBasecallerNode", mean_qscore_start_pos);
+            duplex_rg_name, 1000, "StereoBasecallerNode", mean_qscore_start_pos, true);
 
     NodeHandle last_node_handle = stereo_basecaller_node;
     if (!modbase_runners.empty()) {
@@ -172,11 +197,11 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
     const int kSimplexBatchTimeoutMS = 100;
     auto basecaller_node = pipeline_desc.add_node<BasecallerNode>(
             {splitter_node}, std::move(runners), adjusted_simplex_overlap, kSimplexBatchTimeoutMS,
-            model_name, 1000, "BasecallerNode", mean_qscore_start_pos);
+            model_name, 1000, "BasecallerNode", mean_qscore_start_pos, false);
 
     auto scaler_node = pipeline_desc.add_node<ScalerNode>(
             {basecaller_node}, model_config.signal_norm_params, basecall::SampleType::DNA, false,
-            scaler_node_threads, 1000);
+            false, scaler_node_threads, 1000);
 
     // if we've been provided a source node, connect it to the start of our pipeline
     if (source_node_handle != PipelineDescriptor::InvalidNodeHandle) {
@@ -11,6 +11,12 @@
 
 namespace dorado {
 
+class SignalCache;
+
+namespace utils {
+class SignalBufferPool;
+}
+
 namespace basecall {
 class ModelRunnerBase;
 using RunnerPtr = std::unique_ptr<ModelRunnerBase>;
@@ -28,14 +34,23 @@ namespace pipelines {
 /// Create a simplex basecall pipeline description
 /// If source_node_handle is valid, set this to be the source of the simplex pipeline
 /// If sink_node_handle is valid, set this to be the sink of the simplex pipeline
+/// If enable_signal_splitter is set, DNA reads are also split on open-pore signal before basecalling
+/// If trim_open_pore is set, trailing and long internal open-pore signal in DNA reads isn't basecalled
+/// If signal_cache is set, scaled signal is cached, and reads already in the cache aren't rescaled.
+/// It can't be used when reads are split before scaling.
+/// If signal_pool is set, scaled signal is written to buffers from the pool.
 void create_simplex_pipeline(PipelineDescriptor& pipeline_desc,
                              std::vector<basecall::RunnerPtr>&& runners,
                              std::vector<modbase::RunnerPtr>&& modbase_runners,
                              size_t overlap,
                              uint32_t mean_qscore_start_pos,
                              bool trim_adapter,
+                             bool trim_open_pore,
+                             std::shared_ptr<SignalCache> signal_cache,
+                             std::shared_ptr<utils::SignalBufferPool> signal_pool,
                              int scaler_node_threads,
                              bool enable_read_splitter,
+                             bool enable_signal_splitter,
                              int splitter_node_threads,
                              int modbase_threads,
                              NodeHandle sink_node_handle,
@@ -1,7 +1,9 @@
 #include "runner_creation.h"
 
 #include "basecall/crf_utils.h"
+#include "basecall/decode/CPUDecoder.h"
 #include "modbase/ModBaseModelConfig.h"
+#include "utils/thread_utils.h"
 
 #if DORADO_GPU_BUILD
 #ifdef __APPLE__
@@ -15,6 +17,7 @@
 #include <cxxpool.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <thread>
 
 namespace dorado {
@@ -24,6 +27,7 @@ std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
         const std::string& device,
         size_t num_gpu_runners,
         size_t num_cpu_runners,
+        size_t cpu_threads_per_caller,
         size_t batch_size,
         size_t chunk_size,
         float memory_fraction,
@@ -52,9 +56,52 @@ std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
         spdlog::debug("- CPU calling: set batch size to {}, num_cpu_runners to {}", batch_size,
                       num_cpu_runners);
 
-        for (size_t i = 0; i < num_cpu_runners; i++) {
-            runners.push_back(std::make_unique<basecall::ModelRunner>(
-                    model_config, device, int(chunk_size), int(batch_size)));
+        // Only the CPUs this process may run on, which aren't necessarily the first ones.
+        const auto allowed_cpus = utils::get_allowed_cpus();
+
+        // With more than one thread per caller, each caller gets its own set of cores to split its
+        // batches over, and there are only as many callers as there are core sets.  Otherwise
+        // the callers run single-threaded and are left to the OS scheduler.
+        std::vector<std::vector<int>> caller_cpus(num_cpu_runners);
+        if (cpu_threads_per_caller > 1) {
+            cpu_threads_per_caller = std::min(cpu_threads_per_caller, allowed_cpus.size());
+            caller_cpus.resize(
+                    std::min(num_cpu_runners, allowed_cpus.size() / cpu_threads_per_caller));
+            auto next_cpu = allowed_cpus.begin();
+            for (auto& cpus : caller_cpus) {
+                cpus.assign(next_cpu, next_cpu + cpu_threads_per_caller);
+                next_cpu += cpu_threads_per_caller;
+            }
+            spdlog::debug("- CPU calling: {} callers with {} pinned threads each",
+                          caller_cpus.size(), cpu_threads_per_caller);
+        }
+
+        // Each caller runs the model on cpu_threads_per_caller threads and the decoder on up to
+        // CPUDecoder::MAX_THREADS more, so batches can go through it as a 3 stage pipeline: one
+        // runner's batch in the model, one in the decoder, and one being filled by
+        // accept_chunk.  That needs a runner per stage, each costing a worker thread and a
+        // batch_size * chunk_size float input buffer (5 MB at the defaults), next to a copy of
+        // the model per caller.  It only pays off if every caller's model and decode threads have
+        // a core to run on; otherwise the stages just contend for cores, so callers get a single
+        // runner, calling one batch at a time.
+        constexpr size_t CPU_CALLER_PIPELINE_STAGES = 3;
+        const size_t decode_threads_per_caller =
+                std::min(batch_size, size_t(basecall::decode::CPUDecoder::MAX_THREADS));
+        const size_t busy_threads_per_caller =
+                std::max(cpu_threads_per_caller, size_t{1}) + decode_threads_per_caller;
+        const size_t runners_per_caller =
+                caller_cpus.size() * busy_threads_per_caller <= allowed_cpus.size()
+                        ? CPU_CALLER_PIPELINE_STAGES
+                        : 1;
+        spdlog::debug("- CPU calling: {} callers with {} runners each", caller_cpus.size(),
+                      runners_per_caller);
+
+        for (auto& cpus : caller_cpus) {
+            auto caller = basecall::create_cpu_caller(model_config, device, int(chunk_size),
+                                                      int(batch_size), std::move(cpus));
+            for (size_t j = 0; j < runners_per_caller; j++) {
+                runners.push_back(std::make_unique<basecall::ModelRunner>(caller));
+            }
         }
     }
 #if DORADO_GPU_BUILD
@@ -150,11 +197,14 @@ std::vector<modbase::RunnerPtr> create_modbase_runners(
     std::vector<std::string> modbase_devices;
 
     int remora_callers = 1;
+    int threads_per_model = 1;
     if (device == "cpu") {
+        // A single caller shared by one runner per core, so that partial batches from different
+        // runners can be merged into one forward pass of the model.
         modbase_devices.push_back(device);
         remora_batch_size = 128;
-        remora_runners_per_caller = 1;
-        remora_callers = std::thread::hardware_concurrency();
+        remora_runners_per_caller = std::thread::hardware_concurrency();
+        threads_per_model = int(std::thread::hardware_concurrency());
     }
 #if DORADO_GPU_BUILD
 #ifdef __APPLE__
@@ -170,7 +220,7 @@ std::vector<modbase::RunnerPtr> create_modbase_runners(
     for (const auto& device_string : modbase_devices) {
         for (int i = 0; i < remora_callers; ++i) {
             auto caller = modbase::create_modbase_caller(remora_models, int(remora_batch_size),
-                                                         device_string);
+                                                         device_string, threads_per_model);
             for (size_t j = 0; j < remora_runners_per_caller; j++) {
                 remora_runners.push_back(std::make_unique<modbase::ModBaseRunner>(caller));
             }
@@ -2,50 +2,363 @@
 
 #include "CRFModel.h"
 #include "decode/Decoder.h"
+#include "utils/thread_utils.h"
+
+#include <ATen/ATen.h>
+#include <nvtx3/nvtx3.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace std::chrono_literals;
 
 namespace dorado::basecall {
 
+class CPUCaller {
+public:
+    struct NNTask {
+        NNTask(at::Tensor input_, int num_chunks_) : input(input_), num_chunks(num_chunks_) {}
+        at::Tensor input;
+        int num_chunks;
+        at::Tensor scores;
+        std::vector<decode::DecodedChunk> decoded_chunks;
+        std::mutex mut;
+        std::condition_variable cv;
+        bool done{false};
+    };
+
+    CPUCaller(const CRFModelConfig &model_config,
+              const std::string &device,
+              int chunk_size,
+              int batch_size,
+              std::vector<int> cpus)
+            : m_config(model_config),
+              m_decoder(decode::create_decoder(device, model_config)),
+              m_options(at::TensorOptions().dtype(m_decoder->dtype()).device(device)),
+              m_module(load_crf_model(model_config, m_options)),
+              m_batch_size(batch_size),
+              m_cpus(std::move(cpus)) {
+        m_decoder_options.q_shift = model_config.qbias;
+        m_decoder_options.q_scale = model_config.qscale;
+
+        // adjust chunk size to be a multiple of the stride
+        m_chunk_size = chunk_size - chunk_size % model_config.stride;
+
+        start_threads();
+    }
+
+    ~CPUCaller() { terminate(); }
+
+    void start_threads() {
+        // The model thread runs the first slice of each batch itself.  The others must be waiting
+        // on the current generation before it can hand them any work.
+        for (size_t i = 1; i < m_cpus.size(); ++i) {
+            m_forward_threads.emplace_back(&CPUCaller::forward_thread_fn, this, i,
+                                           m_forward_generation);
+        }
+        m_model_thread = std::make_unique<std::thread>(&CPUCaller::model_thread_fn, this);
+        m_decode_thread = std::make_unique<std::thread>(&CPUCaller::decode_thread_fn, this);
+    }
+
+    // Pins the calling thread to the given CPU of this caller's set, if it has one.
+    void pin_thread(size_t cpu_idx) const {
+        if (cpu_idx < m_cpus.size() && !utils::set_thread_affinity({m_cpus[cpu_idx]})) {
+            spdlog::debug("Unable to pin {} thread to CPU {}", get_name(), m_cpus[cpu_idx]);
+        }
+    }
+
+    // Runs the model on one slice of each batch split up by forward().
+    void forward_thread_fn(size_t slice_idx, uint64_t last_generation) {
+        at::InferenceMode guard;
+        pin_thread(slice_idx);
+        std::unique_lock<std::mutex> lock(m_forward_lock);
+        while (true) {
+            m_forward_cv.wait(lock, [&] {
+                return m_forward_generation != last_generation || m_terminate_forward;
+            });
+            if (m_terminate_forward) {
+                return;
+            }
+            last_generation = m_forward_generation;
+            auto input = m_forward_slices[slice_idx];
+            lock.unlock();
+            auto output = input.defined() ? m_module->forward(input) : at::Tensor();
+            lock.lock();
+            m_forward_slices[slice_idx] = std::move(output);
+            if (--m_forward_slices_pending == 0) {
+                m_forward_done_cv.notify_one();
+            }
+        }
+    }
+
+    // With more than one CPU, the batch is split across the forward threads, each of which runs
+    // its slice single-threaded on its own core.  This keeps ATen's intra-op parallelism, which is
+    // process-wide, out of the picture.
+    at::Tensor forward(const at::Tensor &input) {
+        if (m_forward_threads.empty()) {
+            return m_module->forward(input);
+        }
+
+        const auto num_slices = int64_t(m_cpus.size());
+        auto slices = input.chunk(num_slices, 0);
+        {
+            std::lock_guard<std::mutex> lock(m_forward_lock);
+            m_forward_slices.assign(m_cpus.size(), at::Tensor());
+            std::copy(slices.begin(), slices.end(), m_forward_slices.begin());
+            m_forward_slices_pending = m_forward_threads.size();
+            ++m_forward_generation;
+        }
+        m_forward_cv.notify_all();
+
+        auto first_output = m_module->forward(slices[0]);
+
+        std::unique_lock<std::mutex> lock(m_forward_lock);
+        m_forward_done_cv.wait(lock, [&] { return m_forward_slices_pending == 0; });
+        std::vector<at::Tensor> outputs{std::move(first_output)};
+        for (size_t i = 1; i < slices.size(); ++i) {
+            outputs.push_back(std::move(m_forward_slices[i]));
+        }
+        m_forward_slices.clear();
+        lock.unlock();
+
+        // CPU models output [T, N, C], so the slices are joined along the batch dimension.
+        return at::cat(outputs, 1);
+    }
+
+    std::vector<decode::DecodedChunk> call_chunks(at::Tensor &input, int num_chunks) {
+        NVTX3_FUNC_RANGE();
+        if (num_chunks == 0) {
+            return {};
+        }
+
+        auto task = std::make_shared<NNTask>(input.to(m_options.device()), num_chunks);
+        {
+            std::lock_guard<std::mutex> lock(m_model_queue_lock);
+            m_model_queue.push_front(task);
+        }
+        m_model_queue_cv.notify_one();
+
+        std::unique_lock lock(task->mut);
+        while (!task->done) {
+            task->cv.wait(lock);
+        }
+        return std::move(task->decoded_chunks);
+    }
+
+    // Runs the model on each task in turn, then hands it over to the decode thread.
+    void model_thread_fn() {
+        at::InferenceMode guard;
+        pin_thread(0);
+        while (true) {
+            std::unique_lock<std::mutex> model_lock(m_model_queue_lock);
+            while (m_model_queue.empty() && !m_terminate.load()) {
+                m_model_queue_cv.wait_for(model_lock, 100ms);
+            }
+            if (m_model_queue.empty() && m_terminate.load()) {
+                return;
+            }
+            auto task = m_model_queue.back();
+            m_model_queue.pop_back();
+            model_lock.unlock();
+
+            nvtx3::scoped_range loop{"cpu_model_forward"};
+            stats::Timer timer;
+            task->scores = forward(task->input);
+            m_model_ms += timer.GetElapsedMS();
+
+            {
+                std::lock_guard<std::mutex> lock(m_decode_queue_lock);
+                m_decode_queue.push_front(std::move(task));
+            }
+            m_decode_queue_cv.notify_one();
+        }
+    }
+
+    // Decodes the model output of each task in turn, and hands the results back to the runner.
+    void decode_thread_fn() {
+        at::InferenceMode guard;
+        while (true) {
+            std::unique_lock<std::mutex> decode_lock(m_decode_queue_lock);
+            while (m_decode_queue.empty() && !m_terminate_decode.load()) {
+                m_decode_queue_cv.wait_for(decode_lock, 100ms);
+            }
+            if (m_decode_queue.empty() && m_terminate_decode.load()) {
+                return;
+            }
+            auto task = m_decode_queue.back();
+            m_decode_queue.pop_back();
+            decode_lock.unlock();
+
+            nvtx3::scoped_range loop{"cpu_decode"};
+            stats::Timer timer;
+            auto decoded_chunks = m_decoder->beam_search_part_2(m_decoder->beam_search_part_1(
+                    {task->scores, task->num_chunks, m_decoder_options}));
+            m_decode_ms += timer.GetElapsedMS();
+            ++m_num_batches_called;
+
+            std::unique_lock<std::mutex> task_lock(task->mut);
+            task->scores = {};
+            task->decoded_chunks = std::move(decoded_chunks);
+            task->done = true;
+            task_lock.unlock();
+            task->cv.notify_one();
+        }
+    }
+
+    void terminate() {
+        // The model thread is stopped first, so that the decode thread can finish off everything
+        // it has already passed on.
+        m_terminate.store(true);
+        m_model_queue_cv.notify_one();
+        if (m_model_thread && m_model_thread->joinable()) {
+            m_model_thread->join();
+        }
+        m_model_thread.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(m_forward_lock);
+            m_terminate_forward = true;
+        }
+        m_forward_cv.notify_all();
+        for (auto &thread : m_forward_threads) {
+            thread.join();
+        }
+        m_forward_threads.clear();
+
+        m_terminate_decode.store(true);
+        m_decode_queue_cv.notify_one();
+        if (m_decode_thread && m_decode_thread->joinable()) {
+            m_decode_thread->join();
+        }
+        m_decode_thread.reset();
+    }
+
+    void restart() {
+        // This can be called more than once, via multiple runners.
+        if (m_terminate.load()) {
+            m_terminate.store(false);
+            m_terminate_decode.store(false);
+            m_terminate_forward = false;
+            start_threads();
+        }
+    }
+
+    std::string get_name() const {
+        std::ostringstream name_stream;
+        name_stream << "CPUCaller_" << this;
+        return name_stream.str();
+    }
+
+    stats::NamedStats sample_stats() const {
+        stats::NamedStats stats;
+        stats["batches_called"] = double(m_num_batches_called);
+        stats["model_ms"] = double(m_model_ms);
+        stats["decode_ms"] = double(m_decode_ms);
+        // The fraction of the time since the caller was created that each thread was busy.
+        const auto elapsed_ms = double(std::max<int64_t>(m_lifetime_timer.GetElapsedMS(), 1));
+        stats["model_occupancy"] = double(m_model_ms) / elapsed_ms;
+        stats["decode_occupancy"] = double(m_decode_ms) / elapsed_ms;
+        stats["forward_threads"] = double(std::max<size_t>(m_cpus.size(), 1));
+        return stats;
+    }
+
+    const CRFModelConfig m_config;
+    std::unique_ptr<decode::Decoder> m_decoder;
+    at::TensorOptions m_options;
+    decode::DecoderOptions m_decoder_options;
+    torch::nn::ModuleHolder<torch::nn::AnyModule> m_module{nullptr};
+    int m_batch_size;
+    int m_chunk_size;
+    // The CPUs the model threads are pinned to, or empty to leave them unpinned.
+    const std::vector<int> m_cpus;
+
+    std::atomic<bool> m_terminate{false};
+    std::atomic<bool> m_terminate_decode{false};
+    std::deque<std::shared_ptr<NNTask>> m_model_queue;
+    std::mutex m_model_queue_lock;
+    std::condition_variable m_model_queue_cv;
+    std::deque<std::shared_ptr<NNTask>> m_decode_queue;
+    std::mutex m_decode_queue_lock;
+    std::condition_variable m_decode_queue_cv;
+    std::unique_ptr<std::thread> m_model_thread;
+    std::unique_ptr<std::thread> m_decode_thread;
+
+    // Hand-off of batch slices between the model thread and the forward threads.
+    std::vector<std::thread> m_forward_threads;
+    std::vector<at::Tensor> m_forward_slices;
+    size_t m_forward_slices_pending{0};
+    uint64_t m_forward_generation{0};
+    bool m_terminate_forward{false};
+    std::mutex m_forward_lock;
+    std::condition_variable m_forward_cv;
+    std::condition_variable m_forward_done_cv;
+
+    // Performance monitoring stats.
+    mutable stats::Timer m_lifetime_timer;
+    std::atomic<int64_t> m_num_batches_called = 0;
+    std::atomic<int64_t> m_model_ms = 0;
+    std::atomic<int64_t> m_decode_ms = 0;
+};
+
+std::shared_ptr<CPUCaller> create_cpu_caller(const CRFModelConfig &model_config,
+                                             const std::string &device,
+                                             int chunk_size,
+                                             int batch_size,
+                                             std::vector<int> cpus) {
+    return std::make_shared<CPUCaller>(model_config, device, chunk_size, batch_size,
+                                       std::move(cpus));
+}
+
 ModelRunner::ModelRunner(const CRFModelConfig &model_config,
                          const std::string &device,
                          int chunk_size,
                          int batch_size)
-        : m_config(model_config),
-          m_decoder(decode::create_decoder(device, model_config)),
-          m_options(at::TensorOptions().dtype(m_decoder->dtype()).device(device)),
-          m_module(load_crf_model(model_config, m_options)) {
-    m_decoder_options.q_shift = model_config.qbias;
-    m_decoder_options.q_scale = model_config.qscale;
-
-    // adjust chunk size to be a multiple of the stride
-    chunk_size -= chunk_size % model_config.stride;
-
-    m_input = at::zeros({batch_size, model_config.num_features, chunk_size},
-                        at::TensorOptions().dtype(m_decoder->dtype()).device(at::kCPU));
+        : ModelRunner(create_cpu_caller(model_config, device, chunk_size, batch_size, {})) {}
+
+ModelRunner::ModelRunner(std::shared_ptr<CPUCaller> caller) : m_caller(std::move(caller)) {
+    m_input = at::zeros(
+            {m_caller->m_batch_size, m_caller->m_config.num_features, m_caller->m_chunk_size},
+            at::TensorOptions().dtype(m_caller->m_decoder->dtype()).device(at::kCPU));
 }
 
 std::vector<decode::DecodedChunk> ModelRunner::call_chunks(int num_chunks) {
-    at::InferenceMode guard;
-    dorado::stats::Timer timer;
-    auto scores = m_module->forward(m_input.to(m_options.device()));
-    const auto forward_ms = timer.GetElapsedMS();
-    auto decoded_chunks = m_decoder->beam_search_part_2(
-            m_decoder->beam_search_part_1({scores, num_chunks, m_decoder_options}));
-    const auto forward_plus_decode_ms = timer.GetElapsedMS();
     ++m_num_batches_called;
-    m_model_ms += forward_ms;
-    m_decode_ms += forward_plus_decode_ms - forward_ms;
-    return decoded_chunks;
+    return m_caller->call_chunks(m_input, num_chunks);
+}
+
+std::vector<decode::DecodedChunk> ModelRunner::call_short_chunks(int num_chunks,
+                                                                 size_t num_samples) {
+    ++m_num_batches_called;
+    auto input = m_input.narrow(2, 0, int64_t(num_samples)).contiguous();
+    return m_caller->call_chunks(input, num_chunks);
 }
 
 void ModelRunner::accept_chunk(int chunk_idx, const at::Tensor &chunk) {
     m_input.index_put_({chunk_idx, at::indexing::Ellipsis}, chunk);
 }
 
+const CRFModelConfig &ModelRunner::config() const { return m_caller->m_config; }
+size_t ModelRunner::model_stride() const { return m_caller->m_config.stride; }
+void ModelRunner::terminate() { m_caller->terminate(); }
+void ModelRunner::restart() { m_caller->restart(); }
+
+std::string ModelRunner::get_name() const {
+    // The name must be unique across multiple instances.
+    std::ostringstream name_stream;
+    name_stream << "ModelRunner_" << this;
+    return name_stream.str();
+}
+
 stats::NamedStats ModelRunner::sample_stats() const {
-    stats::NamedStats stats;
+    // Each runner passes through the stats of its caller, which may be shared with other runners.
+    stats::NamedStats stats = stats::from_obj(*m_caller);
     stats["batches_called"] = double(m_num_batches_called);
-    stats["model_ms"] = double(m_model_ms);
-    stats["decode_ms"] = double(m_decode_ms);
     return stats;
 }
 
@@ -8,39 +8,51 @@
 #include <torch/nn.h>
 
 #include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace dorado::basecall {
 
+class CPUCaller;
+
+// The caller runs the model forward passes and decoding on separate threads, so that one runner's
+// batch can go through the model while another runner's batch is being decoded.
+// If cpus is given, the model threads are pinned to them, and with more than one CPU each batch is
+// split across them.
+std::shared_ptr<CPUCaller> create_cpu_caller(const CRFModelConfig &model_config,
+                                             const std::string &device,
+                                             int chunk_size,
+                                             int batch_size,
+                                             std::vector<int> cpus);
+
 class ModelRunner final : public ModelRunnerBase {
 public:
+    // Runs on a caller of its own.
     ModelRunner(const CRFModelConfig &model_config,
                 const std::string &device,
                 int chunk_size,
                 int batch_size);
+    explicit ModelRunner(std::shared_ptr<CPUCaller> caller);
     void accept_chunk(int chunk_idx, const at::Tensor &chunk) final;
     std::vector<decode::DecodedChunk> call_chunks(int num_chunks) final;
-    const CRFModelConfig &config() const final { return m_config; };
-    size_t model_stride() const final { return m_config.stride; }
+    std::vector<decode::DecodedChunk> call_short_chunks(int num_chunks, size_t num_samples) final;
+    bool supports_short_chunks() const final { return true; }
+    const CRFModelConfig &config() const final;
+    size_t model_stride() const final;
     size_t chunk_size() const final { return m_input.size(2); }
     size_t batch_size() const final { return m_input.size(0); }
-    void terminate() final {}
-    void restart() final {}
-    std::string get_name() const final { return "ModelRunner"; }
+    void terminate() final;
+    void restart() final;
+    std::string get_name() const final;
     stats::NamedStats sample_stats() const final;
 
 private:
-    const CRFModelConfig m_config;
-    std::unique_ptr<decode::Decoder> m_decoder;
-    at::TensorOptions m_options;
-    decode::DecoderOptions m_decoder_options;
-    torch::nn::ModuleHolder<torch::nn::AnyModule> m_module{nullptr};
+    std::shared_ptr<CPUCaller> m_caller;
     at::Tensor m_input;
 
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
-    std::atomic<int64_t> m_model_ms = 0;
-    std::atomic<int64_t> m_decode_ms = 0;
 };
 
 }  // namespace dorado::basecall
@@ -19,6 +19,16 @@ public:
     virtual ~ModelRunnerBase() = default;
     virtual void accept_chunk(int chunk_idx, const at::Tensor &chunk) = 0;
     virtual std::vector<decode::DecodedChunk> call_chunks(int num_chunks) = 0;
+    // As above, but only the first num_samples samples of each chunk need to be called, where
+    // num_samples is a multiple of the model stride.  Runners which can't run shorter chunks call
+    // them in full, so the moves of the results give the length actually called.
+    virtual std::vector<decode::DecodedChunk> call_short_chunks(int num_chunks,
+                                                                size_t num_samples) {
+        (void)num_samples;
+        return call_chunks(num_chunks);
+    }
+    // Whether call_short_chunks only runs the model over the requested samples.
+    virtual bool supports_short_chunks() const { return false; }
     virtual const CRFModelConfig &config() const = 0;
     virtual size_t model_stride() const = 0;
     virtual size_t chunk_size() const = 0;
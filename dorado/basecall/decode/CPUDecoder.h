@@ -8,6 +8,9 @@ namespace dorado::basecall::decode {
 
 class CPUDecoder final : public Decoder {
 public:
+    // The most threads a batch is decoded on.
+    static constexpr int MAX_THREADS = 4;
+
     DecodeData beam_search_part_1(DecodeData data) const;
     std::vector<DecodedChunk> beam_search_part_2(DecodeData data) const;
 
@@ -1,25 +1,25 @@
 #include "beam_search.h"
 
-#include "utils/simd.h"
+#include "beam_search_kernels.h"
 
 #include <math.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
 #include <array>
-#include <bitset>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <numeric>
+#include <type_traits>
 
 namespace {
 
-// 16 bit state supports 7-mers with 4 bases.
-typedef uint16_t state_t;
-
-constexpr int NUM_BASE_BITS = 2;
-constexpr int NUM_BASES = 1 << NUM_BASE_BITS;
+using dorado::basecall::decode::details::BeamFrontElement;
+using dorado::basecall::decode::details::crc32c;
+using dorado::basecall::decode::details::NUM_BASE_BITS;
+using dorado::basecall::decode::details::NUM_BASES;
+using dorado::basecall::decode::details::state_t;
 
 // This is the data we need to retain for the whole beam
 struct BeamElement {
@@ -28,15 +28,6 @@ struct BeamElement {
     bool stay;
 };
 
-// This is the data we need to retain for only the previous timestep (block) in the beam
-// (and what we construct for the new timestep)
-struct BeamFrontElement {
-    uint32_t hash;
-    state_t state;
-    uint8_t prev_element_index;
-    bool stay;
-};
-
 float log_sum_exp(float x, float y) {
     float abs_diff = std::abs(x - y);
     return std::max(x, y) + ((abs_diff < 17.0f) ? (std::log1p(std::exp(-abs_diff))) : 0.0f);
@@ -99,22 +90,6 @@ std::tuple<std::string, std::string> generate_sequence(const std::vector<uint8_t
     return make_tuple(sequence, qstring);
 }
 
-// Incorporates NUM_NEW_BITS into a Castagnoli CRC32, aka CRC32C
-// (not the same polynomial as CRC32 as used in zip/ethernet).
-template <int NUM_NEW_BITS>
-uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
-    // Note that this is the reversed polynomial.
-    constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
-    for (int i = 0; i < NUM_NEW_BITS; ++i) {
-        auto b = (new_bits ^ crc) & 1;
-        crc >>= 1;
-        if (b)
-            crc ^= POLYNOMIAL;
-        new_bits >>= 1;
-    }
-    return crc;
-}
-
 }  // anonymous namespace
 
 namespace dorado::basecall::decode {
@@ -135,7 +110,6 @@ float beam_search(const T* const scores,
                   float score_scale,
                   float posts_scale) {
     const size_t num_states = 1ull << num_state_bits;
-    const auto states_mask = static_cast<state_t>(num_states - 1);
 
     if (max_beam_width > 256) {
         throw std::range_error("Beamsearch max_beam_width cannot be greater than 256.");
@@ -159,6 +133,9 @@ float beam_search(const T* const scores,
     std::vector<float> current_scores(max_beam_candidates);
     std::vector<float> prev_scores(max_beam_candidates);
 
+    // Indices of the steps whose hashes match a stay.
+    std::vector<uint16_t> step_matches(max_beam_width);
+
     // Find the score an initial element needs in order to make it into the beam
     T beam_init_threshold = std::numeric_limits<T>::lowest();
     if (max_beam_width < num_states) {
@@ -197,10 +174,6 @@ float beam_search(const T* const scores,
     // Iterate through blocks, extending beam
     for (size_t block_idx = 0; block_idx < num_blocks; ++block_idx) {
         const T* const block_scores = scores + (block_idx * scores_block_stride);
-        // Retrieves the given score as a float, multiplied by score_scale.
-        const auto fetch_block_score = [block_scores, score_scale](size_t idx) {
-            return static_cast<float>(block_scores[idx]) * score_scale;
-        };
         const float* const block_back_scores = back_guide + ((block_idx + 1) << num_state_bits);
 
         /*  kmer transitions order:
@@ -218,43 +191,27 @@ float beam_search(const T* const scores,
          *  Transition (movement) ACGTT (111) -> CGTTG (446) has index 446 * 4 + 0 = 1784
          */
 
-        float max_score = std::numeric_limits<float>::lowest();
-
-        // Essentially a k=1 Bloom filter, indicating the presence of steps with particular
-        // sequence hashes.  Avoids comparing stay hashes against all possible progenitor
-        // states where none of them has the requisite sequence hash.
-        const uint32_t HASH_PRESENT_BITS = 4096;
-        const uint32_t HASH_PRESENT_MASK = HASH_PRESENT_BITS - 1;
-        std::bitset<HASH_PRESENT_BITS> step_hash_present;  // Default constructor zeros content.
+        // Indicates the presence of steps with particular sequence hashes.  Avoids comparing stay
+        // hashes against all possible progenitor states where none of them has the requisite
+        // sequence hash.
+        details::HashPresentBits step_hash_present;  // Default constructor zeros content.
 
         // Generate list of candidate elements for this timestep (block).
         // As we do so, update the maximum score.
-        size_t new_elem_count = 0;
-        for (size_t prev_elem_idx = 0; prev_elem_idx < current_beam_width; ++prev_elem_idx) {
-            const auto& previous_element = prev_beam_front[prev_elem_idx];
-
-            // Expand all the possible steps
-            for (int new_base = 0; new_base < NUM_BASES; new_base++) {
-                state_t new_state =
-                        (state_t((previous_element.state << NUM_BASE_BITS) & states_mask) |
-                         state_t(new_base));
-                const auto move_idx = static_cast<state_t>(
-                        (new_state << NUM_BASE_BITS) +
-                        (((previous_element.state << NUM_BASE_BITS) >> num_state_bits)));
-                float new_score = prev_scores[prev_elem_idx] + fetch_block_score(move_idx) +
-                                  static_cast<float>(block_back_scores[new_state]);
-                uint32_t new_hash = crc32c<NUM_BASE_BITS>(previous_element.hash, new_base);
-
-                step_hash_present[new_hash & HASH_PRESENT_MASK] = true;
-
-                // Add new element to the candidate list
-                current_beam_front[new_elem_count] = {new_hash, new_state, (uint8_t)prev_elem_idx,
-                                                      false};
-                current_scores[new_elem_count] = new_score;
-                max_score = std::max(max_score, new_score);
-                ++new_elem_count;
-            }
+        float max_score;
+        if constexpr (std::is_same_v<T, float>) {
+            max_score = details::expand_steps(block_scores, score_scale, block_back_scores,
+                                              num_state_bits, prev_beam_front.data(),
+                                              prev_scores.data(), current_beam_width,
+                                              current_beam_front.data(), current_scores.data(),
+                                              step_hash_present);
+        } else {
+            max_score = details::expand_steps_generic(
+                    block_scores, score_scale, block_back_scores, num_state_bits,
+                    prev_beam_front.data(), prev_scores.data(), current_beam_width,
+                    current_beam_front.data(), current_scores.data(), step_hash_present);
         }
+        size_t new_elem_count = current_beam_width << NUM_BASE_BITS;
 
         for (size_t prev_elem_idx = 0; prev_elem_idx < current_beam_width; ++prev_elem_idx) {
             const auto& previous_element = prev_beam_front[prev_elem_idx];
@@ -268,35 +225,34 @@ float beam_search(const T* const scores,
 
             // Determine whether the path including this stay duplicates another sequence ending in
             // a step.
-            if (step_hash_present[previous_element.hash & HASH_PRESENT_MASK]) {
+            if (step_hash_present[previous_element.hash & details::HASH_PRESENT_MASK]) {
                 size_t stay_elem_idx = (current_beam_width << NUM_BASE_BITS) + prev_elem_idx;
                 // latest base is in smallest bits
                 int stay_latest_base = int(previous_element.state & 3);
 
                 // Go through all the possible step extensions that match this destination base with the stay and compare
                 // their hashes, merging if we find any.
-                for (size_t prev_elem_comp_idx = 0; prev_elem_comp_idx < current_beam_width;
-                     prev_elem_comp_idx++) {
-                    size_t step_elem_idx = (prev_elem_comp_idx << NUM_BASE_BITS) | stay_latest_base;
-                    if (current_beam_front[stay_elem_idx].hash ==
-                        current_beam_front[step_elem_idx].hash) {
-                        if (current_scores[stay_elem_idx] > current_scores[step_elem_idx]) {
-                            // Fold the step into the stay
-                            const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
-                                                                   current_scores[step_elem_idx]);
-                            current_scores[stay_elem_idx] = folded_score;
-                            max_score = std::max(max_score, folded_score);
-                            // The step element will end up last, sorted by score
-                            current_scores[step_elem_idx] = std::numeric_limits<float>::lowest();
-                        } else {
-                            // Fold the stay into the step
-                            const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
-                                                                   current_scores[step_elem_idx]);
-                            current_scores[step_elem_idx] = folded_score;
-                            max_score = std::max(max_score, folded_score);
-                            // The stay element will end up last, sorted by score
-                            current_scores[stay_elem_idx] = std::numeric_limits<float>::lowest();
-                        }
+                const size_t num_matches = details::find_matching_steps(
+                        current_beam_front.data(), current_beam_width, stay_latest_base,
+                        previous_element.hash, step_matches.data());
+                for (size_t match_idx = 0; match_idx < num_matches; ++match_idx) {
+                    const size_t step_elem_idx = step_matches[match_idx];
+                    if (current_scores[stay_elem_idx] > current_scores[step_elem_idx]) {
+                        // Fold the step into the stay
+                        const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
+                                                               current_scores[step_elem_idx]);
+                        current_scores[stay_elem_idx] = folded_score;
+                        max_score = std::max(max_score, folded_score);
+                        // The step element will end up last, sorted by score
+                        current_scores[step_elem_idx] = std::numeric_limits<float>::lowest();
+                    } else {
+                        // Fold the stay into the step
+                        const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
+                                                               current_scores[step_elem_idx]);
+                        current_scores[step_elem_idx] = folded_score;
+                        max_score = std::max(max_score, folded_score);
+                        // The stay element will end up last, sorted by score
+                        current_scores[stay_elem_idx] = std::numeric_limits<float>::lowest();
                     }
                 }
             }
@@ -307,48 +263,10 @@ float beam_search(const T* const scores,
         // Starting point for finding the cutoff score is the beam cut score
         float beam_cutoff_score = max_score - log_beam_cut;
 
+        // Count the elements which meet the beam cutoff.
         auto get_elem_count = [new_elem_count, &beam_cutoff_score, &current_scores]() {
-            // Count the elements which meet the beam cutoff.
-            size_t elem_count = 0;
-            const float* score_ptr = current_scores.data();
-#if !ENABLE_NEON_IMPL
-            for (int i = int(new_elem_count); i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#else
-            uint32x4_t counts_x4_a = vdupq_n_u32(0u);
-            uint32x4_t counts_x4_b = vdupq_n_u32(0u);
-            const float32x4_t cutoff_x4 = vdupq_n_f32(beam_cutoff_score);
-
-            // 8 fold unrolled version has the small upside that both loads
-            // can be done with a single ldp instruction.
-            const int kUnroll = 8;
-            for (int i = int(new_elem_count) / kUnroll; i; --i) {
-                // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
-                // which we subtract to increment our counts.
-                float32x4_t scores_x4_a = vld1q_f32(score_ptr);
-                uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
-                counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
-
-                float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
-                uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
-                counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
-
-                score_ptr += 8;
-            }
-            // Add together the result of 2 horizontal adds.
-            elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
-            for (int i = new_elem_count % kUnroll; i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#endif
-            return elem_count;
+            return details::count_scores_above_cutoff(current_scores.data(), new_elem_count,
+                                                      beam_cutoff_score);
         };
 
         // Count the elements which meet the min score
@@ -392,18 +310,9 @@ float beam_search(const T* const scores,
             elem_count = std::min(elem_count, max_beam_width);
         }
 
-        size_t write_idx = 0;
-        for (size_t read_idx = 0; read_idx < new_elem_count; ++read_idx) {
-            if (current_scores[read_idx] >= beam_cutoff_score) {
-                if (write_idx < max_beam_width) {
-                    prev_beam_front[write_idx] = current_beam_front[read_idx];
-                    prev_scores[write_idx] = current_scores[read_idx];
-                    ++write_idx;
-                } else {
-                    break;
-                }
-            }
-        }
+        details::select_above_cutoff(current_beam_front.data(), current_scores.data(),
+                                     new_elem_count, beam_cutoff_score, max_beam_width,
+                                     prev_beam_front.data(), prev_scores.data());
 
         // At the last timestep, we need to ensure the best path corresponds to element 0.
         // The other elements don't matter.
@@ -0,0 +1,494 @@
+#include "beam_search_kernels.h"
+
+#include "utils/simd.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace dorado::basecall::decode::details {
+
+namespace {
+
+// Expands a single previous element into its NUM_BASES step candidates, returning the maximum
+// candidate score.
+template <typename T>
+inline float expand_element(const T* block_scores,
+                            float score_scale,
+                            const float* block_back_scores,
+                            int num_state_bits,
+                            const BeamFrontElement* prev_front,
+                            const float* prev_scores,
+                            size_t prev_elem_idx,
+                            BeamFrontElement* new_front,
+                            float* new_scores,
+                            HashPresentBits& step_hash_present) {
+    const auto states_mask = static_cast<state_t>((1 << num_state_bits) - 1);
+    const auto& previous_element = prev_front[prev_elem_idx];
+    float max_score = std::numeric_limits<float>::lowest();
+    size_t new_elem_idx = prev_elem_idx << NUM_BASE_BITS;
+    for (int new_base = 0; new_base < NUM_BASES; new_base++) {
+        state_t new_state = (state_t((previous_element.state << NUM_BASE_BITS) & states_mask) |
+                             state_t(new_base));
+        const auto move_idx = static_cast<state_t>(
+                (new_state << NUM_BASE_BITS) +
+                (((previous_element.state << NUM_BASE_BITS) >> num_state_bits)));
+        float new_score = prev_scores[prev_elem_idx] +
+                          static_cast<float>(block_scores[move_idx]) * score_scale +
+                          static_cast<float>(block_back_scores[new_state]);
+        uint32_t new_hash = crc32c<NUM_BASE_BITS>(previous_element.hash, new_base);
+
+        step_hash_present[new_hash & HASH_PRESENT_MASK] = true;
+
+        // Add new element to the candidate list
+        new_front[new_elem_idx] = {new_hash, new_state, (uint8_t)prev_elem_idx, false};
+        new_scores[new_elem_idx] = new_score;
+        max_score = std::max(max_score, new_score);
+        ++new_elem_idx;
+    }
+    return max_score;
+}
+
+}  // namespace
+
+template <typename T>
+float expand_steps_generic(const T* block_scores,
+                           float score_scale,
+                           const float* block_back_scores,
+                           int num_state_bits,
+                           const BeamFrontElement* prev_front,
+                           const float* prev_scores,
+                           size_t beam_width,
+                           BeamFrontElement* new_front,
+                           float* new_scores,
+                           HashPresentBits& step_hash_present) {
+    float max_score = std::numeric_limits<float>::lowest();
+    for (size_t prev_elem_idx = 0; prev_elem_idx < beam_width; ++prev_elem_idx) {
+        max_score = std::max(max_score,
+                             expand_element(block_scores, score_scale, block_back_scores,
+                                            num_state_bits, prev_front, prev_scores, prev_elem_idx,
+                                            new_front, new_scores, step_hash_present));
+    }
+    return max_score;
+}
+
+template float expand_steps_generic(const float*,
+                                    float,
+                                    const float*,
+                                    int,
+                                    const BeamFrontElement*,
+                                    const float*,
+                                    size_t,
+                                    BeamFrontElement*,
+                                    float*,
+                                    HashPresentBits&);
+template float expand_steps_generic(const int8_t*,
+                                    float,
+                                    const float*,
+                                    int,
+                                    const BeamFrontElement*,
+                                    const float*,
+                                    size_t,
+                                    BeamFrontElement*,
+                                    float*,
+                                    HashPresentBits&);
+
+size_t find_matching_steps_generic(const BeamFrontElement* front,
+                                   size_t beam_width,
+                                   int latest_base,
+                                   uint32_t hash,
+                                   uint16_t* matches) {
+    size_t num_matches = 0;
+    for (size_t prev_elem_comp_idx = 0; prev_elem_comp_idx < beam_width; prev_elem_comp_idx++) {
+        size_t step_elem_idx = (prev_elem_comp_idx << NUM_BASE_BITS) | latest_base;
+        if (front[step_elem_idx].hash == hash) {
+            matches[num_matches++] = uint16_t(step_elem_idx);
+        }
+    }
+    return num_matches;
+}
+
+size_t count_scores_above_cutoff_generic(const float* scores, size_t num_scores, float cutoff) {
+    size_t elem_count = 0;
+    for (size_t i = 0; i < num_scores; ++i) {
+        if (scores[i] >= cutoff) {
+            ++elem_count;
+        }
+    }
+    return elem_count;
+}
+
+size_t select_above_cutoff_generic(const BeamFrontElement* front,
+                                   const float* scores,
+                                   size_t num_elements,
+                                   float cutoff,
+                                   size_t max_count,
+                                   BeamFrontElement* selected_front,
+                                   float* selected_scores) {
+    size_t write_idx = 0;
+    for (size_t read_idx = 0; read_idx < num_elements && write_idx < max_count; ++read_idx) {
+        if (scores[read_idx] >= cutoff) {
+            selected_front[write_idx] = front[read_idx];
+            selected_scores[write_idx] = scores[read_idx];
+            ++write_idx;
+        }
+    }
+    return write_idx;
+}
+
+namespace {
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+float expand_steps_impl(const float* block_scores,
+                        float score_scale,
+                        const float* block_back_scores,
+                        int num_state_bits,
+                        const BeamFrontElement* prev_front,
+                        const float* prev_scores,
+                        size_t beam_width,
+                        BeamFrontElement* new_front,
+                        float* new_scores,
+                        HashPresentBits& step_hash_present) {
+    return expand_steps_generic(block_scores, score_scale, block_back_scores, num_state_bits,
+                                prev_front, prev_scores, beam_width, new_front, new_scores,
+                                step_hash_present);
+}
+
+#if ENABLE_AVX2_IMPL
+// AVX2 implementation which expands 2 previous elements into 8 candidates at once, with one
+// previous element per 128 bit lane.  The scores are gathered, the CRC32C hashes are updated in
+// parallel across the lanes, and the candidates are interleaved back into BeamFrontElements with
+// two 256 bit stores.
+__attribute__((target("avx2"))) float expand_steps_impl(const float* block_scores,
+                                                        float score_scale,
+                                                        const float* block_back_scores,
+                                                        int num_state_bits,
+                                                        const BeamFrontElement* prev_front,
+                                                        const float* prev_scores,
+                                                        size_t beam_width,
+                                                        BeamFrontElement* new_front,
+                                                        float* new_scores,
+                                                        HashPresentBits& step_hash_present) {
+    const int states_mask = (1 << num_state_bits) - 1;
+    const int move_shift = num_state_bits - NUM_BASE_BITS;
+    const __m256 scale_x8 = _mm256_set1_ps(score_scale);
+    const __m256i bases_x8 = _mm256_setr_epi32(0, 1, 2, 3, 0, 1, 2, 3);
+    const __m256i polynomial_x8 = _mm256_set1_epi32(int(0x82f63b78u));
+    const __m256i one_x8 = _mm256_set1_epi32(1);
+    const __m256i zero_x8 = _mm256_setzero_si256();
+    __m256 max_score_x8 = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+    alignas(32) uint32_t new_hashes[8];
+
+    size_t prev_elem_idx = 0;
+    for (; prev_elem_idx + 2 <= beam_width; prev_elem_idx += 2) {
+        const auto& element_a = prev_front[prev_elem_idx];
+        const auto& element_b = prev_front[prev_elem_idx + 1];
+        const int state_base_a = (element_a.state << NUM_BASE_BITS) & states_mask;
+        const int state_base_b = (element_b.state << NUM_BASE_BITS) & states_mask;
+        const int move_base_a = element_a.state >> move_shift;
+        const int move_base_b = element_b.state >> move_shift;
+
+        const __m256i new_states_x8 = _mm256_or_si256(
+                _mm256_setr_epi32(state_base_a, state_base_a, state_base_a, state_base_a,
+                                  state_base_b, state_base_b, state_base_b, state_base_b),
+                bases_x8);
+        const __m256i move_idxs_x8 =
+                _mm256_add_epi32(_mm256_slli_epi32(new_states_x8, NUM_BASE_BITS),
+                                 _mm256_setr_epi32(move_base_a, move_base_a, move_base_a,
+                                                   move_base_a, move_base_b, move_base_b,
+                                                   move_base_b, move_base_b));
+
+        // The back scores for the 4 candidates of an element are contiguous.
+        const __m256 back_scores_x8 =
+                _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(
+                                             block_back_scores + state_base_a)),
+                                     _mm_loadu_ps(block_back_scores + state_base_b), 1);
+        const __m256 move_scores_x8 = _mm256_i32gather_ps(block_scores, move_idxs_x8, 4);
+        const __m256 prev_scores_x8 = _mm256_insertf128_ps(
+                _mm256_set1_ps(prev_scores[prev_elem_idx]),
+                _mm_set1_ps(prev_scores[prev_elem_idx + 1]), 1);
+        // Same order of operations as the generic version, so the results are identical.
+        const __m256 new_scores_x8 = _mm256_add_ps(
+                _mm256_add_ps(prev_scores_x8, _mm256_mul_ps(move_scores_x8, scale_x8)),
+                back_scores_x8);
+        max_score_x8 = _mm256_max_ps(max_score_x8, new_scores_x8);
+
+        // crc32c<NUM_BASE_BITS>, one candidate per lane.
+        __m256i hashes_x8 = _mm256_insertf128_si256(
+                _mm256_set1_epi32(int(element_a.hash)), _mm_set1_epi32(int(element_b.hash)), 1);
+        __m256i new_bits_x8 = bases_x8;
+        for (int i = 0; i < NUM_BASE_BITS; ++i) {
+            const __m256i low_bits_x8 =
+                    _mm256_and_si256(_mm256_xor_si256(new_bits_x8, hashes_x8), one_x8);
+            hashes_x8 = _mm256_srli_epi32(hashes_x8, 1);
+            hashes_x8 = _mm256_xor_si256(
+                    hashes_x8,
+                    _mm256_and_si256(polynomial_x8, _mm256_sub_epi32(zero_x8, low_bits_x8)));
+            new_bits_x8 = _mm256_srli_epi32(new_bits_x8, 1);
+        }
+
+        // The upper word of each element holds state, prev_element_index and stay (false).
+        const __m256i upper_words_x8 = _mm256_or_si256(
+                new_states_x8,
+                _mm256_insertf128_si256(_mm256_set1_epi32(int(prev_elem_idx << 16)),
+                                        _mm_set1_epi32(int((prev_elem_idx + 1) << 16)), 1));
+        const __m256i interleaved_lo = _mm256_unpacklo_epi32(hashes_x8, upper_words_x8);
+        const __m256i interleaved_hi = _mm256_unpackhi_epi32(hashes_x8, upper_words_x8);
+        auto* const front_ptr = reinterpret_cast<__m256i*>(new_front + (prev_elem_idx << 2));
+        _mm256_storeu_si256(front_ptr, _mm256_permute2x128_si256(interleaved_lo, interleaved_hi,
+                                                                  0x20));
+        _mm256_storeu_si256(front_ptr + 1, _mm256_permute2x128_si256(interleaved_lo,
+                                                                      interleaved_hi, 0x31));
+        _mm256_storeu_ps(new_scores + (prev_elem_idx << 2), new_scores_x8);
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(new_hashes), hashes_x8);
+        for (uint32_t new_hash : new_hashes) {
+            step_hash_present[new_hash & HASH_PRESENT_MASK] = true;
+        }
+    }
+
+    // Horizontal max.
+    __m128 max_score_x4 = _mm_max_ps(_mm256_castps256_ps128(max_score_x8),
+                                     _mm256_extractf128_ps(max_score_x8, 1));
+    max_score_x4 = _mm_max_ps(max_score_x4, _mm_movehl_ps(max_score_x4, max_score_x4));
+    max_score_x4 = _mm_max_ss(max_score_x4, _mm_shuffle_ps(max_score_x4, max_score_x4, 1));
+    float max_score = _mm_cvtss_f32(max_score_x4);
+
+    for (; prev_elem_idx < beam_width; ++prev_elem_idx) {
+        max_score = std::max(max_score,
+                             expand_element(block_scores, score_scale, block_back_scores,
+                                            num_state_bits, prev_front, prev_scores, prev_elem_idx,
+                                            new_front, new_scores, step_hash_present));
+    }
+    return max_score;
+}
+#endif
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+size_t find_matching_steps_impl(const BeamFrontElement* front,
+                                size_t beam_width,
+                                int latest_base,
+                                uint32_t hash,
+                                uint16_t* matches) {
+    return find_matching_steps_generic(front, beam_width, latest_base, hash, matches);
+}
+
+#if ENABLE_AVX2_IMPL
+// AVX2 implementation which gathers the hashes of the steps of 8 previous elements at once.
+__attribute__((target("avx2"))) size_t find_matching_steps_impl(const BeamFrontElement* front,
+                                                                size_t beam_width,
+                                                                int latest_base,
+                                                                uint32_t hash,
+                                                                uint16_t* matches) {
+    // Offsets, in 32 bit words, of the hashes of the steps of consecutive previous elements.
+    constexpr int kWordsPerElement = sizeof(BeamFrontElement) / sizeof(int);
+    constexpr int kWordsPerStep = kWordsPerElement * NUM_BASES;
+    const __m256i offsets_x8 = _mm256_add_epi32(
+            _mm256_setr_epi32(0, kWordsPerStep, 2 * kWordsPerStep, 3 * kWordsPerStep,
+                              4 * kWordsPerStep, 5 * kWordsPerStep, 6 * kWordsPerStep,
+                              7 * kWordsPerStep),
+            _mm256_set1_epi32(latest_base * kWordsPerElement));
+    const __m256i hash_x8 = _mm256_set1_epi32(int(hash));
+    const int* const words = reinterpret_cast<const int*>(front);
+
+    size_t num_matches = 0;
+    size_t prev_elem_comp_idx = 0;
+    for (; prev_elem_comp_idx + 8 <= beam_width; prev_elem_comp_idx += 8) {
+        const __m256i hashes_x8 = _mm256_i32gather_epi32(
+                words + prev_elem_comp_idx * kWordsPerStep, offsets_x8, sizeof(int));
+        auto match_mask = static_cast<uint32_t>(
+                _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(hashes_x8, hash_x8))));
+        while (match_mask) {
+            const size_t lane = __builtin_ctz(match_mask);
+            matches[num_matches++] =
+                    uint16_t(((prev_elem_comp_idx + lane) << NUM_BASE_BITS) | latest_base);
+            match_mask &= match_mask - 1;
+        }
+    }
+    for (; prev_elem_comp_idx < beam_width; prev_elem_comp_idx++) {
+        size_t step_elem_idx = (prev_elem_comp_idx << NUM_BASE_BITS) | latest_base;
+        if (front[step_elem_idx].hash == hash) {
+            matches[num_matches++] = uint16_t(step_elem_idx);
+        }
+    }
+    return num_matches;
+}
+#endif
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+size_t count_scores_above_cutoff_impl(const float* scores, size_t num_scores, float cutoff) {
+#if ENABLE_NEON_IMPL
+    size_t elem_count = 0;
+    const float* score_ptr = scores;
+    uint32x4_t counts_x4_a = vdupq_n_u32(0u);
+    uint32x4_t counts_x4_b = vdupq_n_u32(0u);
+    const float32x4_t cutoff_x4 = vdupq_n_f32(cutoff);
+
+    // 8 fold unrolled version has the small upside that both loads
+    // can be done with a single ldp instruction.
+    const int kUnroll = 8;
+    for (int i = int(num_scores) / kUnroll; i; --i) {
+        // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
+        // which we subtract to increment our counts.
+        float32x4_t scores_x4_a = vld1q_f32(score_ptr);
+        uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
+        counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
+
+        float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
+        uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
+        counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
+
+        score_ptr += 8;
+    }
+    // Add together the result of 2 horizontal adds.
+    elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
+    for (int i = num_scores % kUnroll; i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++elem_count;
+        }
+        ++score_ptr;
+    }
+    return elem_count;
+#else
+    return count_scores_above_cutoff_generic(scores, num_scores, cutoff);
+#endif
+}
+
+#if ENABLE_AVX2_IMPL
+// AVX2 implementation, counting 16 scores per iteration with 2 independent accumulators.
+__attribute__((target("avx2"))) size_t count_scores_above_cutoff_impl(const float* scores,
+                                                                      size_t num_scores,
+                                                                      float cutoff) {
+    const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+    __m256i counts_x8_a = _mm256_setzero_si256();
+    __m256i counts_x8_b = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 16 <= num_scores; i += 16) {
+        // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
+        // which we subtract to increment our counts.
+        const __m256 comparisons_x8_a =
+                _mm256_cmp_ps(_mm256_loadu_ps(scores + i), cutoff_x8, _CMP_GE_OQ);
+        counts_x8_a = _mm256_sub_epi32(counts_x8_a, _mm256_castps_si256(comparisons_x8_a));
+        const __m256 comparisons_x8_b =
+                _mm256_cmp_ps(_mm256_loadu_ps(scores + i + 8), cutoff_x8, _CMP_GE_OQ);
+        counts_x8_b = _mm256_sub_epi32(counts_x8_b, _mm256_castps_si256(comparisons_x8_b));
+    }
+
+    // Horizontal add.
+    const __m256i counts_x8 = _mm256_add_epi32(counts_x8_a, counts_x8_b);
+    __m128i counts_x4 = _mm_add_epi32(_mm256_castsi256_si128(counts_x8),
+                                      _mm256_extracti128_si256(counts_x8, 1));
+    counts_x4 = _mm_add_epi32(counts_x4, _mm_shuffle_epi32(counts_x4, 0x4e));
+    counts_x4 = _mm_add_epi32(counts_x4, _mm_shuffle_epi32(counts_x4, 0xb1));
+    size_t elem_count = size_t(_mm_cvtsi128_si32(counts_x4));
+
+    for (; i < num_scores; ++i) {
+        if (scores[i] >= cutoff) {
+            ++elem_count;
+        }
+    }
+    return elem_count;
+}
+#endif
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+size_t select_above_cutoff_impl(const BeamFrontElement* front,
+                                const float* scores,
+                                size_t num_elements,
+                                float cutoff,
+                                size_t max_count,
+                                BeamFrontElement* selected_front,
+                                float* selected_scores) {
+    return select_above_cutoff_generic(front, scores, num_elements, cutoff, max_count,
+                                       selected_front, selected_scores);
+}
+
+#if ENABLE_AVX2_IMPL
+// AVX2 implementation which compares 8 scores at once, so that runs of scores below the cutoff
+// are skipped without branching on each one.
+__attribute__((target("avx2"))) size_t select_above_cutoff_impl(const BeamFrontElement* front,
+                                                                const float* scores,
+                                                                size_t num_elements,
+                                                                float cutoff,
+                                                                size_t max_count,
+                                                                BeamFrontElement* selected_front,
+                                                                float* selected_scores) {
+    const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+    size_t write_idx = 0;
+    size_t read_idx = 0;
+    if (max_count == 0) {
+        return 0;
+    }
+    for (; read_idx + 8 <= num_elements; read_idx += 8) {
+        auto selected_mask = static_cast<uint32_t>(_mm256_movemask_ps(
+                _mm256_cmp_ps(_mm256_loadu_ps(scores + read_idx), cutoff_x8, _CMP_GE_OQ)));
+        while (selected_mask) {
+            const size_t idx = read_idx + __builtin_ctz(selected_mask);
+            selected_front[write_idx] = front[idx];
+            selected_scores[write_idx] = scores[idx];
+            if (++write_idx == max_count) {
+                return write_idx;
+            }
+            selected_mask &= selected_mask - 1;
+        }
+    }
+    for (; read_idx < num_elements && write_idx < max_count; ++read_idx) {
+        if (scores[read_idx] >= cutoff) {
+            selected_front[write_idx] = front[read_idx];
+            selected_scores[write_idx] = scores[read_idx];
+            ++write_idx;
+        }
+    }
+    return write_idx;
+}
+#endif
+
+}  // namespace
+
+float expand_steps(const float* block_scores,
+                   float score_scale,
+                   const float* block_back_scores,
+                   int num_state_bits,
+                   const BeamFrontElement* prev_front,
+                   const float* prev_scores,
+                   size_t beam_width,
+                   BeamFrontElement* new_front,
+                   float* new_scores,
+                   HashPresentBits& step_hash_present) {
+    return expand_steps_impl(block_scores, score_scale, block_back_scores, num_state_bits,
+                             prev_front, prev_scores, beam_width, new_front, new_scores,
+                             step_hash_present);
+}
+
+size_t find_matching_steps(const BeamFrontElement* front,
+                           size_t beam_width,
+                           int latest_base,
+                           uint32_t hash,
+                           uint16_t* matches) {
+    return find_matching_steps_impl(front, beam_width, latest_base, hash, matches);
+}
+
+size_t count_scores_above_cutoff(const float* scores, size_t num_scores, float cutoff) {
+    return count_scores_above_cutoff_impl(scores, num_scores, cutoff);
+}
+
+size_t select_above_cutoff(const BeamFrontElement* front,
+                           const float* scores,
+                           size_t num_elements,
+                           float cutoff,
+                           size_t max_count,
+                           BeamFrontElement* selected_front,
+                           float* selected_scores) {
+    return select_above_cutoff_impl(front, scores, num_elements, cutoff, max_count, selected_front,
+                                    selected_scores);
+}
+
+}  // namespace dorado::basecall::decode::details
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// Inner loops of the CPU beam search, split out so that vectorised versions can be selected at
+// runtime and checked against the generic versions.  The generic versions define the expected
+// results, which the vectorised versions reproduce exactly.
+namespace dorado::basecall::decode::details {
+
+// 16 bit state supports 7-mers with 4 bases.
+using state_t = uint16_t;
+
+constexpr int NUM_BASE_BITS = 2;
+constexpr int NUM_BASES = 1 << NUM_BASE_BITS;
+
+// This is the data we need to retain for only the previous timestep (block) in the beam
+// (and what we construct for the new timestep)
+struct BeamFrontElement {
+    uint32_t hash;
+    state_t state;
+    uint8_t prev_element_index;
+    bool stay;
+};
+static_assert(sizeof(BeamFrontElement) == 8, "Vectorised kernels rely on the element layout");
+
+// Essentially a k=1 Bloom filter, indicating the presence of steps with particular
+// sequence hashes.
+constexpr uint32_t HASH_PRESENT_BITS = 4096;
+constexpr uint32_t HASH_PRESENT_MASK = HASH_PRESENT_BITS - 1;
+using HashPresentBits = std::bitset<HASH_PRESENT_BITS>;
+
+// Incorporates NUM_NEW_BITS into a Castagnoli CRC32, aka CRC32C
+// (not the same polynomial as CRC32 as used in zip/ethernet).
+template <int NUM_NEW_BITS>
+uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
+    // Note that this is the reversed polynomial.
+    constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
+    for (int i = 0; i < NUM_NEW_BITS; ++i) {
+        auto b = (new_bits ^ crc) & 1;
+        crc >>= 1;
+        if (b)
+            crc ^= POLYNOMIAL;
+        new_bits >>= 1;
+    }
+    return crc;
+}
+
+// Writes the NUM_BASES step candidates of each of the beam_width previous elements, in order, to
+// new_front/new_scores, and marks their hashes in step_hash_present.
+// Returns the maximum candidate score.
+template <typename T>
+float expand_steps_generic(const T* block_scores,
+                           float score_scale,
+                           const float* block_back_scores,
+                           int num_state_bits,
+                           const BeamFrontElement* prev_front,
+                           const float* prev_scores,
+                           size_t beam_width,
+                           BeamFrontElement* new_front,
+                           float* new_scores,
+                           HashPresentBits& step_hash_present);
+float expand_steps(const float* block_scores,
+                   float score_scale,
+                   const float* block_back_scores,
+                   int num_state_bits,
+                   const BeamFrontElement* prev_front,
+                   const float* prev_scores,
+                   size_t beam_width,
+                   BeamFrontElement* new_front,
+                   float* new_scores,
+                   HashPresentBits& step_hash_present);
+
+// Writes the indices of the step candidates among the first beam_width * NUM_BASES elements of
+// front which end in latest_base and have the given hash, in increasing order.
+// Returns the number of matches.
+size_t find_matching_steps_generic(const BeamFrontElement* front,
+                                   size_t beam_width,
+                                   int latest_base,
+                                   uint32_t hash,
+                                   uint16_t* matches);
+size_t find_matching_steps(const BeamFrontElement* front,
+                           size_t beam_width,
+                           int latest_base,
+                           uint32_t hash,
+                           uint16_t* matches);
+
+// Returns the number of scores which meet the cutoff.
+size_t count_scores_above_cutoff_generic(const float* scores, size_t num_scores, float cutoff);
+size_t count_scores_above_cutoff(const float* scores, size_t num_scores, float cutoff);
+
+// Copies the first max_count elements whose scores meet the cutoff, in order, to
+// selected_front/selected_scores.  Returns the number of elements copied.
+size_t select_above_cutoff_generic(const BeamFrontElement* front,
+                                   const float* scores,
+                                   size_t num_elements,
+                                   float cutoff,
+                                   size_t max_count,
+                                   BeamFrontElement* selected_front,
+                                   float* selected_scores);
+size_t select_above_cutoff(const BeamFrontElement* front,
+                           const float* scores,
+                           size_t num_elements,
+                           float cutoff,
+                           size_t max_count,
+                           BeamFrontElement* selected_front,
+                           float* selected_scores);
+
+}  // namespace dorado::basecall::decode::details
@@ -1,6 +1,8 @@
 #include "Version.h"
 #include "alignment/IndexFileAccess.h"
+#include "cli/cli.h"
 #include "cli/cli_utils.h"
+#include "cli/daemon.h"
 #include "read_pipeline/AlignerNode.h"
 #include "read_pipeline/HtsReader.h"
 #include "read_pipeline/HtsWriter.h"
@@ -32,8 +34,13 @@ void add_pg_hdr(sam_hdr_t* hdr) {
                      MM_VERSION, NULL);
 }
 
-int aligner(int argc, char* argv[]) {
-    utils::InitLogging();
+namespace {
+
+// Runs the aligner, either standalone or as a job inside a daemon if daemon_job is set.
+int run_aligner(int argc, char* argv[], cli::DaemonJob* daemon_job) {
+    if (!daemon_job) {
+        utils::InitLogging();
+    }
 
     cli::ArgParser parser("dorado");
     parser.visible.add_description(
@@ -43,8 +50,17 @@ int aligner(int argc, char* argv[]) {
             "parameter names are not finalized and may change.");
     parser.visible.add_argument("index").help("reference in (fastq/fasta/mmi).");
     parser.visible.add_argument("reads")
-            .help("any HTS format.")
+            .help("any HTS format, or directories of HTS files.")
             .nargs(argparse::nargs_pattern::any);
+    // No short form, since minimap2 uses -r for the bandwidth.
+    parser.visible.add_argument("--recursive")
+            .help("search input directories recursively.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.visible.add_argument("--ordered")
+            .help("write records in input order, reading input files one at a time.")
+            .default_value(false)
+            .implicit_value(true);
     parser.visible.add_argument("-t", "--threads")
             .help("number of threads for alignment and BAM writing.")
             .default_value(0)
@@ -53,6 +69,10 @@ int aligner(int argc, char* argv[]) {
             .help("maximum number of reads to process (for debugging, 0=unlimited).")
             .default_value(0)
             .scan<'i', int>();
+    parser.visible.add_argument("--daemon-socket")
+            .help("submit the job to the `dorado daemon` listening on this socket, which keeps "
+                  "indexes loaded between jobs.")
+            .default_value(std::string());
     int verbosity = 0;
     parser.visible.add_argument("-v", "--verbose")
             .default_value(false)
@@ -61,27 +81,91 @@ int aligner(int argc, char* argv[]) {
             .action([&](const auto&) { ++verbosity; })
             .append();
 
+    cli::add_output_shard_arguments(parser.visible);
     cli::add_minimap2_arguments(parser, alignment::dflt_options);
 
     try {
         cli::parse(parser, argc, argv);
     } catch (const std::exception& e) {
+        if (daemon_job) {
+            throw;
+        }
         std::ostringstream parser_stream;
         parser_stream << parser.visible;
         spdlog::error("{}\n{}", e.what(), parser_stream.str());
         std::exit(1);
     }
 
+    // Daemon jobs run alongside each other, so only their own logger is made verbose.
+    auto& logger = daemon_job ? *daemon_job->logger : *spdlog::default_logger_raw();
     if (parser.visible.get<bool>("--verbose")) {
-        mm_verbose = 3;
-        utils::SetVerboseLogging(static_cast<dorado::utils::VerboseLogLevel>(verbosity));
+        const auto level = static_cast<dorado::utils::VerboseLogLevel>(verbosity);
+        if (daemon_job) {
+            logger.set_level(level >= utils::VerboseLogLevel::TRACE ? spdlog::level::trace
+                                                                    : spdlog::level::debug);
+        } else {
+            mm_verbose = 3;
+            utils::SetVerboseLogging(level);
+        }
+    }
+
+    auto daemon_socket(parser.visible.get<std::string>("daemon-socket"));
+    if (!daemon_socket.empty() && !daemon_job) {
+        // The daemon has a different working directory, so pass it absolute paths.
+        auto index_arg = parser.visible.get<std::string>("index");
+        auto reads_args = parser.visible.get<std::vector<std::string>>("reads");
+#ifndef _WIN32
+        if (reads_args.empty() && isatty(fileno(stdin))) {
+            std::cout << parser.visible << std::endl;
+            return 1;
+        }
+#endif
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg(argv[i]);
+            if (arg == "--daemon-socket") {
+                ++i;
+                continue;
+            }
+            if (arg.rfind("--daemon-socket=", 0) == 0) {
+                continue;
+            }
+            // The output files don't exist yet, so this path is always made absolute.
+            const std::string shard_output_prefix = "--shard-output=";
+            if (arg == "--shard-output" && i + 1 < argc) {
+                args.push_back(std::move(arg));
+                args.push_back(std::filesystem::absolute(argv[++i]).string());
+                continue;
+            }
+            if (arg.rfind(shard_output_prefix, 0) == 0 && arg.size() > shard_output_prefix.size()) {
+                const auto path = arg.substr(shard_output_prefix.size());
+                args.push_back(shard_output_prefix + std::filesystem::absolute(path).string());
+                continue;
+            }
+            bool is_path = arg == index_arg ||
+                           std::find(reads_args.begin(), reads_args.end(), arg) != reads_args.end();
+            if (is_path && std::filesystem::exists(arg)) {
+                arg = std::filesystem::absolute(arg).string();
+            }
+            args.push_back(std::move(arg));
+        }
+        return cli::submit_daemon_job(daemon_socket, "aligner", args);
     }
 
     auto index(parser.visible.get<std::string>("index"));
     auto reads(parser.visible.get<std::vector<std::string>>("reads"));
     auto threads(parser.visible.get<int>("threads"));
     auto max_reads(parser.visible.get<int>("max-reads"));
+    auto ordered(parser.visible.get<bool>("--ordered"));
     auto options = cli::process_minimap2_arguments(parser, alignment::dflt_options);
+    auto shard_output(parser.visible.get<std::string>("--shard-output"));
+    OutputShardOptions shard_options;
+    try {
+        shard_options = cli::process_output_shard_arguments<OutputShardOptions>(parser.visible);
+    } catch (const std::exception& e) {
+        logger.error("{}", e.what());
+        return 1;
+    }
     threads = threads == 0 ? std::thread::hardware_concurrency() : threads;
     // The input thread is the total number of threads to use for dorado
     // alignment. Heuristically use 10% of threads for BAM generation and
@@ -89,46 +173,63 @@ int aligner(int argc, char* argv[]) {
     int aligner_threads, writer_threads;
     std::tie(aligner_threads, writer_threads) =
             cli::worker_vs_writer_thread_allocation(threads, 0.1f);
-    spdlog::debug("> aligner threads {}, writer threads {}", aligner_threads, writer_threads);
+    logger.debug("> aligner threads {}, writer threads {}", aligner_threads, writer_threads);
 
     if (reads.size() == 0) {
 #ifndef _WIN32
-        if (isatty(fileno(stdin))) {
+        if (!daemon_job && isatty(fileno(stdin))) {
             std::cout << parser.visible << std::endl;
             return 1;
         }
 #endif
         reads.push_back("-");
-    } else if (reads.size() > 1) {
-        spdlog::error("> multi file input not yet handled");
+    }
+
+    if (daemon_job && reads.size() == 1 && reads[0] == "-") {
+        reads[0] = daemon_job->input_path;
+    }
+    reads = get_hts_input_files(reads, parser.visible.get<bool>("--recursive"));
+    if (reads.empty()) {
+        logger.error("> no input files found");
         return 1;
     }
 
-    spdlog::info("> loading index {}", index);
+    logger.info("> loading index {}", index);
 
-    HtsReader reader(reads[0], std::nullopt);
-    spdlog::debug("> input fmt: {} aligned: {}", reader.format, reader.is_aligned);
-    auto header = sam_hdr_dup(reader.header);
+    MultiHtsReader reader(reads, std::nullopt);
+    logger.debug("> input files: {} aligned: {}", reads.size(), reader.is_aligned);
+    auto header = sam_hdr_dup(reader.header());
     add_pg_hdr(header);
 
+    // Output files are always BAM, whatever stdout is.
+    auto output_path = shard_output;
     auto output_mode = HtsWriter::OutputMode::BAM;
-    if (utils::is_fd_tty(stdout)) {
-        output_mode = HtsWriter::OutputMode::SAM;
-    } else if (utils::is_fd_pipe(stdout)) {
-        output_mode = HtsWriter::OutputMode::UBAM;
+    if (output_path.empty()) {
+        output_path = daemon_job ? daemon_job->output_path : "-";
+        if (daemon_job ? daemon_job->output_is_tty : utils::is_fd_tty(stdout)) {
+            output_mode = HtsWriter::OutputMode::SAM;
+        } else if (daemon_job ? daemon_job->output_is_pipe : utils::is_fd_pipe(stdout)) {
+            output_mode = HtsWriter::OutputMode::UBAM;
+        }
     }
 
     PipelineDescriptor pipeline_desc;
-    auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, writer_threads);
-    auto index_file_access = std::make_shared<alignment::IndexFileAccess>();
+    auto hts_writer = pipeline_desc.add_node<HtsWriter>(
+            {}, output_path, output_mode, writer_threads,
+            ordered ? HtsWriter::DEFAULT_REORDER_BUFFER_SIZE : 0, shard_options);
+    // Jobs run by a daemon share its index cache, so the index is only loaded by the first job.
+    auto index_file_access = daemon_job ? daemon_job->index_file_access
+                                        : std::make_shared<alignment::IndexFileAccess>();
     auto aligner = pipeline_desc.add_node<AlignerNode>({hts_writer}, index_file_access, index,
                                                        options, aligner_threads);
 
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters;
-    auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
     if (pipeline == nullptr) {
-        spdlog::error("Failed to create pipeline");
+        logger.error("Failed to create pipeline");
+        if (daemon_job) {
+            return EXIT_FAILURE;
+        }
         std::exit(EXIT_FAILURE);
     }
 
@@ -142,14 +243,20 @@ int aligner(int argc, char* argv[]) {
     // Set up stats counting
     std::vector<dorado::stats::StatsCallable> stats_callables;
     ProgressTracker tracker(0, false);
-    stats_callables.push_back(
-            [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
+    if (!daemon_job) {
+        // Progress is read from the pipeline's counters, so no node stats need to be sampled.
+        stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+            tracker.update_progress_bar(pipeline->counters());
+        });
+    }
     constexpr auto kStatsPeriod = 100ms;
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
-            kStatsPeriod, stats_reporters, stats_callables, static_cast<size_t>(0));
+            kStatsPeriod, std::vector<stats::StatsReporter>(), stats_callables,
+            static_cast<size_t>(0));
 
-    spdlog::info("> starting alignment");
-    reader.read(*pipeline, max_reads);
+    logger.info("> starting alignment");
+    // Read as many files at once as there are writer threads, as both are bound by compression.
+    reader.read(*pipeline, max_reads, writer_threads, ordered);
 
     // Wait for the pipeline to complete.  When it does, we collect
     // final stats to allow accurate summarisation.
@@ -158,13 +265,30 @@ int aligner(int argc, char* argv[]) {
     // Stop the stats sampler thread before tearing down any pipeline objects.
     stats_sampler->terminate();
 
-    tracker.update_progress_bar(final_stats);
+    if (daemon_job) {
+        // Reported back to the client rather than shown by the daemon.
+        daemon_job->stats = std::move(final_stats);
+        daemon_job->stats["job_total"] = double(hts_writer_ref.get_total());
+        daemon_job->stats["job_primary"] = double(hts_writer_ref.get_primary());
+        daemon_job->stats["job_unmapped"] = double(hts_writer_ref.get_unmapped());
+        return 0;
+    }
+
+    tracker.update_progress_bar(pipeline->counters());
     tracker.summarize();
 
-    spdlog::info("> finished alignment");
-    spdlog::info("> total/primary/unmapped {}/{}/{}", hts_writer_ref.get_total(),
-                 hts_writer_ref.get_primary(), hts_writer_ref.get_unmapped());
+    logger.info("> finished alignment");
+    logger.info("> total/primary/unmapped {}/{}/{}", hts_writer_ref.get_total(),
+                hts_writer_ref.get_primary(), hts_writer_ref.get_unmapped());
     return 0;
 }
 
+}  // namespace
+
+int aligner(int argc, char* argv[]) { return run_aligner(argc, argv, nullptr); }
+
+int aligner_daemon_job(int argc, char* argv[], cli::DaemonJob& job) {
+    return run_aligner(argc, argv, &job);
+}
+
 }  // namespace dorado
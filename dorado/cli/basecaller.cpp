@@ -15,14 +15,18 @@
 #include "read_pipeline/PolyACalculator.h"
 #include "read_pipeline/ProgressTracker.h"
 #include "read_pipeline/ReadFilterNode.h"
+#include "read_pipeline/ReadQCStatsNode.h"
 #include "read_pipeline/ReadToBamTypeNode.h"
 #include "read_pipeline/ResumeLoaderNode.h"
+#include "read_pipeline/SignalCache.h"
 #include "utils/SampleSheet.h"
+#include "utils/SignalBufferPool.h"
 #include "utils/bam_utils.h"
 #include "utils/barcode_kits.h"
 #include "utils/basecaller_utils.h"
 #include "utils/fs_utils.h"
 #include "utils/log_utils.h"
+#include "utils/memory_utils.h"
 #include "utils/parameters.h"
 #include "utils/stats.h"
 #include "utils/string_utils.h"
@@ -60,10 +64,13 @@ void setup(std::vector<std::string> args,
            size_t overlap,
            size_t batch_size,
            size_t num_runners,
+           size_t cpu_threads_per_caller,
            size_t remora_batch_size,
            size_t num_remora_threads,
            float methylation_threshold_pct,
            HtsWriter::OutputMode output_mode,
+           const std::string& output_path,
+           const OutputShardOptions& shard_options,
            bool emit_moves,
            size_t max_reads,
            size_t min_qscore,
@@ -84,6 +91,11 @@ void setup(std::vector<std::string> args,
            const std::optional<std::string>& custom_seqs,
            argparse::ArgumentParser& resume_parser,
            bool estimate_poly_a,
+           bool split_before_basecall,
+           bool trim_open_pore,
+           const std::string& qc_stats_file,
+           const std::string& signal_cache_dir,
+           bool use_huge_pages,
            const ModelSelection& model_selection) {
     const auto model_config = basecall::load_crf_model_config(model_path);
     const std::string model_name = models::extract_model_name_from_path(model_path);
@@ -122,8 +134,9 @@ void setup(std::vector<std::string> args,
                                                  default_parameters.mod_base_runners_per_caller,
                                                  remora_batch_size);
 
-    auto [runners, num_devices] = create_basecall_runners(model_config, device, num_runners, 0,
-                                                          batch_size, chunk_size, 1.f, false);
+    auto [runners, num_devices] =
+            create_basecall_runners(model_config, device, num_runners, 0, cpu_threads_per_caller,
+                                    batch_size, chunk_size, 1.f, false);
 
     auto read_groups = DataLoader::load_read_groups(data_path, model_name, modbase_model_names,
                                                     recursive_file_loading);
@@ -146,8 +159,8 @@ void setup(std::vector<std::string> args,
     utils::add_rg_hdr(hdr.get(), read_groups, barcode_kits, sample_sheet.get());
 
     PipelineDescriptor pipeline_desc;
-    auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode,
-                                                        thread_allocations.writer_threads);
+    auto hts_writer = pipeline_desc.add_node<HtsWriter>(
+            {}, output_path, output_mode, thread_allocations.writer_threads, 0, shard_options);
     auto aligner = PipelineDescriptor::InvalidNodeHandle;
     auto current_sink_node = hts_writer;
     if (enable_aligner) {
@@ -160,6 +173,10 @@ void setup(std::vector<std::string> args,
     current_sink_node = pipeline_desc.add_node<ReadToBamType>(
             {current_sink_node}, emit_moves, thread_allocations.read_converter_threads,
             methylation_threshold_pct, std::move(sample_sheet), 1000);
+    if (!qc_stats_file.empty()) {
+        current_sink_node =
+                pipeline_desc.add_node<ReadQCStatsNode>({current_sink_node}, qc_stats_file, 1000);
+    }
     if (estimate_poly_a) {
         current_sink_node = pipeline_desc.add_node<PolyACalculator>(
                 {current_sink_node}, std::thread::hardware_concurrency(),
@@ -182,16 +199,54 @@ void setup(std::vector<std::string> args,
 
     auto mean_qscore_start_pos = model_config.mean_qscore_start_pos;
 
+    std::shared_ptr<SignalCache> signal_cache;
+    if (!signal_cache_dir.empty()) {
+        // Reads split before scaling don't correspond to the reads in the input files.
+        if (is_rna_model(model_config) || split_before_basecall) {
+            spdlog::warn(
+                    "> Signal caching isn't supported for RNA or with --split-before-basecall, "
+                    "ignoring --signal-cache");
+        } else {
+            signal_cache = std::make_shared<SignalCache>(
+                    signal_cache_dir,
+                    SignalCache::make_key(model_config.signal_norm_params,
+                                          model_config.sample_type, !adapter_no_trim,
+                                          trim_open_pore));
+        }
+    }
+
+    // Signal buffers freed by reads which have been basecalled are reused by those being loaded.
+    // The free buffers kept are limited to a small share of the memory available, so that the
+    // pool doesn't hold on to memory the basecall runners sized themselves to use.
+    constexpr size_t kMaxFreeSignalBufferBytes = size_t{512} << 20;
+    constexpr size_t kFreeSignalBufferMemoryDivisor = 64;
+    const size_t max_free_signal_buffer_bytes =
+            std::min(kMaxFreeSignalBufferBytes,
+                     (utils::available_host_memory_GB() << 30) / kFreeSignalBufferMemoryDivisor);
+    spdlog::debug("> Keeping up to {} MiB of free signal buffers",
+                  max_free_signal_buffer_bytes >> 20);
+    auto signal_pool = std::make_shared<utils::SignalBufferPool>(max_free_signal_buffer_bytes,
+                                                                 use_huge_pages);
+
     pipelines::create_simplex_pipeline(
             pipeline_desc, std::move(runners), std::move(remora_runners), overlap,
-            mean_qscore_start_pos, !adapter_no_trim, thread_allocations.scaler_node_threads,
-            true /* Enable read splitting */, thread_allocations.splitter_node_threads,
+            mean_qscore_start_pos, !adapter_no_trim, trim_open_pore, signal_cache, signal_pool,
+            thread_allocations.scaler_node_threads,
+            true /* Enable read splitting */, split_before_basecall,
+            thread_allocations.splitter_node_threads,
             thread_allocations.remora_threads, current_sink_node,
             PipelineDescriptor::InvalidNodeHandle);
 
-    // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters{dorado::stats::sys_stats_report};
-    auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+    // Create the Pipeline from our description.  Progress is read from the pipeline's counters, so
+    // stats are only sampled when they're to be dumped.
+    const bool sample_stats = !dump_stats_file.empty();
+    std::vector<dorado::stats::StatsReporter> stats_reporters;
+    if (sample_stats) {
+        stats_reporters = {dorado::stats::sys_stats_report,
+                           dorado::stats::make_stats_reporter(*signal_pool)};
+    }
+    auto pipeline =
+            Pipeline::create(std::move(pipeline_desc), sample_stats ? &stats_reporters : nullptr);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
         std::exit(EXIT_FAILURE);
@@ -247,29 +302,35 @@ void setup(std::vector<std::string> args,
 
     std::vector<dorado::stats::StatsCallable> stats_callables;
     ProgressTracker tracker(int(num_reads), false);
-    stats_callables.push_back(
-            [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
+    stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+        tracker.update_progress_bar(pipeline->counters());
+    });
     constexpr auto kStatsPeriod = 100ms;
     const size_t max_stats_records = static_cast<size_t>(dump_stats_file.empty() ? 0 : 100000);
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
             kStatsPeriod, stats_reporters, stats_callables, max_stats_records);
 
     DataLoader loader(*pipeline, "cpu", thread_allocations.loader_threads, max_reads, read_list,
-                      reads_already_processed);
+                      reads_already_processed, signal_cache, signal_pool);
 
     // Run pipeline.
     loader.load_reads(data_path, recursive_file_loading, ReadOrder::UNRESTRICTED);
 
-    // Wait for the pipeline to complete.  When it does, we collect
-    // final stats to allow accurate summarisation.
-    auto final_stats = pipeline->terminate(DefaultFlushOptions());
+    // Wait for the pipeline to complete.  When it does, its counters
+    // are final, allowing accurate summarisation.
+    pipeline->terminate(DefaultFlushOptions());
+    // Later runs use the cache in place of the input files, so it's only saved if it holds every
+    // read in them.  Otherwise it's discarded when it's destroyed.
+    if (signal_cache && max_reads == 0 && !read_list && resume_from_file.empty()) {
+        signal_cache->finalise();
+    }
 
     // Stop the stats sampler thread before tearing down any pipeline objects.
     stats_sampler->terminate();
 
     // Then update progress tracking one more time from this thread, to
     // allow accurate summarisation.
-    tracker.update_progress_bar(final_stats);
+    tracker.update_progress_bar(pipeline->counters());
     tracker.summarize();
     if (!dump_stats_file.empty()) {
         std::ofstream stats_file(dump_stats_file);
@@ -375,6 +436,7 @@ int basecaller(int argc, char* argv[]) {
             .help("Output in SAM format.")
             .default_value(false)
             .implicit_value(true);
+    cli::add_output_shard_arguments(parser.visible);
 
     parser.visible.add_argument("--emit-moves").default_value(false).implicit_value(true);
 
@@ -418,6 +480,32 @@ int basecaller(int argc, char* argv[]) {
                   "will be disabled.")
             .default_value(false)
             .implicit_value(true);
+    parser.visible.add_argument("--split-before-basecall")
+            .help("Split DNA reads on open-pore signal before basecalling, discarding the "
+                  "open-pore samples (beta feature). Reads are still checked for concatenation "
+                  "after basecalling.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.visible.add_argument("--trim-open-pore")
+            .help("Skip basecalling of trailing and long internal open-pore signal in DNA reads "
+                  "(beta feature). Skipped internal signal is covered by zero moves in the move "
+                  "table.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.visible.add_argument("--qc-stats-file")
+            .help("Write per-read QC metrics and running length and Q-score summaries to this "
+                  "columnar file while basecalling.")
+            .default_value(std::string(""));
+    parser.visible.add_argument("--signal-cache")
+            .help("Directory in which to cache scaled and trimmed POD5 signal, so that later runs "
+                  "with a model which scales signal the same way skip loading and scaling it. "
+                  "The cache is only saved by runs which call every read, without --max-reads, "
+                  "--read-ids or --resume-from.")
+            .default_value(std::string(""));
+    parser.visible.add_argument("--huge-pages")
+            .help("Back large signal buffers with transparent huge pages, where supported.")
+            .default_value(false)
+            .implicit_value(true);
 
     cli::add_minimap2_arguments(parser, alignment::dflt_options);
     cli::add_internal_arguments(parser);
@@ -468,6 +556,14 @@ int basecaller(int argc, char* argv[]) {
 
     auto emit_fastq = parser.visible.get<bool>("--emit-fastq");
     auto emit_sam = parser.visible.get<bool>("--emit-sam");
+    auto shard_output = parser.visible.get<std::string>("--shard-output");
+    OutputShardOptions shard_options;
+    try {
+        shard_options = cli::process_output_shard_arguments<OutputShardOptions>(parser.visible);
+    } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+        std::exit(EXIT_FAILURE);
+    }
 
     if (emit_fastq && emit_sam) {
         spdlog::error("Only one of --emit-{fastq, sam} can be set (or none).");
@@ -489,9 +585,9 @@ int basecaller(int argc, char* argv[]) {
         }
         spdlog::info(" - Note: FASTQ output is not recommended as not all data can be preserved.");
         output_mode = HtsWriter::OutputMode::FASTQ;
-    } else if (emit_sam || utils::is_fd_tty(stdout)) {
+    } else if (emit_sam || (shard_output.empty() && utils::is_fd_tty(stdout))) {
         output_mode = HtsWriter::OutputMode::SAM;
-    } else if (utils::is_fd_pipe(stdout)) {
+    } else if (shard_output.empty() && utils::is_fd_pipe(stdout)) {
         output_mode = HtsWriter::OutputMode::UBAM;
     }
 
@@ -583,10 +679,11 @@ int basecaller(int argc, char* argv[]) {
         setup(args, model_path, data, mods_model_paths, parser.visible.get<std::string>("-x"),
               parser.visible.get<std::string>("--reference"), parser.visible.get<int>("-c"),
               parser.visible.get<int>("-o"), parser.visible.get<int>("-b"),
-              default_parameters.num_runners, default_parameters.remora_batchsize,
-              default_parameters.remora_threads, methylation_threshold, output_mode,
-              parser.visible.get<bool>("--emit-moves"), parser.visible.get<int>("--max-reads"),
-              parser.visible.get<int>("--min-qscore"),
+              default_parameters.num_runners, parser.hidden.get<int>("--cpu-threads-per-caller"),
+              default_parameters.remora_batchsize, default_parameters.remora_threads,
+              methylation_threshold, output_mode, shard_output.empty() ? "-" : shard_output,
+              shard_options, parser.visible.get<bool>("--emit-moves"),
+              parser.visible.get<int>("--max-reads"), parser.visible.get<int>("--min-qscore"),
               parser.visible.get<std::string>("--read-ids"), recursive,
               cli::process_minimap2_arguments(parser, alignment::dflt_options),
               parser.hidden.get<bool>("--skip-model-compatibility-check"),
@@ -597,7 +694,12 @@ int basecaller(int argc, char* argv[]) {
               parser.visible.get<bool>("--barcode-both-ends"), no_trim_barcodes, no_trim_adapters,
               no_trim_primers, parser.visible.get<std::string>("--sample-sheet"),
               std::move(custom_kit), std::move(custom_seqs), resume_parser,
-              parser.visible.get<bool>("--estimate-poly-a"), model_selection);
+              parser.visible.get<bool>("--estimate-poly-a"),
+              parser.visible.get<bool>("--split-before-basecall"),
+              parser.visible.get<bool>("--trim-open-pore"),
+              parser.visible.get<std::string>("--qc-stats-file"),
+              parser.visible.get<std::string>("--signal-cache"),
+              parser.visible.get<bool>("--huge-pages"), model_selection);
     } catch (const std::exception& e) {
         spdlog::error("{}", e.what());
         utils::clean_temporary_models(temp_download_paths);
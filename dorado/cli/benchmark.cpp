@@ -1,25 +1,36 @@
 #include "../utils/tensor_utils.h"
 #include "Version.h"
+#include "api/pipeline_creation.h"
+#include "api/runner_creation.h"
+#include "basecall/CRFModelConfig.h"
+#include "cli/cli_utils.h"
+#include "modbase/ModBaseModelConfig.h"
+#include "read_pipeline/AdapterDetectorNode.h"
+#include "read_pipeline/BarcodeClassifierNode.h"
+#include "read_pipeline/FakeDataLoader.h"
+#include "read_pipeline/NullNode.h"
+#include "utils/barcode_kits.h"
+#include "utils/log_utils.h"
+#include "utils/parameters.h"
+#include "utils/stats.h"
+#include "utils/torch_utils.h"
 
 #include <ATen/ATen.h>
 #include <argparse.hpp>
+#include <spdlog/spdlog.h>
 
+#include <array>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 namespace dorado {
 
-int benchmark(int argc, char* argv[]) {
-    argparse::ArgumentParser parser("dorado", DORADO_VERSION, argparse::default_arguments::help);
-
-    try {
-        parser.parse_args(argc, argv);
-    } catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
-        std::cerr << parser;
-        std::exit(1);
-    }
+namespace {
 
+void benchmark_quantiles() {
     std::vector<size_t> sizes{1000, 1000, 2000, 3000, 4000, 10000, 100000, 1000000, 10000000};
 
     for (auto n : sizes) {
@@ -61,11 +72,274 @@ int benchmark(int argc, char* argv[]) {
 
         std::cerr << "counting     "
                   << " q20=" << res[0].item<int>() << " q90=" << res[1].item<int>() << " "
+                  << duration << "us" << std::endl;
+
+        // counting on raw samples, with a thread-local histogram
+        const std::array<float, 2> quantiles = {0.2f, 0.9f};
+        std::array<int16_t, 2> quantile_values;
+        start = std::chrono::system_clock::now();
+        utils::quantile_counting(x.data_ptr<int16_t>(), n, quantiles.data(), quantiles.size(),
+                                 quantile_values.data());
+        end = std::chrono::system_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        std::cerr << "counting raw "
+                  << " q20=" << quantile_values[0] << " q90=" << quantile_values[1] << " "
                   << duration << "us" << std::endl
                   << std::endl;
     }
+}
+
+// Reads all the sequences in a FASTA file, concatenated.
+std::string load_fasta_sequence(const std::string& path) {
+    std::ifstream fasta(path);
+    if (!fasta) {
+        throw std::runtime_error("Unable to open reference " + path);
+    }
+    std::string sequence;
+    std::string line;
+    while (std::getline(fasta, line)) {
+        if (!line.empty() && line[0] != '>') {
+            if (line.back() == '\r') {
+                line.pop_back();
+            }
+            sequence += line;
+        }
+    }
+    return sequence;
+}
+
+// Barcode arrangements, including flanks, for each of the barcodes in a kit.
+std::vector<std::string> get_barcode_arrangements(const std::string& kit_name) {
+    const auto& kit_infos = barcode_kits::get_kit_infos();
+    auto kit_info = kit_infos.find(kit_name);
+    if (kit_info == kit_infos.end()) {
+        throw std::runtime_error(kit_name + " is not a valid barcode kit name. Please run the help "
+                                            "command to find out available barcode kits.");
+    }
+    const auto& barcodes = barcode_kits::get_barcodes();
+    std::vector<std::string> arrangements;
+    for (const auto& barcode_name : kit_info->second.barcodes) {
+        arrangements.push_back(kit_info->second.top_front_flank + barcodes.at(barcode_name) +
+                               kit_info->second.top_rear_flank);
+    }
+    return arrangements;
+}
+
+// Runs the simplex basecalling pipeline on synthetic reads, discarding the results, and reports
+// the end-to-end throughput.
+int benchmark_pipeline(const argparse::ArgumentParser& parser) {
+    const std::filesystem::path model_path(parser.get<std::string>("--model"));
+    const auto model_config = basecall::load_crf_model_config(model_path);
 
+    SyntheticReadParams params;
+    params.sample_rate = model_config.sample_rate > 0 ? model_config.sample_rate : 5000;
+    params.read_length_mean = parser.get<float>("--read-length-mean");
+    params.read_length_sd = parser.get<float>("--read-length-sd");
+    params.concatemer_fraction = parser.get<float>("--concatemer-fraction");
+    params.duplex_fraction = parser.get<float>("--duplex-fraction");
+    params.seed = parser.get<int>("--seed");
+    if (parser.get<bool>("--adapters")) {
+        // LSK114 sequencing adapter.
+        params.adapter = "CCTGTACTTCGTTCAGTTACGTATTGC";
+    }
+    const auto kit_name = parser.get<std::string>("--kit-name");
+    if (!kit_name.empty()) {
+        params.barcodes = get_barcode_arrangements(kit_name);
+    }
+    const auto reference = parser.get<std::string>("--reference");
+    if (!reference.empty()) {
+        params.reference = load_fasta_sequence(reference);
+    }
+    const auto kmer_levels_model = parser.get<std::string>("--kmer-levels");
+    if (!kmer_levels_model.empty()) {
+        auto modbase_config = modbase::load_modbase_model_config(kmer_levels_model);
+        if (modbase_config.refine_kmer_levels.empty()) {
+            throw std::runtime_error("Model " + kmer_levels_model + " has no refine kmer levels");
+        }
+        params.kmer_levels = std::move(modbase_config.refine_kmer_levels);
+        params.kmer_centre = modbase_config.refine_kmer_center_idx;
+    }
+
+    const auto device = parser.get<std::string>("-x");
+    const int cpu_threads_per_caller = parser.get<int>("--cpu-threads-per-caller");
+    auto [runners, num_devices] = create_basecall_runners(
+            model_config, device, utils::default_parameters.num_runners, 0,
+            cpu_threads_per_caller, parser.get<int>("-b"), parser.get<int>("-c"), 1.f, false);
+    // Reported with the results, so runs with different caller layouts can be compared.
+    const size_t num_runners = runners.size();
+
+    const bool adapter_detection_enabled = !params.adapter.empty();
+    const bool barcode_enabled = !kit_name.empty();
+    const auto thread_allocations = utils::default_thread_allocations(
+            int(num_devices), 0, false, barcode_enabled, adapter_detection_enabled);
+
+    PipelineDescriptor pipeline_desc;
+    auto current_sink_node = pipeline_desc.add_node<NullNode>({});
+    if (adapter_detection_enabled) {
+        current_sink_node = pipeline_desc.add_node<AdapterDetectorNode>(
+                {current_sink_node}, thread_allocations.adapter_threads, true, true);
+    }
+    if (barcode_enabled) {
+        current_sink_node = pipeline_desc.add_node<BarcodeClassifierNode>(
+                {current_sink_node}, thread_allocations.barcoder_threads,
+                std::vector<std::string>{kit_name}, false, false, BarcodingInfo::FilterSet{},
+                std::nullopt, std::nullopt);
+    }
+    pipelines::create_simplex_pipeline(
+            pipeline_desc, std::move(runners), {}, parser.get<int>("-o"),
+            model_config.mean_qscore_start_pos, adapter_detection_enabled,
+            parser.get<bool>("--trim-open-pore"), nullptr, nullptr,
+            thread_allocations.scaler_node_threads,
+            true /* Enable read splitting */, parser.get<bool>("--split-before-basecall"),
+            thread_allocations.splitter_node_threads, 0, current_sink_node,
+            PipelineDescriptor::InvalidNodeHandle);
+
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+    if (pipeline == nullptr) {
+        spdlog::error("Failed to create pipeline");
+        return EXIT_FAILURE;
+    }
+
+    // Generation of the synthetic reads is not part of the timed run.
+    const int num_reads = parser.get<int>("--num-reads");
+    spdlog::info("> Simulating {} reads", num_reads);
+    std::vector<SimplexReadPtr> reads;
+    size_t num_samples = 0;
+    SyntheticReadGenerator generator(std::move(params));
+    while (int(reads.size()) < num_reads) {
+        for (auto& synthetic_read : generator.next_reads()) {
+            if (int(reads.size()) < num_reads) {
+                num_samples += synthetic_read.read->read_common.raw_data.size(0);
+                reads.push_back(std::move(synthetic_read.read));
+            }
+        }
+    }
+
+    spdlog::info("> Running pipeline");
+    const auto start = std::chrono::steady_clock::now();
+    for (auto& read : reads) {
+        pipeline->push_message(std::move(read));
+    }
+    auto final_stats = pipeline->terminate(DefaultFlushOptions());
+    const double duration_s =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto bases = final_stats.find("BasecallerNode.bases_processed");
+    std::ostringstream summary;
+    summary << "runners: " << num_runners;
+    if (device == "cpu") {
+        summary << ", cpu threads per caller: " << cpu_threads_per_caller;
+    }
+    summary << ", reads: " << num_reads << ", samples: " << num_samples
+            << ", duration: " << duration_s << "s, reads/s: " << num_reads / duration_s
+            << ", samples/s: " << double(num_samples) / duration_s;
+    if (bases != final_stats.end()) {
+        summary << ", bases/s: " << bases->second / duration_s;
+    }
+    spdlog::info("> {}", summary.str());
+
+    const auto dump_stats_file = parser.get<std::string>("--dump-stats");
+    if (!dump_stats_file.empty()) {
+        std::ofstream stats_file(dump_stats_file);
+        for (const auto& [name, value] : final_stats) {
+            stats_file << name << "," << value << "\n";
+        }
+    }
     return 0;
 }
 
+}  // namespace
+
+int benchmark(int argc, char* argv[]) {
+    utils::InitLogging();
+    utils::make_torch_deterministic();
+    torch::set_num_threads(1);
+
+    argparse::ArgumentParser parser("dorado", DORADO_VERSION, argparse::default_arguments::help);
+
+    parser.add_argument("--model")
+            .help("run a headless basecalling pipeline on synthetic reads using this model "
+                  "directory, instead of the quantile benchmarks")
+            .default_value(std::string(""));
+    parser.add_argument("-x", "--device")
+            .help("device string in format \"cuda:0,...,N\", \"cuda:all\", \"metal\", \"cpu\" "
+                  "etc..")
+            .default_value(utils::default_parameters.device);
+    parser.add_argument("-b", "--batchsize")
+            .default_value(utils::default_parameters.batchsize)
+            .scan<'i', int>();
+    parser.add_argument("-c", "--chunksize")
+            .default_value(utils::default_parameters.chunksize)
+            .scan<'i', int>();
+    parser.add_argument("-o", "--overlap")
+            .default_value(utils::default_parameters.overlap)
+            .scan<'i', int>();
+    parser.add_argument("--cpu-threads-per-caller")
+            .help("number of cores each CPU basecall caller splits its batches over, with one "
+                  "pinned thread per core. 1 runs more single-threaded callers instead.")
+            .default_value(utils::default_parameters.cpu_threads_per_caller)
+            .action(cli::parse_cpu_threads_per_caller);
+    parser.add_argument("-n", "--num-reads").default_value(1000).scan<'i', int>();
+    parser.add_argument("--read-length-mean")
+            .help("mean length of the simulated molecules in bases")
+            .default_value(8000.f)
+            .scan<'f', float>();
+    parser.add_argument("--read-length-sd")
+            .help("standard deviation of the (log-normal) molecule lengths in bases")
+            .default_value(6000.f)
+            .scan<'f', float>();
+    parser.add_argument("--reference")
+            .help("FASTA file to sample molecules from. A random reference is used if not given.")
+            .default_value(std::string(""));
+    parser.add_argument("--kmer-levels")
+            .help("modbase model directory whose refine kmer levels are used to simulate the "
+                  "signal. Random levels are used if not given.")
+            .default_value(std::string(""));
+    parser.add_argument("--kit-name")
+            .help("barcode kit whose barcodes are added to the simulated molecules, and which "
+                  "the pipeline classifies.")
+            .default_value(std::string(""));
+    parser.add_argument("--adapters")
+            .help("add sequencing adapters to the simulated molecules, and detect and trim them.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.add_argument("--concatemer-fraction")
+            .help("fraction of reads containing a template and complement joined by open pore.")
+            .default_value(0.05f)
+            .scan<'f', float>();
+    parser.add_argument("--duplex-fraction")
+            .help("fraction of reads followed on the same channel by their complement strand.")
+            .default_value(0.1f)
+            .scan<'f', float>();
+    parser.add_argument("--split-before-basecall")
+            .default_value(false)
+            .implicit_value(true);
+    parser.add_argument("--trim-open-pore").default_value(false).implicit_value(true);
+    parser.add_argument("--seed").default_value(42).scan<'i', int>();
+    parser.add_argument("--dump-stats")
+            .help("write the final pipeline stats to this file.")
+            .default_value(std::string(""));
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+
+    if (parser.get<std::string>("--model").empty()) {
+        benchmark_quantiles();
+        return 0;
+    }
+
+    try {
+        return benchmark_pipeline(parser);
+    } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+        return 1;
+    }
+}
+
 }  // namespace dorado
@@ -1,5 +1,11 @@
+#pragma once
+
 namespace dorado {
 
+namespace cli {
+struct DaemonJob;
+}  // namespace cli
+
 int basecaller(int argc, char *argv[]);
 int duplex(int argc, char *argv[]);
 int download(int argc, char *argv[]);
@@ -7,5 +13,11 @@ int aligner(int argc, char *argv[]);
 int demuxer(int argc, char *argv[]);
 int summary(int argc, char *argv[]);
 int trim(int argc, char *argv[]);
+int modbase(int argc, char *argv[]);
+int daemon_server(int argc, char *argv[]);
+int benchmark(int argc, char *argv[]);
+
+// Runs an aligner invocation as a job inside `dorado daemon`.
+int aligner_daemon_job(int argc, char *argv[], cli::DaemonJob &job);
 
 }  // namespace dorado
@@ -4,6 +4,7 @@
 #include "Version.h"
 #include "models/kits.h"
 #include "utils/dev_utils.h"
+#include "utils/parameters.h"
 
 #include <optional>
 #include <stdexcept>
@@ -155,6 +156,15 @@ inline std::string to_size(double value) {
 
 inline std::string to_yes_or_no(bool value) { return value ? "yes" : "no"; }
 
+// Parses --cpu-threads-per-caller, which must be at least 1.
+inline int parse_cpu_threads_per_caller(const std::string& value) {
+    const int threads = std::stoi(value);
+    if (threads < 1) {
+        throw std::runtime_error("--cpu-threads-per-caller must be at least 1.");
+    }
+    return threads;
+}
+
 inline void add_internal_arguments(ArgParser& parser) {
     parser.hidden.add_argument("--skip-model-compatibility-check")
             .help("(WARNING: For expert users only) Skip model and data compatibility checks.")
@@ -166,6 +176,11 @@ inline void add_internal_arguments(ArgParser& parser) {
     parser.hidden.add_argument("--dump_stats_filter")
             .help("Internal processing stats. name filter regex.")
             .default_value(std::string(""));
+    parser.hidden.add_argument("--cpu-threads-per-caller")
+            .help("Number of cores each CPU basecall caller splits its batches over, with one "
+                  "pinned thread per core. 1 runs each caller on a single unpinned thread.")
+            .default_value(utils::default_parameters.cpu_threads_per_caller)
+            .action(parse_cpu_threads_per_caller);
 }
 
 template <class Options>
@@ -214,6 +229,28 @@ void add_minimap2_arguments(ArgParser& parser, const Options& dflt) {
             .implicit_value(true);
 }
 
+inline void add_output_shard_arguments(argparse::ArgumentParser& parser) {
+    parser.add_argument("--shard-output")
+            .help("write output to files named after this path rather than to stdout, split "
+                  "between files as set by the --shard-* options. Every file has the full header.")
+            .default_value(std::string());
+    parser.add_argument("--shard-count")
+            .help("number of output files to write in parallel.")
+            .default_value(1)
+            .scan<'i', int>();
+    parser.add_argument("--shard-by")
+            .help("how records are assigned to output files, one of: round-robin, read-id.")
+            .default_value(std::string("round-robin"));
+    parser.add_argument("--shard-max-reads")
+            .help("start a new output file once a file holds this many records (0=unlimited).")
+            .default_value(0)
+            .scan<'i', int>();
+    parser.add_argument("--shard-max-size")
+            .help("start a new output file once a file holds this many bytes of records before "
+                  "compression, e.g. 2G (0=unlimited).")
+            .default_value(std::string("0"));
+}
+
 inline void parse(ArgParser& parser, int argc, const char* const argv[]) {
     parser.hidden.add_argument("--devopts")
             .help("Internal options for testing & debugging, 'key=value' pairs separated by ';'")
@@ -256,6 +293,33 @@ Options process_minimap2_arguments(const ArgParser& parser, const Options& dflt)
     return res;
 }
 
+template <class ShardOptions>
+ShardOptions process_output_shard_arguments(const argparse::ArgumentParser& parser) {
+    ShardOptions res;
+    auto num_shards = parser.get<int>("--shard-count");
+    if (num_shards < 1) {
+        throw std::runtime_error("--shard-count must be at least 1.");
+    }
+    auto max_reads = parser.get<int>("--shard-max-reads");
+    if (max_reads < 0) {
+        throw std::runtime_error("--shard-max-reads cannot be negative.");
+    }
+    res.num_shards = size_t(num_shards);
+    res.max_records_per_file = size_t(max_reads);
+    res.max_bytes_per_file =
+            cli::parse_string_to_size<size_t>(parser.get<std::string>("--shard-max-size"));
+    auto shard_by = parser.get<std::string>("--shard-by");
+    if (shard_by == "read-id") {
+        res.assignment = ShardOptions::Assignment::READ_ID_HASH;
+    } else if (shard_by != "round-robin") {
+        throw std::runtime_error("Unknown --shard-by value '" + shard_by + "'.");
+    }
+    if (res.is_sharded() && parser.get<std::string>("--shard-output").empty()) {
+        throw std::runtime_error("--shard-output must be set to split the output between files.");
+    }
+    return res;
+}
+
 inline std::vector<std::string> extract_token_from_cli(const std::string& cmd) {
     std::stringstream ss(cmd);
     std::string token;
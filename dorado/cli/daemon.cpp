@@ -0,0 +1,484 @@
+#include "cli/daemon.h"
+
+#include "alignment/IndexFileAccess.h"
+#include "cli/cli.h"
+#include "cli/cli_utils.h"
+#include "utils/log_utils.h"
+#include "utils/tty_utils.h"
+
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace dorado {
+
+namespace {
+
+#ifndef _WIN32
+
+using DaemonEntryPoint = std::function<int(int, char**, cli::DaemonJob&)>;
+
+// Subcommands which can be run as daemon jobs.
+const std::map<std::string, DaemonEntryPoint> daemon_subcommands = {
+        {"aligner", &aligner_daemon_job},
+};
+
+constexpr auto kJobRequest = "dorado-daemon-job";
+constexpr auto kShutdownRequest = "dorado-daemon-shutdown";
+constexpr auto kExitCodeField = "exit";
+constexpr auto kErrorField = "error";
+
+// Messages are a u32 count of fields, then each field as a u32 length followed by its bytes, so
+// that fields may be empty or contain NULs.  Both ends are on the same host, so integers are sent
+// in its byte order.
+bool send_fields(int socket_fd, const std::vector<std::string>& fields) {
+    std::string message;
+    auto append_size = [&message](size_t size) {
+        const auto size32 = uint32_t(size);
+        message.append(reinterpret_cast<const char*>(&size32), sizeof(size32));
+    };
+    append_size(fields.size());
+    for (const auto& field : fields) {
+        append_size(field.size());
+        message.append(field);
+    }
+
+    size_t num_sent = 0;
+    while (num_sent < message.size()) {
+        auto result = ::send(socket_fd, message.data() + num_sent, message.size() - num_sent, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        num_sent += size_t(result);
+    }
+    return true;
+}
+
+// Fills the buffer from the socket, returning false if the connection ends first.
+bool receive_exactly(int socket_fd, char* buffer, size_t size) {
+    size_t num_received = 0;
+    while (num_received < size) {
+        auto result = ::recv(socket_fd, buffer + num_received, size - num_received, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        num_received += size_t(result);
+    }
+    return true;
+}
+
+std::optional<std::vector<std::string>> receive_fields(int socket_fd) {
+    auto receive_size = [socket_fd]() -> std::optional<uint32_t> {
+        uint32_t size = 0;
+        if (!receive_exactly(socket_fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+            return std::nullopt;
+        }
+        return size;
+    };
+    const auto num_fields = receive_size();
+    if (!num_fields) {
+        return std::nullopt;
+    }
+    std::vector<std::string> fields;
+    for (uint32_t i = 0; i < *num_fields; ++i) {
+        const auto field_size = receive_size();
+        if (!field_size) {
+            return std::nullopt;
+        }
+        std::string field(*field_size, '\0');
+        if (!receive_exactly(socket_fd, field.data(), field.size())) {
+            return std::nullopt;
+        }
+        fields.push_back(std::move(field));
+    }
+    return fields;
+}
+
+// File descriptors are passed alongside a single placeholder byte.
+bool send_fds(int socket_fd, const std::vector<int>& fds) {
+    char placeholder = 0;
+    iovec iov{&placeholder, 1};
+    if (fds.empty()) {
+        return ::send(socket_fd, &placeholder, 1, 0) == 1;
+    }
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = socklen_t(control.size());
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+    return ::sendmsg(socket_fd, &message, 0) == 1;
+}
+
+std::vector<int> receive_fds(int socket_fd, size_t num_fds) {
+    char placeholder = 0;
+    iovec iov{&placeholder, 1};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * num_fds));
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = socklen_t(control.size());
+    if (::recvmsg(socket_fd, &message, 0) != 1) {
+        return {};
+    }
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+        header->cmsg_len != CMSG_LEN(sizeof(int) * num_fds)) {
+        return {};
+    }
+    std::vector<int> fds(num_fds);
+    std::memcpy(fds.data(), CMSG_DATA(header), sizeof(int) * num_fds);
+    return fds;
+}
+
+std::optional<sockaddr_un> make_socket_address(const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        spdlog::error("Socket path is too long: {}", socket_path);
+        return std::nullopt;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+int connect_to_daemon(const std::string& socket_path) {
+    auto address = make_socket_address(socket_path);
+    if (!address) {
+        return -1;
+    }
+    int socket_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0 ||
+        ::connect(socket_fd, reinterpret_cast<sockaddr*>(&*address), sizeof(*address)) != 0) {
+        spdlog::error("Unable to connect to dorado daemon at {}: {}", socket_path,
+                      std::strerror(errno));
+        if (socket_fd >= 0) {
+            ::close(socket_fd);
+        }
+        return -1;
+    }
+    return socket_fd;
+}
+
+// The client's stdin, stdout and stderr.
+constexpr size_t kNumClientFds = 3;
+
+// Runs a job received on connection_fd, replying with its stats and exit code.
+void run_job(int connection_fd,
+             const std::vector<int>& client_fds,
+             const std::vector<std::string>& request,
+             const std::shared_ptr<alignment::IndexFileAccess>& index_file_access,
+             size_t job_number) {
+    // request: header, subcommand, output kind, subcommand arguments...
+    const auto& subcommand = request[1];
+    std::vector<std::string> reply;
+    int exit_code = EXIT_FAILURE;
+
+    cli::DaemonJob job;
+    job.index_file_access = index_file_access;
+    job.input_path = "/dev/fd/" + std::to_string(client_fds[0]);
+    job.output_path = "/dev/fd/" + std::to_string(client_fds[1]);
+    try {
+        // Not registered with spdlog, so that every job has a logger of its own.
+        auto log_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+                "/dev/fd/" + std::to_string(client_fds[2]));
+        job.logger = std::make_shared<spdlog::logger>("job" + std::to_string(job_number),
+                                                      std::move(log_sink));
+    } catch (const std::exception& e) {
+        spdlog::warn("Unable to log to client's stderr: {}", e.what());
+        job.logger = std::make_shared<spdlog::logger>("job" + std::to_string(job_number));
+    }
+    job.output_is_tty = request[2] == "tty";
+    job.output_is_pipe = request[2] == "pipe";
+
+    auto entry_point = daemon_subcommands.find(subcommand);
+    if (entry_point == daemon_subcommands.end()) {
+        reply.push_back(std::string(kErrorField) + "=subcommand '" + subcommand +
+                        "' can't be run by the daemon");
+    } else {
+        std::vector<std::string> args(std::next(request.begin()), request.end());
+        args.erase(std::next(args.begin()));  // Drop the output kind.
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+
+        spdlog::info("> starting {} job {}", subcommand, job_number);
+        stats::Timer timer;
+        try {
+            exit_code = entry_point->second(int(args.size()), argv.data(), job);
+        } catch (const std::exception& e) {
+            spdlog::error("{} job failed: {}", subcommand, e.what());
+            reply.push_back(std::string(kErrorField) + "=" + e.what());
+        }
+        job.stats["job_elapsed_ms"] = double(timer.GetElapsedMS());
+        spdlog::info("> finished {} job {} in {} ms", subcommand, job_number,
+                     job.stats["job_elapsed_ms"]);
+    }
+
+    for (const auto& [name, value] : job.stats) {
+        reply.push_back(name + "=" + std::to_string(value));
+    }
+    reply.push_back(std::string(kExitCodeField) + "=" + std::to_string(exit_code));
+    for (int fd : client_fds) {
+        ::close(fd);
+    }
+    if (!send_fields(connection_fd, reply)) {
+        spdlog::warn("Unable to report {} job results to client", subcommand);
+    }
+    ::close(connection_fd);
+}
+
+int serve(const std::string& socket_path, size_t max_indexes) {
+    auto address = make_socket_address(socket_path);
+    if (!address) {
+        return EXIT_FAILURE;
+    }
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    std::error_code ec;
+    std::filesystem::remove(socket_path, ec);
+    if (listen_fd < 0 ||
+        ::bind(listen_fd, reinterpret_cast<sockaddr*>(&*address), sizeof(*address)) != 0 ||
+        ::listen(listen_fd, SOMAXCONN) != 0) {
+        spdlog::error("Unable to listen on {}: {}", socket_path, std::strerror(errno));
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // Clients going away mid-job shouldn't take the daemon down with them.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto index_file_access = std::make_shared<alignment::IndexFileAccess>(max_indexes);
+    struct RunningJob {
+        std::thread thread;
+        std::atomic_bool finished{false};
+    };
+    std::list<RunningJob> running_jobs;
+    size_t num_jobs = 0;
+
+    spdlog::info("> dorado daemon listening on {}", socket_path);
+    while (true) {
+        int connection_fd = ::accept(listen_fd, nullptr, nullptr);
+        if (connection_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            spdlog::error("Unable to accept connection: {}", std::strerror(errno));
+            break;
+        }
+
+        // Reap any jobs which have completed.
+        running_jobs.remove_if([](RunningJob& job) {
+            if (!job.finished) {
+                return false;
+            }
+            job.thread.join();
+            return true;
+        });
+
+        auto client_fds = receive_fds(connection_fd, kNumClientFds);
+        auto request = receive_fields(connection_fd);
+        if (request && request->size() == 1 && request->front() == kShutdownRequest) {
+            send_fields(connection_fd, {std::string(kExitCodeField) + "=0"});
+            ::close(connection_fd);
+            break;
+        }
+        if (client_fds.size() != kNumClientFds || !request || request->size() < 3 ||
+            request->front() != kJobRequest) {
+            spdlog::warn("Ignoring malformed daemon request");
+            for (int fd : client_fds) {
+                ::close(fd);
+            }
+            ::close(connection_fd);
+            continue;
+        }
+
+        auto& job = running_jobs.emplace_back();
+        job.thread = std::thread([&job, connection_fd, client_fds,
+                                  job_request = std::move(*request), index_file_access,
+                                  job_number = ++num_jobs] {
+            run_job(connection_fd, client_fds, job_request, index_file_access, job_number);
+            job.finished = true;
+        });
+    }
+
+    spdlog::info("> waiting for {} running jobs", running_jobs.size());
+    for (auto& job : running_jobs) {
+        job.thread.join();
+    }
+    ::close(listen_fd);
+    std::filesystem::remove(socket_path, ec);
+    spdlog::info("> dorado daemon stopped");
+    return EXIT_SUCCESS;
+}
+
+int stop(const std::string& socket_path) {
+    int socket_fd = connect_to_daemon(socket_path);
+    if (socket_fd < 0) {
+        return EXIT_FAILURE;
+    }
+    bool stopped = send_fds(socket_fd, {}) && send_fields(socket_fd, {kShutdownRequest}) &&
+                   receive_fields(socket_fd).has_value();
+    ::close(socket_fd);
+    return stopped ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif  // _WIN32
+
+}  // namespace
+
+namespace cli {
+
+int submit_daemon_job(const std::string& socket_path,
+                      const std::string& subcommand,
+                      const std::vector<std::string>& args) {
+#ifdef _WIN32
+    (void)socket_path;
+    (void)subcommand;
+    (void)args;
+    spdlog::error("dorado daemon is not supported on Windows");
+    return EXIT_FAILURE;
+#else
+    int socket_fd = connect_to_daemon(socket_path);
+    if (socket_fd < 0) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> request{kJobRequest, subcommand};
+    if (utils::is_fd_tty(stdout)) {
+        request.push_back("tty");
+    } else if (utils::is_fd_pipe(stdout)) {
+        request.push_back("pipe");
+    } else {
+        request.push_back("file");
+    }
+    request.insert(request.end(), args.begin(), args.end());
+
+    std::optional<std::vector<std::string>> reply;
+    if (send_fds(socket_fd, {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}) &&
+        send_fields(socket_fd, request)) {
+        reply = receive_fields(socket_fd);
+    }
+    ::close(socket_fd);
+    if (!reply) {
+        spdlog::error("Lost connection to dorado daemon at {}", socket_path);
+        return EXIT_FAILURE;
+    }
+
+    int exit_code = EXIT_FAILURE;
+    for (const auto& field : *reply) {
+        auto separator = field.find('=');
+        auto name = field.substr(0, separator);
+        auto value = separator == std::string::npos ? "" : field.substr(separator + 1);
+        if (name == kExitCodeField) {
+            exit_code = std::stoi(value);
+        } else if (name == kErrorField) {
+            spdlog::error("{}", value);
+        } else if (name.rfind("job_", 0) == 0) {
+            spdlog::info("> {}: {}", name, value);
+        } else {
+            spdlog::debug("> {}: {}", name, value);
+        }
+    }
+    return exit_code;
+#endif  // _WIN32
+}
+
+}  // namespace cli
+
+int daemon_server(int argc, char* argv[]) {
+    utils::InitLogging();
+
+    cli::ArgParser parser("dorado");
+    parser.visible.add_description(
+            "Runs a long lived dorado process which keeps alignment indexes loaded between aligner "
+            "jobs.\n"
+            "Jobs are submitted over a local socket, e.g. `dorado aligner --daemon-socket "
+            "<socket> ...`.");
+    parser.visible.add_argument("socket").help("path of the unix socket to listen on.");
+    parser.visible.add_argument("--max-indexes")
+            .help("maximum number of indexes to keep loaded between jobs. The least recently used "
+                  "index which no running job is using is unloaded to make room for another. "
+                  "0=unlimited.")
+            .default_value(2)
+            .scan<'i', int>();
+    parser.visible.add_argument("--stop")
+            .help("stop the daemon listening on the socket once its running jobs complete.")
+            .default_value(false)
+            .implicit_value(true);
+    int verbosity = 0;
+    parser.visible.add_argument("-v", "--verbose")
+            .default_value(false)
+            .implicit_value(true)
+            .nargs(0)
+            .action([&](const auto&) { ++verbosity; })
+            .append();
+
+    try {
+        cli::parse(parser, argc, argv);
+    } catch (const std::exception& e) {
+        std::ostringstream parser_stream;
+        parser_stream << parser.visible;
+        spdlog::error("{}\n{}", e.what(), parser_stream.str());
+        return EXIT_FAILURE;
+    }
+
+    if (parser.visible.get<bool>("--verbose")) {
+        utils::SetVerboseLogging(static_cast<dorado::utils::VerboseLogLevel>(verbosity));
+    }
+
+#ifdef _WIN32
+    spdlog::error("dorado daemon is not supported on Windows");
+    return EXIT_FAILURE;
+#else
+    auto socket_path = parser.visible.get<std::string>("socket");
+    if (parser.visible.get<bool>("--stop")) {
+        return stop(socket_path);
+    }
+    const int max_indexes = parser.visible.get<int>("--max-indexes");
+    if (max_indexes < 0) {
+        spdlog::error("--max-indexes must not be negative");
+        return EXIT_FAILURE;
+    }
+    return serve(socket_path, size_t(max_indexes));
+#endif  // _WIN32
+}
+
+}  // namespace dorado
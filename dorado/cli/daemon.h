@@ -0,0 +1,45 @@
+#pragma once
+
+#include "utils/stats.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
+namespace dorado {
+
+namespace alignment {
+class IndexFileAccess;
+}  // namespace alignment
+
+namespace cli {
+
+// A job run by `dorado daemon` on behalf of a client.
+struct DaemonJob {
+    // Shared by every job, so that indexes stay loaded between jobs.
+    std::shared_ptr<alignment::IndexFileAccess> index_file_access;
+    // Writes to the client's stderr.  Jobs log through this rather than the default logger, and
+    // set its level rather than the global one, as other jobs run alongside them.
+    std::shared_ptr<spdlog::logger> logger;
+    // Paths to use in place of the client's stdin and stdout.
+    std::string input_path;
+    std::string output_path;
+    bool output_is_tty{false};
+    bool output_is_pipe{false};
+    // Filled in by the job and reported back to the client.
+    stats::NamedStats stats;
+};
+
+// Runs the subcommand with the given arguments in the daemon listening on socket_path,
+// forwarding this process's stdin, stdout and stderr to it.  Returns the exit code of the job.
+int submit_daemon_job(const std::string& socket_path,
+                      const std::string& subcommand,
+                      const std::vector<std::string>& args);
+
+}  // namespace cli
+
+}  // namespace dorado
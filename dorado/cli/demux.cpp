@@ -40,8 +40,13 @@ int demuxer(int argc, char* argv[]) {
     argparse::ArgumentParser parser("dorado", DORADO_VERSION, argparse::default_arguments::help);
     parser.add_description("Barcode demultiplexing tool. Users need to specify the kit name(s).");
     parser.add_argument("reads")
-            .help("Path to a file with reads to demultiplex. Can be in any HTS format.")
+            .help("Paths to files with reads to demultiplex, or directories of such files. Can "
+                  "be in any HTS format.")
             .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-r", "--recursive")
+            .help("Recursively scan through directories to load input files.")
+            .default_value(false)
+            .implicit_value(true);
     parser.add_argument("--output-dir").help("Output folder for demultiplexed reads.").required();
     parser.add_argument("--kit-name")
             .help("Barcoding kit name. Cannot be used with --no-classify. Choose "
@@ -146,13 +151,15 @@ int demuxer(int argc, char* argv[]) {
         }
 #endif
         reads.push_back("-");
-    } else if (reads.size() > 1) {
-        spdlog::error("> multi file input not yet handled");
+    }
+    reads = get_hts_input_files(reads, parser.get<bool>("--recursive"));
+    if (reads.empty()) {
+        spdlog::error("> no input files found");
         return 1;
     }
 
-    HtsReader reader(reads[0], read_list);
-    auto header = SamHdrPtr(sam_hdr_dup(reader.header));
+    MultiHtsReader reader(reads, read_list);
+    auto header = SamHdrPtr(sam_hdr_dup(reader.header()));
     add_pg_hdr(header.get());
 
     auto barcode_sample_sheet = parser.get<std::string>("--sample-sheet");
@@ -180,8 +187,7 @@ int demuxer(int argc, char* argv[]) {
     }
 
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters;
-    auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
         std::exit(EXIT_FAILURE);
@@ -196,23 +202,27 @@ int demuxer(int argc, char* argv[]) {
     // Set up stats counting
     std::vector<dorado::stats::StatsCallable> stats_callables;
     ProgressTracker tracker(0, false);
-    stats_callables.push_back(
-            [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
+    // Progress is read from the pipeline's counters, so no node stats need to be sampled.
+    stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+        tracker.update_progress_bar(pipeline->counters());
+    });
     constexpr auto kStatsPeriod = 100ms;
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
-            kStatsPeriod, stats_reporters, stats_callables, static_cast<size_t>(0));
+            kStatsPeriod, std::vector<stats::StatsReporter>(), stats_callables,
+            static_cast<size_t>(0));
     // End stats counting setup.
 
     spdlog::info("> starting barcode demuxing");
-    reader.read(*pipeline, max_reads);
+    // Read as many files at once as there are writer threads, as both are bound by compression.
+    reader.read(*pipeline, max_reads, demux_writer_threads, false);
 
-    // Wait for the pipeline to complete.  When it does, we collect
-    // final stats to allow accurate summarisation.
-    auto final_stats = pipeline->terminate(DefaultFlushOptions());
+    // Wait for the pipeline to complete.  When it does, its counters
+    // are final, allowing accurate summarisation.
+    pipeline->terminate(DefaultFlushOptions());
 
     stats_sampler->terminate();
 
-    tracker.update_progress_bar(final_stats);
+    tracker.update_progress_bar(pipeline->counters());
     tracker.summarize();
 
     spdlog::info("> finished barcode demuxing");
@@ -14,6 +14,7 @@
 #include "read_pipeline/HtsWriter.h"
 #include "read_pipeline/ProgressTracker.h"
 #include "read_pipeline/ReadFilterNode.h"
+#include "read_pipeline/ReadQCStatsNode.h"
 #include "read_pipeline/ReadToBamTypeNode.h"
 #include "utils/SampleSheet.h"
 #include "utils/bam_utils.h"
@@ -245,6 +246,11 @@ int duplex(int argc, char* argv[]) {
             .help("Path to reference for alignment.")
             .default_value(std::string(""));
 
+    parser.visible.add_argument("--qc-stats-file")
+            .help("Write per-read QC metrics and running length and Q-score summaries to this "
+                  "columnar file while basecalling.")
+            .default_value(std::string(""));
+
     int verbosity = 0;
     parser.visible.add_argument("-v", "--verbose")
             .default_value(false)
@@ -367,20 +373,26 @@ int duplex(int argc, char* argv[]) {
         auto aligner = PipelineDescriptor::InvalidNodeHandle;
         auto converted_reads_sink = PipelineDescriptor::InvalidNodeHandle;
         if (ref.empty()) {
-            hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, 4);
+            hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, 4, 0);
             converted_reads_sink = hts_writer;
         } else {
             auto options = cli::process_minimap2_arguments(parser, alignment::dflt_options);
             auto index_file_access = std::make_shared<alignment::IndexFileAccess>();
             aligner = pipeline_desc.add_node<AlignerNode>({}, index_file_access, ref, options,
                                                           std::thread::hardware_concurrency());
-            hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, 4);
+            hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, 4, 0);
             pipeline_desc.add_node_sink(aligner, hts_writer);
             converted_reads_sink = aligner;
         }
         auto read_converter = pipeline_desc.add_node<ReadToBamType>(
                 {converted_reads_sink}, emit_moves, 2, 0.0f, nullptr, 1000);
-        auto duplex_read_tagger = pipeline_desc.add_node<DuplexReadTaggingNode>({read_converter});
+        auto qc_stats_sink = read_converter;
+        const auto qc_stats_file = parser.visible.get<std::string>("--qc-stats-file");
+        if (!qc_stats_file.empty()) {
+            qc_stats_sink =
+                    pipeline_desc.add_node<ReadQCStatsNode>({read_converter}, qc_stats_file, 1000);
+        }
+        auto duplex_read_tagger = pipeline_desc.add_node<DuplexReadTaggingNode>({qc_stats_sink});
         // The minimum sequence length is set to 5 to avoid issues with duplex node printing very short sequences for mismatched pairs.
         std::unordered_set<std::string> read_ids_to_filter;
         auto read_filter_node = pipeline_desc.add_node<ReadFilterNode>(
@@ -390,11 +402,17 @@ int duplex(int argc, char* argv[]) {
         std::unique_ptr<dorado::Pipeline> pipeline;
         ProgressTracker tracker(int(num_reads), duplex);
         std::vector<dorado::stats::StatsCallable> stats_callables;
-        stats_callables.push_back(
-                [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
-        stats::NamedStats final_stats;
+        stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+            tracker.update_progress_bar(pipeline->counters());
+        });
         std::unique_ptr<dorado::stats::StatsSampler> stats_sampler;
-        std::vector<dorado::stats::StatsReporter> stats_reporters{dorado::stats::sys_stats_report};
+        // Progress is read from the pipeline's counters, so stats are only sampled when they're to
+        // be dumped.
+        const bool sample_stats = !dump_stats_file.empty();
+        std::vector<dorado::stats::StatsReporter> stats_reporters;
+        if (sample_stats) {
+            stats_reporters.push_back(dorado::stats::sys_stats_report);
+        }
 
         constexpr auto kStatsPeriod = 100ms;
 
@@ -419,7 +437,8 @@ int duplex(int argc, char* argv[]) {
                                                               std::move(template_complement_map),
                                                               std::move(read_map), threads);
 
-            pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+            pipeline = Pipeline::create(std::move(pipeline_desc),
+                                        sample_stats ? &stats_reporters : nullptr);
             if (pipeline == nullptr) {
                 spdlog::error("Failed to create pipeline");
                 std::exit(EXIT_FAILURE);
@@ -470,6 +489,8 @@ int duplex(int argc, char* argv[]) {
             int chunk_size(parser.visible.get<int>("-c"));
             int overlap(parser.visible.get<int>("-o"));
             const size_t num_runners = default_parameters.num_runners;
+            const size_t cpu_threads_per_caller =
+                    parser.hidden.get<int>("--cpu-threads-per-caller");
 
             int stereo_batch_size = 0;
 #if DORADO_GPU_BUILD
@@ -484,8 +505,9 @@ int duplex(int argc, char* argv[]) {
             // performed based on empirical results considering a SUP model for simplex
             // calling.
             auto [runners, num_devices] =
-                    create_basecall_runners(models.model_config, device, num_runners, 0, batch_size,
-                                            chunk_size, 0.9f, true);
+                    create_basecall_runners(models.model_config, device, num_runners, 0,
+                                            cpu_threads_per_caller, batch_size, chunk_size, 0.9f,
+                                            true);
 
             std::vector<basecall::RunnerPtr> stereo_runners;
             // The fraction argument for GPU memory allocates the fraction of the
@@ -499,7 +521,8 @@ int duplex(int argc, char* argv[]) {
             // model.
             std::tie(stereo_runners, std::ignore) =
                     create_basecall_runners(models.stereo_model_config, device, num_runners, 0,
-                                            stereo_batch_size, chunk_size, 0.5f, true);
+                                            cpu_threads_per_caller, stereo_batch_size, chunk_size,
+                                            0.5f, true);
 
             spdlog::info("> Starting Stereo Duplex pipeline");
 
@@ -521,7 +544,8 @@ int duplex(int argc, char* argv[]) {
                     std::move(pairing_parameters), read_filter_node,
                     PipelineDescriptor::InvalidNodeHandle);
 
-            pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+            pipeline = Pipeline::create(std::move(pipeline_desc),
+                                        sample_stats ? &stats_reporters : nullptr);
             if (pipeline == nullptr) {
                 spdlog::error("Failed to create pipeline");
                 std::exit(EXIT_FAILURE);
@@ -549,14 +573,14 @@ int duplex(int argc, char* argv[]) {
             utils::clean_temporary_models(temp_model_paths);
         }
 
-        // Wait for the pipeline to complete.  When it does, we collect
-        // final stats to allow accurate summarisation.
-        final_stats = pipeline->terminate(DefaultFlushOptions());
+        // Wait for the pipeline to complete.  When it does, its counters
+        // are final, allowing accurate summarisation.
+        pipeline->terminate(DefaultFlushOptions());
 
         // Stop the stats sampler thread before tearing down any pipeline objects.
         stats_sampler->terminate();
 
-        tracker.update_progress_bar(final_stats);
+        tracker.update_progress_bar(pipeline->counters());
         tracker.summarize();
         if (!dump_stats_file.empty()) {
             std::ofstream stats_file(dump_stats_file);
@@ -0,0 +1,207 @@
+#include "Version.h"
+#include "api/runner_creation.h"
+#include "cli/cli.h"
+#include "cli/cli_utils.h"
+#include "data_loader/DataLoader.h"
+#include "modbase/ModBaseRunner.h"
+#include "read_pipeline/HtsReader.h"
+#include "read_pipeline/HtsWriter.h"
+#include "read_pipeline/ModBaseCallerNode.h"
+#include "read_pipeline/ModBaseMergeNode.h"
+#include "read_pipeline/ProgressTracker.h"
+#include "utils/bam_utils.h"
+#include "utils/log_utils.h"
+#include "utils/parameters.h"
+#include "utils/stats.h"
+#include "utils/string_utils.h"
+#include "utils/torch_utils.h"
+
+#include <htslib/sam.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace dorado {
+
+namespace {
+
+void add_pg_hdr(sam_hdr_t* hdr) {
+    sam_hdr_add_line(hdr, "PG", "ID", "modbase", "PN", "dorado", "VN", DORADO_VERSION, NULL);
+}
+
+// Returns the move table stride of the first record with a move table, or 0 if none has one.
+int get_move_table_stride(const std::string& filename) {
+    HtsReader reader(filename, std::nullopt);
+    while (reader.read()) {
+        const auto [stride, moves] = utils::extract_move_table(reader.record.get());
+        if (stride > 0) {
+            return stride;
+        }
+    }
+    return 0;
+}
+
+}  // anonymous namespace
+
+int modbase(int argc, char* argv[]) {
+    utils::InitLogging();
+    utils::make_torch_deterministic();
+    torch::set_num_threads(1);
+
+    argparse::ArgumentParser parser("dorado", DORADO_VERSION, argparse::default_arguments::help);
+    parser.add_description(
+            "Modified base calling of reads which have already been basecalled, using the move "
+            "tables in their records rather than basecalling them again.");
+    parser.add_argument("reads").help(
+            "BAM file written by the basecaller with --emit-moves. Aligned records keep their "
+            "alignments, and secondary and supplementary records are written unchanged.");
+    parser.add_argument("data").help("The POD5 file or directory the reads were basecalled from.");
+    parser.add_argument("-r", "--recursive")
+            .help("Recursively scan through directories to load POD5 files.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.add_argument("-x", "--device")
+            .help("device string in format \"cuda:0,...,N\", \"cuda:all\", \"metal\", \"cpu\" "
+                  "etc..")
+            .default_value(utils::default_parameters.device);
+    parser.add_argument("--modified-bases-models")
+            .required()
+            .help("a comma separated list of modified base models");
+    parser.add_argument("--modified-bases-threshold")
+            .default_value(utils::default_parameters.methylation_threshold)
+            .scan<'f', float>()
+            .help("the minimum predicted methylation probability for a modified base to be emitted "
+                  "in an all-context model, [0, 1]");
+    parser.add_argument("--emit-sam")
+            .help("Output in SAM format.")
+            .default_value(false)
+            .implicit_value(true);
+    int verbosity = 0;
+    parser.add_argument("-v", "--verbose")
+            .default_value(false)
+            .implicit_value(true)
+            .nargs(0)
+            .action([&](const auto&) { ++verbosity; })
+            .append();
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::ostringstream parser_stream;
+        parser_stream << parser;
+        spdlog::error("{}\n{}", e.what(), parser_stream.str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (parser.get<bool>("--verbose")) {
+        utils::SetVerboseLogging(static_cast<dorado::utils::VerboseLogLevel>(verbosity));
+    }
+
+    const auto reads = parser.get<std::string>("reads");
+    const auto data = parser.get<std::string>("data");
+    const auto recursive = parser.get<bool>("--recursive");
+    const auto methylation_threshold = parser.get<float>("--modified-bases-threshold");
+    if (methylation_threshold < 0.f || methylation_threshold > 1.f) {
+        spdlog::error("--modified-bases-threshold must be between 0 and 1.");
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::filesystem::path> mods_model_paths;
+    const auto split = utils::split(parser.get<std::string>("--modified-bases-models"), ',');
+    std::transform(split.begin(), split.end(), std::back_inserter(mods_model_paths),
+                   [](const std::string& m) { return std::filesystem::path(m); });
+
+    // The reads are read twice, so can't come from stdin.
+    if (!std::filesystem::exists(reads)) {
+        spdlog::error("> Reads file {} does not exist", reads);
+        std::exit(EXIT_FAILURE);
+    }
+    const int model_stride = get_move_table_stride(reads);
+    if (model_stride == 0) {
+        spdlog::error("> No move tables found in {}, basecall with --emit-moves", reads);
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto output_mode = HtsWriter::OutputMode::BAM;
+    if (parser.get<bool>("--emit-sam") || utils::is_fd_tty(stdout)) {
+        output_mode = HtsWriter::OutputMode::SAM;
+    } else if (utils::is_fd_pipe(stdout)) {
+        output_mode = HtsWriter::OutputMode::UBAM;
+    }
+
+    const auto& params = utils::default_parameters;
+    auto remora_runners =
+            create_modbase_runners(mods_model_paths, parser.get<std::string>("--device"),
+                                   params.mod_base_runners_per_caller, params.remora_batchsize);
+    if (remora_runners.empty()) {
+        spdlog::error("> No modified base models given, set --modified-bases-models");
+        std::exit(EXIT_FAILURE);
+    }
+
+    PipelineDescriptor pipeline_desc;
+    auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, 4, 0);
+    auto merge_node = pipeline_desc.add_node<ModBaseMergeNode>({hts_writer}, methylation_threshold,
+                                                               2, 1000);
+    pipeline_desc.add_node<ModBaseCallerNode>({merge_node}, std::move(remora_runners),
+                                              params.remora_threads, model_stride, 1000);
+
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+    if (pipeline == nullptr) {
+        spdlog::error("Failed to create pipeline");
+        std::exit(EXIT_FAILURE);
+    }
+
+    // At present, header output file header writing relies on direct node method calls
+    // rather than the pipeline framework.
+    HtsReader header_reader(reads, std::nullopt);
+    auto header = SamHdrPtr(sam_hdr_dup(header_reader.header));
+    add_pg_hdr(header.get());
+    auto& hts_writer_ref = dynamic_cast<HtsWriter&>(pipeline->get_node_ref(hts_writer));
+    hts_writer_ref.set_and_write_header(header.get());
+    auto& merge_node_ref = dynamic_cast<ModBaseMergeNode&>(pipeline->get_node_ref(merge_node));
+
+    std::vector<dorado::stats::StatsCallable> stats_callables;
+    ProgressTracker tracker(0, false);
+    stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+        tracker.update_progress_bar(pipeline->counters());
+    });
+    constexpr auto kStatsPeriod = 100ms;
+    auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
+            kStatsPeriod, std::vector<stats::StatsReporter>(), stats_callables,
+            static_cast<size_t>(0));
+
+    spdlog::info("> starting modified base calling");
+    DataLoader loader(*pipeline, "cpu", params.num_runners, 0, std::nullopt, {});
+    loader.load_basecalled_reads(reads, data, recursive, model_stride,
+                                 [&merge_node_ref](const std::string& read_id, BamPtr record) {
+                                     merge_node_ref.add_record(read_id, std::move(record));
+                                 });
+
+    // Wait for the pipeline to complete.  When it does, its counters
+    // are final, allowing accurate summarisation.
+    pipeline->terminate(DefaultFlushOptions());
+
+    stats_sampler->terminate();
+
+    tracker.update_progress_bar(pipeline->counters());
+    tracker.summarize();
+
+    const auto loader_stats = loader.sample_stats();
+    spdlog::info("> Modbase called {} reads, wrote {} other records unchanged",
+                 size_t(loader_stats.at("loaded_read_count")),
+                 size_t(loader_stats.at("passed_through_record_count")));
+    spdlog::info("> finished modified base calling");
+
+    return 0;
+}
+
+}  // namespace dorado
@@ -38,8 +38,17 @@ int trim(int argc, char* argv[]) {
     argparse::ArgumentParser parser("dorado", DORADO_VERSION, argparse::default_arguments::help);
     parser.add_description("Adapter/primer trimming tool.");
     parser.add_argument("reads")
-            .help("Path to a file with reads to trim. Can be in any HTS format.")
+            .help("Paths to files with reads to trim, or directories of such files. Can be in "
+                  "any HTS format.")
             .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-r", "--recursive")
+            .help("Recursively scan through directories to load input files.")
+            .default_value(false)
+            .implicit_value(true);
+    parser.add_argument("--ordered")
+            .help("Write reads in input order, reading input files one at a time.")
+            .default_value(false)
+            .implicit_value(true);
     parser.add_argument("-t", "--threads")
             .help("Combined number of threads for adapter/primer detection and output generation. "
                   "Default uses "
@@ -65,10 +74,16 @@ int trim(int argc, char* argv[]) {
             .help("Output in fastq format. Default is BAM.")
             .default_value(false)
             .implicit_value(true);
+    parser.add_argument("--emit-sam")
+            .help("Output in SAM format. Standard output is always SAM unless --emit-fastq is "
+                  "set, so this only changes --shard-output files, which are otherwise BAM.")
+            .default_value(false)
+            .implicit_value(true);
     parser.add_argument("--no-trim-primers")
             .help("Skip primer detection and trimming. Only adapters will be detected and trimmed.")
             .default_value(false)
             .implicit_value(true);
+    cli::add_output_shard_arguments(parser);
 
     try {
         parser.parse_args(argc, argv);
@@ -86,6 +101,15 @@ int trim(int argc, char* argv[]) {
     auto reads(parser.get<std::vector<std::string>>("reads"));
     auto threads(parser.get<int>("threads"));
     auto max_reads(parser.get<int>("max-reads"));
+    auto ordered(parser.get<bool>("--ordered"));
+    auto shard_output(parser.get<std::string>("--shard-output"));
+    OutputShardOptions shard_options;
+    try {
+        shard_options = cli::process_output_shard_arguments<OutputShardOptions>(parser);
+    } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+        std::exit(EXIT_FAILURE);
+    }
 
     threads = threads == 0 ? std::thread::hardware_concurrency() : threads;
     // The input thread is the total number of threads to use for dorado
@@ -106,38 +130,44 @@ int trim(int argc, char* argv[]) {
         }
 #endif
         reads.push_back("-");
-    } else if (reads.size() > 1) {
-        spdlog::error("> multi file input not yet handled");
+    }
+    reads = get_hts_input_files(reads, parser.get<bool>("--recursive"));
+    if (reads.empty()) {
+        spdlog::error("> no input files found");
         std::exit(EXIT_FAILURE);
     }
 
-    HtsReader reader(reads[0], read_list);
-    auto header = SamHdrPtr(sam_hdr_dup(reader.header));
+    MultiHtsReader reader(reads, read_list);
+    auto header = SamHdrPtr(sam_hdr_dup(reader.header()));
     add_pg_hdr(header.get());
 
     auto output_mode = HtsWriter::OutputMode::BAM;
 
     auto emit_fastq = parser.get<bool>("--emit-fastq");
-    auto emit_sam = !emit_fastq;
+    // Standard output is SAM unless FASTQ is asked for; shard files are BAM unless SAM is.
+    auto emit_sam = parser.get<bool>("--emit-sam") || shard_output.empty();
+    if (emit_fastq && parser.get<bool>("--emit-sam")) {
+        spdlog::error("Only one of --emit-{fastq, sam} can be set (or none).");
+        std::exit(EXIT_FAILURE);
+    }
 
     if (emit_fastq) {
         spdlog::info(" - Note: FASTQ output is not recommended as not all data can be preserved.");
         output_mode = HtsWriter::OutputMode::FASTQ;
-    } else if (emit_sam || utils::is_fd_tty(stdout)) {
+    } else if (emit_sam) {
         output_mode = HtsWriter::OutputMode::SAM;
-    } else if (utils::is_fd_pipe(stdout)) {
-        output_mode = HtsWriter::OutputMode::UBAM;
     }
 
     PipelineDescriptor pipeline_desc;
-    auto hts_writer = pipeline_desc.add_node<HtsWriter>({}, "-", output_mode, trim_writer_threads);
+    auto hts_writer = pipeline_desc.add_node<HtsWriter>(
+            {}, shard_output.empty() ? "-" : shard_output, output_mode, trim_writer_threads,
+            ordered ? HtsWriter::DEFAULT_REORDER_BUFFER_SIZE : 0, shard_options);
 
     pipeline_desc.add_node<AdapterDetectorNode>({hts_writer}, trim_threads, true,
                                                 !parser.get<bool>("--no-trim-primers"));
 
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters;
-    auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
         std::exit(EXIT_FAILURE);
@@ -151,23 +181,27 @@ int trim(int argc, char* argv[]) {
     // Set up stats counting
     std::vector<dorado::stats::StatsCallable> stats_callables;
     ProgressTracker tracker(0, false);
-    stats_callables.push_back(
-            [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
+    // Progress is read from the pipeline's counters, so no node stats need to be sampled.
+    stats_callables.push_back([&tracker, &pipeline](const stats::NamedStats&) {
+        tracker.update_progress_bar(pipeline->counters());
+    });
     constexpr auto kStatsPeriod = 100ms;
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
-            kStatsPeriod, stats_reporters, stats_callables, static_cast<size_t>(0));
+            kStatsPeriod, std::vector<stats::StatsReporter>(), stats_callables,
+            static_cast<size_t>(0));
     // End stats counting setup.
 
     spdlog::info("> starting adapter/primer trimming");
-    reader.read(*pipeline, max_reads);
+    // Read as many files at once as there are writer threads, as both are bound by compression.
+    reader.read(*pipeline, max_reads, trim_writer_threads, ordered);
 
-    // Wait for the pipeline to complete.  When it does, we collect
-    // final stats to allow accurate summarisation.
-    auto final_stats = pipeline->terminate(DefaultFlushOptions());
+    // Wait for the pipeline to complete.  When it does, its counters
+    // are final, allowing accurate summarisation.
+    pipeline->terminate(DefaultFlushOptions());
 
     stats_sampler->terminate();
 
-    tracker.update_progress_bar(final_stats);
+    tracker.update_progress_bar(pipeline->counters());
     tracker.summarize();
 
     spdlog::info("> finished adapter/primer trimming");
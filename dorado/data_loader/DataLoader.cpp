@@ -1,7 +1,11 @@
 #include "DataLoader.h"
 
 #include "models/models.h"
+#include "read_pipeline/HtsReader.h"
 #include "read_pipeline/ReadPipeline.h"
+#include "read_pipeline/SignalCache.h"
+#include "read_pipeline/read_utils.h"
+#include "utils/SignalBufferPool.h"
 #include "utils/compat_utils.h"
 #include "utils/time_utils.h"
 #include "utils/types.h"
@@ -11,13 +15,16 @@
 #include <cxxpool.h>
 #include <highfive/H5Easy.hpp>
 #include <highfive/H5File.hpp>
+#include <htslib/sam.h>
 #include <pod5_format/c_api.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <ctime>
 #include <filesystem>
+#include <map>
 #include <mutex>
 #include <optional>
 #include <stdexcept>
@@ -159,7 +166,9 @@ SimplexReadPtr process_pod5_read(
         Pod5FileReader* file,
         const std::string& path,
         const std::unordered_map<int, std::vector<DataLoader::ReadSortInfo>>* reads_by_channel,
-        const std::unordered_map<std::string, size_t>* read_id_to_index) {
+        const std::unordered_map<std::string, size_t>* read_id_to_index,
+        const SignalCache* signal_cache,
+        utils::SignalBufferPool* signal_pool) {
     uint16_t read_table_version = 0;
     ReadBatchRowInfo_t read_data;
     if (pod5_get_read_batch_row_info_data(batch, row, READ_BATCH_ROW_INFO_VERSION, &read_data,
@@ -181,16 +190,7 @@ SimplexReadPtr process_pod5_read(
     }
     std::string read_id_str(read_id_tmp);
 
-    auto options = at::TensorOptions().dtype(at::kShort);
-    auto samples = at::empty(read_data.num_samples, options);
-
-    if (pod5_get_read_complete_signal(file, batch, row, read_data.num_samples,
-                                      samples.data_ptr<int16_t>()) != POD5_OK) {
-        spdlog::error("Failed to get read {} signal: {}", row, pod5_get_error_string());
-    }
-
     auto new_read = std::make_unique<SimplexRead>();
-    new_read->read_common.raw_data = samples;
     new_read->read_common.sample_rate = run_sample_rate;
 
     auto start_time_ms = run_acquisition_start_time_ms +
@@ -218,6 +218,18 @@ SimplexReadPtr process_pod5_read(
     new_read->read_common.experiment_id = run_info_data->experiment_name;
     new_read->read_common.is_duplex = false;
 
+    // Cached signal has already been scaled and trimmed, so skips the scaler.
+    if (!signal_cache || !signal_cache->load(new_read->read_common)) {
+        auto samples = signal_pool ? signal_pool->empty(read_data.num_samples, at::kShort)
+                                   : at::empty(read_data.num_samples, at::kShort);
+
+        if (pod5_get_read_complete_signal(file, batch, row, read_data.num_samples,
+                                          samples.data_ptr<int16_t>()) != POD5_OK) {
+            spdlog::error("Failed to get read {} signal: {}", row, pod5_get_error_string());
+        }
+        new_read->read_common.raw_data = samples;
+    }
+
     // Determine the time sorted predecessor of the read
     // if that information is available (primarily used for offline
     // duplex runs).
@@ -502,6 +514,155 @@ void DataLoader::load_read_channels(std::string data_path, bool recursive_file_l
     iterate_directory(fetch_directory_entries(data_path, recursive_file_loading));
 }
 
+namespace {
+
+// Number of records read from the BAM file before the signal of their reads is loaded.  The
+// reads of a batch are loaded a POD5 file at a time, so larger batches mean fewer passes over
+// each file when the records aren't in the order the reads were basecalled.
+constexpr size_t BASECALLED_READ_BATCH_SIZE = 10000;
+
+// Records the file index and POD5 id of each read in the file at path.
+void index_pod5_read_ids(const std::string& path,
+                         size_t file_index,
+                         std::unordered_map<std::string, std::pair<size_t, ReadID>>& read_locations) {
+    pod5_init();
+    Pod5FileReader_t* file = pod5_open_file(path.c_str());
+    if (!file) {
+        spdlog::error("Failed to open file {}: {}", path, pod5_get_error_string());
+        return;
+    }
+
+    std::size_t batch_count = 0;
+    if (pod5_get_read_batch_count(&batch_count, file) != POD5_OK) {
+        spdlog::error("Failed to query batch count: {}", pod5_get_error_string());
+    }
+    for (std::size_t batch_index = 0; batch_index < batch_count; ++batch_index) {
+        Pod5ReadRecordBatch_t* batch = nullptr;
+        if (pod5_get_read_batch(&batch, file, batch_index) != POD5_OK) {
+            spdlog::error("Failed to get batch: {}", pod5_get_error_string());
+            continue;
+        }
+
+        std::size_t batch_row_count = 0;
+        if (pod5_get_read_batch_row_count(&batch_row_count, batch) != POD5_OK) {
+            spdlog::error("Failed to get batch row count");
+        }
+        for (std::size_t row = 0; row < batch_row_count; ++row) {
+            uint16_t read_table_version = 0;
+            ReadBatchRowInfo_t read_data;
+            if (pod5_get_read_batch_row_info_data(batch, row, READ_BATCH_ROW_INFO_VERSION,
+                                                  &read_data, &read_table_version) != POD5_OK) {
+                spdlog::error("Failed to get read {}", row);
+                continue;
+            }
+            char read_id_tmp[POD5_READ_ID_LEN];
+            if (pod5_format_read_id(read_data.read_id, read_id_tmp) != POD5_OK) {
+                spdlog::error("Failed to format read id");
+                continue;
+            }
+            ReadID read_id;
+            std::memcpy(read_id.data(), read_data.read_id, POD5_READ_ID_SIZE);
+            read_locations.emplace(read_id_tmp, std::make_pair(file_index, read_id));
+        }
+
+        if (pod5_free_read_batch(batch) != POD5_OK) {
+            spdlog::error("Failed to release batch");
+        }
+    }
+    if (pod5_close_and_free_reader(file) != POD5_OK) {
+        spdlog::error("Failed to close and free POD5 reader");
+    }
+}
+
+}  // namespace
+
+void DataLoader::load_basecalled_reads(
+        const std::string& bam_path,
+        const std::string& data_path,
+        bool recursive_file_loading,
+        int model_stride,
+        const std::function<void(const std::string&, BamPtr)>& record_callback) {
+    std::vector<std::string> pod5_files;
+    std::unordered_map<std::string, std::pair<size_t, ReadID>> read_locations;
+    for (const auto& entry : fetch_directory_entries(data_path, recursive_file_loading)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        if (ext == ".pod5") {
+            index_pod5_read_ids(entry.path().string(), pod5_files.size(), read_locations);
+            pod5_files.push_back(entry.path().string());
+        }
+    }
+    spdlog::debug("> Indexed {} reads in {} POD5 files", read_locations.size(), pod5_files.size());
+
+    auto pass_through = [this](BamPtr record) {
+        m_pipeline.push_message(std::move(record));
+        ++m_passed_through_record_count;
+    };
+
+    // Records waiting for the signal of their reads, and the ids of those reads in each file.
+    std::unordered_map<std::string, BamPtr> pending_records;
+    std::map<size_t, std::vector<ReadID>> pending_read_ids;
+    auto load_pending_reads = [&]() {
+        auto rebuild_read = [&](SimplexReadPtr read) {
+            const auto read_id = read->read_common.read_id;
+            auto it = pending_records.find(read_id);
+            if (it == pending_records.end()) {
+                return;
+            }
+            auto record = std::move(it->second);
+            pending_records.erase(it);
+
+            try {
+                utils::restore_basecall(*read, record.get());
+                if (read->read_common.model_stride != model_stride) {
+                    throw std::runtime_error("move table stride " +
+                                             std::to_string(read->read_common.model_stride) +
+                                             " doesn't match the model's");
+                }
+            } catch (const std::exception& e) {
+                spdlog::debug("Can't rebuild read {} from its record: {}", read_id, e.what());
+                pass_through(std::move(record));
+                return;
+            }
+            record_callback(read_id, std::move(record));
+            m_pipeline.push_message(std::move(read));
+            m_loaded_read_count++;
+        };
+
+        for (const auto& [file_index, read_ids] : pending_read_ids) {
+            load_pod5_reads_from_file_by_read_ids(pod5_files[file_index], read_ids, rebuild_read);
+        }
+        // Anything left is for reads which couldn't be loaded.
+        for (auto& [read_id, record] : pending_records) {
+            pass_through(std::move(record));
+        }
+        pending_records.clear();
+        pending_read_ids.clear();
+    };
+
+    HtsReader reader(bam_path, std::nullopt);
+    while (reader.read()) {
+        const bam1_t* record = reader.record.get();
+        const std::string read_id = bam_get_qname(record);
+        // Secondary and supplementary records may not hold the whole basecall.
+        const bool is_primary = !(record->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY));
+        const auto location = read_locations.find(read_id);
+        if (!is_primary || location == read_locations.end() || !bam_aux_get(record, "mv") ||
+            pending_records.count(read_id) != 0) {
+            pass_through(BamPtr(bam_dup1(record)));
+            continue;
+        }
+
+        pending_read_ids[location->second.first].push_back(location->second.second);
+        pending_records.emplace(read_id, BamPtr(bam_dup1(record)));
+        if (pending_records.size() == BASECALLED_READ_BATCH_SIZE) {
+            load_pending_reads();
+        }
+    }
+    load_pending_reads();
+}
+
 std::unordered_map<std::string, ReadGroup> DataLoader::load_read_groups(
         std::string data_path,
         std::string model_path,
@@ -756,8 +917,10 @@ std::vector<models::ChemistryKey> DataLoader::get_sequencing_chemistry(
     }
 }
 
-void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
-                                                       const std::vector<ReadID>& read_ids) {
+void DataLoader::load_pod5_reads_from_file_by_read_ids(
+        const std::string& path,
+        const std::vector<ReadID>& read_ids,
+        const std::function<void(SimplexReadPtr)>& read_callback) {
     pod5_init();
 
     // Open the file ready for walking:
@@ -821,14 +984,19 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
 
             if (can_process_pod5_row(batch, row, m_allowed_read_ids, m_ignored_read_ids)) {
                 futures.push_back(pool.push(process_pod5_read, row, batch, file, path,
-                                            &m_reads_by_channel, &m_read_id_to_index));
+                                            &m_reads_by_channel, &m_read_id_to_index,
+                                            m_signal_cache.get(), m_signal_pool.get()));
             }
         }
 
         for (auto& v : futures) {
             auto read = v.get();
-            m_pipeline.push_message(std::move(read));
-            m_loaded_read_count++;
+            if (read_callback) {
+                read_callback(std::move(read));
+            } else {
+                m_pipeline.push_message(std::move(read));
+                m_loaded_read_count++;
+            }
         }
 
         if (pod5_free_read_batch(batch) != POD5_OK) {
@@ -881,7 +1049,8 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
 
             if (can_process_pod5_row(batch, int(row), m_allowed_read_ids, m_ignored_read_ids)) {
                 futures.push_back(pool.push(process_pod5_read, row, batch, file, path,
-                                            &m_reads_by_channel, &m_read_id_to_index));
+                                            &m_reads_by_channel, &m_read_id_to_index,
+                                            m_signal_cache.get(), m_signal_pool.get()));
             }
         }
 
@@ -943,8 +1112,9 @@ void DataLoader::load_fast5_reads_from_file(const std::string& path) {
             throw std::runtime_error("Invalid FAST5 Signal data type of " +
                                      ds.getDataType().string());
 
-        auto options = at::TensorOptions().dtype(at::kShort);
-        auto samples = at::empty(ds.getElementCount(), options);
+        const auto num_samples = int64_t(ds.getElementCount());
+        auto samples = m_signal_pool ? m_signal_pool->empty(num_samples, at::kShort)
+                                     : at::empty(num_samples, at::kShort);
         ds.read(samples.data_ptr<int16_t>());
 
         HighFive::Attribute mux_attr = raw.getAttribute("start_mux");
@@ -1003,12 +1173,16 @@ DataLoader::DataLoader(Pipeline& pipeline,
                        size_t num_worker_threads,
                        size_t max_reads,
                        std::optional<std::unordered_set<std::string>> read_list,
-                       std::unordered_set<std::string> read_ignore_list)
+                       std::unordered_set<std::string> read_ignore_list,
+                       std::shared_ptr<const SignalCache> signal_cache,
+                       std::shared_ptr<utils::SignalBufferPool> signal_pool)
         : m_pipeline(pipeline),
           m_device(device),
           m_num_worker_threads(num_worker_threads),
           m_allowed_read_ids(std::move(read_list)),
-          m_ignored_read_ids(std::move(read_ignore_list)) {
+          m_ignored_read_ids(std::move(read_ignore_list)),
+          m_signal_cache(std::move(signal_cache)),
+          m_signal_pool(std::move(signal_pool)) {
     m_max_reads = max_reads == 0 ? std::numeric_limits<decltype(m_max_reads)>::max() : max_reads;
     assert(m_num_worker_threads > 0);
     static std::once_flag vbz_init_flag;
@@ -1016,6 +1190,8 @@ DataLoader::DataLoader(Pipeline& pipeline,
 }
 
 stats::NamedStats DataLoader::sample_stats() const {
-    return stats::NamedStats{{"loaded_read_count", static_cast<double>(m_loaded_read_count)}};
+    return stats::NamedStats{
+            {"loaded_read_count", static_cast<double>(m_loaded_read_count)},
+            {"passed_through_record_count", static_cast<double>(m_passed_through_record_count)}};
 }
 }  // namespace dorado
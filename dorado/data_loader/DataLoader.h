@@ -4,6 +4,7 @@
 #include "utils/types.h"
 
 #include <array>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -17,8 +18,14 @@ struct Pod5FileReader;
 namespace dorado {
 
 class Pipeline;
+class SignalCache;
+class SimplexRead;
 struct ReadGroup;
 
+namespace utils {
+class SignalBufferPool;
+}
+
 constexpr size_t POD5_READ_ID_SIZE = 16;
 using ReadID = std::array<uint8_t, POD5_READ_ID_SIZE>;
 typedef std::map<int, std::vector<ReadID>> channel_to_read_id_t;
@@ -35,12 +42,27 @@ public:
                size_t num_worker_threads,
                size_t max_reads,
                std::optional<std::unordered_set<std::string>> read_list,
-               std::unordered_set<std::string> read_ignore_list);
+               std::unordered_set<std::string> read_ignore_list,
+               std::shared_ptr<const SignalCache> signal_cache = nullptr,
+               std::shared_ptr<utils::SignalBufferPool> signal_pool = nullptr);
     ~DataLoader() = default;
     void load_reads(const std::string& path,
                     bool recursive_file_loading,
                     ReadOrder traversal_order);
 
+    // Loads the reads of a BAM file written by the basecaller with --emit-moves, rebuilding each
+    // from its primary record and its signal in the POD5 files in data_path, so that modified
+    // bases can be called without basecalling the reads again.  The record a read was rebuilt
+    // from is passed to record_callback before the read is pushed.  Records which can't be
+    // rebuilt, e.g. secondary alignments, split reads, or those with a move table stride other
+    // than model_stride, are pushed as they are.
+    void load_basecalled_reads(
+            const std::string& bam_path,
+            const std::string& data_path,
+            bool recursive_file_loading,
+            int model_stride,
+            const std::function<void(const std::string&, BamPtr)>& record_callback);
+
     static std::unordered_map<std::string, ReadGroup> load_read_groups(
             std::string data_path,
             std::string model_path,
@@ -71,16 +93,24 @@ public:
 private:
     void load_fast5_reads_from_file(const std::string& path);
     void load_pod5_reads_from_file(const std::string& path);
-    void load_pod5_reads_from_file_by_read_ids(const std::string& path,
-                                               const std::vector<ReadID>& read_ids);
+    // Reads are passed to read_callback if it's set, rather than pushed to the pipeline.
+    void load_pod5_reads_from_file_by_read_ids(
+            const std::string& path,
+            const std::vector<ReadID>& read_ids,
+            const std::function<void(std::unique_ptr<SimplexRead>)>& read_callback = {});
     void load_read_channels(std::string data_path, bool recursive_file_loading);
     Pipeline& m_pipeline;  // Where should the loaded reads go?
     std::atomic<size_t> m_loaded_read_count{0};
+    std::atomic<size_t> m_passed_through_record_count{0};
     std::string m_device;
     size_t m_num_worker_threads{1};
     size_t m_max_reads{0};
     std::optional<std::unordered_set<std::string>> m_allowed_read_ids;
     std::unordered_set<std::string> m_ignored_read_ids;
+    // POD5 reads found in the cache are loaded from it rather than decompressed.
+    std::shared_ptr<const SignalCache> m_signal_cache;
+    // If set, signal is loaded into buffers from the pool.
+    std::shared_ptr<utils::SignalBufferPool> m_signal_pool;
 
     std::unordered_map<std::string, channel_to_read_id_t> m_file_channel_read_order_map;
     std::unordered_map<int, std::vector<ReadSortInfo>> m_reads_by_channel;
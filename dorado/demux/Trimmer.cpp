@@ -7,6 +7,14 @@
 #include <ATen/ATen.h>
 #include <htslib/sam.h>
 
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
 using Slice = at::indexing::Slice;
 
 namespace {
@@ -38,6 +46,63 @@ std::pair<int, int> reverse_complement_interval(const std::pair<int, int>& inter
     return {seqlen - interval.second, seqlen - interval.first};
 }
 
+// Copies length bases of a 4-bit packed sequence starting from base start in src to the start of
+// dest.
+void copy_packed_sequence(uint8_t* dest, const uint8_t* src, int start, int length) {
+    src += start / 2;
+    if (start % 2 == 0) {
+        memcpy(dest, src, (size_t(length) + 1) / 2);
+    } else {
+        // Every base moves to the other half of a byte.
+        for (int i = 0; i < length / 2; ++i) {
+            dest[i] = uint8_t((src[i] << 4) | (src[i + 1] >> 4));
+        }
+        if (length % 2 != 0) {
+            dest[length / 2] = uint8_t(src[length / 2] << 4);
+        }
+    }
+    if (length % 2 != 0) {
+        // The unused half of the last byte is zero.
+        dest[length / 2] &= 0xf0;
+    }
+}
+
+// Returns the size of the value of a tag in an aux block, including its type, given a pointer to
+// its type.
+size_t aux_value_size(const uint8_t* value, const uint8_t* aux_end) {
+    auto element_size = [](uint8_t type) -> size_t {
+        switch (type) {
+        case 'A':
+        case 'c':
+        case 'C':
+            return 1;
+        case 's':
+        case 'S':
+            return 2;
+        case 'i':
+        case 'I':
+        case 'f':
+            return 4;
+        case 'd':
+            return 8;
+        default:
+            throw std::runtime_error("Invalid BAM aux type " + std::to_string(int(type)));
+        }
+    };
+    switch (*value) {
+    case 'Z':
+    case 'H':
+        return size_t(std::find(value + 1, aux_end, uint8_t(0)) - value) + 1;
+    case 'B': {
+        uint32_t count;
+        memcpy(&count, value + 2, sizeof(count));
+        return 6 + count * element_size(value[1]);
+    }
+    default:
+        return 1 + element_size(*value);
+    }
+}
+
 }  // namespace
 
 namespace dorado {
@@ -129,32 +194,24 @@ std::pair<int, int> Trimmer::determine_trim_interval(const AdapterScoreResult& r
 
 BamPtr Trimmer::trim_sequence(BamPtr input, std::pair<int, int> trim_interval) {
     bam1_t* input_record = input.get();
+    const int seqlen = input_record->core.l_qseq;
+    if (trim_interval.first >= seqlen || trim_interval.second > seqlen ||
+        trim_interval.second < trim_interval.first) {
+        throw std::invalid_argument("Trim interval " + std::to_string(trim_interval.first) + "-" +
+                                    std::to_string(trim_interval.second) +
+                                    " is invalid for sequence of length " +
+                                    std::to_string(seqlen));
+    }
+    if (trim_interval.first == 0 && trim_interval.second == seqlen) {
+        return input;
+    }
+
+    // The record is trimmed in its packed form: the sequence, qualities, and the tags which don't
+    // depend on the sequence are copied straight into a single newly allocated data block, and
+    // only the tags which do are rewritten.
+    const int trimmed_len = trim_interval.second - trim_interval.first;
+    const bool is_seq_reversed = input_record->core.flag & BAM_FREVERSE;
 
-    bool is_seq_reversed = input_record->core.flag & BAM_FREVERSE;
-
-    // Fetch components that need to be trimmed.
-    std::string seq = utils::extract_sequence(input_record);
-    std::vector<uint8_t> qual = utils::extract_quality(input_record);
-    auto [stride, move_vals] = utils::extract_move_table(input_record);
-    int ts = bam_aux_get(input_record, "ts") ? int(bam_aux2i(bam_aux_get(input_record, "ts"))) : 0;
-    int ns = bam_aux_get(input_record, "ns") ? int(bam_aux2i(bam_aux_get(input_record, "ns"))) : 0;
-    auto [modbase_str, modbase_probs] = utils::extract_modbase_info(input_record);
-
-    // Actually trim components.
-    auto trimmed_seq = utils::trim_sequence(seq, trim_interval);
-    auto trimmed_qual = utils::trim_quality(qual, trim_interval);
-    auto [positions_trimmed, trimmed_moves] = utils::trim_move_table(move_vals, trim_interval);
-    ts += positions_trimmed * stride;
-    // After sequence trimming, the number of samples corresponding to the sequence is the size of
-    // the new move table * stride. However, the ns tag includes the number of samples trimmed from the
-    // front of the read as well.
-    // |---------------------- ns ------------------|
-    // |----ts----|--------moves signal-------------|
-    ns = int(trimmed_moves.size() * stride) + ts;
-    auto [trimmed_modbase_str, trimmed_modbase_probs] = utils::trim_modbase_info(
-            is_seq_reversed ? utils::reverse_complement(seq) : seq, modbase_str, modbase_probs,
-            is_seq_reversed ? reverse_complement_interval(trim_interval, int(seq.length()))
-                            : trim_interval);
     auto n_cigar = input_record->core.n_cigar;
     std::vector<uint32_t> ops;
     uint32_t ref_pos_consumed = 0;
@@ -165,40 +222,169 @@ BamPtr Trimmer::trim_sequence(BamPtr input, std::pair<int, int> trim_interval) {
                 ops.empty() ? 0 : utils::ref_pos_consumed(n_cigar, cigar_arr, trim_interval.first);
     }
 
-    // Create a new bam record to hold the trimmed read.
-    bam1_t* out_record = bam_init1();
-    bam_set1(out_record, input_record->core.l_qname - input_record->core.l_extranul - 1,
-             bam_get_qname(input_record), input_record->core.flag, input_record->core.tid,
-             input_record->core.pos + ref_pos_consumed, input_record->core.qual, ops.size(),
-             ops.empty() ? NULL : ops.data(), input_record->core.mtid, input_record->core.mpos,
-             input_record->core.isize, trimmed_seq.size(), trimmed_seq.data(),
-             trimmed_qual.empty() ? NULL : (char*)trimmed_qual.data(), bam_get_l_aux(input_record));
-    memcpy(bam_get_aux(out_record), bam_get_aux(input_record), bam_get_l_aux(input_record));
-    out_record->l_data += bam_get_l_aux(input_record);
-
-    // Insert the new tags and delete the old ones.
-    if (!trimmed_moves.empty()) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "mv"));
+    // The moves kept are those from the one for the first base kept to the one for the first base
+    // after the interval.
+    const uint8_t* mv_tag = bam_aux_get(input_record, "mv");
+    int stride = 0;
+    int moves_begin = 0;
+    int moves_end = 0;
+    if (mv_tag && trimmed_len > 0) {
+        if (mv_tag[1] != 'c' && mv_tag[1] != 'C') {
+            throw std::runtime_error("Unexpected move table type in " +
+                                     std::string(bam_get_qname(input_record)));
+        }
         // Move table format is stride followed by moves.
-        trimmed_moves.insert(trimmed_moves.begin(), uint8_t(stride));
-        bam_aux_update_array(out_record, "mv", 'c', int(trimmed_moves.size()),
-                             (uint8_t*)trimmed_moves.data());
+        const int num_moves = int(bam_auxB_len(mv_tag)) - 1;
+        const uint8_t* moves = mv_tag + 7;
+        stride = int(int8_t(mv_tag[6]));
+        moves_begin = moves_end = num_moves;
+        int seq_base_pos = -1;
+        for (int i = 0; i < num_moves; ++i) {
+            if (moves[i] == 1) {
+                ++seq_base_pos;
+                if (seq_base_pos == trim_interval.first) {
+                    moves_begin = i;
+                } else if (seq_base_pos == trim_interval.second) {
+                    moves_end = i;
+                    break;
+                }
+            }
+        }
+    }
+    const int num_moves_kept = moves_end - moves_begin;
+    auto ts_tag = bam_aux_get(input_record, "ts");
+    auto ns_tag = bam_aux_get(input_record, "ns");
+    const int32_t ts = (ts_tag ? int32_t(bam_aux2i(ts_tag)) : 0) + moves_begin * stride;
+    // After sequence trimming, the number of samples corresponding to the sequence is the size of
+    // the new move table * stride. However, the ns tag includes the number of samples trimmed from the
+    // front of the read as well.
+    // |---------------------- ns ------------------|
+    // |----ts----|--------moves signal-------------|
+    const int32_t ns = num_moves_kept * stride + ts;
+
+    // Modified base tags count bases from the start of the sequence as basecalled, so they still
+    // need the unpacked sequence.
+    const bool has_modbase_tags = bam_aux_get(input_record, "MM") != nullptr;
+    std::string trimmed_modbase_str;
+    std::vector<uint8_t> trimmed_modbase_probs;
+    if (has_modbase_tags) {
+        auto [modbase_str, modbase_probs] = utils::extract_modbase_info(input_record);
+        const auto seq = utils::extract_sequence(input_record);
+        std::tie(trimmed_modbase_str, trimmed_modbase_probs) = utils::trim_modbase_info(
+                is_seq_reversed ? utils::reverse_complement(seq) : seq, modbase_str,
+                modbase_probs,
+                is_seq_reversed ? reverse_complement_interval(trim_interval, seqlen)
+                                : trim_interval);
     }
 
-    if (!trimmed_modbase_str.empty()) {
-        bam_aux_del(out_record, bam_aux_get(out_record, "MM"));
-        bam_aux_append(out_record, "MM", 'Z', int(trimmed_modbase_str.length() + 1),
-                       (uint8_t*)trimmed_modbase_str.c_str());
-        bam_aux_del(out_record, bam_aux_get(out_record, "ML"));
-        bam_aux_update_array(out_record, "ML", 'C', int(trimmed_modbase_probs.size()),
-                             (uint8_t*)trimmed_modbase_probs.data());
-        bam_aux_update_int(out_record, "MN", trimmed_seq.length());
+    // Writes the trimmed tags to dest, or just measures them if dest is null.
+    const int32_t modbase_count = trimmed_len;
+    auto write_aux = [&](uint8_t* dest) {
+        size_t size = 0;
+        auto write = [&](const void* src, size_t count) {
+            if (dest) {
+                memcpy(dest + size, src, count);
+            }
+            size += count;
+        };
+        auto write_tag = [&](const char* tag, char type) {
+            write(tag, 2);
+            write(&type, 1);
+        };
+        auto write_array_header = [&](const char* tag, char subtype, uint32_t count) {
+            write_tag(tag, 'B');
+            write(&subtype, 1);
+            write(&count, sizeof(count));
+        };
+
+        const uint8_t* aux = bam_get_aux(input_record);
+        const uint8_t* aux_end = input_record->data + input_record->l_data;
+        bool has_ts = false, has_ns = false, has_mn = false;
+        while (aux + 3 <= aux_end) {
+            const char tag[2] = {char(aux[0]), char(aux[1])};
+            const uint8_t* value = aux + 2;
+            const size_t value_size = aux_value_size(value, aux_end);
+            if (tag[0] == 'm' && tag[1] == 'v' && num_moves_kept > 0) {
+                write_array_header("mv", char(value[1]), uint32_t(num_moves_kept + 1));
+                write(&value[6], 1);
+                write(value + 7 + moves_begin, num_moves_kept);
+            } else if (tag[0] == 't' && tag[1] == 's') {
+                write_tag("ts", 'i');
+                write(&ts, sizeof(ts));
+                has_ts = true;
+            } else if (tag[0] == 'n' && tag[1] == 's') {
+                write_tag("ns", 'i');
+                write(&ns, sizeof(ns));
+                has_ns = true;
+            } else if (has_modbase_tags && tag[0] == 'M' && tag[1] == 'M') {
+                write_tag("MM", 'Z');
+                write(trimmed_modbase_str.c_str(), trimmed_modbase_str.size() + 1);
+            } else if (has_modbase_tags && tag[0] == 'M' && tag[1] == 'L') {
+                write_array_header("ML", 'C', uint32_t(trimmed_modbase_probs.size()));
+                write(trimmed_modbase_probs.data(), trimmed_modbase_probs.size());
+            } else if (has_modbase_tags && tag[0] == 'M' && tag[1] == 'N') {
+                write_tag("MN", 'i');
+                write(&modbase_count, sizeof(modbase_count));
+                has_mn = true;
+            } else {
+                write(aux, 2 + value_size);
+            }
+            aux = value + value_size;
+        }
+        if (has_modbase_tags && !has_mn) {
+            write_tag("MN", 'i');
+            write(&modbase_count, sizeof(modbase_count));
+        }
+        if (!has_ts) {
+            write_tag("ts", 'i');
+            write(&ts, sizeof(ts));
+        }
+        if (!has_ns) {
+            write_tag("ns", 'i');
+            write(&ns, sizeof(ns));
+        }
+        return size;
+    };
+
+    const size_t l_qname = input_record->core.l_qname;
+    const size_t l_cigar = ops.size() * sizeof(uint32_t);
+    const size_t l_seq = (size_t(trimmed_len) + 1) / 2;
+    const size_t l_data = l_qname + l_cigar + l_seq + size_t(trimmed_len) + write_aux(nullptr);
+
+    BamPtr output(bam_init1());
+    bam1_t* out_record = output.get();
+    if (sam_realloc_bam_data(out_record, l_data) < 0) {
+        throw std::bad_alloc();
+    }
+    out_record->core = input_record->core;
+    out_record->id = input_record->id;
+    out_record->core.pos += ref_pos_consumed;
+    out_record->core.n_cigar = uint32_t(ops.size());
+    out_record->core.l_qseq = trimmed_len;
+    out_record->l_data = int(l_data);
+
+    // As bam_set1().
+    hts_pos_t rlen = 0;
+    if (!(out_record->core.flag & BAM_FUNMAP)) {
+        rlen = bam_cigar2rlen(int(ops.size()), ops.data());
     }
+    if (rlen == 0) {
+        rlen = 1;
+    }
+    out_record->core.bin = uint16_t(
+            hts_reg2bin(out_record->core.pos, out_record->core.pos + rlen, 14, 5));
 
-    bam_aux_update_int(out_record, "ts", ts);
-    bam_aux_update_int(out_record, "ns", ns);
+    memcpy(out_record->data, input_record->data, l_qname);
+    if (!ops.empty()) {
+        memcpy(bam_get_cigar(out_record), ops.data(), l_cigar);
+    }
+    copy_packed_sequence(bam_get_seq(out_record), bam_get_seq(input_record), trim_interval.first,
+                         trimmed_len);
+    memcpy(bam_get_qual(out_record), bam_get_qual(input_record) + trim_interval.first,
+           trimmed_len);
+    write_aux(bam_get_aux(out_record));
 
-    return BamPtr(out_record);
+    return output;
 }
 
 void Trimmer::trim_sequence(SimplexRead& read, std::pair<int, int> trim_interval) {
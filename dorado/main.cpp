@@ -71,6 +71,9 @@ int main(int argc, char* argv[]) {
             {"summary", &dorado::summary},
             {"demux", &dorado::demuxer},
             {"trim", &dorado::trim},
+            {"modbase", &dorado::modbase},
+            {"daemon", &dorado::daemon_server},
+            {"benchmark", &dorado::benchmark},
     };
 
     std::vector<std::string> arguments(argv + 1, argv + argc);
@@ -18,6 +18,7 @@
 #include <toml.hpp>
 #include <torch/torch.h>
 
+#include <algorithm>
 #include <chrono>
 
 using namespace std::chrono_literals;
@@ -86,8 +87,10 @@ public:
 
     ModBaseCaller(const std::vector<std::filesystem::path>& model_paths,
                   int batch_size,
-                  const std::string& device)
-            : m_num_models(model_paths.size()) {
+                  const std::string& device,
+                  int num_threads_per_model)
+            : m_num_models(model_paths.size()),
+              m_num_threads_per_model(std::max(num_threads_per_model, 1)) {
         if (device == "cpu") {
             // no slow_conv2d_cpu for type Half, need to use float32
             m_options = at::TensorOptions().device(torch::kCPU).dtype(torch::kFloat32);
@@ -110,7 +113,7 @@ public:
         // Allocate enough elements up-front so that m_caller_data.push_back() doesn't reallocate while
         // other threads can be referencing elements that it's holding.
         m_caller_data.reserve(m_num_models);
-        m_task_threads.reserve(m_num_models);
+        m_task_threads.reserve(m_num_models * m_num_threads_per_model);
 
         for (size_t model_id = 0; model_id < m_num_models; ++model_id) {
             const auto& model_path = model_paths[model_id];
@@ -125,15 +128,17 @@ public:
 
     void start_threads() {
         for (size_t model_id = 0; model_id < m_num_models; ++model_id) {
-            m_task_threads.push_back(std::make_unique<std::thread>(
-                    &ModBaseCaller::modbase_task_thread_fn, this, model_id));
+            for (size_t i = 0; i < m_num_threads_per_model; ++i) {
+                m_task_threads.push_back(std::make_unique<std::thread>(
+                        &ModBaseCaller::modbase_task_thread_fn, this, model_id));
+            }
         }
     }
 
     ~ModBaseCaller() {
         m_terminate.store(true);
         for (auto& caller_data : m_caller_data) {
-            caller_data->input_cv.notify_one();
+            caller_data->input_cv.notify_all();
         }
 
         for (auto& task_thread : m_task_threads) {
@@ -147,8 +152,16 @@ public:
                            int num_chunks) {
         NVTX3_FUNC_RANGE();
         auto& caller_data = m_caller_data[model_id];
-        auto task = std::make_shared<ModBaseTask>(input_sigs.to(m_options.device()),
-                                                  input_seqs.to(m_options.device()), num_chunks);
+        std::shared_ptr<ModBaseTask> task;
+        if (m_options.device().is_cpu()) {
+            // There's nothing to gain from fixed size batches on CPU, so only the chunks actually
+            // present are run through the model.
+            task = std::make_shared<ModBaseTask>(input_sigs.narrow(0, 0, num_chunks),
+                                                 input_seqs.narrow(0, 0, num_chunks), num_chunks);
+        } else {
+            task = std::make_shared<ModBaseTask>(input_sigs.to(m_options.device()),
+                                                 input_seqs.to(m_options.device()), num_chunks);
+        }
 #if DORADO_GPU_BUILD && !defined(__APPLE__)
         if (m_options.device().is_cuda()) {
             task->stream = c10::cuda::getCurrentCUDAStream(m_options.device().index());
@@ -185,8 +198,27 @@ public:
 
             auto task = caller_data->input_queue.back();
             caller_data->input_queue.pop_back();
+
+            // On CPU, partial batches from other runners which are already waiting are merged
+            // into this one, up to the batch size, and called with a single forward.
+            std::vector<std::shared_ptr<ModBaseTask>> merged_tasks;
+            if (m_options.device().is_cpu()) {
+                int num_merged_chunks = task->num_chunks;
+                while (!caller_data->input_queue.empty() &&
+                       num_merged_chunks + caller_data->input_queue.back()->num_chunks <=
+                               caller_data->batch_size) {
+                    num_merged_chunks += caller_data->input_queue.back()->num_chunks;
+                    merged_tasks.push_back(std::move(caller_data->input_queue.back()));
+                    caller_data->input_queue.pop_back();
+                }
+            }
             input_lock.unlock();
 
+            if (!merged_tasks.empty()) {
+                call_merged_tasks(*caller_data, std::move(task), std::move(merged_tasks));
+                continue;
+            }
+
 #if DORADO_GPU_BUILD && !defined(__APPLE__)
             // If task->stream is set, sets the current stream to task->stream, and the current device to
             // the device associated with the stream. Resets both to their prior state on destruction
@@ -204,16 +236,52 @@ public:
             m_model_ms += timer.GetElapsedMS();
 #endif
             ++m_num_batches_called;
+            ++m_num_forwards;
+            m_num_chunks_called += task->num_chunks;
             task->done = true;
             task_lock.unlock();
             task->cv.notify_one();
         }
     }
 
+    // Runs task and merged_tasks through the model as one batch, and hands each task its rows
+    // of the output.  CPU only.
+    void call_merged_tasks(ModBaseData& caller_data,
+                           std::shared_ptr<ModBaseTask> task,
+                           std::vector<std::shared_ptr<ModBaseTask>> merged_tasks) {
+        NVTX3_FUNC_RANGE();
+        merged_tasks.insert(merged_tasks.begin(), std::move(task));
+
+        std::vector<at::Tensor> input_sigs;
+        std::vector<at::Tensor> input_seqs;
+        input_sigs.reserve(merged_tasks.size());
+        input_seqs.reserve(merged_tasks.size());
+        for (const auto& merged_task : merged_tasks) {
+            input_sigs.push_back(merged_task->input_sigs);
+            input_seqs.push_back(merged_task->input_seqs);
+        }
+        auto out = caller_data.module_holder->forward(at::cat(input_sigs), at::cat(input_seqs));
+
+        int64_t row = 0;
+        for (auto& merged_task : merged_tasks) {
+            {
+                std::lock_guard<std::mutex> task_lock(merged_task->mut);
+                merged_task->out = out.narrow(0, row, merged_task->num_chunks);
+                merged_task->done = true;
+            }
+            merged_task->cv.notify_one();
+            row += merged_task->num_chunks;
+            m_num_chunks_called += merged_task->num_chunks;
+        }
+        m_num_batches_called += int64_t(merged_tasks.size());
+        m_num_tasks_merged += int64_t(merged_tasks.size() - 1);
+        ++m_num_forwards;
+    }
+
     void terminate() {
         m_terminate.store(true);
         for (auto& caller_data : m_caller_data) {
-            caller_data->input_cv.notify_one();
+            caller_data->input_cv.notify_all();
         }
         for (auto& task_thread : m_task_threads) {
             task_thread->join();
@@ -235,6 +303,15 @@ public:
     stats::NamedStats sample_stats() const {
         stats::NamedStats stats;
         stats["batches_called"] = double(m_num_batches_called);
+        stats["forwards_called"] = double(m_num_forwards);
+        stats["tasks_merged"] = double(m_num_tasks_merged);
+        // The fraction of each forward's batch occupied by real chunks, across all models.
+        int64_t batch_capacity = 0;
+        if (!m_caller_data.empty()) {
+            batch_capacity = m_num_forwards * m_caller_data.front()->batch_size;
+        }
+        stats["batch_utilisation"] =
+                batch_capacity > 0 ? double(m_num_chunks_called) / double(batch_capacity) : 0.0;
 #if DORADO_GPU_BUILD && !defined(__APPLE__)
         stats["model_ms"] = double(m_model_ms);
 #endif
@@ -242,6 +319,7 @@ public:
     }
 
     size_t m_num_models = 0;
+    size_t m_num_threads_per_model = 1;
 
     at::TensorOptions m_options;
     std::atomic<bool> m_terminate{false};
@@ -250,14 +328,19 @@ public:
 
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
+    std::atomic<int64_t> m_num_forwards = 0;
+    std::atomic<int64_t> m_num_chunks_called = 0;
+    std::atomic<int64_t> m_num_tasks_merged = 0;
     std::atomic<int64_t> m_model_ms = 0;
 };
 
 std::shared_ptr<ModBaseCaller> create_modbase_caller(
         const std::vector<std::filesystem::path>& model_paths,
         int batch_size,
-        const std::string& device) {
-    return std::make_shared<ModBaseCaller>(model_paths, batch_size, device);
+        const std::string& device,
+        int num_threads_per_model) {
+    return std::make_shared<ModBaseCaller>(model_paths, batch_size, device,
+                                           num_threads_per_model);
 }
 
 ModBaseRunner::ModBaseRunner(std::shared_ptr<ModBaseCaller> caller) : m_caller(std::move(caller)) {
@@ -293,7 +376,7 @@ ModBaseRunner::ModBaseRunner(std::shared_ptr<ModBaseCaller> caller) : m_caller(s
 void ModBaseRunner::accept_chunk(int model_id,
                                  int chunk_idx,
                                  const at::Tensor& signal,
-                                 const std::vector<int8_t>& kmers) {
+                                 const at::Tensor& kmers) {
     // As usual, avoid torch indexing because it is glacially slow.
     // GPU base calling uses float16 signals and input tensors.
     // CPU base calling uses float16 signals, float32 input tensors.
@@ -307,12 +390,13 @@ void ModBaseRunner::accept_chunk(int model_id,
     dorado::utils::copy_tensor_elems(input_sigs, chunk_idx * sig_len, signal, 0, sig_len);
 
     const auto kmer_elem_count = input_seqs.size(1) * input_seqs.size(2);
+    assert(kmers.numel() == kmer_elem_count && kmers.is_contiguous());
     if (input_seqs.dtype() != torch::kInt8) {
         throw std::runtime_error("Unsupported input dtype");
     }
     using SeqInputType = int8_t;
     SeqInputType* const input_seqs_ptr = input_seqs.data_ptr<SeqInputType>();
-    std::memcpy(&input_seqs_ptr[chunk_idx * kmer_elem_count], kmers.data(),
+    std::memcpy(&input_seqs_ptr[chunk_idx * kmer_elem_count], kmers.data_ptr<SeqInputType>(),
                 kmer_elem_count * sizeof(SeqInputType));
 }
 
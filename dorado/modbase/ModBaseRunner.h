@@ -16,10 +16,13 @@ namespace dorado::modbase {
 struct ModBaseModelConfig;
 class ModBaseCaller;
 
+// num_threads_per_model forward passes of each model may run concurrently.  On CPU, partial batches
+// queued for a model are merged into a single forward pass.
 std::shared_ptr<ModBaseCaller> create_modbase_caller(
         const std::vector<std::filesystem::path>& model_paths,
         int batch_size,
-        const std::string& device);
+        const std::string& device,
+        int num_threads_per_model = 1);
 
 class ModBaseRunner {
 public:
@@ -27,7 +30,7 @@ public:
     void accept_chunk(int model_id,
                       int chunk_idx,
                       const at::Tensor& signal,
-                      const std::vector<int8_t>& kmers);
+                      const at::Tensor& kmers);
     at::Tensor call_chunks(int model_id, int num_chunks);
     at::Tensor scale_signal(size_t caller_id,
                             at::Tensor signal,
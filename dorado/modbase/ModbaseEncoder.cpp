@@ -25,12 +25,13 @@ ModBaseEncoder::ModBaseEncoder(size_t block_stride,
 
 void ModBaseEncoder::init(const std::vector<int>& sequence_ints,
                           const std::vector<uint64_t>& seq_to_sig_map) {
-    // gcc9 doesn't support <ranges>, which would be useful here
-    m_sequence_ints = sequence_ints;
-    m_sample_offsets.resize(seq_to_sig_map.size());
-    for (size_t i = 0; i < seq_to_sig_map.size(); i++) {
-        m_sample_offsets[i] = int(seq_to_sig_map[i]);
-    }
+    // Padding the sequence once up front means the kmers of each context can be encoded straight
+    // from this buffer, with no per-context copies.
+    m_padded_sequence_ints.assign(sequence_ints.size() + m_bases_before + m_bases_after, -1);
+    std::copy(sequence_ints.begin(), sequence_ints.end(),
+              m_padded_sequence_ints.begin() + m_bases_before);
+
+    m_sample_offsets = seq_to_sig_map.data();
 
     // last entry is the signal length
     m_signal_len = int(seq_to_sig_map.back());
@@ -39,13 +40,16 @@ void ModBaseEncoder::init(const std::vector<int>& sequence_ints,
     m_seq_len = int(sequence_ints.size());
 }
 
-ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
-    NVTX3_FUNC_RANGE();
+size_t ModBaseEncoder::kmer_context_size() const {
+    return size_t(m_kmer_len) * utils::BaseInfo::NUM_BASES * size_t(m_context_samples);
+}
+
+ModBaseEncoder::ContextSamples ModBaseEncoder::compute_context_samples(size_t seq_pos) const {
     if (seq_pos >= size_t(m_seq_len)) {
         throw std::out_of_range("Sequence position out of range.");
     }
 
-    Context context{};
+    ContextSamples context{};
     int base_sample_pos =
             (compute_sample_pos(int(seq_pos)) + compute_sample_pos(int(seq_pos) + 1)) / 2;
     int samples_before = (m_context_samples / 2);
@@ -65,50 +69,58 @@ ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
         context.num_samples = size_t(last_sample) - context.first_sample;
         context.tail_samples_needed = 0;
     }
+    return context;
+}
 
-    // find base position for first and last sample
-    auto start_it = std::upper_bound(m_sample_offsets.begin(), m_sample_offsets.end(),
-                                     context.first_sample);
-    auto end_it = std::lower_bound(m_sample_offsets.begin(), m_sample_offsets.end(),
-                                   context.first_sample + context.num_samples);
+ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
+    NVTX3_FUNC_RANGE();
+    Context context{};
+    static_cast<ContextSamples&>(context) = compute_context_samples(seq_pos);
 
-    auto seq_start = std::distance(m_sample_offsets.begin(), start_it) - 1;
-    auto seq_end = std::distance(m_sample_offsets.begin(), end_it);
+    // find base position for first and last sample
+    const auto offsets_begin = m_sample_offsets;
+    const auto offsets_end = m_sample_offsets + m_seq_len + 1;
+    const auto start_it = std::upper_bound(offsets_begin, offsets_end, context.first_sample);
+    const auto end_it = std::lower_bound(offsets_begin, offsets_end,
+                                         context.first_sample + context.num_samples);
+
+    context.data.resize(kmer_context_size());
+    encode_kmers(context, size_t(std::distance(offsets_begin, start_it) - 1),
+                 size_t(std::distance(offsets_begin, end_it)), context.data.data());
+    return context;
+}
 
-    std::vector<int> seq_ints;
+void ModBaseEncoder::get_contexts(const std::vector<size_t>& seq_positions,
+                                  ContextSamples* contexts,
+                                  int8_t* encoded_kmers) const {
+    NVTX3_FUNC_RANGE();
+    const size_t num_offsets = size_t(m_seq_len) + 1;
+    const size_t context_size = kmer_context_size();
+
+    // The context windows advance monotonically with the sequence position, so rather than
+    // searching the sample offsets for each context we walk them once for the whole read.
+    // start_idx and end_idx track the upper_bound of the first sample and the lower_bound of the
+    // end sample respectively.
+    size_t start_idx = 0;
+    size_t end_idx = 0;
+    for (size_t i = 0; i < seq_positions.size(); ++i) {
+        if (i != 0 && seq_positions[i] < seq_positions[i - 1]) {
+            throw std::invalid_argument("Sequence positions must be in ascending order.");
+        }
+        auto& context = contexts[i];
+        context = compute_context_samples(seq_positions[i]);
 
-    if (seq_start >= m_bases_before &&
-        seq_end + m_bases_after < static_cast<int>(m_sequence_ints.size())) {
-        seq_ints = {m_sequence_ints.begin() + seq_start - m_bases_before,
-                    m_sequence_ints.begin() + seq_end + m_bases_after};
-    } else {
-        seq_ints.insert(seq_ints.end(), seq_end - seq_start + m_bases_before + m_bases_after, -1);
-        auto fill_st = 0;
-        auto chunk_seq_st = seq_start - m_bases_before;
-        auto chunk_seq_en = seq_end + m_bases_after;
-        if (seq_start < m_bases_before) {
-            fill_st = m_bases_before - int(seq_start);
-            chunk_seq_st = 0;
+        const uint64_t first_sample = context.first_sample;
+        const uint64_t end_sample = context.first_sample + context.num_samples;
+        while (start_idx < num_offsets && m_sample_offsets[start_idx] <= first_sample) {
+            ++start_idx;
         }
-        if (seq_end + m_bases_after > static_cast<int>(m_sequence_ints.size())) {
-            chunk_seq_en = m_sequence_ints.size();
+        while (end_idx < num_offsets && m_sample_offsets[end_idx] < end_sample) {
+            ++end_idx;
         }
-        std::copy(m_sequence_ints.begin() + chunk_seq_st, m_sequence_ints.begin() + chunk_seq_en,
-                  seq_ints.begin() + fill_st);
-    }
 
-    std::vector<int> chunk_seq_to_sig = {m_sample_offsets.begin() + seq_start,
-                                         m_sample_offsets.begin() + seq_end + 1};
-    std::transform(
-            chunk_seq_to_sig.begin(), chunk_seq_to_sig.end(), chunk_seq_to_sig.begin(),
-            [sig_start = context.first_sample, seq_to_sig_offset = context.lead_samples_needed](
-                    auto val) { return val -= int(sig_start - seq_to_sig_offset); });
-    chunk_seq_to_sig.front() = 0;
-    chunk_seq_to_sig.back() = m_context_samples;
-
-    context.data = encode_kmer(seq_ints, chunk_seq_to_sig);
-
-    return context;
+        encode_kmers(context, start_idx - 1, end_idx, encoded_kmers + i * context_size);
+    }
 }
 
 int ModBaseEncoder::compute_sample_pos(int base_pos) const {
@@ -128,24 +140,37 @@ int ModBaseEncoder::compute_sample_pos(int base_pos) const {
 
 namespace {
 
+// The kmers of a single context: seq[i] to seq[i + kmer_len - 1] is the kmer of the i'th of
+// num_bases bases, and sample_offsets[i] is where that base begins in the signal.  The first and
+// last bases are clipped to the context, and sample_shift maps signal offsets to context offsets.
+struct ContextKmers {
+    const int* seq;
+    const uint64_t* sample_offsets;
+    size_t num_bases;
+    int64_t sample_shift;
+    int context_samples;
+};
+
+// Returns the number of context samples covered by the base at seq_pos.
+inline int base_sample_count(const ContextKmers& kmers, size_t seq_pos) {
+    const int base_st = (seq_pos == 0)
+                                ? 0
+                                : int(int64_t(kmers.sample_offsets[seq_pos]) - kmers.sample_shift);
+    const int base_en = (seq_pos + 1 == kmers.num_bases)
+                                ? kmers.context_samples
+                                : int(int64_t(kmers.sample_offsets[seq_pos + 1]) -
+                                      kmers.sample_shift);
+    return base_en - base_st;
+}
+
 // Fallback path for non-AVX / kmer lengths not specifically optimised.
-std::vector<int8_t> encode_kmer_generic(const std::vector<int>& seq,
-                                        const std::vector<int>& seq_mappings,
-                                        int bases_before,
-                                        int bases_after,
-                                        int context_samples,
-                                        int kmer_len) {
-    const size_t seq_len = seq.size() - bases_before - bases_after;
-    std::vector<int8_t> output(kmer_len * utils::BaseInfo::NUM_BASES * context_samples);
-
-    int8_t* output_ptr = &output[0];
-    for (size_t seq_pos = 0; seq_pos < seq_len; ++seq_pos) {
-        auto base_st = seq_mappings[seq_pos];
-        auto base_en = seq_mappings[seq_pos + 1];
-
-        for (int i = base_st; i < base_en; ++i) {
+void encode_kmer_generic(const ContextKmers& kmers, int kmer_len, int8_t* output) {
+    int8_t* output_ptr = output;
+    for (size_t seq_pos = 0; seq_pos < kmers.num_bases; ++seq_pos) {
+        const int count = base_sample_count(kmers, seq_pos);
+        for (int i = 0; i < count; ++i) {
             for (size_t kmer_pos = 0; kmer_pos < size_t(kmer_len); ++kmer_pos) {
-                auto base = seq[seq_pos + kmer_pos];
+                auto base = kmers.seq[seq_pos + kmer_pos];
                 uint32_t base_oh = (base == -1) ? uint32_t{} : (uint32_t{1} << (base << 3));
                 // memcpy will be translated to a single 32 bit write.
                 std::memcpy(output_ptr, &base_oh, sizeof(base_oh));
@@ -153,33 +178,18 @@ std::vector<int8_t> encode_kmer_generic(const std::vector<int>& seq,
             }
         }
     }
-    return output;
 }
 
 // For non-AVX we use the generic path that handles any kmer length.
 #if ENABLE_AVX2_IMPL
 __attribute__((target("default")))
 #endif
-std::vector<int8_t>
-encode_kmer_len9(const std::vector<int>& seq,
-                 const std::vector<int>& seq_mappings,
-                 int bases_before,
-                 int bases_after,
-                 int context_samples) {
-    return encode_kmer_generic(seq, seq_mappings, bases_before, bases_after, context_samples, 9);
+void encode_kmer_len9(const ContextKmers& kmers, int8_t* output) {
+    encode_kmer_generic(kmers, 9, output);
 }
 
 #if ENABLE_AVX2_IMPL
-__attribute__((target("avx2"))) std::vector<int8_t> encode_kmer_len9(
-        const std::vector<int>& seq,
-        const std::vector<int>& seq_mappings,
-        int bases_before,
-        int bases_after,
-        int context_samples) {
-    // These cannot change without a rewrite.
-    constexpr int kKmerLen = 9;
-    constexpr int kNumBases = 4;
-
+__attribute__((target("avx2"))) void encode_kmer_len9(const ContextKmers& kmers, int8_t* output) {
     const __m256i kOnes = _mm256_set_epi32(1, 1, 1, 1, 1, 1, 1, 1);
 
     // Permutations for rotations of 32 bit elements by 1, 2 and 3 elements.
@@ -187,13 +197,9 @@ __attribute__((target("avx2"))) std::vector<int8_t> encode_kmer_len9(
     const __m256i kRotate2 = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
     const __m256i kRotate3 = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
 
-    const size_t seq_len = seq.size() - bases_before - bases_after;
-    std::vector<int8_t> output_t(kKmerLen * kNumBases * context_samples);
-    std::byte* output_t_ptr = reinterpret_cast<std::byte*>(&output_t[0]);
-    for (size_t seq_pos = 0; seq_pos < seq_len; ++seq_pos) {
-        const auto base_st = seq_mappings[seq_pos];
-        const auto base_en = seq_mappings[seq_pos + 1];
-
+    const int* const seq = kmers.seq;
+    std::byte* output_t_ptr = reinterpret_cast<std::byte*>(output);
+    for (size_t seq_pos = 0; seq_pos < kmers.num_bases; ++seq_pos) {
         // Load the 9 base indices with 2 overlapping 256 bit loads.
         const __m256i bases_01234567 =
                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&seq[seq_pos]));
@@ -231,7 +237,7 @@ __attribute__((target("avx2"))) std::vector<int8_t> encode_kmer_len9(
 
         const __m128i bases_5678_oh = _mm256_extracti128_si256(bases_12345678_oh, 1);
 
-        const int count = base_en - base_st;
+        const int count = base_sample_count(kmers, seq_pos);
 
         // 4x unrolled loop.
         for (int i = 0; i < count / 4; ++i) {
@@ -257,22 +263,28 @@ __attribute__((target("avx2"))) std::vector<int8_t> encode_kmer_len9(
             output_t_ptr += 36;
         }
     }
-
-    return output_t;
 }
 #endif
 
 }  // namespace
 
-std::vector<int8_t> ModBaseEncoder::encode_kmer(const std::vector<int>& seq,
-                                                const std::vector<int>& seq_mappings) const {
+void ModBaseEncoder::encode_kmers(const ContextSamples& context,
+                                  size_t seq_start,
+                                  size_t seq_end,
+                                  int8_t* output) const {
+    // m_padded_sequence_ints[seq_start] is the first base of the kmer centred on seq_start.
+    const ContextKmers kmers{m_padded_sequence_ints.data() + seq_start,
+                             m_sample_offsets + seq_start, seq_end - seq_start,
+                             int64_t(context.first_sample) - int64_t(context.lead_samples_needed),
+                             m_context_samples};
+
     // Specialised version for the case of kmer_len 9 that can be faster.
-    if (m_kmer_len == 9)
-        return encode_kmer_len9(seq, seq_mappings, m_bases_before, m_bases_after,
-                                m_context_samples);
+    if (m_kmer_len == 9) {
+        encode_kmer_len9(kmers, output);
+        return;
+    }
 
-    return encode_kmer_generic(seq, seq_mappings, m_bases_before, m_bases_after, m_context_samples,
-                               m_kmer_len);
+    encode_kmer_generic(kmers, m_kmer_len, output);
 }
 
 }  // namespace dorado::modbase
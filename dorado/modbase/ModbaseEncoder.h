@@ -16,14 +16,14 @@ private:
 
     int m_seq_len;
     int m_signal_len;
-    std::vector<int> m_sequence_ints;
-    std::vector<int> m_sample_offsets;
+    // The sequence with m_bases_before/m_bases_after -1 entries either side, so that the kmers of
+    // any context can be encoded in place.
+    std::vector<int> m_padded_sequence_ints;
+    // Points into the seq_to_sig_map passed to init, which has m_seq_len + 1 entries.
+    const uint64_t* m_sample_offsets = nullptr;
 
     int compute_sample_pos(int base_pos) const;
 
-    std::vector<int8_t> encode_kmer(const std::vector<int>& seq,
-                                    const std::vector<int>& seq_mappings) const;
-
 public:
     /** Encoder for Remora-style modified base detection.
      *  @param block_stride The number of samples corresponding to a single entry in the movement vector.
@@ -37,18 +37,30 @@ public:
      *  @param sequence_ints The basecall sequence encoded as integers (A=0, C=1, G=2, T=3)
      *  @param seq_to_sig_map An array indicating the position in the signal at which the corresponding base begins/the 
      *  previous base ends. The final value in the array should be the length of the signal. @see ::utils::moves_to_map
+     *
+     *  seq_to_sig_map is referenced rather than copied, so it must outlive any subsequent get_context(s) calls.
      */
     void init(const std::vector<int>& sequence_ints, const std::vector<uint64_t>& seq_to_sig_map);
 
-    /// Helper structure for specifying the context and returning the corresponding encoded data.
-    struct Context {
-        std::vector<int8_t> data;  ///< Encoded data slice
-        size_t first_sample;       ///< Index of first raw data sample for the slice.
-        size_t num_samples;        ///< Number of samples of raw data in the slice.
+    /// The raw data samples covered by a context.
+    struct ContextSamples {
+        size_t first_sample;  ///< Index of first raw data sample for the slice.
+        size_t num_samples;   ///< Number of samples of raw data in the slice.
         size_t lead_samples_needed;  ///< Number of samples, if any, to pad the beginning of the raw data slice with.
         size_t tail_samples_needed;  ///< Number of samples, if any, to pad the end of the raw data slice with.
     };
 
+    /// Helper structure for specifying the context and returning the corresponding encoded data.
+    struct Context : ContextSamples {
+        std::vector<int8_t> data;  ///< Encoded data slice
+    };
+
+    /// The number of samples in each context, including any padding.
+    size_t context_samples() const { return size_t(m_context_samples); }
+
+    /// The number of encoded entries in each context, i.e. kmer_len * 4 * context_samples.
+    size_t kmer_context_size() const;
+
     /** Get the encoded data of the context centered on a specified sequence position.
      *  @param seq_pos The position of the base to center the encoded data on.
      *  @return Encoded data for the context.
@@ -59,6 +71,29 @@ public:
      *  The data is arranged in Feature-Time order i.e each column corresponds to the kmer at a given sample.
      */
     Context get_context(size_t seq_pos) const;
+
+    /** Get the sample ranges and encoded data of the contexts centered on each of a set of sequence positions.
+     *  @param seq_positions The positions of the bases to center the contexts on, in ascending order.
+     *  @param contexts Receives the samples covered by each context. Must have room for seq_positions.size() entries.
+     *  @param encoded_kmers Receives the encoded data of each context, laid out as for get_context, one after
+     *  the other. Must have room for seq_positions.size() * kmer_context_size() entries.
+     *
+     *  Equivalent to calling get_context for each position, but the sample offsets are walked once for the whole
+     *  read and no per-context buffers are allocated.
+     */
+    void get_contexts(const std::vector<size_t>& seq_positions,
+                      ContextSamples* contexts,
+                      int8_t* encoded_kmers) const;
+
+private:
+    ContextSamples compute_context_samples(size_t seq_pos) const;
+
+    // Encodes the kmers of the context covering bases [seq_start, seq_end) to output, which must
+    // have room for kmer_context_size() entries.
+    void encode_kmers(const ContextSamples& context,
+                      size_t seq_start,
+                      size_t seq_end,
+                      int8_t* output) const;
 };
 
 }  // namespace dorado::modbase
@@ -3,10 +3,12 @@
 #include "ClientInfo.h"
 #include "alignment/Minimap2Aligner.h"
 #include "alignment/Minimap2Index.h"
+#include "utils/bam_utils.h"
 
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
 #include <string>
@@ -20,7 +22,11 @@ std::shared_ptr<const dorado::alignment::Minimap2Index> load_and_get_index(
         const dorado::alignment::Minimap2Options& options,
         const int threads) {
     int num_index_construction_threads{options.print_aln_seq ? 1 : static_cast<int>(threads)};
-    switch (index_file_access.load_index(filename, options, num_index_construction_threads)) {
+    // The index is returned by the load itself, as another job loading an index could otherwise
+    // unload it before it's fetched.
+    std::shared_ptr<const dorado::alignment::Minimap2Index> index;
+    switch (index_file_access.load_index(filename, options, num_index_construction_threads,
+                                         index)) {
     case dorado::alignment::IndexLoadResult::reference_file_not_found:
         throw std::runtime_error("AlignerNode reference path does not exist: " + filename);
     case dorado::alignment::IndexLoadResult::validation_error:
@@ -32,7 +38,7 @@ std::shared_ptr<const dorado::alignment::Minimap2Index> load_and_get_index(
     case dorado::alignment::IndexLoadResult::success:
         break;
     }
-    return index_file_access.get_index(filename, options);
+    return index;
 }
 
 }  // namespace
@@ -122,6 +128,29 @@ void AlignerNode::align_read_common(ReadCommon& read_common, mm_tbuf_t* tbuf) {
     alignment::Minimap2Aligner(index).align(read_common, tbuf);
 }
 
+std::vector<BamPtr> AlignerNode::align_record(bam1_t* record, mm_tbuf_t* tbuf) {
+    auto records = alignment::Minimap2Aligner(m_index_for_bam_messages).align(record, tbuf);
+    // The alignments take the place of the read in the input order.
+    if (const auto order = utils::get_record_order(record); order.sequence_number) {
+        // Only so many records can share a place in the order.  Any more alignments are left
+        // without one, so they're written as they arrive rather than in input order.
+        const auto count =
+                uint32_t(std::min(records.size(), size_t(utils::RecordOrder::MAX_COUNT)));
+        if (count < records.size()) {
+            spdlog::warn("{} has {} alignments, only the first {} are written in input order",
+                         bam_get_qname(record), records.size(), count);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            utils::set_record_order(records[i].get(), {order.sequence_number, i, count});
+        }
+        for (size_t i = count; i < records.size(); ++i) {
+            // An id of 0 means no place in the order.
+            records[i]->id = 0;
+        }
+    }
+    return records;
+}
+
 void AlignerNode::worker_thread() {
     Message message;
     mm_tbuf_t* tbuf = mm_tbuf_init();
@@ -132,9 +161,7 @@ void AlignerNode::worker_thread() {
     while (get_input_message(message)) {
         if (std::holds_alternative<BamPtr>(message)) {
             auto read = std::get<BamPtr>(std::move(message));
-            auto records =
-                    alignment::Minimap2Aligner(m_index_for_bam_messages).align(read.get(), tbuf);
-            for (auto& record : records) {
+            for (auto& record : align_record(read.get(), tbuf)) {
                 send_message_to_sink(std::move(record));
             }
         } else if (std::holds_alternative<SimplexReadPtr>(message)) {
@@ -41,6 +41,7 @@ private:
     void worker_thread();
     std::shared_ptr<const alignment::Minimap2Index> get_index(const ReadCommon& read_common);
     void align_read_common(ReadCommon& read_common, mm_tbuf_t* tbuf);
+    std::vector<BamPtr> align_record(bam1_t* record, mm_tbuf_t* tbuf);
 
     size_t m_threads;
     std::vector<std::thread> m_workers;
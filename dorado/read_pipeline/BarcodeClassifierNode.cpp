@@ -136,6 +136,7 @@ void BarcodeClassifierNode::barcode(BamPtr& read) {
     auto bc = generate_barcode_string(bc_res);
     bam_aux_append(irecord, "BC", 'Z', int(bc.length() + 1), (uint8_t*)bc.c_str());
     m_num_records++;
+    add_to_counter(stats::Counter::BARCODES_DEMUXED, 1);
 
     if (m_default_barcoding_info->trim) {
         int seqlen = irecord->core.l_qseq;
@@ -166,6 +167,7 @@ void BarcodeClassifierNode::barcode(SimplexRead& read) {
     }
 
     m_num_records++;
+    add_to_counter(stats::Counter::BARCODES_DEMUXED, 1);
 }
 
 stats::NamedStats BarcodeClassifierNode::sample_stats() const {
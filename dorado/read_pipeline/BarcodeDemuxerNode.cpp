@@ -110,6 +110,7 @@ int BarcodeDemuxerNode::write(bam1_t* const record) {
                                  std::to_string(hts_res));
     }
     m_processed_reads++;
+    add_to_counter(stats::Counter::SIMPLEX_READS_WRITTEN, 1);
     return hts_res;
 }
 
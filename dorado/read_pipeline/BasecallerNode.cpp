@@ -3,6 +3,7 @@
 #include "basecall/CRFModelConfig.h"
 #include "basecall/ModelRunnerBase.h"
 #include "stitch.h"
+#include "utils/math_utils.h"
 #include "utils/stats.h"
 
 #include <ATen/ATen.h>
@@ -10,6 +11,9 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <map>
+#include <mutex>
+#include <utility>
 
 #if defined(__APPLE__) && DORADO_GPU_BUILD
 #include "utils/metal_utils.h"
@@ -24,29 +28,181 @@ struct BasecallerNode::BasecallingChunk : utils::Chunk {
     BasecallingChunk(std::shared_ptr<BasecallingRead> owner,
                      size_t offset,
                      size_t chunk_in_read_idx,
-                     size_t chunk_size)
+                     size_t chunk_size,
+                     size_t segment_end)
             : Chunk(offset, chunk_size),
               owning_read(std::move(owner)),
-              idx_in_read(chunk_in_read_idx) {}
+              idx_in_read(chunk_in_read_idx),
+              input_end(segment_end) {}
 
     std::shared_ptr<BasecallingRead> owning_read;  // The object that owns us.
     size_t idx_in_read;  // Just for tracking that the chunks don't go out of order.
+    size_t input_end;    // End of the called signal segment this chunk belongs to.
 };
 
 struct BasecallerNode::BasecallingRead {
-    Message read;                                              // The read itself.
-    std::vector<std::unique_ptr<utils::Chunk>> called_chunks;  // Vector of basecalled chunks.
-    std::atomic_size_t num_chunks_called;  // Number of chunks which have been basecalled.
+    Message read;  // The read itself.
+    // Stitches called chunks into the read as soon as all of their predecessors are stitched.
+    std::unique_ptr<utils::ChunkStitcher> stitcher;
+    size_t num_chunks{0};  // Total number of chunks in the read.
+
+    std::mutex stitch_mutex;
+    // Called chunks which arrived ahead of the next chunk to stitch, keyed by index in read.
+    std::map<size_t, std::unique_ptr<utils::Chunk>> out_of_order_chunks;
+    size_t num_chunks_stitched{0};
 };
 
+namespace {
+
+// Where a chunk starts in the signal, and the end of the segment it belongs to.
+struct ChunkRange {
+    size_t offset;
+    size_t segment_end;
+};
+
+// Splits the signal into the segments to basecall, skipping any excluded ranges.
+// Excluded ranges are shrunk to stride boundaries so that every segment starts on one.
+std::vector<utils::CalledSegment> get_called_segments(const ReadCommon &read_common,
+                                                      size_t raw_size,
+                                                      size_t model_stride) {
+    std::vector<utils::CalledSegment> segments;
+    size_t segment_start = 0;
+    for (const auto &excluded_range : read_common.excluded_signal_ranges) {
+        const size_t excluded_start = utils::pad_to(size_t(excluded_range.first), model_stride);
+        const size_t excluded_end = (size_t(excluded_range.second) / model_stride) * model_stride;
+        if (excluded_end <= excluded_start || excluded_start < segment_start ||
+            excluded_end >= raw_size) {
+            continue;
+        }
+        if (excluded_start > segment_start) {
+            segments.push_back({segment_start, excluded_start, 0});
+        }
+        segment_start = excluded_end;
+    }
+    segments.push_back({segment_start, raw_size, 0});
+    return segments;
+}
+
+// Lays out the chunks covering each segment, filling in the number of chunks per segment.
+std::vector<ChunkRange> get_chunk_ranges(std::vector<utils::CalledSegment> &segments,
+                                         size_t chunk_size,
+                                         size_t overlap,
+                                         size_t model_stride) {
+    std::vector<ChunkRange> chunk_ranges;
+    const size_t signal_chunk_step = chunk_size - overlap;
+    for (auto &segment : segments) {
+        const size_t segment_end = segment.signal_end;
+        const size_t first_chunk = chunk_ranges.size();
+        size_t offset = segment.signal_start;
+        chunk_ranges.push_back({offset, segment_end});
+        if (offset + chunk_size < segment_end) {
+            auto last_chunk_offset = segment_end - chunk_size;
+            auto misalignment = last_chunk_offset % model_stride;
+            if (misalignment != 0) {
+                // move last chunk start to the next stride boundary. we'll zero pad any excess samples required.
+                last_chunk_offset += model_stride - misalignment;
+            }
+            while (offset + chunk_size < segment_end) {
+                offset = std::min(offset + signal_chunk_step, last_chunk_offset);
+                chunk_ranges.push_back({offset, segment_end});
+            }
+        }
+        segment.num_chunks = chunk_ranges.size() - first_chunk;
+    }
+    return chunk_ranges;
+}
+
+}  // namespace
+
+void BasecallerNode::chunk_read(Message message) {
+    // If this is a duplex read, raw_data won't have been generated yet.
+    materialise_read_raw_data(message);
+    ReadCommon &read_common_data = get_read_common_data(message);
+
+    // Chunk up the read and put the chunks into the pending chunk list.
+    size_t raw_size =
+            read_common_data.raw_data
+                    .sizes()[read_common_data.raw_data.sizes().size() - 1];  // Time dimension.
+
+    auto segments = get_called_segments(read_common_data, raw_size, m_model_stride);
+    const auto chunk_ranges = get_chunk_ranges(segments, m_chunk_size, m_overlap, m_model_stride);
+    size_t num_samples_called = 0;
+    for (const auto &segment : segments) {
+        num_samples_called += segment.signal_end - segment.signal_start;
+    }
+    m_num_samples_excluded += raw_size - num_samples_called;
+
+    auto working_read = std::make_shared<BasecallingRead>();
+    working_read->stitcher = std::make_unique<utils::ChunkStitcher>(std::move(segments));
+    working_read->num_chunks = chunk_ranges.size();
+    working_read->read = std::move(message);
+
+    // Put the read in the working list
+    {
+        std::lock_guard working_reads_lock(m_working_reads_mutex);
+        m_working_reads_signal_bytes += get_read_common_data(working_read->read).raw_data.nbytes();
+        m_working_reads.insert(working_read);
+        ++m_working_reads_size;
+    }
+
+    // push the chunks to the chunk queue
+    // needs to be done after working_read->read is set as chunks could be processed
+    // before we set that value otherwise.  Chunks are only created as the bounded queue takes
+    // them, and are released as they're stitched, so however long the read, no more of its
+    // chunks are held than the queues and batches have room for.
+    for (size_t chunk_idx = 0; chunk_idx < chunk_ranges.size(); ++chunk_idx) {
+        const auto &chunk_range = chunk_ranges[chunk_idx];
+        m_chunks_in.try_push(std::make_unique<BasecallingChunk>(
+                working_read, chunk_range.offset, chunk_idx, m_chunk_size, chunk_range.segment_end));
+    }
+}
+
+void BasecallerNode::chunk_reads_by_length(std::vector<Message> &reads) {
+    // Shortest first, so that reads of similar lengths end up in the same batches.
+    std::stable_sort(reads.begin(), reads.end(), [](const Message &a, const Message &b) {
+        return get_read_common_data(a).raw_data.size(-1) <
+               get_read_common_data(b).raw_data.size(-1);
+    });
+    for (auto &read : reads) {
+        chunk_read(std::move(read));
+    }
+    reads.clear();
+}
+
 void BasecallerNode::input_worker_thread() {
     at::InferenceMode inference_mode_guard;
 
+    // Reads held back to be sorted by length, when length sorted batching is enabled.
+    std::vector<Message> sort_window;
+    size_t sort_window_chunks = 0;
+    auto flush_sort_window = [&] {
+        chunk_reads_by_length(sort_window);
+        sort_window_chunks = 0;
+    };
+
     Message message;
-    while (get_input_message(message)) {
+    while (true) {
+        auto pop_status = utils::AsyncQueueStatus::Success;
+        if (sort_window.empty()) {
+            pop_status = m_work_queue.try_pop(message);
+        } else {
+            // Don't hold reads back for longer than a batch would wait for more chunks.
+            pop_status = m_work_queue.try_pop_until(
+                    message,
+                    std::chrono::system_clock::now() + std::chrono::milliseconds(m_batch_timeout_ms));
+        }
+        if (pop_status == utils::AsyncQueueStatus::Terminate) {
+            break;
+        }
+        if (pop_status == utils::AsyncQueueStatus::Timeout) {
+            flush_sort_window();
+            continue;
+        }
+
         // If this message isn't a read, just forward it to the sink.
 
         if (!is_read_message(message)) {
+            flush_sort_window();
             send_message_to_sink(std::move(message));
             continue;
         }
@@ -62,55 +218,23 @@ void BasecallerNode::input_worker_thread() {
             continue;
         }
 
-        // If this is a duplex read, raw_data won't have been generated yet.
-        materialise_read_raw_data(message);
-
-        // Now that we have acquired a read, wait until we can push to chunks_in
-        // Chunk up the read and put the chunks into the pending chunk list.
-        size_t raw_size =
-                read_common_data.raw_data
-                        .sizes()[read_common_data.raw_data.sizes().size() - 1];  // Time dimension.
-
-        size_t offset = 0;
-        size_t chunk_in_read_idx = 0;
-        size_t signal_chunk_step = m_chunk_size - m_overlap;
-        auto working_read = std::make_shared<BasecallingRead>();
-        std::vector<std::unique_ptr<BasecallingChunk>> read_chunks;
-        read_chunks.emplace_back(std::make_unique<BasecallingChunk>(
-                working_read, offset, chunk_in_read_idx++, m_chunk_size));
-        size_t num_chunks = 1;
-        auto last_chunk_offset = raw_size - m_chunk_size;
-        auto misalignment = last_chunk_offset % m_model_stride;
-        if (misalignment != 0) {
-            // move last chunk start to the next stride boundary. we'll zero pad any excess samples required.
-            last_chunk_offset += m_model_stride - misalignment;
-        }
-        while (offset + m_chunk_size < raw_size) {
-            offset = std::min(offset + signal_chunk_step, last_chunk_offset);
-            read_chunks.push_back(std::make_unique<BasecallingChunk>(
-                    working_read, offset, chunk_in_read_idx++, m_chunk_size));
-            ++num_chunks;
-        }
-        working_read->called_chunks.resize(num_chunks);
-        working_read->num_chunks_called.store(0);
-        working_read->read = std::move(message);
-
-        // Put the read in the working list
-        {
-            std::lock_guard working_reads_lock(m_working_reads_mutex);
-            m_working_reads_signal_bytes +=
-                    get_read_common_data(working_read->read).raw_data.nbytes();
-            m_working_reads.insert(std::move(working_read));
-            ++m_working_reads_size;
+        if (!m_length_sorted_batching) {
+            chunk_read(std::move(message));
+            continue;
         }
 
-        // push the chunks to the chunk queue
-        // needs to be done after working_read->read is set as chunks could be processed
-        // before we set that value otherwise
-        for (auto &chunk : read_chunks) {
-            m_chunks_in.try_push(std::move(chunk));
+        // Gather reads until there are enough chunks to fill the chunk queue, then chunk them up
+        // in length order.
+        materialise_read_raw_data(message);
+        const size_t chunk_step = m_chunk_size - m_overlap;
+        sort_window_chunks +=
+                utils::pad_to(size_t(read_common_data.raw_data.size(-1)), chunk_step) / chunk_step;
+        sort_window.push_back(std::move(message));
+        if (sort_window_chunks >= m_chunks_in.capacity()) {
+            flush_sort_window();
         }
     }
+    flush_sort_window();
 
     // Notify the basecaller threads that it is safe to gracefully terminate the basecaller
     m_chunks_in.terminate();
@@ -119,14 +243,33 @@ void BasecallerNode::input_worker_thread() {
 void BasecallerNode::basecall_current_batch(int worker_id) {
     NVTX3_FUNC_RANGE();
     auto &model_runner = m_model_runners[worker_id];
+    auto &batch = m_batched_chunks[worker_id];
+    const size_t batch_max_samples = std::exchange(m_batch_max_samples[worker_id], 0);
+    const bool call_short_chunks = m_length_sorted_batching && batch_max_samples < m_chunk_size;
     dorado::stats::Timer timer;
-    auto decode_results = model_runner->call_chunks(int(m_batched_chunks[worker_id].size()));
+    std::vector<decode::DecodedChunk> decode_results;
+    if (call_short_chunks) {
+        // Every chunk in the batch is short, so only call as much of them as is needed.
+        decode_results = model_runner->call_short_chunks(
+                int(batch.size()), utils::pad_to(batch_max_samples, m_model_stride));
+        ++m_num_short_batches_called;
+    } else {
+        decode_results = model_runner->call_chunks(int(batch.size()));
+    }
     m_call_chunks_ms += timer.GetElapsedMS();
+    if (!decode_results.empty()) {
+        m_num_chunk_samples_called +=
+                int64_t(batch.size() * decode_results.front().moves.size() * m_model_stride);
+    }
 
-    for (size_t i = 0; i < m_batched_chunks[worker_id].size(); i++) {
-        m_batched_chunks[worker_id][i]->seq = decode_results[i].sequence;
-        m_batched_chunks[worker_id][i]->qstring = decode_results[i].qstring;
-        m_batched_chunks[worker_id][i]->moves = decode_results[i].moves;
+    for (size_t i = 0; i < batch.size(); i++) {
+        batch[i]->seq = decode_results[i].sequence;
+        batch[i]->qstring = decode_results[i].qstring;
+        batch[i]->moves = decode_results[i].moves;
+        if (call_short_chunks) {
+            // The runner may still have called whole chunks.
+            batch[i]->raw_chunk_size = batch[i]->moves.size() * m_model_stride;
+        }
     }
 
     for (auto &complete_chunk : m_batched_chunks[worker_id]) {
@@ -137,6 +280,34 @@ void BasecallerNode::basecall_current_batch(int worker_id) {
     ++m_num_batches_called;
 }
 
+bool BasecallerNode::add_called_chunk(BasecallingRead &working_read,
+                                      std::unique_ptr<BasecallingChunk> chunk) {
+    const auto idx_in_read = chunk->idx_in_read;
+
+    bool read_complete = false;
+    {
+        std::lock_guard stitch_lock(working_read.stitch_mutex);
+        auto &num_chunks_stitched = working_read.num_chunks_stitched;
+        auto &out_of_order_chunks = working_read.out_of_order_chunks;
+        if (idx_in_read != num_chunks_stitched) {
+            out_of_order_chunks.emplace(idx_in_read, std::move(chunk));
+            return false;
+        }
+
+        // Stitch this chunk and any successors which were waiting for it, releasing each once merged.
+        working_read.stitcher->add_chunk(std::move(chunk));
+        ++num_chunks_stitched;
+        auto next_chunk = out_of_order_chunks.begin();
+        while (next_chunk != out_of_order_chunks.end() && next_chunk->first == num_chunks_stitched) {
+            working_read.stitcher->add_chunk(std::move(next_chunk->second));
+            next_chunk = out_of_order_chunks.erase(next_chunk);
+            ++num_chunks_stitched;
+        }
+        read_complete = num_chunks_stitched == working_read.num_chunks;
+    }
+    return read_complete;
+}
+
 void BasecallerNode::working_reads_manager() {
     at::InferenceMode inference_mode_guard;
 
@@ -145,16 +316,15 @@ void BasecallerNode::working_reads_manager() {
         nvtx3::scoped_range loop{"working_reads_manager"};
 
         auto working_read = chunk->owning_read;
-        auto idx_in_read = chunk->idx_in_read;
-        working_read->called_chunks[idx_in_read] = std::move(chunk);
-        auto num_chunks_called = ++working_read->num_chunks_called;
-        if (num_chunks_called == working_read->called_chunks.size()) {
+        if (add_called_chunk(*working_read, std::move(chunk))) {
             // Finalise the read.
             auto source_read = std::move(working_read->read);
 
             ReadCommon &read_common_data = get_read_common_data(source_read);
 
-            utils::stitch_chunks(read_common_data, working_read->called_chunks);
+            // Chunks were stitched as they arrived, so this only hands over the result.
+            working_read->stitcher->finalise(read_common_data);
+            read_common_data.excluded_signal_ranges.clear();
             read_common_data.model_name = m_model_name;
             read_common_data.mean_qscore_start_pos = m_mean_qscore_start_pos;
             read_common_data.pre_trim_seq_length = read_common_data.seq.length();
@@ -168,9 +338,13 @@ void BasecallerNode::working_reads_manager() {
             ++m_called_reads_pushed;
             m_num_bases_processed += read_common_data.seq.length();
             m_num_samples_processed += read_common_data.get_raw_data_samples();
-
-            // Chunks have ownership of the working read, so destroy them to avoid a leak.
-            working_read->called_chunks.clear();
+            const bool is_duplex = read_common_data.is_duplex;
+            add_to_counter(is_duplex ? stats::Counter::DUPLEX_BASES_PROCESSED
+                                     : stats::Counter::SIMPLEX_BASES_PROCESSED,
+                           int64_t(read_common_data.seq.length()));
+            add_to_counter(is_duplex ? stats::Counter::DUPLEX_SAMPLES_PROCESSED
+                                     : stats::Counter::SIMPLEX_SAMPLES_PROCESSED,
+                           int64_t(read_common_data.get_raw_data_samples()));
 
             // Cleanup the working read.
             {
@@ -230,7 +404,9 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
 
             auto &read_common = get_read_common_data(source_read);
             auto input_slice = read_common.raw_data.index(
-                    {Ellipsis, Slice(chunk->input_offset, chunk->input_offset + m_chunk_size)});
+                    {Ellipsis, Slice(chunk->input_offset,
+                                     std::min(chunk->input_offset + m_chunk_size,
+                                              chunk->input_end))});
             size_t slice_size;
             if (input_slice.ndimension() == 1) {
                 slice_size = input_slice.size(0);
@@ -238,6 +414,9 @@ void BasecallerNode::basecall_worker_thread(int worker_id) {
                 slice_size = input_slice.sizes()[1];
             }
 
+            m_batch_max_samples[worker_id] = std::max(m_batch_max_samples[worker_id], slice_size);
+            m_num_chunk_samples_used += int64_t(slice_size);
+
             // repeat-pad any non-full chunks
             // Stereo and Simplex encoding need to be treated differently
             if (slice_size != m_chunk_size) {
@@ -306,7 +485,8 @@ BasecallerNode::BasecallerNode(std::vector<basecall::RunnerPtr> model_runners,
                                std::string model_name,
                                size_t max_reads,
                                const std::string &node_name,
-                               uint32_t read_mean_qscore_start_pos)
+                               uint32_t read_mean_qscore_start_pos,
+                               bool length_sorted_batching)
         : MessageSink(max_reads),
           m_model_runners(std::move(model_runners)),
           m_chunk_size(m_model_runners.front()->chunk_size()),
@@ -316,12 +496,19 @@ BasecallerNode::BasecallerNode(std::vector<basecall::RunnerPtr> model_runners,
           m_batch_timeout_ms(batch_timeout_ms),
           m_model_name(std::move(model_name)),
           m_mean_qscore_start_pos(read_mean_qscore_start_pos),
+          // Sorting only pays off if the runners can call short batches for less than whole ones.
+          m_length_sorted_batching(length_sorted_batching &&
+                                   std::all_of(m_model_runners.begin(), m_model_runners.end(),
+                                               [](const basecall::RunnerPtr &runner) {
+                                                   return runner->supports_short_chunks();
+                                               })),
           m_chunks_in(CalcMaxChunksIn(m_model_runners)),
           m_processed_chunks(CalcMaxChunksIn(m_model_runners)),
           m_node_name(node_name) {
     // Setup worker state
     const size_t num_workers = m_model_runners.size();
     m_batched_chunks.resize(num_workers);
+    m_batch_max_samples.resize(num_workers, 0);
 
     initialization_time = std::chrono::system_clock::now();
 
@@ -390,6 +577,13 @@ stats::NamedStats BasecallerNode::sample_stats() const {
     stats["working_reads_signal_mb"] = double(m_working_reads_signal_bytes) / double((1024 * 1024));
     stats["bases_processed"] = double(m_num_bases_processed);
     stats["samples_processed"] = double(m_num_samples_processed);
+    stats["samples_excluded"] = double(m_num_samples_excluded);
+    stats["short_batches_called"] = double(m_num_short_batches_called);
+    // The fraction of the chunk samples run through the model which hold real signal.
+    if (m_num_chunk_samples_called > 0) {
+        stats["chunk_utilisation"] =
+                double(m_num_chunk_samples_used) / double(m_num_chunk_samples_called);
+    }
     return stats;
 }
 
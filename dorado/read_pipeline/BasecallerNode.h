@@ -30,7 +30,8 @@ public:
                    std::string model_name,
                    size_t max_reads,
                    const std::string& node_name,
-                   uint32_t read_mean_qscore_start_pos);
+                   uint32_t read_mean_qscore_start_pos,
+                   bool length_sorted_batching);
     ~BasecallerNode();
     std::string get_name() const override { return m_node_name; }
     stats::NamedStats sample_stats() const override;
@@ -42,12 +43,18 @@ private:
     void terminate_impl();
     // Consume reads from input queue
     void input_worker_thread();
+    // Chunk up a read and queue its chunks for basecalling
+    void chunk_read(Message message);
+    // As above for each of the reads, shortest first
+    void chunk_reads_by_length(std::vector<Message> &reads);
     // Basecall reads
     void basecall_worker_thread(int worker_id);
     // Basecall batch of chunks
     void basecall_current_batch(int worker_id);
     // Construct complete reads
     void working_reads_manager();
+    // Hands a called chunk to its read, returning true if the read is now complete.
+    bool add_called_chunk(BasecallingRead &working_read, std::unique_ptr<BasecallingChunk> chunk);
 
     // Vector of model runners (each with their own GPU access etc)
     std::vector<basecall::RunnerPtr> m_model_runners;
@@ -65,6 +72,11 @@ private:
     std::string m_model_name;
     // Mean Q-score start position from model properties.
     uint32_t m_mean_qscore_start_pos;
+    // Whether reads are gathered and chunked up in length order, so that short reads are batched
+    // together and batches of short chunks are only called as far as their longest chunk.  Only
+    // set if every runner supports short chunks (currently the CPU runner), as otherwise holding
+    // reads back to sort them saves nothing.
+    const bool m_length_sorted_batching;
 
     // Model runners which have not terminated.
     std::atomic<int> m_num_active_model_runners{0};
@@ -82,6 +94,8 @@ private:
 
     // If we go multi-threaded, there will be one of these batches per thread
     std::vector<std::vector<std::unique_ptr<BasecallingChunk>>> m_batched_chunks;
+    // Length of the longest chunk in each batch, before padding.
+    std::vector<size_t> m_batch_max_samples;
 
     utils::AsyncQueue<std::unique_ptr<BasecallingChunk>> m_processed_chunks;
 
@@ -105,6 +119,10 @@ private:
     std::atomic<int64_t> m_working_reads_size = 0;
     std::atomic<int64_t> m_num_bases_processed = 0;
     std::atomic<int64_t> m_num_samples_processed = 0;
+    std::atomic<int64_t> m_num_samples_excluded = 0;
+    std::atomic<int64_t> m_num_short_batches_called = 0;
+    std::atomic<int64_t> m_num_chunk_samples_used = 0;
+    std::atomic<int64_t> m_num_chunk_samples_called = 0;
     std::atomic<int64_t> m_working_reads_signal_bytes = 0;
 };
 
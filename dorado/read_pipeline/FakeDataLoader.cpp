@@ -1,26 +1,278 @@
 #include "FakeDataLoader.h"
 
 #include "read_pipeline/ReadPipeline.h"
+#include "utils/sequence_utils.h"
+#include "utils/time_utils.h"
 
 #include <ATen/ATen.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr size_t DEFAULT_KMER_LEN = 9;
+// Acquisition start time used for all synthetic runs (2024-01-01T00:00:00Z).
+constexpr uint64_t RUN_ACQUISITION_START_TIME_MS = 1704067200000ull;
+
+}  // namespace
 
 namespace dorado {
 
-void FakeDataLoader::load_reads(const int num_reads) {
-    for (int i = 0; i < num_reads; ++i) {
-        auto fake_read = std::make_unique<SimplexRead>();
+SyntheticReadGenerator::SyntheticReadGenerator(SyntheticReadParams params)
+        : m_params(std::move(params)), m_rng(m_params.seed) {
+    if (m_params.num_channels < 1) {
+        throw std::runtime_error("SyntheticReadGenerator: num_channels must be at least 1");
+    }
+    if (m_params.samples_per_base < 1.f) {
+        throw std::runtime_error("SyntheticReadGenerator: samples_per_base must be at least 1");
+    }
+
+    std::uniform_int_distribution<int> base_dist(0, 3);
+    const char* bases = "ACGT";
+    if (m_params.reference.empty()) {
+        m_params.reference.resize(m_params.random_reference_length);
+        for (auto& base : m_params.reference) {
+            base = bases[base_dist(m_rng)];
+        }
+    } else {
+        // Replace ambiguous bases so that every position maps to a kmer level.
+        for (auto& base : m_params.reference) {
+            base = char(std::toupper(static_cast<unsigned char>(base)));
+            if (base != 'A' && base != 'C' && base != 'G' && base != 'T') {
+                base = bases[base_dist(m_rng)];
+            }
+        }
+    }
+    if (m_params.reference.size() < m_params.min_read_length) {
+        throw std::runtime_error("SyntheticReadGenerator: reference is shorter than the minimum "
+                                 "read length");
+    }
+
+    if (m_params.kmer_levels.empty()) {
+        m_kmer_len = DEFAULT_KMER_LEN;
+        std::normal_distribution<float> level_dist(0.f, 1.f);
+        m_params.kmer_levels.resize(size_t(1) << (2 * m_kmer_len));
+        for (auto& level : m_params.kmer_levels) {
+            level = level_dist(m_rng);
+        }
+    } else {
+        m_kmer_len = size_t(
+                std::round(std::log(double(m_params.kmer_levels.size())) / std::log(4.0)));
+        if (m_params.kmer_levels.size() != (size_t(1) << (2 * m_kmer_len))) {
+            throw std::runtime_error("SyntheticReadGenerator: number of kmer levels must be a "
+                                     "power of 4");
+        }
+    }
+    if (m_params.kmer_centre >= m_kmer_len) {
+        throw std::runtime_error("SyntheticReadGenerator: kmer centre must be within the kmer");
+    }
 
-        constexpr int64_t read_size = 40000;
-        fake_read->read_common.raw_data = at::randint(0, 10000, {read_size}, at::kShort);
-        fake_read->read_common.read_id = "Placeholder-read-id";
+    // Stagger the first read on each channel over the first 10 seconds of the run.
+    std::uniform_int_distribution<uint64_t> start_dist(0, 10 * m_params.sample_rate);
+    m_channel_next_sample.resize(m_params.num_channels);
+    for (auto& start_sample : m_channel_next_sample) {
+        start_sample = start_dist(m_rng);
+    }
+    m_channel_read_number.resize(m_params.num_channels, 0);
+}
+
+std::string SyntheticReadGenerator::sample_molecule() {
+    // Parameterise the log-normal so that it has the requested mean and standard deviation.
+    const double mean = std::max(1.0, double(m_params.read_length_mean));
+    const double sd = std::max(0.0, double(m_params.read_length_sd));
+    const double sigma = std::sqrt(std::log1p((sd * sd) / (mean * mean)));
+    const double mu = std::log(mean) - 0.5 * sigma * sigma;
+    const double sampled_length =
+            sigma > 0 ? std::lognormal_distribution<double>(mu, sigma)(m_rng) : mean;
+
+    const auto& reference = m_params.reference;
+    size_t length = std::clamp(size_t(sampled_length), m_params.min_read_length,
+                               m_params.max_read_length);
+    length = std::min(length, reference.size());
+
+    std::uniform_int_distribution<size_t> start_dist(0, reference.size() - length);
+    auto insert = reference.substr(start_dist(m_rng), length);
+    if (std::bernoulli_distribution(0.5)(m_rng)) {
+        insert = utils::reverse_complement(insert);
+    }
+    return insert;
+}
+
+void SyntheticReadGenerator::append_signal(const std::string& sequence,
+                                           std::vector<float>& signal) {
+    const int64_t seq_len = int64_t(sequence.size());
+    const int64_t kmer_len = int64_t(m_kmer_len);
+    const int64_t kmer_centre = int64_t(m_params.kmer_centre);
+    std::geometric_distribution<int> extra_dwell_dist(1.0 / m_params.samples_per_base);
+    std::normal_distribution<float> noise_dist(0.f, m_params.noise_sd);
+
+    for (int64_t pos = 0; pos < seq_len; ++pos) {
+        // Bases beyond the ends of the sequence are taken from the nearest end.
+        size_t kmer_index = 0;
+        for (int64_t kmer_pos = 0; kmer_pos < kmer_len; ++kmer_pos) {
+            const int64_t seq_pos = std::clamp(pos - kmer_centre + kmer_pos, int64_t(0),
+                                               seq_len - 1);
+            kmer_index = (kmer_index << 2) | size_t(utils::base_to_int(sequence[seq_pos]));
+        }
+        const float level = m_params.kmer_levels[kmer_index] * m_params.level_scale +
+                            m_params.level_shift;
+        const int dwell = 1 + extra_dwell_dist(m_rng);
+        for (int i = 0; i < dwell; ++i) {
+            signal.push_back(level + noise_dist(m_rng));
+        }
+    }
+}
 
-        m_pipeline.push_message(std::move(fake_read));
+std::string SyntheticReadGenerator::make_read_id() {
+    // Random (version 4) UUID.
+    std::uniform_int_distribution<int> nibble_dist(0, 15);
+    std::string read_id = "xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx";
+    const char* hex_digits = "0123456789abcdef";
+    for (auto& c : read_id) {
+        if (c == 'x') {
+            c = hex_digits[nibble_dist(m_rng)];
+        } else if (c == 'y') {
+            c = hex_digits[8 + (nibble_dist(m_rng) & 3)];
+        }
     }
+    return read_id;
 }
 
-FakeDataLoader::FakeDataLoader(Pipeline& pipeline) : m_pipeline(pipeline) {}
+SyntheticRead SyntheticReadGenerator::make_read(const std::string& sequence,
+                                                const std::string& second_sequence,
+                                                int channel,
+                                                uint64_t start_sample) {
+    std::vector<float> signal;
+    signal.reserve(size_t(float(sequence.size() + second_sequence.size()) *
+                          m_params.samples_per_base * 1.2f));
+    append_signal(sequence, signal);
+    if (!second_sequence.empty()) {
+        // A brief return to open pore between the two molecules of a concatemer.
+        std::normal_distribution<float> noise_dist(0.f, m_params.noise_sd);
+        const int num_open_pore_samples = std::uniform_int_distribution<int>(50, 300)(m_rng);
+        for (int i = 0; i < num_open_pore_samples; ++i) {
+            signal.push_back(m_params.open_pore_level + noise_dist(m_rng));
+        }
+        append_signal(second_sequence, signal);
+    }
+
+    auto raw_data = at::empty({int64_t(signal.size())}, at::kShort);
+    auto raw_ptr = raw_data.data_ptr<int16_t>();
+    for (size_t i = 0; i < signal.size(); ++i) {
+        const float raw = std::round(signal[i] / m_params.scaling - m_params.offset);
+        raw_ptr[i] = int16_t(std::clamp(raw, float(std::numeric_limits<int16_t>::min()),
+                                        float(std::numeric_limits<int16_t>::max())));
+    }
+
+    auto read = std::make_unique<SimplexRead>();
+    const uint64_t start_time_ms =
+            RUN_ACQUISITION_START_TIME_MS + (start_sample * 1000) / m_params.sample_rate;
+    read->read_common.raw_data = raw_data;
+    read->read_common.sample_rate = m_params.sample_rate;
+    read->read_common.read_id = make_read_id();
+    read->read_common.start_time_ms = start_time_ms;
+    read->read_common.num_trimmed_samples = 0;
+    read->read_common.attributes.read_number = m_channel_read_number[channel]++;
+    read->read_common.attributes.channel_number = channel + 1;
+    read->read_common.attributes.mux = uint32_t(1 + (channel % 4));
+    read->read_common.attributes.num_samples = signal.size();
+    read->read_common.attributes.start_time =
+            utils::get_string_timestamp_from_unix_time(start_time_ms);
+    read->read_common.attributes.fast5_filename = "synthetic.pod5";
+    read->read_common.run_id = "synthetic";
+    read->read_common.flowcell_id = "SYNTHETIC";
+    read->read_common.position_id = "synthetic";
+    read->read_common.experiment_id = "synthetic";
+    read->read_common.is_duplex = false;
+    read->digitisation = 8192.f;
+    read->range = m_params.scaling * read->digitisation;
+    read->offset = m_params.offset;
+    read->scaling = m_params.scaling;
+    read->start_sample = start_sample;
+    read->end_sample = start_sample + signal.size();
+    read->run_acquisition_start_time_ms = RUN_ACQUISITION_START_TIME_MS;
+
+    auto full_sequence = sequence;
+    if (!second_sequence.empty()) {
+        full_sequence += second_sequence;
+    }
+    return {std::move(read), std::move(full_sequence)};
+}
+
+std::vector<SyntheticRead> SyntheticReadGenerator::next_reads() {
+    const int channel = std::uniform_int_distribution<int>(0, m_params.num_channels - 1)(m_rng);
+
+    std::string front;
+    std::string rear;
+    if (!m_params.barcodes.empty()) {
+        const auto& barcode = m_params.barcodes[std::uniform_int_distribution<size_t>(
+                0, m_params.barcodes.size() - 1)(m_rng)];
+        front = barcode;
+        rear = utils::reverse_complement(barcode);
+    }
+    const auto wrap = [&](const std::string& insert) {
+        return m_params.adapter + front + insert + rear;
+    };
+
+    const auto insert = sample_molecule();
+    const bool is_concatemer = std::bernoulli_distribution(m_params.concatemer_fraction)(m_rng);
+    const bool is_duplex = std::bernoulli_distribution(m_params.duplex_fraction)(m_rng);
+
+    std::vector<SyntheticRead> reads;
+    reads.push_back(make_read(wrap(insert),
+                              is_concatemer ? wrap(utils::reverse_complement(insert)) : "",
+                              channel, m_channel_next_sample[channel]));
+    uint64_t end_sample = reads.back().read->end_sample;
+
+    if (is_duplex) {
+        // The complement strand follows shortly after the template on the same channel, and is
+        // usually slightly truncated.
+        auto complement = utils::reverse_complement(insert);
+        const size_t truncation = std::uniform_int_distribution<size_t>(
+                0, complement.size() / 20)(m_rng);
+        complement.resize(complement.size() - truncation);
+        const uint64_t gap = std::uniform_int_distribution<uint64_t>(
+                m_params.sample_rate / 50, m_params.sample_rate / 2)(m_rng);
+        reads.push_back(make_read(wrap(complement), "", channel, end_sample + gap));
+        auto& template_read = *reads.front().read;
+        auto& complement_read = *reads.back().read;
+        template_read.next_read = complement_read.read_common.read_id;
+        complement_read.prev_read = template_read.read_common.read_id;
+        end_sample = complement_read.end_sample;
+    }
+
+    // Channels wait for a new molecule to be captured for an exponentially distributed time,
+    // with a mean of one second.
+    std::exponential_distribution<double> capture_dist(1.0);
+    m_channel_next_sample[channel] =
+            end_sample + uint64_t(capture_dist(m_rng) * double(m_params.sample_rate));
+    return reads;
+}
+
+void FakeDataLoader::load_reads(const int num_reads) {
+    int num_reads_loaded = 0;
+    while (num_reads_loaded < num_reads) {
+        for (auto& synthetic_read : m_generator.next_reads()) {
+            if (num_reads_loaded == num_reads) {
+                break;
+            }
+            m_num_samples_loaded += synthetic_read.read->read_common.raw_data.size(0);
+            m_pipeline.push_message(std::move(synthetic_read.read));
+            ++num_reads_loaded;
+        }
+    }
+}
+
+FakeDataLoader::FakeDataLoader(Pipeline& pipeline) : FakeDataLoader(pipeline, {}) {}
+
+FakeDataLoader::FakeDataLoader(Pipeline& pipeline, SyntheticReadParams params)
+        : m_pipeline(pipeline), m_generator(std::move(params)) {}
 
 }  // namespace dorado
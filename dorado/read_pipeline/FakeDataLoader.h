@@ -1,17 +1,110 @@
 #pragma once
 
+#include "ReadPipeline.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
 namespace dorado {
 
 class Pipeline;
 
-// Supplies a stream of reads with random signals for testing purposes.
+// Parameters controlling the simulation of reads by SyntheticReadGenerator.
+struct SyntheticReadParams {
+    // Sequence the reads are sampled from.  If empty, a random reference of
+    // random_reference_length bases is generated.
+    std::string reference;
+    size_t random_reference_length = 1000000;
+
+    // Expected normalised signal level of each kmer, indexed as in the refine_kmer_levels.tensor
+    // of a modbase model (first base most significant).  If empty, a random table is generated.
+    std::vector<float> kmer_levels;
+    // The level for base i is taken from the kmer starting kmer_centre bases before it.
+    size_t kmer_centre = 4;
+    // Normalised levels are converted to pA as level * level_scale + level_shift.
+    float level_shift = 90.f;
+    float level_scale = 15.f;
+    float noise_sd = 2.f;
+    float open_pore_level = 220.f;
+
+    // Molecule lengths in bases are drawn from a log-normal distribution with this mean and
+    // standard deviation, and clamped to [min_read_length, max_read_length].
+    float read_length_mean = 8000.f;
+    float read_length_sd = 6000.f;
+    size_t min_read_length = 200;
+    size_t max_read_length = 200000;
+    // Mean number of samples per base.  Dwells are drawn from a geometric distribution.
+    float samples_per_base = 10.f;
+
+    // Calibration applied to the raw signal: pA = scaling * (raw + offset).
+    float scaling = 0.18f;
+    float offset = -10.f;
+    uint64_t sample_rate = 5000;
+
+    // Sequence prepended to each molecule, e.g. a sequencing adapter.
+    std::string adapter;
+    // Barcode arrangements, including flanks.  If not empty, each molecule gets one of these after
+    // the adapter, and the reverse complement of the same barcode at its rear.
+    std::vector<std::string> barcodes;
+
+    // Fraction of reads which contain two molecules (the second being the reverse complement of the
+    // first) separated by a short open-pore event, as seen by the read splitters.
+    float concatemer_fraction = 0.f;
+    // Fraction of reads which are followed on the same channel by their complement strand, as
+    // duplex follow-on pairs.
+    float duplex_fraction = 0.f;
+
+    int num_channels = 512;
+    uint64_t seed = 42;
+};
+
+// A simulated read along with the sequence its signal was generated from.
+struct SyntheticRead {
+    SimplexReadPtr read;
+    std::string sequence;
+};
+
+// Simulates squiggles from a reference using a table of kmer levels, with realistic read
+// lengths, acquisition timings and (optionally) barcodes, adapters, concatemers and duplex pairs.
+class SyntheticReadGenerator {
+public:
+    explicit SyntheticReadGenerator(SyntheticReadParams params);
+
+    // Returns the next read, or the next two reads when a duplex follow-on pair is generated.
+    std::vector<SyntheticRead> next_reads();
+
+private:
+    std::string sample_molecule();
+    SyntheticRead make_read(const std::string& sequence,
+                            const std::string& second_sequence,
+                            int channel,
+                            uint64_t start_sample);
+    void append_signal(const std::string& sequence, std::vector<float>& signal);
+    std::string make_read_id();
+
+    SyntheticReadParams m_params;
+    std::mt19937_64 m_rng;
+    size_t m_kmer_len = 0;
+    std::vector<uint64_t> m_channel_next_sample;
+    std::vector<int32_t> m_channel_read_number;
+};
+
+// Supplies a stream of reads with simulated signals for testing and benchmarking purposes.
 class FakeDataLoader {
 public:
     FakeDataLoader(Pipeline& read_sink);
+    FakeDataLoader(Pipeline& read_sink, SyntheticReadParams params);
     void load_reads(int num_reads);
 
+    size_t get_num_samples_loaded() const { return m_num_samples_loaded; }
+
 private:
     Pipeline& m_pipeline;
+    SyntheticReadGenerator m_generator;
+    size_t m_num_samples_loaded = 0;
 };
 
 }  // namespace dorado
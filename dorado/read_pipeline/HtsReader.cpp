@@ -1,20 +1,141 @@
 #include "HtsReader.h"
 
 #include "read_pipeline/ReadPipeline.h"
+#include "utils/bam_utils.h"
 #include "utils/types.h"
 
 #include <htslib/sam.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cctype>
+#include <exception>
 #include <filesystem>
+#include <mutex>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
 namespace dorado {
 
+namespace {
+
+bool is_hts_file(const std::filesystem::path& path) {
+    static const std::set<std::string> extensions{".bam", ".sam",   ".cram", ".fastq",
+                                                  ".fq",  ".fasta", ".fa"};
+    auto extension = path.extension().string();
+    if (extension == ".gz") {
+        extension = path.stem().extension().string();
+    }
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+    return extensions.count(extension) > 0;
+}
+
+std::string get_header_line(sam_hdr_t* header, const char* type, int pos) {
+    kstring_t line = utils::allocate_kstring();
+    std::string result;
+    if (sam_hdr_find_line_pos(header, type, pos, &line) == 0) {
+        result.assign(line.s, line.l);
+    }
+    free(line.s);
+    return result;
+}
+
+// Returns the line of the given type with the given ID, or an empty string if there isn't one.
+std::string get_header_line(sam_hdr_t* header, const char* type, const std::string& id) {
+    kstring_t line = utils::allocate_kstring();
+    std::string result;
+    if (sam_hdr_find_line_id(header, type, "ID", id.c_str(), &line) == 0) {
+        result.assign(line.s, line.l);
+    }
+    free(line.s);
+    return result;
+}
+
+bool have_same_references(const sam_hdr_t* a, const sam_hdr_t* b) {
+    if (a->n_targets != b->n_targets) {
+        return false;
+    }
+    for (int32_t i = 0; i < a->n_targets; ++i) {
+        if (a->target_len[i] != b->target_len[i] ||
+            std::string(a->target_name[i]) != b->target_name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds the reference sequences, read groups and programs of src to dest, and returns the read
+// group IDs which had to be changed because dest already had a different read group with the
+// same ID.
+std::unordered_map<std::string, std::string> merge_header(sam_hdr_t* dest,
+                                                          sam_hdr_t* src,
+                                                          const std::string& src_filename) {
+    if (src->n_targets > 0) {
+        if (dest->n_targets == 0) {
+            for (int i = 0; i < sam_hdr_count_lines(src, "SQ"); ++i) {
+                sam_hdr_add_lines(dest, get_header_line(src, "SQ", i).c_str(), 0);
+            }
+        } else if (!have_same_references(dest, src)) {
+            throw std::runtime_error("Aligned input " + src_filename +
+                                     " has different reference sequences to earlier inputs");
+        }
+    }
+
+    std::unordered_map<std::string, std::string> read_group_renames;
+    for (int i = 0; i < sam_hdr_count_lines(src, "RG"); ++i) {
+        const char* line_id = sam_hdr_line_name(src, "RG", i);
+        if (line_id == nullptr) {
+            continue;
+        }
+        const std::string id(line_id);
+        const auto line = get_header_line(src, "RG", i);
+        const auto existing_line = get_header_line(dest, "RG", id);
+        if (existing_line.empty()) {
+            sam_hdr_add_lines(dest, line.c_str(), 0);
+            continue;
+        }
+        if (existing_line == line) {
+            continue;
+        }
+        // Use the first suffixed ID which is either free or already has this read group.
+        const std::string id_field = "\tID:" + id;
+        const auto id_pos = line.find(id_field);
+        for (int suffix = 1;; ++suffix) {
+            const auto new_id = id + "_" + std::to_string(suffix);
+            auto new_line = line;
+            new_line.replace(id_pos, id_field.size(), "\tID:" + new_id);
+            const auto existing_new_line = get_header_line(dest, "RG", new_id);
+            if (existing_new_line.empty()) {
+                sam_hdr_add_lines(dest, new_line.c_str(), 0);
+            } else if (existing_new_line != new_line) {
+                continue;
+            }
+            read_group_renames[id] = new_id;
+            break;
+        }
+    }
+
+    // Programs are only added if they aren't already there, since records rarely refer to them.
+    for (int i = 0; i < sam_hdr_count_lines(src, "PG"); ++i) {
+        const char* line_id = sam_hdr_line_name(src, "PG", i);
+        if (line_id == nullptr) {
+            continue;
+        }
+        const std::string id(line_id);
+        if (get_header_line(dest, "PG", id).empty()) {
+            sam_hdr_add_lines(dest, get_header_line(src, "PG", i).c_str(), 0);
+        }
+    }
+    return read_group_renames;
+}
+
+}  // namespace
+
 HtsReader::HtsReader(const std::string& filename,
                      std::optional<std::unordered_set<std::string>> read_list)
         : m_read_list(std::move(read_list)) {
@@ -65,6 +186,103 @@ void HtsReader::read(Pipeline& pipeline, int max_reads) {
     spdlog::debug("Total reads processed: {}", num_reads);
 }
 
+MultiHtsReader::MultiHtsReader(std::vector<std::string> filenames,
+                               std::optional<std::unordered_set<std::string>> read_list)
+        : m_filenames(std::move(filenames)), m_read_list(std::move(read_list)) {
+    if (m_filenames.empty()) {
+        throw std::runtime_error("No input files");
+    }
+    if (m_filenames.size() > 1 &&
+        std::find(m_filenames.begin(), m_filenames.end(), "-") != m_filenames.end()) {
+        throw std::runtime_error("stdin can't be read along with other inputs");
+    }
+
+    m_first_reader = std::make_unique<HtsReader>(m_filenames.front(), std::nullopt);
+    m_header.reset(sam_hdr_dup(m_first_reader->header));
+    m_read_group_renames.resize(m_filenames.size());
+    for (size_t i = 1; i < m_filenames.size(); ++i) {
+        HtsReader reader(m_filenames[i], std::nullopt);
+        m_read_group_renames[i] = merge_header(m_header.get(), reader.header, m_filenames[i]);
+        for (const auto& [id, new_id] : m_read_group_renames[i]) {
+            spdlog::debug("Read group {} in {} renamed to {}", id, m_filenames[i], new_id);
+        }
+    }
+    is_aligned = m_header->n_targets > 0;
+}
+
+MultiHtsReader::~MultiHtsReader() = default;
+
+void MultiHtsReader::read_file(size_t file_idx, Pipeline& pipeline, int max_reads, bool ordered) {
+    auto reader = file_idx == 0 ? std::move(m_first_reader)
+                                : std::make_unique<HtsReader>(m_filenames[file_idx], std::nullopt);
+    const auto& read_group_renames = m_read_group_renames[file_idx];
+    while (reader->read()) {
+        auto record = reader->record.get();
+        if (m_read_list) {
+            std::string read_id = bam_get_qname(record);
+            if (m_read_list->find(read_id) == m_read_list->end()) {
+                continue;
+            }
+        }
+        const int read_num = m_num_reads++;
+        if (max_reads > 0 && read_num >= max_reads) {
+            break;
+        }
+        if (!read_group_renames.empty()) {
+            if (auto rg_tag = bam_aux_get(record, "RG")) {
+                auto it = read_group_renames.find(bam_aux2Z(rg_tag));
+                if (it != read_group_renames.end()) {
+                    bam_aux_update_str(record, "RG", int(it->second.size() + 1),
+                                       it->second.c_str());
+                }
+            }
+        }
+        BamPtr message(bam_dup1(record));
+        if (ordered) {
+            // Only one file is read at a time, so the read number follows the input order.
+            utils::set_record_order(message.get(), {uint64_t(read_num) + 1, 0, 1});
+        }
+        pipeline.push_message(std::move(message));
+    }
+}
+
+void MultiHtsReader::read(Pipeline& pipeline, int max_reads, int num_threads, bool ordered) {
+    const size_t num_workers =
+            ordered ? 1 : std::clamp(size_t(num_threads), size_t(1), m_filenames.size());
+    std::atomic<size_t> next_file_idx{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        for (size_t file_idx = next_file_idx++; file_idx < m_filenames.size();
+             file_idx = next_file_idx++) {
+            try {
+                read_file(file_idx, pipeline, max_reads, ordered);
+            } catch (const std::exception&) {
+                std::lock_guard lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next_file_idx = m_filenames.size();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < num_workers; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    spdlog::debug("Total reads processed from {} files: {}", m_filenames.size(),
+                  max_reads > 0 ? std::min(m_num_reads.load(), max_reads) : m_num_reads.load());
+}
+
 ReadMap read_bam(const std::string& filename, const std::unordered_set<std::string>& read_ids) {
     HtsReader reader(filename, std::nullopt);
 
@@ -127,4 +345,33 @@ std::unordered_set<std::string> fetch_read_ids(const std::string& filename) {
     return read_ids;
 }
 
+std::vector<std::string> get_hts_input_files(const std::vector<std::string>& paths,
+                                             bool recursive) {
+    std::vector<std::string> files;
+    for (const auto& path : paths) {
+        if (!std::filesystem::is_directory(path)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> directory_files;
+        auto add_entry = [&](const std::filesystem::directory_entry& entry) {
+            if (entry.is_regular_file() && is_hts_file(entry.path())) {
+                directory_files.push_back(entry.path().string());
+            }
+        };
+        if (recursive) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                add_entry(entry);
+            }
+        } else {
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                add_entry(entry);
+            }
+        }
+        std::sort(directory_files.begin(), directory_files.end());
+        files.insert(files.end(), directory_files.begin(), directory_files.end());
+    }
+    return files;
+}
+
 }  // namespace dorado
@@ -5,12 +5,14 @@
 
 #include <htslib/sam.h>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace dorado {
 
@@ -40,6 +42,37 @@ private:
     std::optional<std::unordered_set<std::string>> m_read_list;
 };
 
+// Reads several HTS files into the same pipeline at once, with a single header merged from all of
+// theirs.  Read groups with the same ID but different contents in different files are given
+// distinct IDs, and the RG tags of their records are updated to match.  Aligned inputs must share
+// the same reference sequences.
+class MultiHtsReader {
+public:
+    MultiHtsReader(std::vector<std::string> filenames,
+                   std::optional<std::unordered_set<std::string>> read_list);
+    ~MultiHtsReader();
+    // Reads the files, up to num_threads of them at a time, stopping once max_reads reads have
+    // been pushed in total if max_reads is non-zero.  If ordered is set, the files are read one
+    // after another instead, and each record is given its position in the input as its
+    // utils::RecordOrder, so that they can be written in order.
+    void read(Pipeline& pipeline, int max_reads, int num_threads, bool ordered);
+    sam_hdr_t* header() const { return m_header.get(); }
+
+    bool is_aligned{false};
+
+private:
+    void read_file(size_t file_idx, Pipeline& pipeline, int max_reads, bool ordered);
+
+    std::vector<std::string> m_filenames;
+    std::optional<std::unordered_set<std::string>> m_read_list;
+    SamHdrPtr m_header;
+    // The first file is kept open from reading its header, so that it can be stdin.
+    std::unique_ptr<HtsReader> m_first_reader;
+    // For each file, the read group IDs which were changed in the merged header.
+    std::vector<std::unordered_map<std::string, std::string>> m_read_group_renames;
+    std::atomic<int> m_num_reads{0};
+};
+
 template <typename T>
 T HtsReader::get_tag(std::string tagname) {
     T tag_value{};
@@ -88,4 +121,17 @@ ReadMap read_bam(const std::string& filename, const std::unordered_set<std::stri
  */
 std::unordered_set<std::string> fetch_read_ids(const std::string& filename);
 
+/**
+ * @brief Lists the HTS files to read from a set of input paths.
+ *
+ * Files are returned as given, and directories are searched for SAM/BAM/CRAM/FASTQ/FASTA files,
+ * which are returned in name order.
+ *
+ * @param paths The input files and directories.
+ * @param recursive Whether to search subdirectories too.
+ * @return The paths of the files found.
+ */
+std::vector<std::string> get_hts_input_files(const std::vector<std::string>& paths,
+                                             bool recursive);
+
 }  // namespace dorado
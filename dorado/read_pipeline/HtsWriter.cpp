@@ -1,6 +1,7 @@
 #include "HtsWriter.h"
 
 #include "read_pipeline/ReadPipeline.h"
+#include "utils/bam_utils.h"
 #include "utils/sequence_utils.h"
 
 #include <htslib/bgzf.h>
@@ -9,41 +10,119 @@
 #include <indicators/progress_bar.hpp>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
 namespace dorado {
 
-HtsWriter::HtsWriter(const std::string& filename, OutputMode mode, size_t threads)
-        : MessageSink(10000) {
-    switch (mode) {
+namespace {
+
+// Size of the block size and fixed-length fields of a BAM record, which bam1_t::l_data leaves out.
+constexpr size_t BAM_RECORD_FIXED_SIZE = 36;
+
+// 64-bit FNV-1a, which unlike std::hash gives the same value with every standard library, so
+// that reads go to the same shards on every platform.
+uint64_t read_id_hash(std::string_view read_id) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : read_id) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
+HtsWriter::HtsWriter(const std::string& filename,
+                     OutputMode mode,
+                     size_t threads,
+                     size_t reorder_buffer_size,
+                     const OutputShardOptions& shard_options)
+        : MessageSink(10000),
+          m_filename(filename),
+          m_mode(mode),
+          m_shard_options(shard_options),
+          m_threads_per_shard(
+                  std::max(1, int(threads / std::max(shard_options.num_shards, size_t(1))))),
+          m_reorder_buffer_size(reorder_buffer_size) {
+    if (m_shard_options.num_shards == 0) {
+        throw std::runtime_error("Number of output shards must be at least 1.");
+    }
+    if (m_shard_options.is_sharded() && filename == "-") {
+        throw std::runtime_error("Sharded output must be written to files.");
+    }
+    m_shards.resize(m_shard_options.num_shards);
+    if (m_shard_options.is_sharded()) {
+        // Shard files are only opened once there's a record to write to them, so that there are
+        // no empty files, but a bad output directory can still be reported up front.
+        const auto directory = std::filesystem::path(filename).parent_path();
+        if (!directory.empty() && !std::filesystem::is_directory(directory)) {
+            throw std::runtime_error("Output directory does not exist: " + directory.string());
+        }
+    } else {
+        m_shards.front().file = open_file(filename);
+    }
+    start_threads();
+}
+
+htsFile* HtsWriter::open_file(const std::string& filename) {
+    htsFile* file = nullptr;
+    switch (m_mode) {
     case OutputMode::FASTQ:
-        m_file = hts_open(filename.c_str(), "wf");
+        file = hts_open(filename.c_str(), "wf");
         break;
     case OutputMode::BAM:
-        m_file = hts_open(filename.c_str(), "wb");
+        file = hts_open(filename.c_str(), "wb");
         break;
     case OutputMode::SAM:
-        m_file = hts_open(filename.c_str(), "w");
+        file = hts_open(filename.c_str(), "w");
         break;
     case OutputMode::UBAM:
-        m_file = hts_open(filename.c_str(), "wb0");
+        file = hts_open(filename.c_str(), "wb0");
         break;
     default:
         throw std::runtime_error("Unknown output mode selected: " +
-                                 std::to_string(static_cast<int>(mode)));
+                                 std::to_string(static_cast<int>(m_mode)));
     }
-    if (!m_file) {
+    if (!file) {
         throw std::runtime_error("Could not open file: " + filename);
     }
-    if (m_file->format.compression == bgzf) {
-        auto res = bgzf_mt(m_file->fp.bgzf, int(threads), 128);
+    if (file->format.compression == bgzf) {
+        auto res = bgzf_mt(file->fp.bgzf, m_threads_per_shard, 128);
         if (res < 0) {
+            hts_close(file);
             throw std::runtime_error("Could not enable multi threading for BAM generation.");
         }
     }
-    start_threads();
+    m_num_files_opened++;
+    return file;
+}
+
+std::string HtsWriter::get_shard_filename(const std::string& filename,
+                                          const OutputShardOptions& shard_options,
+                                          size_t shard,
+                                          size_t part) {
+    if (!shard_options.is_sharded()) {
+        return filename;
+    }
+    const std::filesystem::path path(filename);
+    std::ostringstream name;
+    name << path.stem().string() << std::setfill('0');
+    if (shard_options.num_shards > 1) {
+        name << '.' << std::setw(4) << shard;
+    }
+    if (shard_options.max_records_per_file > 0 || shard_options.max_bytes_per_file > 0) {
+        name << '.' << std::setw(6) << part;
+    }
+    name << path.extension().string();
+    return (path.parent_path() / name.str()).string();
 }
 
 void HtsWriter::start_threads() {
@@ -66,7 +145,11 @@ void HtsWriter::restart() {
 HtsWriter::~HtsWriter() {
     terminate_impl();
     sam_hdr_destroy(m_header);
-    hts_close(m_file);
+    for (auto& shard : m_shards) {
+        if (shard.file) {
+            hts_close(shard.file);
+        }
+    }
 }
 
 HtsWriter::OutputMode HtsWriter::get_output_mode(const std::string& mode) {
@@ -89,35 +172,95 @@ void HtsWriter::worker_thread() {
         }
 
         auto aln = std::move(std::get<BamPtr>(message));
-        write(aln.get());
+        if (m_reorder_buffer_size > 0) {
+            reorder_record(std::move(aln));
+        } else {
+            handle_record(std::move(aln));
+        }
+    }
+
+    // Nothing else is coming, so write whatever is still held back.
+    while (!m_pending_records.empty()) {
+        write_next_records(true);
+    }
+}
+
+void HtsWriter::reorder_record(BamPtr aln) {
+    const auto order = utils::get_record_order(aln.get());
+    if (order.sequence_number < m_next_sequence_number) {
+        // Either it has no order, or its turn was skipped when the buffer filled up.
+        handle_record(std::move(aln));
+        return;
+    }
+
+    auto& pending = m_pending_records[order.sequence_number];
+    pending.records.resize(order.count);
+    pending.records[order.index] = std::move(aln);
+    ++pending.num_received;
+    const size_t num_pending = ++m_num_pending_records;
+    if (num_pending > m_max_pending_records) {
+        m_max_pending_records = num_pending;
+    }
+
+    write_next_records(false);
+    while (m_num_pending_records > m_reorder_buffer_size) {
+        write_next_records(true);
+        ++m_num_forced_writes;
+    }
+}
 
-        // For the purpose of estimating write count, we ignore duplex reads
-        int64_t dx_tag = 0;
-        auto tag_str = bam_aux_get(aln.get(), "dx");
-        if (tag_str) {
-            dx_tag = bam_aux2i(tag_str);
+void HtsWriter::write_next_records(bool force) {
+    while (!m_pending_records.empty()) {
+        auto it = m_pending_records.begin();
+        auto& pending = it->second;
+        if (!force && (it->first != m_next_sequence_number ||
+                       pending.num_received < pending.records.size())) {
+            return;
         }
+        for (auto& record : pending.records) {
+            if (record) {
+                handle_record(std::move(record));
+            }
+        }
+        m_num_pending_records -= pending.num_received;
+        m_next_sequence_number = it->first + 1;
+        m_pending_records.erase(it);
+        force = false;
+    }
+}
 
-        bool ignore_read_id = dx_tag == 1;
+void HtsWriter::handle_record(BamPtr aln) {
+    write(aln.get());
 
-        if (ignore_read_id) {
-            // Read is a duplex read.
-            m_duplex_reads_written++;
+    // For the purpose of estimating write count, we ignore duplex reads
+    int64_t dx_tag = 0;
+    auto tag_str = bam_aux_get(aln.get(), "dx");
+    if (tag_str) {
+        dx_tag = bam_aux2i(tag_str);
+    }
+
+    bool ignore_read_id = dx_tag == 1;
+
+    if (ignore_read_id) {
+        // Read is a duplex read.
+        m_duplex_reads_written++;
+        add_to_counter(stats::Counter::DUPLEX_READS_WRITTEN, 1);
+    } else {
+        std::string read_id;
+
+        // If read is a split read, use the parent read id
+        // to track write count since we don't know a priori
+        // how many split reads will be generated.
+        auto pid_tag = bam_aux_get(aln.get(), "pi");
+        if (pid_tag) {
+            read_id = std::string(bam_aux2Z(pid_tag));
+            m_split_reads_written++;
         } else {
-            std::string read_id;
-
-            // If read is a split read, use the parent read id
-            // to track write count since we don't know a priori
-            // how many split reads will be generated.
-            auto pid_tag = bam_aux_get(aln.get(), "pi");
-            if (pid_tag) {
-                read_id = std::string(bam_aux2Z(pid_tag));
-                m_split_reads_written++;
-            } else {
-                read_id = bam_get_qname(aln.get());
-            }
+            read_id = bam_get_qname(aln.get());
+        }
 
-            m_processed_read_ids.insert(std::move(read_id));
+        if (m_processed_read_ids.insert(std::move(read_id)).second) {
+            add_to_counter(stats::Counter::SIMPLEX_READS_WRITTEN, 1);
         }
     }
 }
@@ -147,13 +290,55 @@ int HtsWriter::write(bam1_t* const record) {
     // will segfault, since set_and_write_header has to have been called
     // in order to set m_header.
     assert(m_header);
-    auto res = sam_write1(m_file, m_header, record);
+    auto& shard = select_shard(record);
+    auto res = sam_write1(shard.file, m_header, record);
     if (res < 0) {
         throw std::runtime_error("Failed to write SAM record, error code " + std::to_string(res));
     }
+
+    // Move the shard on to a new file if this one is full.  The next file isn't opened until
+    // there's a record to write to it, so that there are no empty files.
+    ++shard.num_records;
+    shard.num_bytes += BAM_RECORD_FIXED_SIZE + size_t(record->l_data);
+    const auto& options = m_shard_options;
+    if ((options.max_records_per_file > 0 && shard.num_records >= options.max_records_per_file) ||
+        (options.max_bytes_per_file > 0 && shard.num_bytes >= options.max_bytes_per_file)) {
+        auto close_res = hts_close(shard.file);
+        shard.file = nullptr;
+        if (close_res < 0) {
+            throw std::runtime_error("Failed to close output file, error code " +
+                                     std::to_string(close_res));
+        }
+        ++shard.part;
+        shard.num_records = 0;
+        shard.num_bytes = 0;
+    }
     return res;
 }
 
+HtsWriter::Shard& HtsWriter::select_shard(const bam1_t* const record) {
+    size_t index = 0;
+    if (m_shards.size() > 1) {
+        if (m_shard_options.assignment == OutputShardOptions::Assignment::READ_ID_HASH) {
+            index = size_t(read_id_hash(bam_get_qname(record)) % m_shards.size());
+        } else {
+            index = m_next_shard;
+            m_next_shard = (m_next_shard + 1) % m_shards.size();
+        }
+    }
+
+    auto& shard = m_shards[index];
+    if (!shard.file) {
+        shard.file = open_file(get_shard_filename(m_filename, m_shard_options, index, shard.part));
+        auto res = sam_hdr_write(shard.file, m_header);
+        if (res < 0) {
+            throw std::runtime_error("Failed to write SAM header, error code " +
+                                     std::to_string(res));
+        }
+    }
+    return shard;
+}
+
 int HtsWriter::set_and_write_header(const sam_hdr_t* const header) {
     if (header) {
         // Avoid leaking memory if this is called twice.
@@ -161,7 +346,15 @@ int HtsWriter::set_and_write_header(const sam_hdr_t* const header) {
             sam_hdr_destroy(m_header);
         }
         m_header = sam_hdr_dup(header);
-        return sam_hdr_write(m_file, m_header);
+        // Files opened later get the header when they're opened.
+        for (auto& shard : m_shards) {
+            if (shard.file) {
+                auto res = sam_hdr_write(shard.file, m_header);
+                if (res < 0) {
+                    return res;
+                }
+            }
+        }
     }
     return 0;
 }
@@ -171,6 +364,14 @@ stats::NamedStats HtsWriter::sample_stats() const {
     stats["unique_simplex_reads_written"] = double(m_processed_read_ids.size());
     stats["duplex_reads_written"] = m_duplex_reads_written.load();
     stats["split_reads_written"] = m_split_reads_written.load();
+    if (m_reorder_buffer_size > 0) {
+        stats["reorder_buffer_records"] = double(m_num_pending_records.load());
+        stats["reorder_buffer_max_records"] = double(m_max_pending_records.load());
+        stats["reorder_forced_writes"] = double(m_num_forced_writes.load());
+    }
+    if (m_shard_options.is_sharded()) {
+        stats["output_files_opened"] = m_num_files_opened.load();
+    }
     return stats;
 }
 
@@ -6,13 +6,36 @@
 
 #include <atomic>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
 namespace dorado {
 
+// How HtsWriter splits its output between files, so that downstream consumers can process the
+// files in parallel without a separate split pass.  Every file gets the full header.
+struct OutputShardOptions {
+    enum class Assignment {
+        ROUND_ROBIN,   // Records are dealt out to the shards in turn.
+        READ_ID_HASH,  // Records with the same read ID, such as its alignments, share a shard.
+    };
+
+    // Number of files written in parallel, each with its own compression threads.
+    size_t num_shards{1};
+    Assignment assignment{Assignment::ROUND_ROBIN};
+    // If non-zero, a shard moves on to a new file once its current file holds this many records,
+    // or this many bytes of records as measured before compression.
+    size_t max_records_per_file{0};
+    size_t max_bytes_per_file{0};
+
+    bool is_sharded() const {
+        return num_shards > 1 || max_records_per_file > 0 || max_bytes_per_file > 0;
+    }
+};
+
 class HtsWriter : public MessageSink {
 public:
     enum class OutputMode {
@@ -22,7 +45,21 @@ public:
         FASTQ,
     };
 
-    HtsWriter(const std::string& filename, OutputMode mode, size_t threads);
+    // Number of records which may be held back to write records in input order, by default.
+    static constexpr size_t DEFAULT_REORDER_BUFFER_SIZE = 100000;
+
+    // If reorder_buffer_size is non-zero, records with a utils::RecordOrder are written in input
+    // order, holding back up to that many records which arrive early.  Once the buffer is full,
+    // records are written as soon as those before them are written or dropped, so missing
+    // records don't stall the output.
+    // If shard_options is sharded, filename is used as a template for the names of the files
+    // written, as given by get_shard_filename(), and the threads are divided between the shards.
+    // Shard files are opened when their first record is written, so there are no empty files.
+    HtsWriter(const std::string& filename,
+              OutputMode mode,
+              size_t threads,
+              size_t reorder_buffer_size,
+              const OutputShardOptions& shard_options = {});
     ~HtsWriter();
     std::string get_name() const override { return "HtsWriter"; }
     stats::NamedStats sample_stats() const override;
@@ -31,6 +68,13 @@ public:
 
     int set_and_write_header(const sam_hdr_t* header);
     static OutputMode get_output_mode(const std::string& mode);
+    // The name of the file of the given shard and part, which is filename with the shard and part
+    // numbers inserted before its extension, e.g. "calls.0001.000002.bam".  Shard numbers are
+    // left out if there's one shard, and part numbers if files aren't size limited.
+    static std::string get_shard_filename(const std::string& filename,
+                                          const OutputShardOptions& shard_options,
+                                          size_t shard,
+                                          size_t part);
     size_t get_total() const { return m_total; }
     size_t get_primary() const { return m_primary; }
     size_t get_unmapped() const { return m_unmapped; }
@@ -45,13 +89,47 @@ private:
     size_t m_supplementary{0};
     sam_hdr_t* m_header{nullptr};
 
-    htsFile* m_file{nullptr};
+    // A file being written to, and how much has been written to it.
+    struct Shard {
+        htsFile* file{nullptr};
+        size_t part{0};
+        size_t num_records{0};
+        size_t num_bytes{0};
+    };
+    const std::string m_filename;
+    const OutputMode m_mode;
+    const OutputShardOptions m_shard_options;
+    const int m_threads_per_shard;
+    std::vector<Shard> m_shards;
+    size_t m_next_shard{0};
+    std::atomic<int> m_num_files_opened{0};
+    htsFile* open_file(const std::string& filename);
+    Shard& select_shard(const bam1_t* record);
+
     std::unique_ptr<std::thread> m_worker;
     void worker_thread();
+    void handle_record(BamPtr aln);
+    void reorder_record(BamPtr aln);
+    // Writes the held back records which are next in order, after writing the earliest held back
+    // records whether or not they're next if force is set.
+    void write_next_records(bool force);
     int write(bam1_t* record);
     std::unordered_set<std::string> m_processed_read_ids;
     std::atomic<int> m_duplex_reads_written{0};
     std::atomic<int> m_split_reads_written{0};
+
+    // The records made from each input record which are held back until their turn, by sequence
+    // number.
+    struct PendingRecords {
+        std::vector<BamPtr> records;
+        size_t num_received{0};
+    };
+    const size_t m_reorder_buffer_size;
+    std::map<uint64_t, PendingRecords> m_pending_records;
+    uint64_t m_next_sequence_number{1};
+    std::atomic<size_t> m_num_pending_records{0};
+    std::atomic<size_t> m_max_pending_records{0};
+    std::atomic<int64_t> m_num_forced_writes{0};
 };
 
 }  // namespace dorado
@@ -26,7 +26,7 @@ constexpr auto FORCE_TIMEOUT = 100ms;
 struct ModBaseCallerNode::RemoraChunk {
     RemoraChunk(std::shared_ptr<WorkingRead> read,
                 at::Tensor input_signal,
-                std::vector<int8_t> kmer_data,
+                at::Tensor kmer_data,
                 size_t position,
                 bool is_template_direction)
             : working_read(std::move(read)),
@@ -37,7 +37,7 @@ struct ModBaseCallerNode::RemoraChunk {
 
     std::shared_ptr<WorkingRead> working_read;
     at::Tensor signal;
-    std::vector<int8_t> encoded_kmers;
+    at::Tensor encoded_kmers;
     size_t context_hit;
     std::vector<float> scores;
     bool is_template_direction;
@@ -240,19 +240,26 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
 
                 auto context_hits = runner->get_motif_hits(caller_id, new_seq);
                 m_num_context_hits += static_cast<int64_t>(context_hits.size());
-                chunks_to_enqueue.reserve(context_hits.size());
-
-                for (auto context_hit : context_hits) {
-                    nvtx3::scoped_range range_create_chunk{"create_chunk"};
-                    auto slice = encoder.get_context(context_hit);
-                    // signal
-                    auto input_signal = scaled_signal.index({at::indexing::Slice(
-                            slice.first_sample, slice.first_sample + slice.num_samples)});
-                    if (slice.lead_samples_needed != 0 || slice.tail_samples_needed != 0) {
-                        input_signal = at::constant_pad_nd(input_signal,
-                                                           {(int64_t)slice.lead_samples_needed,
-                                                            (int64_t)slice.tail_samples_needed});
-                    }
+
+                // Encode the contexts of every hit in one pass over the read.  The chunks
+                // reference rows of these buffers rather than owning copies.
+                const auto num_hits = static_cast<int64_t>(context_hits.size());
+                std::vector<modbase::ModBaseEncoder::ContextSamples> contexts(context_hits.size());
+                auto encoded_kmers = at::empty(
+                        {num_hits, static_cast<int64_t>(encoder.kmer_context_size())}, at::kChar);
+                encoder.get_contexts(context_hits, contexts.data(),
+                                     encoded_kmers.data_ptr<int8_t>());
+                // Any lead and tail samples needed are left as zero padding.
+                auto input_signals = at::zeros({num_hits, static_cast<int64_t>(context_samples)},
+                                               scaled_signal.options());
+
+                chunks_to_enqueue.reserve(chunks_to_enqueue.size() + context_hits.size());
+                for (size_t hit_idx = 0; hit_idx < context_hits.size(); ++hit_idx) {
+                    const auto context_hit = context_hits[hit_idx];
+                    const auto& context = contexts[hit_idx];
+                    utils::copy_tensor_elems(
+                            input_signals, hit_idx * context_samples + context.lead_samples_needed,
+                            scaled_signal, context.first_sample, context.num_samples);
 
                     // Update the context hit into the duplex reference context
                     unsigned long context_hit_in_duplex_space;
@@ -265,7 +272,7 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
                     }
 
                     chunks_to_enqueue.push_back(std::make_unique<RemoraChunk>(
-                            working_read, input_signal, std::move(slice.data),
+                            working_read, input_signals[hit_idx], encoded_kmers[hit_idx],
                             context_hit_in_duplex_space, is_template_direction));
 
                     all_context_hits.push_back(context_hit_in_duplex_space);
@@ -335,24 +342,33 @@ void ModBaseCallerNode::simplex_mod_call(Message&& message) {
     auto& runner = m_runners[0];
     std::vector<std::vector<std::unique_ptr<RemoraChunk>>> chunks_to_enqueue_by_caller(
             runner->num_callers());
+
+    // The base to signal maps are shared by all callers, with the reversed map only built if a
+    // caller needs it.
+    const auto signal_len = read->read_common.get_raw_data_samples();
+    const auto forward_seq_to_sig_map =
+            utils::moves_to_map(read->read_common.moves, m_block_stride, signal_len,
+                                read->read_common.seq.size() + 1);
+    std::vector<uint64_t> reverse_seq_to_sig_map;
+
     for (size_t caller_id = 0; caller_id < runner->num_callers(); ++caller_id) {
         nvtx3::scoped_range range{"generate_chunks"};
 
-        auto signal_len = read->read_common.get_raw_data_samples();
-        std::vector<uint64_t> seq_to_sig_map =
-                utils::moves_to_map(read->read_common.moves, m_block_stride, signal_len,
-                                    read->read_common.seq.size() + 1);
-
         auto& chunks_to_enqueue = chunks_to_enqueue_by_caller.at(caller_id);
         auto& params = runner->caller_params(caller_id);
         auto signal = read->read_common.raw_data;
         if (params.reverse_signal) {
             signal = at::flip(signal, 0);
-            std::reverse(std::begin(seq_to_sig_map), std::end(seq_to_sig_map));
-            std::transform(std::begin(seq_to_sig_map), std::end(seq_to_sig_map),
-                           std::begin(seq_to_sig_map),
-                           [signal_len](auto signal_pos) { return signal_len - signal_pos; });
+            if (reverse_seq_to_sig_map.empty()) {
+                reverse_seq_to_sig_map.resize(forward_seq_to_sig_map.size());
+                std::transform(std::rbegin(forward_seq_to_sig_map),
+                               std::rend(forward_seq_to_sig_map),
+                               std::begin(reverse_seq_to_sig_map),
+                               [signal_len](auto signal_pos) { return signal_len - signal_pos; });
+            }
         }
+        const auto& seq_to_sig_map =
+                params.reverse_signal ? reverse_seq_to_sig_map : forward_seq_to_sig_map;
 
         // scale signal based on model parameters
         auto scaled_signal = runner->scale_signal(caller_id, signal, sequence_ints, seq_to_sig_map);
@@ -366,20 +382,27 @@ void ModBaseCallerNode::simplex_mod_call(Message&& message) {
 
         auto context_hits = runner->get_motif_hits(caller_id, read->read_common.seq);
         m_num_context_hits += static_cast<int64_t>(context_hits.size());
+
+        // Encode the contexts of every hit in one pass over the read.  The chunks reference rows
+        // of these buffers rather than owning copies.
+        const auto num_hits = static_cast<int64_t>(context_hits.size());
+        std::vector<modbase::ModBaseEncoder::ContextSamples> contexts(context_hits.size());
+        auto encoded_kmers = at::empty(
+                {num_hits, static_cast<int64_t>(encoder.kmer_context_size())}, at::kChar);
+        encoder.get_contexts(context_hits, contexts.data(), encoded_kmers.data_ptr<int8_t>());
+        // Any lead and tail samples needed are left as zero padding.
+        auto input_signals = at::zeros({num_hits, static_cast<int64_t>(context_samples)},
+                                       scaled_signal.options());
+
         chunks_to_enqueue.reserve(context_hits.size());
-        for (auto context_hit : context_hits) {
-            nvtx3::scoped_range nvtxrange{"create_chunk"};
-            auto slice = encoder.get_context(context_hit);
-            // signal
-            auto input_signal = scaled_signal.index({at::indexing::Slice(
-                    slice.first_sample, slice.first_sample + slice.num_samples)});
-            if (slice.lead_samples_needed != 0 || slice.tail_samples_needed != 0) {
-                input_signal = at::constant_pad_nd(
-                        input_signal,
-                        {(int64_t)slice.lead_samples_needed, (int64_t)slice.tail_samples_needed});
-            }
+        for (size_t hit_idx = 0; hit_idx < context_hits.size(); ++hit_idx) {
+            const auto& context = contexts[hit_idx];
+            utils::copy_tensor_elems(input_signals,
+                                     hit_idx * context_samples + context.lead_samples_needed,
+                                     scaled_signal, context.first_sample, context.num_samples);
             chunks_to_enqueue.push_back(std::make_unique<RemoraChunk>(
-                    working_read, input_signal, std::move(slice.data), context_hit, true));
+                    working_read, input_signals[hit_idx], encoded_kmers[hit_idx],
+                    context_hits[hit_idx], true));
 
             ++working_read->num_modbase_chunks;
         }
@@ -525,6 +548,10 @@ void ModBaseCallerNode::call_current_batch(
         m_processed_chunks.try_push(std::move(chunk));
     }
 
+    m_num_chunks_called += static_cast<int64_t>(batched_chunks.size());
+    if (batched_chunks.size() < m_batch_size) {
+        ++m_num_partial_batches_called;
+    }
     batched_chunks.clear();
     ++m_num_batches_called;
 }
@@ -605,6 +632,7 @@ std::unordered_map<std::string, double> ModBaseCallerNode::sample_stats() const
     }
     stats["batches_called"] = double(m_num_batches_called);
     stats["partial_batches_called"] = double(m_num_partial_batches_called);
+    stats["chunks_called"] = double(m_num_chunks_called);
     stats["input_chunks_sleeps"] = double(m_num_input_chunks_sleeps);
     stats["call_chunks_ms"] = double(m_call_chunks_ms);
     stats["context_hits"] = double(m_num_context_hits);
@@ -86,6 +86,7 @@ private:
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
     std::atomic<int64_t> m_num_partial_batches_called = 0;
+    std::atomic<int64_t> m_num_chunks_called = 0;
     std::atomic<int64_t> m_num_input_chunks_sleeps = 0;
     std::atomic<int64_t> m_call_chunks_ms = 0;
     std::atomic<int64_t> m_num_context_hits = 0;
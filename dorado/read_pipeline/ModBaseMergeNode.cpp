@@ -0,0 +1,106 @@
+#include "ModBaseMergeNode.h"
+
+#include <htslib/sam.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace dorado {
+
+void ModBaseMergeNode::replace_modbase_tags(bam1_t* record, bam1_t* modbase_record) {
+    for (const char* tag : {"MN", "MM", "ML"}) {
+        if (auto* old_tag = bam_aux_get(record, tag)) {
+            bam_aux_del(record, old_tag);
+        }
+    }
+    if (const auto* mn_tag = bam_aux_get(modbase_record, "MN")) {
+        bam_aux_update_int(record, "MN", bam_aux2i(mn_tag));
+    }
+    if (const auto* mm_tag = bam_aux_get(modbase_record, "MM")) {
+        const char* mm = bam_aux2Z(mm_tag);
+        bam_aux_append(record, "MM", 'Z', int(std::strlen(mm) + 1),
+                       reinterpret_cast<const uint8_t*>(mm));
+    }
+    if (auto* ml_tag = bam_aux_get(modbase_record, "ML")) {
+        // Array data follows the 'B', the element type and the u32 element count.
+        bam_aux_update_array(record, "ML", 'C', bam_auxB_len(ml_tag), ml_tag + 6);
+    }
+}
+
+void ModBaseMergeNode::worker_thread() {
+    Message message;
+    while (get_input_message(message)) {
+        if (!std::holds_alternative<SimplexReadPtr>(message)) {
+            send_message_to_sink(std::move(message));
+            continue;
+        }
+
+        auto read = std::get<SimplexReadPtr>(std::move(message));
+        BamPtr record;
+        {
+            std::lock_guard<std::mutex> lock(m_records_mutex);
+            auto it = m_records.find(read->read_common.read_id);
+            if (it != m_records.end()) {
+                record = std::move(it->second);
+                m_records.erase(it);
+            }
+        }
+        if (!record) {
+            spdlog::warn("No record for read {}, skipping", read->read_common.read_id);
+            ++m_num_reads_without_records;
+            continue;
+        }
+
+        auto modbase_records = read->read_common.extract_sam_lines(false, m_modbase_threshold,
+                                                                   false);
+        replace_modbase_tags(record.get(), modbase_records.front().get());
+        ++m_num_records_updated;
+        send_message_to_sink(std::move(record));
+    }
+}
+
+ModBaseMergeNode::ModBaseMergeNode(float modbase_threshold_frac,
+                                   size_t num_worker_threads,
+                                   size_t max_reads)
+        : MessageSink(max_reads),
+          m_num_worker_threads(num_worker_threads),
+          m_modbase_threshold(
+                  static_cast<uint8_t>(std::min(modbase_threshold_frac * 256.0f, 255.0f))) {
+    start_threads();
+}
+
+void ModBaseMergeNode::add_record(const std::string& read_id, BamPtr record) {
+    std::lock_guard<std::mutex> lock(m_records_mutex);
+    m_records[read_id] = std::move(record);
+}
+
+void ModBaseMergeNode::start_threads() {
+    for (size_t i = 0; i < m_num_worker_threads; i++) {
+        m_workers.push_back(std::make_unique<std::thread>(&ModBaseMergeNode::worker_thread, this));
+    }
+}
+
+void ModBaseMergeNode::terminate_impl() {
+    terminate_input_queue();
+    for (auto& m : m_workers) {
+        if (m->joinable()) {
+            m->join();
+        }
+    }
+    m_workers.clear();
+}
+
+void ModBaseMergeNode::restart() {
+    restart_input_queue();
+    start_threads();
+}
+
+stats::NamedStats ModBaseMergeNode::sample_stats() const {
+    stats::NamedStats stats = stats::from_obj(m_work_queue);
+    stats["records_updated"] = double(m_num_records_updated);
+    stats["reads_without_records"] = double(m_num_reads_without_records);
+    return stats;
+}
+
+}  // namespace dorado
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ReadPipeline.h"
+#include "utils/stats.h"
+#include "utils/types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dorado {
+
+// Adds the modified base calls of reads rebuilt from BAM records back to those records, keeping
+// the rest of each record, including any alignment, as it was.  Records of reads which weren't
+// rebuilt pass straight through.
+class ModBaseMergeNode : public MessageSink {
+public:
+    ModBaseMergeNode(float modbase_threshold_frac, size_t num_worker_threads, size_t max_reads);
+    ~ModBaseMergeNode() { terminate_impl(); }
+    std::string get_name() const override { return "ModBaseMergeNode"; }
+    stats::NamedStats sample_stats() const override;
+    void terminate(const FlushOptions&) override { terminate_impl(); }
+    void restart() override;
+
+    // Holds the record a read was rebuilt from until the read has been modbase called.
+    void add_record(const std::string& read_id, BamPtr record);
+
+    // Replaces any modified base tags of record with those of modbase_record.
+    static void replace_modbase_tags(bam1_t* record, bam1_t* modbase_record);
+
+private:
+    void start_threads();
+    void terminate_impl();
+    void worker_thread();
+
+    std::vector<std::unique_ptr<std::thread>> m_workers;
+    size_t m_num_worker_threads{0};
+    const uint8_t m_modbase_threshold;
+
+    std::mutex m_records_mutex;
+    std::unordered_map<std::string, BamPtr> m_records;
+
+    std::atomic<int64_t> m_num_records_updated{0};
+    std::atomic<int64_t> m_num_reads_without_records{0};
+};
+
+}  // namespace dorado
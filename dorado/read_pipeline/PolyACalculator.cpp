@@ -1,6 +1,7 @@
 #include "PolyACalculator.h"
 
 #include "utils/math_utils.h"
+#include "utils/move_table.h"
 #include "utils/sequence_utils.h"
 
 #include <edlib.h>
@@ -258,10 +259,9 @@ SignalAnchorInfo determine_signal_anchor_and_strand_cdna(const dorado::SimplexRe
         }
 
         const auto stride = read.read_common.model_stride;
-        const auto seq_to_sig_map = dorado::utils::moves_to_map(
-                read.read_common.moves, stride, read.read_common.get_raw_data_samples(),
-                read.read_common.seq.size() + 1);
-        int signal_anchor = int(seq_to_sig_map[base_anchor]);
+        const dorado::utils::MoveTable moves(read.read_common.moves);
+        int signal_anchor = int(moves.base_start_sample(base_anchor, stride,
+                                                        read.read_common.get_raw_data_samples()));
 
         result = {fwd, signal_anchor, trailing_Ts};
     } else {
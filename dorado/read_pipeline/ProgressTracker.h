@@ -72,41 +72,37 @@ public:
         }
     }
 
-    void update_progress_bar(const stats::NamedStats& stats) {
+    // Reads the pipeline's counters, which is cheap enough to do often while it runs.
+    void update_progress_bar(const stats::CounterRegistry& counters) {
         // Instead of capturing end time when summarizer is called,
         // which suffers from delays due to sampler and pipeline termination
         // costs, store it whenever stats are updated.
         m_end_time = std::chrono::system_clock::now();
 
-        auto fetch_stat = [&stats](const std::string& name) {
-            auto res = stats.find(name);
-            if (res != stats.end()) {
-                return res->second;
-            }
-            return 0.;
+        const auto values = counters.get_all();
+        auto fetch_counter = [&values](stats::Counter counter) {
+            return values[size_t(counter)];
         };
 
-        m_num_simplex_reads_written = int(fetch_stat("HtsWriter.unique_simplex_reads_written") +
-                                          fetch_stat("BarcodeDemuxerNode.demuxed_reads_written"));
+        // Reads written by HtsWriter and BarcodeDemuxerNode both count as simplex reads written.
+        m_num_simplex_reads_written = int(fetch_counter(stats::Counter::SIMPLEX_READS_WRITTEN));
 
-        m_num_simplex_reads_filtered = int(fetch_stat("ReadFilterNode.simplex_reads_filtered"));
-        m_num_simplex_bases_filtered = int(fetch_stat("ReadFilterNode.simplex_bases_filtered"));
-        m_num_simplex_bases_processed = int64_t(fetch_stat("BasecallerNode.bases_processed"));
+        m_num_simplex_reads_filtered = int(fetch_counter(stats::Counter::SIMPLEX_READS_FILTERED));
+        m_num_simplex_bases_filtered = int(fetch_counter(stats::Counter::SIMPLEX_BASES_FILTERED));
+        m_num_simplex_bases_processed = fetch_counter(stats::Counter::SIMPLEX_BASES_PROCESSED);
         m_num_bases_processed = m_num_simplex_bases_processed;
-        m_num_samples_processed = int64_t(fetch_stat("BasecallerNode.samples_processed"));
+        m_num_samples_processed = fetch_counter(stats::Counter::SIMPLEX_SAMPLES_PROCESSED);
         if (m_duplex) {
-            m_num_duplex_bases_processed =
-                    int64_t(fetch_stat("StereoBasecallerNode.bases_processed"));
+            m_num_duplex_bases_processed = fetch_counter(stats::Counter::DUPLEX_BASES_PROCESSED);
             m_num_bases_processed += m_num_duplex_bases_processed;
-            m_num_samples_processed +=
-                    int64_t(fetch_stat("StereoBasecallerNode.samples_processed"));
+            m_num_samples_processed += fetch_counter(stats::Counter::DUPLEX_SAMPLES_PROCESSED);
         }
-        m_num_duplex_reads_written = int(fetch_stat("HtsWriter.duplex_reads_written"));
-        m_num_duplex_reads_filtered = int(fetch_stat("ReadFilterNode.duplex_reads_filtered"));
-        m_num_duplex_bases_filtered = int(fetch_stat("ReadFilterNode.duplex_bases_filtered"));
+        m_num_duplex_reads_written = int(fetch_counter(stats::Counter::DUPLEX_READS_WRITTEN));
+        m_num_duplex_reads_filtered = int(fetch_counter(stats::Counter::DUPLEX_READS_FILTERED));
+        m_num_duplex_bases_filtered = int(fetch_counter(stats::Counter::DUPLEX_BASES_FILTERED));
 
         // Barcode demuxing stats.
-        m_num_barcodes_demuxed = int(fetch_stat("BarcodeClassifierNode.num_barcodes_demuxed"));
+        m_num_barcodes_demuxed = int(fetch_counter(stats::Counter::BARCODES_DEMUXED));
 
         if (m_num_reads_expected != 0) {
             // TODO: Add the ceiling because in duplex, reads written can exceed reads expected
@@ -21,9 +21,15 @@ void ReadFilterNode::worker_thread() {
             if (read_common.is_duplex) {
                 ++m_num_duplex_reads_filtered;
                 m_num_duplex_bases_filtered += read_common.seq.length();
+                add_to_counter(stats::Counter::DUPLEX_READS_FILTERED, 1);
+                add_to_counter(stats::Counter::DUPLEX_BASES_FILTERED,
+                               int64_t(read_common.seq.length()));
             } else {
                 ++m_num_simplex_reads_filtered;
                 m_num_simplex_bases_filtered += read_common.seq.length();
+                add_to_counter(stats::Counter::SIMPLEX_READS_FILTERED, 1);
+                add_to_counter(stats::Counter::SIMPLEX_BASES_FILTERED,
+                               int64_t(read_common.seq.length()));
             }
         };
 
@@ -458,8 +458,10 @@ std::unique_ptr<Pipeline> Pipeline::create(
 Pipeline::Pipeline(PipelineDescriptor &&descriptor,
                    std::vector<NodeHandle> source_to_sink_order,
                    std::vector<dorado::stats::StatsReporter> *const stats_reporters)
-        : m_source_to_sink_order(std::move(source_to_sink_order)) {
+        : m_counters(std::make_unique<stats::CounterRegistry>()),
+          m_source_to_sink_order(std::move(source_to_sink_order)) {
     for (auto &[desc_node, _] : descriptor.m_node_descriptors) {
+        desc_node->m_counters.store(m_counters.get(), std::memory_order_release);
         m_nodes.push_back(std::move(desc_node));
         if (stats_reporters) {
             stats_reporters->push_back(stats::make_stats_reporter(*m_nodes.back()));
@@ -6,6 +6,7 @@
 #include <ATen/core/TensorBody.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -93,6 +94,11 @@ public:
 
     uint64_t num_trimmed_samples;  // Number of samples which have been trimmed from the raw read.
 
+    // Ranges [start, end) of raw_data containing no strand translocation, e.g. long open-pore
+    // events. These are skipped by the basecaller and covered by zero moves in the move table.
+    // Set by the scaler and cleared once the read has been basecalled.
+    std::vector<std::pair<uint64_t, uint64_t>> excluded_signal_ranges;
+
     bool is_duplex{false};
 
     size_t get_raw_data_samples() const { return is_duplex ? raw_data.size(1) : raw_data.size(0); }
@@ -273,12 +279,21 @@ protected:
         return status == utils::AsyncQueueStatus::Success;
     }
 
+    // Adds to one of the counters of the pipeline this node is part of, if any.
+    void add_to_counter(stats::Counter counter, int64_t value) {
+        if (auto* counters = m_counters.load(std::memory_order_acquire)) {
+            counters->add(counter, value);
+        }
+    }
+
     // Queue of work items for this node.
     utils::AsyncQueue<Message> m_work_queue;
 
 private:
     // The sinks to which this node can send messages.
     std::vector<std::reference_wrapper<MessageSink>> m_sinks;
+    // Set once the node is added to a pipeline, while its worker threads may be running.
+    std::atomic<stats::CounterRegistry*> m_counters{nullptr};
 
     friend class Pipeline;
     void add_sink(MessageSink& sink);
@@ -368,6 +383,9 @@ public:
     // Exists to accommodate situations where client code avoids using the pipeline framework.
     MessageSink& get_node_ref(NodeHandle node_handle) { return *m_nodes.at(node_handle); }
 
+    // The counters the pipeline's nodes add to, which are cheap to read while it runs.
+    const stats::CounterRegistry& counters() const { return *m_counters; }
+
 private:
     // Constructor is private to ensure instances of this class are created
     // through the create function.
@@ -375,6 +393,8 @@ private:
              std::vector<NodeHandle> source_to_sink_order,
              std::vector<dorado::stats::StatsReporter>* stats_reporters);
 
+    // Declared before the nodes, so that it outlives them.
+    std::unique_ptr<stats::CounterRegistry> m_counters;
     std::vector<std::unique_ptr<MessageSink>> m_nodes;
     std::vector<NodeHandle> m_source_to_sink_order;
 
@@ -0,0 +1,370 @@
+#include "ReadQCStatsNode.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+using ColumnType = dorado::ReadQCStatsNode::ColumnType;
+
+constexpr char MAGIC[4] = {'D', 'Q', 'C', 'S'};
+constexpr size_t READ_ID_WIDTH = 36;
+constexpr size_t NUM_LENGTH_BINS = 32;
+
+struct ColumnSpec {
+    const char* name;
+    ColumnType type;
+    uint8_t width;
+};
+
+// Indices into COLUMNS.
+enum Column : size_t {
+    READ_ID,
+    START_TIME_MS,
+    DURATION,
+    NUM_SAMPLES,
+    SEQUENCE_LENGTH,
+    MEAN_QSCORE,
+    CHANNEL,
+    MUX,
+    FLAGS,
+    BARCODE,
+    POLY_TAIL_LENGTH,
+    SPLIT_POINT,
+    NUM_COLUMNS,
+};
+
+const std::array<ColumnSpec, NUM_COLUMNS> COLUMNS = {{
+        {"read_id", ColumnType::CHARS, uint8_t(READ_ID_WIDTH)},
+        {"start_time_ms", ColumnType::UINT64, 8},
+        {"duration", ColumnType::FLOAT32, 4},
+        {"num_samples", ColumnType::UINT32, 4},
+        {"sequence_length", ColumnType::UINT32, 4},
+        {"mean_qscore", ColumnType::FLOAT32, 4},
+        {"channel", ColumnType::INT32, 4},
+        {"mux", ColumnType::UINT8, 1},
+        {"flags", ColumnType::UINT8, 1},
+        {"barcode", ColumnType::UINT16, 2},
+        {"poly_tail_length", ColumnType::INT32, 4},
+        {"split_point", ColumnType::UINT32, 4},
+}};
+
+template <typename T>
+void append_value(std::vector<char>& column, T value) {
+    const auto* bytes = reinterpret_cast<const char*>(&value);
+    column.insert(column.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void write_value(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_string(std::ostream& stream, const std::string& str) {
+    write_value(stream, uint16_t(str.size()));
+    stream.write(str.data(), str.size());
+}
+
+template <typename T>
+T read_value(std::istream& stream) {
+    T value;
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Truncated QC stats file");
+    }
+    return value;
+}
+
+template <typename T>
+T value_at(const std::vector<char>& column, size_t row) {
+    T value;
+    std::memcpy(&value, column.data() + row * sizeof(T), sizeof(T));
+    return value;
+}
+
+std::string read_string(std::istream& stream) {
+    std::string str(read_value<uint16_t>(stream), '\0');
+    if (!stream.read(str.data(), str.size())) {
+        throw std::runtime_error("Truncated QC stats file");
+    }
+    return str;
+}
+
+size_t length_bin(uint32_t length) {
+    size_t bin = 0;
+    while (length > 1) {
+        length >>= 1;
+        ++bin;
+    }
+    return bin;
+}
+
+}  // namespace
+
+namespace dorado {
+
+ReadQCRecord ReadQCStatsNode::make_record(const ReadCommon& read_common, bool is_duplex_parent) {
+    ReadQCRecord record;
+    record.read_id = read_common.read_id;
+    record.start_time_ms = read_common.start_time_ms;
+    if (!read_common.is_duplex && read_common.raw_data.defined()) {
+        const auto num_samples =
+                read_common.get_raw_data_samples() + read_common.num_trimmed_samples;
+        record.num_samples = uint32_t(num_samples);
+        record.duration_s = float(num_samples) / float(read_common.sample_rate);
+    }
+    record.sequence_length = uint32_t(read_common.seq.size());
+    record.mean_qscore = read_common.qstring.empty() ? 0.f : read_common.calculate_mean_qscore();
+    record.channel = read_common.attributes.channel_number;
+    record.mux = uint8_t(std::min<uint32_t>(read_common.attributes.mux, 255));
+    if (read_common.is_duplex) {
+        record.flags |= ReadQCRecord::FLAG_DUPLEX;
+    }
+    if (is_duplex_parent) {
+        record.flags |= ReadQCRecord::FLAG_DUPLEX_PARENT;
+    }
+    if (!read_common.parent_read_id.empty()) {
+        record.flags |= ReadQCRecord::FLAG_SPLIT;
+    }
+    record.barcode = read_common.barcode;
+    record.poly_tail_length = read_common.rna_poly_tail_length;
+    record.split_point = read_common.split_point;
+    return record;
+}
+
+void ReadQCStatsNode::worker_thread() {
+    Message message;
+    while (get_input_message(message)) {
+        if (is_read_message(message)) {
+            const bool is_duplex_parent =
+                    std::holds_alternative<SimplexReadPtr>(message) &&
+                    std::get<SimplexReadPtr>(message)->is_duplex_parent.load();
+            add_record(make_record(get_read_common_data(message), is_duplex_parent));
+        }
+        send_message_to_sink(std::move(message));
+    }
+}
+
+void ReadQCStatsNode::add_record(const ReadQCRecord& record) {
+    auto read_id = record.read_id;
+    read_id.resize(READ_ID_WIDTH, '\0');
+    auto& read_id_column = m_columns[READ_ID];
+    read_id_column.insert(read_id_column.end(), read_id.begin(), read_id.end());
+
+    auto barcode_index = m_barcode_indices.find(record.barcode);
+    if (barcode_index == m_barcode_indices.end()) {
+        if (m_barcodes.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::runtime_error("ReadQCStatsNode: too many distinct barcodes");
+        }
+        barcode_index =
+                m_barcode_indices.emplace(record.barcode, uint16_t(m_barcodes.size())).first;
+        m_barcodes.push_back(record.barcode);
+    }
+
+    append_value(m_columns[START_TIME_MS], record.start_time_ms);
+    append_value(m_columns[DURATION], record.duration_s);
+    append_value(m_columns[NUM_SAMPLES], record.num_samples);
+    append_value(m_columns[SEQUENCE_LENGTH], record.sequence_length);
+    append_value(m_columns[MEAN_QSCORE], record.mean_qscore);
+    append_value(m_columns[CHANNEL], record.channel);
+    append_value(m_columns[MUX], record.mux);
+    append_value(m_columns[FLAGS], record.flags);
+    append_value(m_columns[BARCODE], barcode_index->second);
+    append_value(m_columns[POLY_TAIL_LENGTH], record.poly_tail_length);
+    append_value(m_columns[SPLIT_POINT], record.split_point);
+    if (++m_block_rows == BLOCK_SIZE) {
+        write_block();
+    }
+
+    std::lock_guard lock(m_summary_mutex);
+    ++m_summary.num_reads;
+    m_summary.num_bases += record.sequence_length;
+    const auto qscore_bin = size_t(std::lround(std::max(record.mean_qscore, 0.f)));
+    ++m_summary.qscore_histogram[std::min(qscore_bin, NUM_QSCORE_BINS - 1)];
+    ++m_summary.length_histogram[length_bin(record.sequence_length)];
+    ++m_length_counts[record.sequence_length];
+}
+
+void ReadQCStatsNode::write_block() {
+    if (m_block_rows == 0) {
+        return;
+    }
+    write_value(m_file, uint32_t(m_block_rows));
+    for (auto& column : m_columns) {
+        m_file.write(column.data(), column.size());
+        column.clear();
+    }
+    m_block_rows = 0;
+    m_file.flush();
+}
+
+void ReadQCStatsNode::write_trailer() {
+    write_value(m_file, uint32_t(0));
+    write_value(m_file, uint32_t(m_barcodes.size()));
+    for (const auto& barcode : m_barcodes) {
+        write_string(m_file, barcode);
+    }
+    const auto summary = get_summary();
+    write_value(m_file, summary.num_reads);
+    write_value(m_file, summary.num_bases);
+    write_value(m_file, summary.n50);
+    for (const auto* histogram : {&summary.qscore_histogram, &summary.length_histogram}) {
+        write_value(m_file, uint32_t(histogram->size()));
+        for (auto count : *histogram) {
+            write_value(m_file, count);
+        }
+    }
+    m_file.flush();
+}
+
+ReadQCSummary ReadQCStatsNode::get_summary() const {
+    std::lock_guard lock(m_summary_mutex);
+    auto summary = m_summary;
+    // The N50 is the length of the shortest read such that reads at least that long make up half
+    // of the bases.
+    uint64_t bases = 0;
+    for (auto it = m_length_counts.rbegin(); it != m_length_counts.rend(); ++it) {
+        bases += it->first * it->second;
+        if (2 * bases >= summary.num_bases) {
+            summary.n50 = it->first;
+            break;
+        }
+    }
+    return summary;
+}
+
+stats::NamedStats ReadQCStatsNode::sample_stats() const {
+    stats::NamedStats stats = stats::from_obj(m_work_queue);
+    const auto summary = get_summary();
+    stats["reads"] = double(summary.num_reads);
+    stats["bases"] = double(summary.num_bases);
+    stats["n50"] = double(summary.n50);
+    return stats;
+}
+
+ReadQCStatsNode::ReadQCStatsNode(const std::string& filename, size_t max_reads)
+        : MessageSink(max_reads), m_file(filename, std::ios::binary), m_columns(NUM_COLUMNS) {
+    if (!m_file) {
+        throw std::runtime_error("Unable to open QC stats file " + filename);
+    }
+    m_summary.qscore_histogram.resize(NUM_QSCORE_BINS);
+    m_summary.length_histogram.resize(NUM_LENGTH_BINS);
+
+    m_file.write(MAGIC, sizeof(MAGIC));
+    write_value(m_file, VERSION);
+    write_value(m_file, uint32_t(COLUMNS.size()));
+    for (const auto& column : COLUMNS) {
+        write_value(m_file, column.type);
+        write_value(m_file, column.width);
+        write_string(m_file, column.name);
+    }
+    for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+        m_columns[i].reserve(BLOCK_SIZE * COLUMNS[i].width);
+    }
+
+    start_threads();
+}
+
+ReadQCStatsNode::~ReadQCStatsNode() {
+    terminate_impl();
+    write_trailer();
+}
+
+void ReadQCStatsNode::start_threads() {
+    m_worker = std::make_unique<std::thread>(&ReadQCStatsNode::worker_thread, this);
+}
+
+void ReadQCStatsNode::terminate_impl() {
+    terminate_input_queue();
+    if (m_worker && m_worker->joinable()) {
+        m_worker->join();
+    }
+    m_worker.reset();
+    // Everything seen so far is on disk, even if the pipeline is restarted.
+    write_block();
+}
+
+void ReadQCStatsNode::restart() {
+    restart_input_queue();
+    start_threads();
+}
+
+ReadQCStatsFile load_read_qc_stats(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Unable to open QC stats file " + filename);
+    }
+
+    char magic[sizeof(MAGIC)];
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+        throw std::runtime_error(filename + " is not a QC stats file");
+    }
+    if (read_value<uint32_t>(file) != ReadQCStatsNode::VERSION) {
+        throw std::runtime_error("Unsupported QC stats file version in " + filename);
+    }
+    if (read_value<uint32_t>(file) != NUM_COLUMNS) {
+        throw std::runtime_error("Unexpected QC stats columns in " + filename);
+    }
+    for (const auto& expected : COLUMNS) {
+        const auto type = read_value<ColumnType>(file);
+        const auto width = read_value<uint8_t>(file);
+        if (type != expected.type || width != expected.width ||
+            read_string(file) != expected.name) {
+            throw std::runtime_error("Unexpected QC stats columns in " + filename);
+        }
+    }
+
+    ReadQCStatsFile result;
+    std::vector<uint16_t> barcode_indices;
+    std::vector<std::vector<char>> columns(NUM_COLUMNS);
+    while (auto num_rows = read_value<uint32_t>(file)) {
+        for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+            columns[i].resize(size_t(num_rows) * COLUMNS[i].width);
+            if (!file.read(columns[i].data(), columns[i].size())) {
+                throw std::runtime_error("Truncated QC stats file");
+            }
+        }
+        for (size_t row = 0; row < num_rows; ++row) {
+            ReadQCRecord record;
+            const char* read_id = columns[READ_ID].data() + row * READ_ID_WIDTH;
+            record.read_id.assign(read_id, std::find(read_id, read_id + READ_ID_WIDTH, '\0'));
+            record.start_time_ms = value_at<uint64_t>(columns[START_TIME_MS], row);
+            record.duration_s = value_at<float>(columns[DURATION], row);
+            record.num_samples = value_at<uint32_t>(columns[NUM_SAMPLES], row);
+            record.sequence_length = value_at<uint32_t>(columns[SEQUENCE_LENGTH], row);
+            record.mean_qscore = value_at<float>(columns[MEAN_QSCORE], row);
+            record.channel = value_at<int32_t>(columns[CHANNEL], row);
+            record.mux = value_at<uint8_t>(columns[MUX], row);
+            record.flags = value_at<uint8_t>(columns[FLAGS], row);
+            record.poly_tail_length = value_at<int32_t>(columns[POLY_TAIL_LENGTH], row);
+            record.split_point = value_at<uint32_t>(columns[SPLIT_POINT], row);
+            barcode_indices.push_back(value_at<uint16_t>(columns[BARCODE], row));
+            result.records.push_back(std::move(record));
+        }
+    }
+
+    std::vector<std::string> barcodes(read_value<uint32_t>(file));
+    for (auto& barcode : barcodes) {
+        barcode = read_string(file);
+    }
+    for (size_t i = 0; i < result.records.size(); ++i) {
+        result.records[i].barcode = barcodes.at(barcode_indices[i]);
+    }
+
+    auto& summary = result.summary;
+    summary.num_reads = read_value<uint64_t>(file);
+    summary.num_bases = read_value<uint64_t>(file);
+    summary.n50 = read_value<uint32_t>(file);
+    for (auto* histogram : {&summary.qscore_histogram, &summary.length_histogram}) {
+        histogram->resize(read_value<uint32_t>(file));
+        for (auto& count : *histogram) {
+            count = read_value<uint64_t>(file);
+        }
+    }
+    return result;
+}
+
+}  // namespace dorado
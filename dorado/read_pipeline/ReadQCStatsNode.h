@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ReadPipeline.h"
+#include "utils/stats.h"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dorado {
+
+// Per-read QC metrics, as stored in a QC stats file.
+struct ReadQCRecord {
+    std::string read_id;
+    uint64_t start_time_ms{0};
+    float duration_s{0};  // 0 for duplex reads.
+    uint32_t num_samples{0};
+    uint32_t sequence_length{0};
+    float mean_qscore{0};
+    int32_t channel{-1};
+    uint8_t mux{0};  // 255 if unknown.
+    uint8_t flags{0};
+    std::string barcode;
+    int32_t poly_tail_length{-1};
+    uint32_t split_point{0};
+
+    static constexpr uint8_t FLAG_DUPLEX = 1;
+    static constexpr uint8_t FLAG_DUPLEX_PARENT = 2;
+    static constexpr uint8_t FLAG_SPLIT = 4;
+};
+
+// Running QC summary over all the reads seen so far.
+struct ReadQCSummary {
+    uint64_t num_reads{0};
+    uint64_t num_bases{0};
+    uint32_t n50{0};
+    // Number of reads by mean Q-score, rounded to the nearest integer, with the last bin holding
+    // everything above.
+    std::vector<uint64_t> qscore_histogram;
+    // Number of reads with lengths in [2^i, 2^(i+1)) for bin i, with 0-length reads in bin 0.
+    std::vector<uint64_t> length_histogram;
+};
+
+// Writes per-read QC metrics to a columnar sidecar file as reads pass through on their way to
+// being converted to BAM, so that QC doesn't need another pass over the output.
+//
+// The file is little-endian, and consists of:
+// - a header: the magic "DQCS", a u32 version, a u32 column count, then for each column its u8
+//   type, u8 element width in bytes, u16 name length and name.
+// - blocks of up to BLOCK_SIZE rows: a u32 row count, then for each column in turn the row
+//   count's fixed-width values.
+// - a u32 0 marking the end of the blocks, then a trailer holding the barcode dictionary (a u32
+//   count, then a u16 length and string for each) which the barcode column indexes, followed by
+//   u64 read and base counts, the u32 N50, and the Q-score and length histograms (a u32 bin count
+//   followed by a u64 count per bin).
+// The trailer is written when the node is destroyed.
+class ReadQCStatsNode : public MessageSink {
+public:
+    enum class ColumnType : uint8_t { UINT8, UINT16, UINT32, UINT64, INT32, FLOAT32, CHARS };
+
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t BLOCK_SIZE = 4096;
+    static constexpr size_t NUM_QSCORE_BINS = 61;
+
+    ReadQCStatsNode(const std::string& filename, size_t max_reads);
+    ~ReadQCStatsNode();
+    std::string get_name() const override { return "ReadQCStatsNode"; }
+    stats::NamedStats sample_stats() const override;
+    void terminate(const FlushOptions&) override { terminate_impl(); }
+    void restart() override;
+
+    ReadQCSummary get_summary() const;
+
+    static ReadQCRecord make_record(const ReadCommon& read_common, bool is_duplex_parent);
+
+private:
+    void start_threads();
+    void terminate_impl();
+    void worker_thread();
+    void add_record(const ReadQCRecord& record);
+    void write_block();
+    void write_trailer();
+
+    std::ofstream m_file;
+    std::unique_ptr<std::thread> m_worker;
+
+    // Column data for the block currently being filled.
+    std::vector<std::vector<char>> m_columns;
+    size_t m_block_rows{0};
+    std::unordered_map<std::string, uint16_t> m_barcode_indices;
+    std::vector<std::string> m_barcodes;
+
+    mutable std::mutex m_summary_mutex;
+    ReadQCSummary m_summary;
+    // Number of reads of each length, for the N50.
+    std::map<uint32_t, uint64_t> m_length_counts;
+};
+
+// Reads back the records and summary of a file written by ReadQCStatsNode.
+struct ReadQCStatsFile {
+    std::vector<ReadQCRecord> records;
+    ReadQCSummary summary;
+};
+ReadQCStatsFile load_read_qc_stats(const std::string& filename);
+
+}  // namespace dorado
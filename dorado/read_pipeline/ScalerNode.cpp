@@ -1,6 +1,8 @@
 #include "ScalerNode.h"
 
+#include "SignalCache.h"
 #include "basecall/CRFModelConfig.h"
+#include "utils/SignalBufferPool.h"
 #include "utils/tensor_utils.h"
 #include "utils/trim.h"
 
@@ -16,6 +18,17 @@
 
 static constexpr float EPS = 1e-9f;
 
+// Internal open-pore regions must span at least this many samples to be skipped by the
+// basecaller, since each excluded region splits the read's chunking.
+static constexpr int kMinExcludedOpenPoreSamples = 2000;
+// Open-pore trimming never leaves less than this many samples to basecall.
+static constexpr int kMinSamplesAfterOpenPoreTrim = 1000;
+// Open-pore threshold on signal standardised from pA (ScalingStrategy::PA), which sits higher
+// relative to the open pore level than med/mad or quantile scaled signal, for which
+// utils::DEFAULT_TRIM_THRESHOLD is used.  The value is DuplexSplitSettings' pore_thr for pA
+// scaling.
+static constexpr float kPAScaledOpenPoreThreshold = 2.8f;
+
 using namespace std::chrono_literals;
 using Slice = at::indexing::Slice;
 
@@ -27,10 +40,13 @@ using SignalNormalisationParams = basecall::SignalNormalisationParams;
 std::pair<float, float> ScalerNode::normalisation(const at::Tensor& x) {
     // Calculate shift and scale factors for normalisation.
     const auto& params = m_scaling_params.quantile;
-    auto quantiles =
-            dorado::utils::quantile_counting(x, at::tensor({params.quantile_a, params.quantile_b}));
-    float q_a = quantiles[0].item<float>();
-    float q_b = quantiles[1].item<float>();
+    const std::array<float, 2> quantiles = {params.quantile_a, params.quantile_b};
+    std::array<int16_t, 2> quantile_values;
+    auto x_contig = x.expect_contiguous();
+    dorado::utils::quantile_counting(x_contig->data_ptr<int16_t>(), x.numel(), quantiles.data(),
+                                     quantiles.size(), quantile_values.data());
+    float q_a = quantile_values[0];
+    float q_b = quantile_values[1];
     float shift = std::max(10.0f, params.shift_multiplier * (q_a + q_b));
     float scale = std::max(1.0f, params.scale_multiplier * (q_b - q_a));
     return {shift, scale};
@@ -46,6 +62,38 @@ std::pair<float, float> ScalerNode::med_mad(const at::Tensor& x) {
     return {med.item<float>(), mad.item<float>()};
 }
 
+void ScalerNode::trim_open_pore(SimplexRead& read) {
+    auto& read_common = read.read_common;
+    const float threshold = m_scaling_params.strategy == ScalingStrategy::PA
+                                    ? kPAScaledOpenPoreThreshold
+                                    : utils::DEFAULT_TRIM_THRESHOLD;
+    auto open_pore_ranges = utils::find_open_pore_ranges(read_common.raw_data, threshold,
+                                                         utils::DEFAULT_TRIM_WINDOW_SIZE,
+                                                         utils::DEFAULT_TRIM_MIN_ELEMENTS);
+    if (open_pore_ranges.empty()) {
+        return;
+    }
+
+    // Trailing open pore is trimmed outright, which is reflected in the ns tag.
+    const int num_samples = int(read_common.get_raw_data_samples());
+    int keep_end = num_samples;
+    if (open_pore_ranges.back().second == num_samples &&
+        open_pore_ranges.back().first >= kMinSamplesAfterOpenPoreTrim) {
+        keep_end = open_pore_ranges.back().first;
+        open_pore_ranges.pop_back();
+        read_common.raw_data = read_common.raw_data.index({Slice(at::indexing::None, keep_end)});
+        m_num_open_pore_samples_trimmed += num_samples - keep_end;
+    }
+
+    // Internal open pore stays in the signal, but isn't basecalled.
+    for (const auto& [start, end] : open_pore_ranges) {
+        if (end - start >= kMinExcludedOpenPoreSamples && end < keep_end) {
+            read_common.excluded_signal_ranges.emplace_back(start, end);
+            m_num_open_pore_samples_excluded += end - start;
+        }
+    }
+}
+
 // This function returns the approximate position where the DNA adapter
 // in a dRNA read ends. The adapter location is determined by looking
 // at the median signal value over a sliding window on the raw signal.
@@ -117,6 +165,13 @@ void ScalerNode::worker_thread() {
 
         auto read = std::get<SimplexReadPtr>(std::move(message));
 
+        // Reads loaded from the signal cache have already been scaled and trimmed.
+        if (m_signal_cache && read->read_common.raw_data.scalar_type() == at::kHalf) {
+            ++m_num_cached_reads;
+            send_message_to_sink(std::move(read));
+            continue;
+        }
+
         bool is_rna = (m_model_type == SampleType::RNA002 || m_model_type == SampleType::RNA004);
         // Trim adapter for RNA first before scaling.
         int trim_start = 0;
@@ -166,10 +221,15 @@ void ScalerNode::worker_thread() {
                                              : med_mad(read->read_common.raw_data);
 
             // raw_data comes from DataLoader with dtype int16.  We send it on as float16 after
-            // shifting/scaling in float32 form.
-            read->read_common.raw_data =
-                    ((read->read_common.raw_data.to(at::kFloat) - shift) / scale)
-                            .to(at::ScalarType::Half);
+            // shifting/scaling in float32 form, without materialising the float32 signal.
+            auto raw_data = read->read_common.raw_data.expect_contiguous();
+            auto scaled_data = m_signal_pool
+                                       ? m_signal_pool->empty(raw_data->numel(), at::kHalf)
+                                       : at::empty({raw_data->numel()}, at::ScalarType::Half);
+            utils::normalise_i16_to_f16(scaled_data.data_ptr<c10::Half>(),
+                                        raw_data->data_ptr<int16_t>(), raw_data->numel(), shift,
+                                        scale);
+            read->read_common.raw_data = std::move(scaled_data);
             // move the shift and scale into pA.
             read->read_common.scale = read->scaling * scale;
             read->read_common.shift = read->scaling * (shift + read->offset);
@@ -195,6 +255,10 @@ void ScalerNode::worker_thread() {
 
             read->read_common.raw_data =
                     read->read_common.raw_data.index({Slice(trim_start, at::indexing::None)});
+
+            if (m_trim_open_pore) {
+                trim_open_pore(*read);
+            }
         }
 
         read->read_common.num_trimmed_samples = trim_start;
@@ -202,6 +266,10 @@ void ScalerNode::worker_thread() {
         spdlog::trace("ScalerNode: {} shift: {} scale: {} trim: {}", read->read_common.read_id,
                       shift, scale, trim_start);
 
+        if (m_signal_cache) {
+            m_signal_cache->add(read->read_common);
+        }
+
         // Pass the read to the next node
         send_message_to_sink(std::move(read));
     }
@@ -210,13 +278,19 @@ void ScalerNode::worker_thread() {
 ScalerNode::ScalerNode(const SignalNormalisationParams& config,
                        SampleType model_type,
                        bool trim_adapter,
+                       bool trim_open_pore,
                        int num_worker_threads,
-                       size_t max_reads)
+                       size_t max_reads,
+                       std::shared_ptr<SignalCache> signal_cache,
+                       std::shared_ptr<utils::SignalBufferPool> signal_pool)
         : MessageSink(max_reads),
           m_num_worker_threads(num_worker_threads),
           m_scaling_params(config),
           m_model_type(model_type),
-          m_trim_adapter(trim_adapter) {
+          m_trim_adapter(trim_adapter),
+          m_trim_open_pore(trim_open_pore),
+          m_signal_cache(std::move(signal_cache)),
+          m_signal_pool(std::move(signal_pool)) {
     start_threads();
 }
 
@@ -245,6 +319,14 @@ void ScalerNode::restart() {
     start_threads();
 }
 
-stats::NamedStats ScalerNode::sample_stats() const { return stats::from_obj(m_work_queue); }
+stats::NamedStats ScalerNode::sample_stats() const {
+    stats::NamedStats stats = stats::from_obj(m_work_queue);
+    stats["open_pore_samples_trimmed"] = double(m_num_open_pore_samples_trimmed);
+    stats["open_pore_samples_excluded"] = double(m_num_open_pore_samples_excluded);
+    if (m_signal_cache) {
+        stats["reads_from_signal_cache"] = double(m_num_cached_reads);
+    }
+    return stats;
+}
 
 }  // namespace dorado
@@ -6,6 +6,7 @@
 #include <ATen/core/TensorBody.h>
 
 #include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 #include <utility>
@@ -13,13 +14,22 @@
 
 namespace dorado {
 
+class SignalCache;
+
+namespace utils {
+class SignalBufferPool;
+}
+
 class ScalerNode : public MessageSink {
 public:
     ScalerNode(const basecall::SignalNormalisationParams& config,
                basecall::SampleType model_type,
                bool trim_adapter,
+               bool trim_open_pore,
                int num_worker_threads,
-               size_t max_reads);
+               size_t max_reads,
+               std::shared_ptr<SignalCache> signal_cache = nullptr,
+               std::shared_ptr<utils::SignalBufferPool> signal_pool = nullptr);
     ~ScalerNode() { terminate_impl(); }
     std::string get_name() const override { return "ScalerNode"; }
     stats::NamedStats sample_stats() const override;
@@ -36,9 +46,20 @@ private:
     basecall::SignalNormalisationParams m_scaling_params;
     const basecall::SampleType m_model_type;
     const bool m_trim_adapter;
+    const bool m_trim_open_pore;
+    // If set, scaled reads are added to the cache, and reads loaded from it are passed on as is.
+    const std::shared_ptr<SignalCache> m_signal_cache;
+    // If set, scaled signal is written to buffers from the pool.
+    const std::shared_ptr<utils::SignalBufferPool> m_signal_pool;
+
+    std::atomic<int64_t> m_num_open_pore_samples_trimmed{0};
+    std::atomic<int64_t> m_num_open_pore_samples_excluded{0};
+    std::atomic<int64_t> m_num_cached_reads{0};
 
     std::pair<float, float> med_mad(const at::Tensor& x);
     std::pair<float, float> normalisation(const at::Tensor& x);
+    // Trims trailing open-pore signal and marks long internal open-pore regions to be skipped.
+    void trim_open_pore(SimplexRead& read);
 };
 
 }  // namespace dorado
@@ -0,0 +1,372 @@
+#include "SignalCache.h"
+
+#include "ReadPipeline.h"
+
+#include <ATen/ATen.h>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = {'D', 'S', 'G', 'C'};
+
+template <typename T>
+void write_value(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_string(std::ostream& stream, const std::string& str) {
+    write_value(stream, uint16_t(str.size()));
+    stream.write(str.data(), str.size());
+}
+
+template <typename T>
+T read_value(std::istream& stream) {
+    T value;
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Truncated signal cache index");
+    }
+    return value;
+}
+
+std::string read_string(std::istream& stream) {
+    std::string str(read_value<uint16_t>(stream), '\0');
+    if (!stream.read(str.data(), str.size())) {
+        throw std::runtime_error("Truncated signal cache index");
+    }
+    return str;
+}
+
+fs::path temporary_path(const fs::path& path) { return fs::path(path).concat(".tmp"); }
+
+}  // namespace
+
+namespace dorado {
+
+// A read-only view of a file in memory.  Pages are mapped copy-on-write, so tensors which wrap
+// the signal can be modified in place without touching the file.
+class SignalCache::Mapping {
+public:
+    explicit Mapping(const fs::path& path) {
+#ifdef _WIN32
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Unable to open " + path.string());
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size)) {
+            CloseHandle(m_file);
+            throw std::runtime_error("Unable to get the size of " + path.string());
+        }
+        m_size = uint64_t(size.QuadPart);
+        if (m_size == 0) {
+            return;
+        }
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (m_mapping) {
+            m_data = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+        }
+        if (!m_data) {
+            if (m_mapping) {
+                CloseHandle(m_mapping);
+            }
+            CloseHandle(m_file);
+            throw std::runtime_error("Unable to map " + path.string());
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open " + path.string());
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw std::runtime_error("Unable to get the size of " + path.string());
+        }
+        m_size = uint64_t(file_stat.st_size);
+        if (m_size != 0) {
+            void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Unable to map " + path.string());
+            }
+            m_data = static_cast<char*>(data);
+        }
+        // The mapping keeps the file alive.
+        close(fd);
+#endif
+    }
+
+    ~Mapping() {
+#ifdef _WIN32
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+        }
+        CloseHandle(m_file);
+#else
+        if (m_data) {
+            munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    char* data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+private:
+    char* m_data{nullptr};
+    uint64_t m_size{0};
+#ifdef _WIN32
+    HANDLE m_file{INVALID_HANDLE_VALUE};
+    HANDLE m_mapping{nullptr};
+#endif
+};
+
+SignalCache::SignalCache(const fs::path& directory, const std::string& key)
+        : m_signal_path(directory / (key + ".signal")), m_index_path(directory / (key + ".index")) {
+    if (!open_for_reading()) {
+        fs::create_directories(directory);
+        open_for_writing();
+    }
+}
+
+SignalCache::~SignalCache() {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    if (!m_writing) {
+        return;
+    }
+    m_signal_file.close();
+    std::error_code error;
+    fs::remove(temporary_path(m_signal_path), error);
+}
+
+std::string SignalCache::make_key(const basecall::SignalNormalisationParams& params,
+                                  basecall::SampleType sample_type,
+                                  bool trim_adapter,
+                                  bool trim_open_pore) {
+    const std::string settings = "version:" + std::to_string(VERSION) + " " + params.to_string() +
+                                 " sample_type:" + std::to_string(int(sample_type)) +
+                                 " trim_adapter:" + std::to_string(trim_adapter) +
+                                 " trim_open_pore:" + std::to_string(trim_open_pore);
+
+    // 64-bit FNV-1a, which unlike std::hash is stable across builds.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : settings) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3ull;
+    }
+    std::ostringstream key;
+    key << std::hex << std::setfill('0') << std::setw(16) << hash;
+    return key.str();
+}
+
+size_t SignalCache::size() const {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    return m_entries.size();
+}
+
+bool SignalCache::open_for_reading() {
+    if (!fs::exists(m_index_path) || !fs::exists(m_signal_path)) {
+        return false;
+    }
+
+    try {
+        std::ifstream file(m_index_path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Unable to open " + m_index_path.string());
+        }
+        char magic[sizeof(MAGIC)];
+        if (!file.read(magic, sizeof(magic)) ||
+            !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+            throw std::runtime_error(m_index_path.string() + " is not a signal cache index");
+        }
+        if (read_value<uint32_t>(file) != VERSION) {
+            throw std::runtime_error("Unsupported signal cache version in " +
+                                     m_index_path.string());
+        }
+
+        auto mapping = std::make_shared<const Mapping>(m_signal_path);
+        m_scaling_method = read_string(file);
+        const auto num_reads = read_value<uint64_t>(file);
+        m_entries.reserve(num_reads);
+        for (uint64_t i = 0; i < num_reads; ++i) {
+            auto read_id = read_string(file);
+            Entry entry;
+            entry.offset = read_value<uint64_t>(file);
+            entry.num_samples = read_value<uint64_t>(file);
+            entry.shift = read_value<float>(file);
+            entry.scale = read_value<float>(file);
+            entry.num_trimmed_samples = read_value<uint64_t>(file);
+            entry.rna_adapter_end_signal_pos = read_value<int32_t>(file);
+            entry.excluded_signal_ranges.resize(read_value<uint32_t>(file));
+            for (auto& [start, end] : entry.excluded_signal_ranges) {
+                start = read_value<uint64_t>(file);
+                end = read_value<uint64_t>(file);
+            }
+            if (entry.offset + entry.num_samples * sizeof(c10::Half) > mapping->size()) {
+                throw std::runtime_error("Signal of " + read_id + " is outside " +
+                                         m_signal_path.string());
+            }
+            m_entries.emplace(std::move(read_id), std::move(entry));
+        }
+        m_mapping = std::move(mapping);
+    } catch (const std::exception& e) {
+        spdlog::warn("Rebuilding signal cache: {}", e.what());
+        m_entries.clear();
+        m_scaling_method.clear();
+        return false;
+    }
+
+    spdlog::info("> Using cached signal for {} reads from {}", m_entries.size(),
+                 m_signal_path.parent_path().string());
+    return true;
+}
+
+void SignalCache::open_for_writing() {
+    // A stale index must not outlive the signal it describes.
+    fs::remove(m_index_path);
+    m_signal_file.open(temporary_path(m_signal_path), std::ios::binary | std::ios::trunc);
+    if (!m_signal_file) {
+        throw std::runtime_error("Unable to create signal cache " + m_signal_path.string());
+    }
+    m_writing = true;
+}
+
+bool SignalCache::load(ReadCommon& read_common) const {
+    if (!m_mapping) {
+        return false;
+    }
+    const auto it = m_entries.find(read_common.read_id);
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    const auto& entry = it->second;
+    const auto options = at::TensorOptions().dtype(at::kHalf);
+    if (entry.num_samples == 0) {
+        read_common.raw_data = at::empty({0}, options);
+    } else {
+        // The tensor keeps the mapping alive for as long as it refers to it.
+        read_common.raw_data =
+                at::from_blob(m_mapping->data() + entry.offset, {int64_t(entry.num_samples)},
+                              [mapping = m_mapping](void*) {}, options);
+    }
+    read_common.shift = entry.shift;
+    read_common.scale = entry.scale;
+    read_common.scaling_method = m_scaling_method;
+    read_common.num_trimmed_samples = entry.num_trimmed_samples;
+    read_common.rna_adapter_end_signal_pos = entry.rna_adapter_end_signal_pos;
+    read_common.excluded_signal_ranges = entry.excluded_signal_ranges;
+    return true;
+}
+
+void SignalCache::add(const ReadCommon& read_common) {
+    if (!m_writing || read_common.raw_data.scalar_type() != at::kHalf) {
+        return;
+    }
+
+    const auto signal = read_common.raw_data.expect_contiguous();
+    Entry entry;
+    entry.num_samples = uint64_t(signal->numel());
+    entry.shift = read_common.shift;
+    entry.scale = read_common.scale;
+    entry.num_trimmed_samples = read_common.num_trimmed_samples;
+    entry.rna_adapter_end_signal_pos = read_common.rna_adapter_end_signal_pos;
+    entry.excluded_signal_ranges = read_common.excluded_signal_ranges;
+
+    static const std::array<char, ALIGNMENT> padding{};
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    if (!m_writing) {
+        return;
+    }
+    const auto padding_size = (ALIGNMENT - m_signal_file_size % ALIGNMENT) % ALIGNMENT;
+    m_signal_file.write(padding.data(), padding_size);
+    entry.offset = m_signal_file_size + padding_size;
+    m_signal_file.write(static_cast<const char*>(signal->data_ptr()), signal->nbytes());
+    if (!m_signal_file) {
+        spdlog::warn("Failed to write signal cache {}, it will not be saved",
+                     m_signal_path.string());
+        m_writing = false;
+        m_signal_file.close();
+        fs::remove(temporary_path(m_signal_path));
+        return;
+    }
+    m_signal_file_size = entry.offset + signal->nbytes();
+    m_scaling_method = read_common.scaling_method;
+    m_entries[read_common.read_id] = std::move(entry);
+}
+
+void SignalCache::write_index(const fs::path& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(MAGIC, sizeof(MAGIC));
+    write_value(file, VERSION);
+    write_string(file, m_scaling_method);
+    write_value(file, uint64_t(m_entries.size()));
+    for (const auto& [read_id, entry] : m_entries) {
+        write_string(file, read_id);
+        write_value(file, entry.offset);
+        write_value(file, entry.num_samples);
+        write_value(file, entry.shift);
+        write_value(file, entry.scale);
+        write_value(file, entry.num_trimmed_samples);
+        write_value(file, entry.rna_adapter_end_signal_pos);
+        write_value(file, uint32_t(entry.excluded_signal_ranges.size()));
+        for (const auto& [start, end] : entry.excluded_signal_ranges) {
+            write_value(file, start);
+            write_value(file, end);
+        }
+    }
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+void SignalCache::finalise() {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    if (!m_writing) {
+        return;
+    }
+    m_writing = false;
+    m_signal_file.close();
+
+    // The index is renamed last, since its presence marks the cache as complete.
+    const auto index_path = temporary_path(m_index_path);
+    try {
+        write_index(index_path);
+        fs::rename(temporary_path(m_signal_path), m_signal_path);
+        fs::rename(index_path, m_index_path);
+    } catch (const std::exception& e) {
+        spdlog::warn("Failed to save signal cache {}: {}", m_signal_path.string(), e.what());
+        return;
+    }
+    spdlog::info("> Cached signal for {} reads in {}", m_entries.size(),
+                 m_signal_path.parent_path().string());
+}
+
+}  // namespace dorado
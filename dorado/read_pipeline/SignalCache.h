@@ -0,0 +1,94 @@
+#pragma once
+
+#include "basecall/CRFModelConfig.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dorado {
+
+class ReadCommon;
+
+// An on-disk cache of scaled and trimmed float16 signal, so that rebasecalling the same data
+// with a model which scales signal the same way doesn't need to load and scale it again.
+//
+// The cache for a set of scaling settings is a pair of files in the cache directory, named by
+// the key of those settings:
+// - <key>.signal holds the samples of each read, starting at a multiple of ALIGNMENT bytes so
+//   that each read's signal can be used in place from the memory-mapped file.
+// - <key>.index is little-endian, and consists of the magic "DSGC", a u32 version, a u16 length
+//   and the scaling method, a u64 read count, then for each read a u16 length and its id, u64
+//   signal offset and sample count, f32 shift and scale, u64 number of trimmed samples, i32 RNA
+//   adapter end position, and a u32 count followed by the u64 start and end of each excluded
+//   signal range.
+// Both are written under temporary names and renamed once the cache is finalised, so only the
+// caches of runs which completed are read back.  A cache which is destroyed without being
+// finalised discards what was written.  A complete cache is only read from: reads
+// missing from it are scaled as usual, but aren't added.
+class SignalCache {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 64;
+
+    SignalCache(const std::filesystem::path& directory, const std::string& key);
+    ~SignalCache();
+
+    // Returns the key for signal scaled and trimmed by ScalerNode with the given settings.
+    static std::string make_key(const basecall::SignalNormalisationParams& params,
+                                basecall::SampleType sample_type,
+                                bool trim_adapter,
+                                bool trim_open_pore);
+
+    // Whether scaled reads are being added to the cache, rather than read from it.
+    bool is_writing() const { return m_writing; }
+    size_t size() const;
+
+    // Sets the scaled signal and scaling of the read from the cache, returning false if the read
+    // isn't cached.
+    bool load(ReadCommon& read_common) const;
+    // Adds the scaled signal and scaling of the read, if the cache is being written.
+    void add(const ReadCommon& read_common);
+    // Writes the index and makes the cache available to later runs.  Only to be called once every
+    // read has been added.
+    void finalise();
+
+private:
+    struct Entry {
+        uint64_t offset{0};
+        uint64_t num_samples{0};
+        float shift{0};
+        float scale{1};
+        uint64_t num_trimmed_samples{0};
+        int32_t rna_adapter_end_signal_pos{0};
+        std::vector<std::pair<uint64_t, uint64_t>> excluded_signal_ranges;
+    };
+    class Mapping;
+
+    bool open_for_reading();
+    void open_for_writing();
+    void write_index(const std::filesystem::path& path) const;
+
+    const std::filesystem::path m_signal_path;
+    const std::filesystem::path m_index_path;
+    std::atomic<bool> m_writing{false};
+    std::string m_scaling_method;
+    std::unordered_map<std::string, Entry> m_entries;
+
+    // Read mode.
+    std::shared_ptr<const Mapping> m_mapping;
+
+    // Write mode.
+    mutable std::mutex m_write_mutex;
+    std::ofstream m_signal_file;
+    uint64_t m_signal_file_size{0};
+};
+
+}  // namespace dorado
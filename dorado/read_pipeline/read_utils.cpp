@@ -1,5 +1,16 @@
 #include "read_utils.h"
 
+#include "basecall/CRFModelConfig.h"
+#include "utils/bam_utils.h"
+#include "utils/sequence_utils.h"
+
+#include <ATen/ATen.h>
+#include <htslib/sam.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 namespace dorado::utils {
 SimplexReadPtr shallow_copy_read(const SimplexRead& read) {
     auto copy = std::make_unique<SimplexRead>();
@@ -40,4 +51,73 @@ SimplexReadPtr shallow_copy_read(const SimplexRead& read) {
     return copy;
 }
 
+void restore_basecall(SimplexRead& read, bam1_t* record) {
+    auto& read_common = read.read_common;
+    // The signal of a split read starts at an offset into its parent's trimmed signal, and the
+    // parent's trimming isn't recorded.
+    if (bam_aux_get(record, "pi")) {
+        throw std::runtime_error("split reads can't be rebuilt");
+    }
+    if (read_common.raw_data.scalar_type() != at::kShort) {
+        throw std::runtime_error("signal has already been scaled");
+    }
+    auto [stride, moves] = extract_move_table(record);
+    if (stride <= 0 || moves.empty()) {
+        throw std::runtime_error("no move table");
+    }
+    const auto* sm_tag = bam_aux_get(record, "sm");
+    const auto* sd_tag = bam_aux_get(record, "sd");
+    const auto* sv_tag = bam_aux_get(record, "sv");
+    const auto* ns_tag = bam_aux_get(record, "ns");
+    const auto* ts_tag = bam_aux_get(record, "ts");
+    if (!sm_tag || !sd_tag || !sv_tag || !ns_tag) {
+        throw std::runtime_error("no signal scaling tags");
+    }
+
+    // The basecalled signal is [ts, ns) of the raw signal, with ns reduced by any trimming of
+    // the end of the read.
+    const int64_t ts = ts_tag ? bam_aux2i(ts_tag) : 0;
+    const int64_t ns = bam_aux2i(ns_tag);
+    if (ts < 0 || ns < ts || ns > int64_t(read_common.get_raw_data_samples())) {
+        throw std::runtime_error("signal length doesn't match the raw data");
+    }
+    if (int64_t(moves.size()) * stride > ns - ts) {
+        throw std::runtime_error("move table doesn't match the signal length");
+    }
+
+    auto seq = extract_sequence(record);
+    auto qual = extract_quality(record);
+    if (seq.empty() || qual.size() != seq.size()) {
+        throw std::runtime_error("no sequence");
+    }
+    // Move tables are in basecall order.
+    if (record->core.flag & BAM_FREVERSE) {
+        seq = reverse_complement(seq);
+        std::reverse(qual.begin(), qual.end());
+    }
+
+    const auto shift = float(bam_aux2f(sm_tag));
+    const auto scale = float(bam_aux2f(sd_tag));
+    const std::string scaling_method = bam_aux2Z(sv_tag);
+    auto signal = read_common.raw_data.index({at::indexing::Slice(ts, ns)}).to(at::kFloat);
+    if (scaling_method == basecall::to_string(basecall::ScalingStrategy::PA)) {
+        signal = (signal + shift) * scale;
+    } else {
+        // Otherwise the shift and scale are in pA.
+        signal = ((signal + read.offset) * read.scaling - shift) / scale;
+    }
+
+    read_common.raw_data = signal.to(at::kHalf);
+    read_common.seq = std::move(seq);
+    read_common.qstring.resize(qual.size());
+    std::transform(qual.begin(), qual.end(), read_common.qstring.begin(),
+                   [](uint8_t q) { return char(q + 33); });
+    read_common.moves = std::move(moves);
+    read_common.model_stride = stride;
+    read_common.num_trimmed_samples = uint64_t(ts);
+    read_common.shift = shift;
+    read_common.scale = scale;
+    read_common.scaling_method = scaling_method;
+}
+
 }  // namespace dorado::utils
@@ -3,4 +3,9 @@
 
 namespace dorado::utils {
 SimplexReadPtr shallow_copy_read(const SimplexRead& read);
+
+// Sets the basecall of a read loaded with its raw signal from the record written for it by the
+// basecaller with its move table, and scales and trims the signal as it was for basecalling.
+// Throws if the record isn't one the read can be rebuilt from.
+void restore_basecall(SimplexRead& read, bam1_t* record);
 }  // namespace dorado::utils
@@ -4,85 +4,138 @@
 #include "utils/math_utils.h"
 
 #include <algorithm>
+#include <cassert>
+#include <numeric>
 
 namespace dorado::utils {
 
-void stitch_chunks(ReadCommon& read_common,
-                   const std::vector<std::unique_ptr<Chunk>>& called_chunks) {
-    // Calculate the chunk down sampling, round to closest int.
-    read_common.model_stride = int(
-            div_round_closest(called_chunks[0]->raw_chunk_size, called_chunks[0]->moves.size()));
-
-    int start_pos = 0;
-    int mid_point_front = 0;
-    std::vector<uint8_t> moves;
-    std::vector<std::string> sequences;
-    std::vector<std::string> qstrings;
-
-    for (int i = 0; i < int(called_chunks.size() - 1); i++) {
-        auto& current_chunk = called_chunks[i];
-        auto& next_chunk = called_chunks[i + 1];
-        int overlap_size = int((current_chunk->raw_chunk_size + current_chunk->input_offset) -
-                               (next_chunk->input_offset));
-        assert(overlap_size % read_common.model_stride == 0);
-        int overlap_down_sampled = overlap_size / read_common.model_stride;
-        int mid_point_rear = overlap_down_sampled / 2;
-
-        int current_chunk_bases_to_trim =
-                std::accumulate(std::prev(current_chunk->moves.end(), mid_point_rear),
-                                current_chunk->moves.end(), 0);
-
-        int current_chunk_seq_len = int(current_chunk->seq.size());
-        int end_pos = current_chunk_seq_len - current_chunk_bases_to_trim;
-        int trimmed_len = end_pos - start_pos;
-        sequences.push_back(current_chunk->seq.substr(start_pos, trimmed_len));
-        qstrings.push_back(current_chunk->qstring.substr(start_pos, trimmed_len));
-        moves.insert(moves.end(), std::next(current_chunk->moves.begin(), mid_point_front),
-                     std::prev(current_chunk->moves.end(), mid_point_rear));
-
-        mid_point_front = overlap_down_sampled - mid_point_rear;
-
-        start_pos = 0;
-        for (int j = 0; j < mid_point_front; j++) {
-            start_pos += (int)next_chunk->moves[j];
-        }
+ChunkStitcher::ChunkStitcher(std::vector<CalledSegment> segments)
+        : m_segments(std::move(segments)) {}
+
+void ChunkStitcher::add_chunk(std::unique_ptr<Chunk> chunk) {
+    // The previously owned chunk is released once the new one has been merged with it.
+    auto previous_chunk = std::move(m_owned_pending_chunk);
+    add_chunk_impl(*chunk);
+    if (m_pending_chunk == chunk.get()) {
+        m_owned_pending_chunk = std::move(chunk);
     }
+}
 
-    // Append the final chunk
-    auto& last_chunk = called_chunks.back();
-    moves.insert(moves.end(), std::next(last_chunk->moves.begin(), mid_point_front),
-                 last_chunk->moves.end());
+void ChunkStitcher::add_chunk(const Chunk& chunk) {
+    m_owned_pending_chunk.reset();
+    add_chunk_impl(chunk);
+}
 
-    if (called_chunks.size() == 1) {
-        // shorten the sequence, qstring & moves where the read is shorter than chunksize
-        int last_index_in_moves_to_keep =
-                int(read_common.get_raw_data_samples() / read_common.model_stride);
-        moves = std::vector<uint8_t>(moves.begin(), moves.begin() + last_index_in_moves_to_keep);
-        int end = std::accumulate(moves.begin(), moves.end(), 0);
-        sequences.push_back(last_chunk->seq.substr(start_pos, end));
-        qstrings.push_back(last_chunk->qstring.substr(start_pos, end));
+void ChunkStitcher::add_chunk_impl(const Chunk& chunk) {
+    assert(!is_complete());
+    if (m_model_stride == 0) {
+        // Calculate the chunk down sampling, round to closest int.
+        m_model_stride = int(div_round_closest(chunk.raw_chunk_size, chunk.moves.size()));
+    }
 
+    const auto& segment = m_segments[m_segment_idx];
+    if (m_num_segment_chunks_added == 0) {
+        // Uncalled signal ahead of the segment has no bases.
+        assert(segment.signal_start % m_model_stride == 0);
+        m_moves.resize(segment.signal_start / m_model_stride, 0);
+        m_segment_moves_start = m_moves.size();
+        m_start_pos = 0;
+        m_mid_point_front = 0;
     } else {
-        sequences.push_back(last_chunk->seq.substr(start_pos));
-        qstrings.push_back(last_chunk->qstring.substr(start_pos));
+        merge_pending_chunk(chunk);
     }
+    m_pending_chunk = &chunk;
+
+    if (++m_num_segment_chunks_added == segment.num_chunks) {
+        merge_last_chunk();
+        m_pending_chunk = nullptr;
+        m_num_segment_chunks_added = 0;
+        ++m_segment_idx;
+    }
+}
+
+void ChunkStitcher::merge_pending_chunk(const Chunk& next_chunk) {
+    const auto& current_chunk = *m_pending_chunk;
+    int overlap_size = int((current_chunk.raw_chunk_size + current_chunk.input_offset) -
+                           (next_chunk.input_offset));
+    assert(overlap_size % m_model_stride == 0);
+    int overlap_down_sampled = overlap_size / m_model_stride;
+    int mid_point_rear = overlap_down_sampled / 2;
+
+    int current_chunk_bases_to_trim = std::accumulate(
+            std::prev(current_chunk.moves.end(), mid_point_rear), current_chunk.moves.end(), 0);
+
+    int current_chunk_seq_len = int(current_chunk.seq.size());
+    int end_pos = current_chunk_seq_len - current_chunk_bases_to_trim;
+    int trimmed_len = end_pos - m_start_pos;
+    m_seq.append(current_chunk.seq, m_start_pos, trimmed_len);
+    m_qstring.append(current_chunk.qstring, m_start_pos, trimmed_len);
+    m_moves.insert(m_moves.end(), std::next(current_chunk.moves.begin(), m_mid_point_front),
+                   std::prev(current_chunk.moves.end(), mid_point_rear));
+
+    m_mid_point_front = overlap_down_sampled - mid_point_rear;
+
+    m_start_pos = 0;
+    for (int j = 0; j < m_mid_point_front; j++) {
+        m_start_pos += (int)next_chunk.moves[j];
+    }
+}
+
+void ChunkStitcher::merge_last_chunk() {
+    const auto& segment = m_segments[m_segment_idx];
+    const size_t num_samples = segment.signal_end - segment.signal_start;
+    const auto& last_chunk = *m_pending_chunk;
 
-    // Set the read seq and qstring
-    read_common.seq = std::accumulate(sequences.begin(), sequences.end(), std::string(""));
-    read_common.qstring = std::accumulate(qstrings.begin(), qstrings.end(), std::string(""));
-    read_common.moves = std::move(moves);
+    m_moves.insert(m_moves.end(), std::next(last_chunk.moves.begin(), m_mid_point_front),
+                   last_chunk.moves.end());
+
+    if (segment.num_chunks == 1) {
+        // shorten the sequence, qstring & moves where the segment is shorter than chunksize
+        size_t last_index_in_moves_to_keep = m_segment_moves_start + num_samples / m_model_stride;
+        m_moves.resize(std::min(m_moves.size(), last_index_in_moves_to_keep));
+        int end = std::accumulate(std::next(m_moves.begin(), m_segment_moves_start), m_moves.end(),
+                                  0);
+        m_seq.append(last_chunk.seq, m_start_pos, end);
+        m_qstring.append(last_chunk.qstring, m_start_pos, end);
+
+    } else {
+        m_seq.append(last_chunk.seq, m_start_pos);
+        m_qstring.append(last_chunk.qstring, m_start_pos);
+    }
 
     // remove partial stride overhang
-    if (static_cast<int>(read_common.moves.size()) >
-        static_cast<int>(read_common.get_raw_data_samples() / read_common.model_stride)) {
-        if (read_common.moves.back() == 1) {
-            read_common.seq.pop_back();
-            read_common.qstring.pop_back();
+    if (m_moves.size() - m_segment_moves_start > num_samples / m_model_stride) {
+        if (m_moves.back() == 1) {
+            m_seq.pop_back();
+            m_qstring.pop_back();
         }
-        read_common.moves.pop_back();
-        assert(size_t(std::accumulate(read_common.moves.begin(), read_common.moves.end(), 0)) ==
-               read_common.seq.size());
+        m_moves.pop_back();
+    }
+}
+
+void ChunkStitcher::finalise(ReadCommon& read_common) {
+    assert(is_complete());
+    assert(size_t(std::accumulate(m_moves.begin(), m_moves.end(), 0)) == m_seq.size());
+    read_common.model_stride = m_model_stride;
+    read_common.seq = std::move(m_seq);
+    read_common.qstring = std::move(m_qstring);
+    read_common.moves = std::move(m_moves);
+}
+
+void stitch_chunks(ReadCommon& read_common,
+                   const std::vector<std::unique_ptr<Chunk>>& called_chunks) {
+    stitch_chunks(read_common, called_chunks,
+                  {{0, read_common.get_raw_data_samples(), called_chunks.size()}});
+}
+
+void stitch_chunks(ReadCommon& read_common,
+                   const std::vector<std::unique_ptr<Chunk>>& called_chunks,
+                   const std::vector<CalledSegment>& segments) {
+    ChunkStitcher stitcher(segments);
+    for (const auto& chunk : called_chunks) {
+        stitcher.add_chunk(*chunk);
     }
+    stitcher.finalise(read_common);
 }
 
 }  // namespace dorado::utils
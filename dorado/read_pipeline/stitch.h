@@ -23,8 +23,62 @@ struct Chunk {
     std::vector<uint8_t> moves;  // For stitching.
 };
 
+// A contiguous range of a read's signal which is basecalled, and the number of chunks covering it.
+// Chunks for each segment are consecutive in the called chunks, in segment order.
+struct CalledSegment {
+    size_t signal_start;
+    size_t signal_end;  // exclusive
+    size_t num_chunks;
+};
+
+// Stitches the called chunks of a read as they become available, in read order.
+// Merging a chunk needs the one after it, so only a single chunk is held back at any time.
+// Signal outside the segments is covered by zero moves, so the move table spans the whole signal.
+class ChunkStitcher {
+public:
+    explicit ChunkStitcher(std::vector<CalledSegment> segments);
+
+    // Merges the next chunk in read order, releasing it once it is no longer needed.
+    void add_chunk(std::unique_ptr<Chunk> chunk);
+    // As above, for a chunk owned by the caller, which must stay alive until the following
+    // chunk has been added or the stitcher is complete.
+    void add_chunk(const Chunk& chunk);
+
+    // True once every chunk of every segment has been added.
+    bool is_complete() const { return m_segment_idx == m_segments.size(); }
+
+    // Moves the stitched seq, qstring and moves into the read.  Must only be called once complete.
+    void finalise(ReadCommon& read);
+
+private:
+    void add_chunk_impl(const Chunk& chunk);
+    void merge_pending_chunk(const Chunk& next_chunk);
+    void merge_last_chunk();
+
+    const std::vector<CalledSegment> m_segments;
+    size_t m_segment_idx{0};
+    size_t m_num_segment_chunks_added{0};
+    size_t m_segment_moves_start{0};
+
+    const Chunk* m_pending_chunk{nullptr};
+    std::unique_ptr<Chunk> m_owned_pending_chunk;
+    int m_model_stride{0};
+    int m_start_pos{0};
+    int m_mid_point_front{0};
+
+    std::string m_seq;
+    std::string m_qstring;
+    std::vector<uint8_t> m_moves;
+};
+
 // Given a read and its unstitched chunks, stitch the chunks (accounting for overlap) and assign basecalled read and
 // qstring to Read
 void stitch_chunks(ReadCommon& read, const std::vector<std::unique_ptr<Chunk>>& called_chunks);
 
+// As above, for a read where only the given stride-aligned segments of the signal were basecalled.
+// Signal outside the segments is covered by zero moves, so the move table still spans the whole signal.
+void stitch_chunks(ReadCommon& read,
+                   const std::vector<std::unique_ptr<Chunk>>& called_chunks,
+                   const std::vector<CalledSegment>& segments);
+
 }  // namespace dorado::utils
@@ -3,6 +3,7 @@
 #include "read_pipeline/read_utils.h"
 #include "splitter/splitter_utils.h"
 #include "utils/alignment_utils.h"
+#include "utils/move_table.h"
 #include "utils/sequence_utils.h"
 #include "utils/uuid_utils.h"
 
@@ -123,16 +124,16 @@ namespace dorado::splitter {
 struct DuplexReadSplitter::ExtRead {
     SimplexReadPtr read;
     at::Tensor data_as_float32;
-    std::vector<uint64_t> move_sums;
+    utils::MoveTable moves;
     splitter::PosRanges possible_pore_regions;
 };
 
 DuplexReadSplitter::ExtRead DuplexReadSplitter::create_ext_read(SimplexReadPtr r) const {
     ExtRead ext_read;
     ext_read.read = std::move(r);
-    ext_read.move_sums = utils::move_cum_sums(ext_read.read->read_common.moves);
-    assert(!ext_read.move_sums.empty());
-    assert(ext_read.move_sums.back() == ext_read.read->read_common.seq.length());
+    ext_read.moves = utils::MoveTable(ext_read.read->read_common.moves);
+    assert(!ext_read.moves.empty());
+    assert(ext_read.moves.num_moves() == ext_read.read->read_common.seq.length());
     ext_read.data_as_float32 = ext_read.read->read_common.raw_data.to(at::kFloat);
     ext_read.possible_pore_regions = possible_pore_regions(ext_read);
     return ext_read;
@@ -145,20 +146,23 @@ PosRanges DuplexReadSplitter::possible_pore_regions(const DuplexReadSplitter::Ex
             detect_pore_signal<float>(read.data_as_float32, m_settings.pore_thr,
                                       m_settings.pore_cl_dist, m_settings.expect_pore_prefix);
 
+    // Number of bases called up to and including a timestep.
+    const auto bases_called = [&read](uint64_t move) { return read.moves.rank(move + 1); };
+
     std::vector<std::pair<float, PosRange>> candidate_regions;
     for (auto pore_sample_range : pore_sample_ranges) {
         auto move_start = pore_sample_range.start_sample / read.read->read_common.model_stride;
         auto move_end = pore_sample_range.end_sample / read.read->read_common.model_stride;
         auto move_argmax = pore_sample_range.argmax_sample / read.read->read_common.model_stride;
         assert(move_end >= move_argmax && move_argmax >= move_start);
-        if (move_end >= read.move_sums.size() || read.move_sums[move_start] == 0) {
+        if (move_end >= read.moves.size() || bases_called(move_start) == 0) {
             //either at very end of the signal or basecalls have not started yet
             continue;
         }
-        auto start_pos = read.move_sums[move_start] - 1;
+        auto start_pos = bases_called(move_start) - 1;
         //TODO check (- 1)
-        auto argmax_pos = read.move_sums[move_argmax] - 1;
-        auto end_pos = read.move_sums[move_end];
+        auto argmax_pos = bases_called(move_argmax) - 1;
+        auto end_pos = bases_called(move_end);
         //check that detected cluster corresponds to not too many bases
         if (end_pos > start_pos + m_settings.max_pore_region) {
             continue;
@@ -346,23 +350,23 @@ std::vector<SimplexReadPtr> DuplexReadSplitter::subreads(SimplexReadPtr read,
     }
 
     const auto stride = read->read_common.model_stride;
-    const auto seq_to_sig_map = utils::moves_to_map(read->read_common.moves, stride,
-                                                    read->read_common.get_raw_data_samples(),
-                                                    read->read_common.seq.size() + 1);
+    const utils::MoveTable moves(read->read_common.moves);
+    assert(moves.num_moves() == read->read_common.seq.size());
+    const auto base_start_sample = [&moves, &read, stride](uint64_t base) {
+        return moves.base_start_sample(base, stride, read->read_common.get_raw_data_samples());
+    };
 
     //TODO maybe simplify by adding begin/end stubs?
     uint64_t start_pos = 0;
-    uint64_t signal_start = seq_to_sig_map[0];
+    uint64_t signal_start = base_start_sample(0);
     for (auto r : spacers) {
-        if (start_pos < r.first && signal_start / stride < seq_to_sig_map[r.first] / stride) {
+        if (start_pos < r.first && signal_start / stride < base_start_sample(r.first) / stride) {
             subreads.push_back(subread(*read, PosRange{start_pos, r.first},
-                                       PosRange{signal_start, seq_to_sig_map[r.first]}));
+                                       PosRange{signal_start, base_start_sample(r.first)}));
         }
         start_pos = r.second;
-        signal_start = seq_to_sig_map[r.second];
+        signal_start = base_start_sample(r.second);
     }
-    assert(read->read_common.get_raw_data_samples() ==
-           seq_to_sig_map[read->read_common.seq.size()]);
     if (start_pos < read->read_common.seq.size() &&
         signal_start / stride < read->read_common.get_raw_data_samples() / stride) {
         subreads.push_back(
@@ -458,6 +462,7 @@ std::vector<SimplexReadPtr> DuplexReadSplitter::split(SimplexReadPtr init_read)
         return split_result;
     }
 
+    const SimplexRead* const original_read = init_read.get();
     std::vector<ExtRead> to_split;
     to_split.push_back(create_ext_read(std::move(init_read)));
     for (const auto& [description, split_f] : m_split_finders) {
@@ -480,20 +485,22 @@ std::vector<SimplexReadPtr> DuplexReadSplitter::split(SimplexReadPtr init_read)
     }
 
     std::vector<SimplexReadPtr> split_result;
-    size_t subread_id = 0;
     for (auto& ext_read : to_split) {
-        if (!ext_read.read->read_common.parent_read_id.empty()) {
-            ext_read.read->read_common.subread_id = subread_id++;
-            ext_read.read->read_common.split_count = to_split.size();
-            const auto subread_uuid =
-                    utils::derive_uuid(ext_read.read->read_common.parent_read_id,
-                                       std::to_string(ext_read.read->read_common.subread_id));
-            ext_read.read->read_common.read_id = subread_uuid;
-        }
-
         split_result.push_back(std::move(ext_read.read));
     }
 
+    // Only rename the subreads of this split.  The read may itself be a subread of an earlier
+    // split (e.g. in signal space), so the new IDs are derived from its own ID rather than from
+    // the parent's, which would clash with those of its siblings.
+    if (split_result.front().get() != original_read) {
+        for (size_t i = 0; i < split_result.size(); i++) {
+            auto& read_common = split_result[i]->read_common;
+            read_common.subread_id = i;
+            read_common.split_count = split_result.size();
+            read_common.read_id = utils::derive_uuid(read_id, std::to_string(i));
+        }
+    }
+
     // Adjust prev and next read ids.
     if (split_result.size() > 1) {
         for (size_t i = 0; i < split_result.size(); i++) {
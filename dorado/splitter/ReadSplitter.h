@@ -21,6 +21,23 @@ struct RNASplitSettings {
     uint64_t expect_pore_prefix = 2000;
 };
 
+// Settings for splitting DNA reads on open-pore signal before basecalling, where only the
+// raw (uncalibrated) signal is available.
+struct SignalSplitSettings {
+    // Open-pore current threshold in pA, converted per read using its calibration.
+    float pore_thr_pa = 160.f;
+    uint64_t pore_cl_dist = 500;  // in samples
+    // Minimal span of a cluster for it to be considered an open-pore event, in samples.
+    // Guards against splitting on isolated spikes, since no basecalls are available to confirm.
+    uint64_t min_pore_region = 20;
+    // Maximal span of a cluster considered to be a single open-pore event, in samples.
+    uint64_t max_pore_region = 4000;
+    //in samples
+    uint64_t expect_pore_prefix = 5000;
+    // Subreads shorter than this (in samples) are discarded rather than basecalled.
+    uint64_t min_subread_samples = 1000;
+};
+
 struct DuplexSplitSettings {
     bool enabled = true;
     bool simplex_mode = false;
@@ -0,0 +1,132 @@
+#include "SignalReadSplitter.h"
+
+#include "read_pipeline/ReadPipeline.h"
+#include "splitter/splitter_utils.h"
+#include "utils/uuid_utils.h"
+
+#include <ATen/ATen.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace dorado::splitter {
+
+int16_t SignalReadSplitter::raw_pore_threshold(const SimplexRead& read) const {
+    // Invert the calibration applied by the scaler: pA = scaling * (raw + offset).
+    if (read.scaling <= 0.f) {
+        return std::numeric_limits<int16_t>::max();
+    }
+    const float raw_thr = m_settings.pore_thr_pa / read.scaling - read.offset;
+    return int16_t(std::clamp(std::round(raw_thr), float(std::numeric_limits<int16_t>::min()),
+                              float(std::numeric_limits<int16_t>::max())));
+}
+
+SampleRanges<int16_t> SignalReadSplitter::possible_pore_regions(const SimplexRead& read) const {
+    const auto threshold = raw_pore_threshold(read);
+    auto pore_sample_ranges =
+            detect_pore_signal<int16_t>(read.read_common.raw_data, threshold,
+                                        m_settings.pore_cl_dist, m_settings.expect_pore_prefix);
+
+    SampleRanges<int16_t> pore_regions;
+    for (const auto& range : pore_sample_ranges) {
+        const auto span = range.end_sample - range.start_sample;
+        if (span < m_settings.min_pore_region || span > m_settings.max_pore_region) {
+            continue;
+        }
+        spdlog::trace("Pore range {}-{} {}", range.start_sample, range.end_sample,
+                      read.read_common.read_id);
+        pore_regions.push_back(range);
+    }
+    return pore_regions;
+}
+
+std::vector<SimplexReadPtr> SignalReadSplitter::subreads(
+        SimplexReadPtr read,
+        const SampleRanges<int16_t>& spacers) const {
+    std::vector<SimplexReadPtr> subreads;
+    subreads.reserve(spacers.size() + 1);
+
+    if (spacers.empty()) {
+        subreads.push_back(std::move(read));
+        return subreads;
+    }
+
+    const uint64_t num_samples = read->read_common.get_raw_data_samples();
+    auto add_subread = [&](uint64_t start_sample, uint64_t end_sample) {
+        // The open-pore samples themselves are never part of a subread, and neither are
+        // fragments too short to be worth basecalling.
+        if (start_sample + m_settings.min_subread_samples <= end_sample) {
+            subreads.push_back(subread(*read, std::nullopt, {start_sample, end_sample}));
+        }
+    };
+
+    uint64_t start_sample = 0;
+    for (const auto& r : spacers) {
+        add_subread(start_sample, r.start_sample);
+        start_sample = r.end_sample;
+    }
+    add_subread(start_sample, num_samples);
+
+    if (subreads.empty()) {
+        // Nothing worth keeping on its own, so leave the read as it is.
+        subreads.push_back(std::move(read));
+    }
+    return subreads;
+}
+
+std::vector<SimplexReadPtr> SignalReadSplitter::split(SimplexReadPtr init_read) const {
+    using namespace std::chrono;
+
+    auto start_ts = high_resolution_clock::now();
+    auto read_id = init_read->read_common.read_id;
+    spdlog::trace("Processing read {}", read_id);
+
+    std::vector<SimplexReadPtr> split_result;
+    if (init_read->read_common.raw_data.dtype() != at::kShort) {
+        // Only raw signal is handled, which is what we see ahead of the scaler.
+        split_result.push_back(std::move(init_read));
+        return split_result;
+    }
+
+    const auto spacers = possible_pore_regions(*init_read);
+    spdlog::trace("SSN: {} splits in read {}", spacers.size(), read_id);
+    const SimplexRead* const original_read = init_read.get();
+    split_result = subreads(std::move(init_read), spacers);
+
+    if (split_result.front().get() != original_read) {
+        for (size_t i = 0; i < split_result.size(); i++) {
+            auto& read_common = split_result[i]->read_common;
+            read_common.subread_id = i;
+            read_common.split_count = split_result.size();
+            read_common.read_id =
+                    utils::derive_uuid(read_common.parent_read_id, std::to_string(i));
+        }
+        // Link the subreads to each other, leaving the outermost prev/next as they were.
+        for (size_t i = 0; i < split_result.size(); i++) {
+            if (i > 0) {
+                split_result[i]->prev_read = split_result[i - 1]->read_common.read_id;
+            }
+            if (i + 1 < split_result.size()) {
+                split_result[i]->next_read = split_result[i + 1]->read_common.read_id;
+            }
+        }
+    }
+
+    spdlog::trace("Read {} split into {} subreads", read_id, split_result.size());
+
+    auto stop_ts = high_resolution_clock::now();
+    spdlog::trace("READ duration: {} microseconds (ID: {})",
+                  duration_cast<microseconds>(stop_ts - start_ts).count(), read_id);
+
+    return split_result;
+}
+
+SignalReadSplitter::SignalReadSplitter(SignalSplitSettings settings)
+        : m_settings(std::move(settings)) {}
+
+}  // namespace dorado::splitter
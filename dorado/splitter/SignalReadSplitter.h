@@ -0,0 +1,31 @@
+#pragma once
+#include "ReadSplitter.h"
+#include "splitter/splitter_utils.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace dorado::splitter {
+
+// Splits DNA reads on open-pore signal ahead of basecalling, so that the open-pore samples
+// between concatenated reads are never chunked and called. Unlike DuplexReadSplitter this
+// only has the raw int16 signal to work with, so it is deliberately conservative.
+class SignalReadSplitter : public ReadSplitter {
+public:
+    SignalReadSplitter(SignalSplitSettings settings);
+
+    std::vector<SimplexReadPtr> split(SimplexReadPtr init_read) const override;
+
+private:
+    // Open-pore threshold for this read in raw (ADC) units.
+    int16_t raw_pore_threshold(const SimplexRead& read) const;
+
+    splitter::SampleRanges<int16_t> possible_pore_regions(const SimplexRead& read) const;
+
+    std::vector<SimplexReadPtr> subreads(SimplexReadPtr read,
+                                         const splitter::SampleRanges<int16_t>& spacers) const;
+
+    const SignalSplitSettings m_settings;
+};
+
+}  // namespace dorado::splitter
@@ -0,0 +1,153 @@
+#include "SignalBufferPool.h"
+
+#include <ATen/ATen.h>
+
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace dorado::utils {
+
+SignalBufferPool::SignalBufferPool(size_t max_pooled_bytes, bool use_huge_pages)
+        : m_max_pooled_bytes(max_pooled_bytes),
+          m_use_huge_pages(use_huge_pages),
+          m_free_blocks(NUM_CLASSES) {}
+
+SignalBufferPool::~SignalBufferPool() {
+    for (size_t size_class = 0; size_class < NUM_CLASSES; ++size_class) {
+        for (void* ptr : m_free_blocks[size_class]) {
+            free_block(ptr, class_bytes(size_class));
+        }
+    }
+}
+
+size_t SignalBufferPool::size_class(size_t bytes) {
+    if (bytes < MIN_CLASS_BYTES || bytes > MAX_CLASS_BYTES) {
+        return NUM_CLASSES;
+    }
+    // Find the power of two below the request, then the quarter step above it.
+    size_t exponent = 16;
+    while ((size_t{2} << exponent) < bytes) {
+        ++exponent;
+    }
+    const size_t power = size_t{1} << exponent;
+    const size_t quarter = power / 4;
+    const size_t steps = (bytes - power + quarter - 1) / quarter;
+    return (exponent - 16) * 4 + steps;
+}
+
+size_t SignalBufferPool::class_bytes(size_t size_class) {
+    const size_t power = MIN_CLASS_BYTES << (size_class / 4);
+    return power / 4 * (4 + size_class % 4);
+}
+
+at::Tensor SignalBufferPool::empty(int64_t num_elements, at::ScalarType dtype) {
+    const auto options = at::TensorOptions().dtype(dtype);
+    const size_t requested_bytes = size_t(num_elements) * c10::elementSize(dtype);
+    if (requested_bytes < MIN_CLASS_BYTES) {
+        return at::empty({num_elements}, options);
+    }
+
+    auto self = shared_from_this();
+    const size_t size_class = SignalBufferPool::size_class(requested_bytes);
+    const size_t block_bytes = size_class < NUM_CLASSES ? class_bytes(size_class) : requested_bytes;
+
+    void* ptr = nullptr;
+    if (size_class < NUM_CLASSES) {
+        std::lock_guard<std::mutex> lock(m_free_blocks_mutex);
+        auto& free_blocks = m_free_blocks[size_class];
+        if (!free_blocks.empty()) {
+            ptr = free_blocks.back();
+            free_blocks.pop_back();
+            m_free_bytes -= block_bytes;
+        }
+    }
+    if (ptr) {
+        ++m_num_hits;
+    } else {
+        ptr = allocate_block(block_bytes);
+        if (size_class < NUM_CLASSES) {
+            ++m_num_misses;
+        } else {
+            ++m_num_unpooled;
+        }
+    }
+    m_bytes_in_use += block_bytes;
+    m_bytes_requested += requested_bytes;
+
+    return at::from_blob(
+            ptr, {num_elements},
+            [self = std::move(self), size_class, requested_bytes, block_bytes](void* buffer) {
+                self->release(buffer, size_class, requested_bytes, block_bytes);
+            },
+            options);
+}
+
+void SignalBufferPool::release(void* ptr,
+                               size_t size_class,
+                               size_t requested_bytes,
+                               size_t block_bytes) {
+    m_bytes_in_use -= block_bytes;
+    m_bytes_requested -= requested_bytes;
+    if (size_class < NUM_CLASSES) {
+        std::lock_guard<std::mutex> lock(m_free_blocks_mutex);
+        if (m_free_bytes + block_bytes <= m_max_pooled_bytes) {
+            m_free_blocks[size_class].push_back(ptr);
+            m_free_bytes += block_bytes;
+            return;
+        }
+    }
+    ++m_num_released;
+    free_block(ptr, block_bytes);
+}
+
+void* SignalBufferPool::allocate_block(size_t bytes) const {
+#ifdef __linux__
+    if (m_use_huge_pages && bytes >= HUGE_PAGE_BYTES) {
+        void* ptr =
+                mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        // Only advisory: without transparent huge page support, this is ordinary memory.
+        madvise(ptr, bytes, MADV_HUGEPAGE);
+        return ptr;
+    }
+#endif
+    return ::operator new(bytes, std::align_val_t{ALIGNMENT});
+}
+
+void SignalBufferPool::free_block(void* ptr, [[maybe_unused]] size_t bytes) const {
+#ifdef __linux__
+    if (m_use_huge_pages && bytes >= HUGE_PAGE_BYTES) {
+        munmap(ptr, bytes);
+        return;
+    }
+#endif
+    ::operator delete(ptr, std::align_val_t{ALIGNMENT});
+}
+
+stats::NamedStats SignalBufferPool::sample_stats() const {
+    stats::NamedStats stats;
+    const double hits = double(m_num_hits.load());
+    const double allocations = hits + double(m_num_misses.load()) + double(m_num_unpooled.load());
+    const double bytes_in_use = double(m_bytes_in_use.load());
+    stats["hits"] = hits;
+    stats["misses"] = double(m_num_misses.load());
+    stats["unpooled_allocations"] = double(m_num_unpooled.load());
+    stats["released_buffers"] = double(m_num_released.load());
+    stats["hit_rate"] = allocations > 0 ? hits / allocations : 0.;
+    stats["bytes_in_use"] = bytes_in_use;
+    // The fraction of the memory in use lost to rounding requests up to size classes.
+    stats["fragmentation"] =
+            bytes_in_use > 0 ? 1. - double(m_bytes_requested.load()) / bytes_in_use : 0.;
+    {
+        std::lock_guard<std::mutex> lock(m_free_blocks_mutex);
+        stats["bytes_free"] = double(m_free_bytes);
+    }
+    return stats;
+}
+
+}  // namespace dorado::utils
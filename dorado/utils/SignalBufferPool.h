@@ -0,0 +1,73 @@
+#pragma once
+
+#include "stats.h"
+
+#include <ATen/core/TensorBody.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dorado::utils {
+
+// A pool of signal buffers, so that the signal of each read reuses memory freed by earlier reads
+// rather than going back to the system allocator.  Buffers go back to the pool when the last
+// tensor using them is destroyed, on whichever thread that happens.
+//
+// Requests are rounded up to size classes a quarter of a power of two apart, from
+// MIN_CLASS_BYTES to MAX_CLASS_BYTES.  Larger requests aren't pooled.  Smaller requests are left
+// to the default allocator, rather than being rounded up to MIN_CLASS_BYTES, and aren't counted
+// in the stats.  Free buffers are kept until max_pooled_bytes are held, after which they're
+// released.  If use_huge_pages is set, buffers of at least HUGE_PAGE_BYTES are mapped separately
+// and advised to use transparent huge pages, on Linux.
+//
+// Tensors keep the pool alive, so it must be owned by a shared_ptr.
+class SignalBufferPool : public std::enable_shared_from_this<SignalBufferPool> {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t MIN_CLASS_BYTES = size_t{1} << 16;
+    static constexpr size_t MAX_CLASS_BYTES = size_t{1} << 28;
+    static constexpr size_t NUM_CLASSES = 49;
+    static constexpr size_t HUGE_PAGE_BYTES = size_t{2} << 20;
+
+    SignalBufferPool(size_t max_pooled_bytes, bool use_huge_pages);
+    ~SignalBufferPool();
+
+    // Returns an uninitialised 1D CPU tensor of num_elements of the given type.  Tensors smaller
+    // than MIN_CLASS_BYTES don't come from the pool.
+    at::Tensor empty(int64_t num_elements, at::ScalarType dtype);
+
+    std::string get_name() const { return "SignalBufferPool"; }
+    stats::NamedStats sample_stats() const;
+
+    // Returns the size class of a buffer of the given size, or NUM_CLASSES if it isn't pooled
+    // because it's smaller than MIN_CLASS_BYTES or larger than MAX_CLASS_BYTES.
+    static size_t size_class(size_t bytes);
+    static size_t class_bytes(size_t size_class);
+
+private:
+    void* allocate_block(size_t bytes) const;
+    void free_block(void* ptr, size_t bytes) const;
+    void release(void* ptr, size_t size_class, size_t requested_bytes, size_t block_bytes);
+
+    const size_t m_max_pooled_bytes;
+    const bool m_use_huge_pages;
+
+    mutable std::mutex m_free_blocks_mutex;
+    std::vector<std::vector<void*>> m_free_blocks;
+    size_t m_free_bytes{0};
+
+    // Sizes of the buffers held by tensors, and of the requests they were allocated for.
+    std::atomic<size_t> m_bytes_in_use{0};
+    std::atomic<size_t> m_bytes_requested{0};
+    std::atomic<size_t> m_num_hits{0};
+    std::atomic<size_t> m_num_misses{0};
+    std::atomic<size_t> m_num_unpooled{0};
+    std::atomic<size_t> m_num_released{0};
+};
+
+}  // namespace dorado::utils
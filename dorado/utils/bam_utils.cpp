@@ -11,6 +11,7 @@
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 
@@ -435,4 +436,17 @@ std::string cigar2str(uint32_t n_cigar, const uint32_t* cigar) {
     return cigar_str;
 }
 
+void set_record_order(bam1_t* record, const RecordOrder& order) {
+    // The sequence number takes the top 40 bits, then the count and index 12 bits each.
+    if (order.count > RecordOrder::MAX_COUNT || order.index >= order.count) {
+        throw std::out_of_range("Invalid record order " + std::to_string(order.index) + "/" +
+                                std::to_string(order.count));
+    }
+    record->id = (order.sequence_number << 24) | (uint64_t(order.count) << 12) | order.index;
+}
+
+RecordOrder get_record_order(const bam1_t* record) {
+    return {record->id >> 24, uint32_t(record->id & 0xfff), uint32_t((record->id >> 12) & 0xfff)};
+}
+
 }  // namespace dorado::utils
@@ -1,6 +1,7 @@
 #pragma once
 #include "types.h"
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -170,4 +171,20 @@ std::string cigar2str(uint32_t n_cigar, const uint32_t* cigar);
  */
 kstring_t allocate_kstring();
 
+// The position of a BAM record in the input, so that records can be written in input order. It is
+// kept in the record's id field, which htslib copies along with the record but never writes out.
+struct RecordOrder {
+    // Numbered from 1, with 0 meaning the record has no position.
+    uint64_t sequence_number{0};
+    // Records made from the same input record, such as the alignments of a read, share its
+    // sequence number, and are told apart by their index.
+    uint32_t index{0};
+    uint32_t count{0};
+
+    static constexpr uint32_t MAX_COUNT = (1u << 12) - 1;
+};
+
+void set_record_order(bam1_t* record, const RecordOrder& order);
+RecordOrder get_record_order(const bam1_t* record);
+
 }  // namespace dorado::utils
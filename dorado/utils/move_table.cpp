@@ -0,0 +1,87 @@
+#include "move_table.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+inline int popcount64(uint64_t x) {
+#ifdef _MSC_VER
+    return int(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+// x must be non-zero.
+inline int count_trailing_zeros64(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, x);
+    return int(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+MoveTable::MoveTable(const std::vector<uint8_t>& moves) : m_size(moves.size()) {
+    m_words.assign((m_size + WORD_BITS - 1) / WORD_BITS, 0);
+    for (size_t i = 0; i < m_size; ++i) {
+        if (moves[i] != 0) {
+            m_words[i / WORD_BITS] |= uint64_t{1} << (i % WORD_BITS);
+        }
+    }
+
+    m_word_ranks.resize(m_words.size() + 1);
+    m_word_ranks[0] = 0;
+    for (size_t w = 0; w < m_words.size(); ++w) {
+        m_word_ranks[w + 1] = m_word_ranks[w] + uint32_t(popcount64(m_words[w]));
+        while (m_select_samples.size() * SELECT_SAMPLE_RATE < m_word_ranks[w + 1]) {
+            m_select_samples.push_back(uint32_t(w));
+        }
+    }
+    m_num_moves = m_word_ranks.back();
+}
+
+size_t MoveTable::rank(size_t timestep) const {
+    assert(timestep <= m_size);
+    const size_t word = timestep / WORD_BITS;
+    const size_t bit = timestep % WORD_BITS;
+    size_t rank = m_word_ranks[word];
+    if (bit != 0) {
+        rank += size_t(popcount64(m_words[word] & ((uint64_t{1} << bit) - 1)));
+    }
+    return rank;
+}
+
+size_t MoveTable::select(size_t n) const {
+    assert(n < m_num_moves);
+    // The move is in the last word with at most n moves before it, which lies between the
+    // sampled words of the moves either side of it.
+    const size_t sample = n / SELECT_SAMPLE_RATE;
+    const size_t first_word = m_select_samples[sample];
+    const size_t last_word = sample + 1 < m_select_samples.size()
+                                     ? size_t(m_select_samples[sample + 1])
+                                     : m_words.size() - 1;
+    const auto ranks_begin = m_word_ranks.begin();
+    const size_t word = size_t(std::upper_bound(ranks_begin + first_word + 1,
+                                                ranks_begin + last_word + 1, uint32_t(n)) -
+                               ranks_begin) -
+                        1;
+
+    uint64_t bits = m_words[word];
+    for (size_t i = m_word_ranks[word]; i < n; ++i) {
+        bits &= bits - 1;
+    }
+    return word * WORD_BITS + size_t(count_trailing_zeros64(bits));
+}
+
+}  // namespace dorado::utils
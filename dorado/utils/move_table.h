@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dorado::utils {
+
+// A move table packed one bit per timestep, with a directory of the number of moves before each
+// 64 bit word, for looking up bases and timesteps without the cumulative sums of the table or a
+// base to sample map, which take 8 bytes per timestep or base.  Packing walks the whole table, so
+// it's no help where a single walk of the unpacked table would do.
+class MoveTable {
+public:
+    MoveTable() = default;
+    explicit MoveTable(const std::vector<uint8_t>& moves);
+
+    // Number of timesteps.
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t num_moves() const { return m_num_moves; }
+    bool operator[](size_t timestep) const {
+        return (m_words[timestep / WORD_BITS] >> (timestep % WORD_BITS)) & 1;
+    }
+
+    // Returns the number of moves in timesteps [0, timestep), for timestep <= size().  Takes
+    // constant time.
+    size_t rank(size_t timestep) const;
+    // Returns the timestep of the n'th move, counting from 0, for n < num_moves().  Takes time
+    // logarithmic in the number of words spanned by the SELECT_SAMPLE_RATE moves around it.
+    size_t select(size_t n) const;
+
+    // Returns the sample at which the given base begins, or signal_len for base == num_moves().
+    uint64_t base_start_sample(size_t base, size_t stride, size_t signal_len) const {
+        return base < m_num_moves ? uint64_t(select(base) * stride) : uint64_t(signal_len);
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+    // Every SELECT_SAMPLE_RATE'th move has the index of its word sampled, bounding the words
+    // select() searches.
+    static constexpr size_t SELECT_SAMPLE_RATE = 256;
+
+    std::vector<uint64_t> m_words;
+    // Number of moves before each word, with a final entry holding num_moves().
+    std::vector<uint32_t> m_word_ranks;
+    std::vector<uint32_t> m_select_samples;
+    size_t m_size{0};
+    size_t m_num_moves{0};
+};
+
+}  // namespace dorado::utils
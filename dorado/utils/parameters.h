@@ -16,6 +16,8 @@ struct DefaultParameters {
     int chunksize{10000};
     int overlap{500};
     int num_runners{2};
+    // Threads each CPU basecall caller splits its batches over, pinned to their own cores.
+    int cpu_threads_per_caller{1};
 #ifdef DORADO_TX2
     int remora_batchsize{128};
 #else
@@ -13,10 +13,34 @@
 #include <cstring>
 #include <iterator>
 #include <numeric>
+#include <string_view>
 #include <vector>
 
 namespace {
 
+// minimap2 options used by compute_overlap.  These are the same for every call, so they are only
+// set up once.  mm_mapopt_update adjusts the mapping options for each index, so callers take a copy.
+struct OverlapOptions {
+    mm_idxopt_t idx_opt;
+    mm_mapopt_t map_opt;
+
+    OverlapOptions() {
+        mm_set_opt(0, &idx_opt, &map_opt);
+        mm_set_opt("map-hifi", &idx_opt, &map_opt);
+    }
+};
+
+const OverlapOptions& overlap_options() {
+    static const OverlapOptions options;
+    return options;
+}
+
+// minimap2 thread buffer reused by every compute_overlap call made on the calling thread.
+mm_tbuf_t* overlap_tbuf() {
+    thread_local dorado::MmTbufPtr tbuf(mm_tbuf_init());
+    return tbuf.get();
+}
+
 #if ENABLE_AVX2_IMPL
 __attribute__((target("default")))
 #endif
@@ -186,22 +210,18 @@ OverlapResult compute_overlap(const std::string& query_seq, const std::string& t
     OverlapResult overlap_result = {false, 0, 0, 0, 0};
 
     // Add mm2 based overlap check.
-    mm_idxopt_t m_idx_opt;
-    mm_mapopt_t m_map_opt;
-    mm_set_opt(0, &m_idx_opt, &m_map_opt);
-    mm_set_opt("map-hifi", &m_idx_opt, &m_map_opt);
-
-    std::vector<const char*> seqs = {query_seq.c_str()};
-    std::vector<const char*> names = {"query"};
-    mm_idx_t* m_index = mm_idx_str(m_idx_opt.w, m_idx_opt.k, 0, m_idx_opt.bucket_bits, 1,
-                                   seqs.data(), names.data());
-    mm_mapopt_update(&m_map_opt, m_index);
+    const auto& options = overlap_options();
+    mm_mapopt_t m_map_opt = options.map_opt;
 
-    MmTbufPtr mbuf = MmTbufPtr(mm_tbuf_init());
+    const char* seqs[] = {query_seq.c_str()};
+    const char* names[] = {"query"};
+    mm_idx_t* m_index = mm_idx_str(options.idx_opt.w, options.idx_opt.k, 0,
+                                   options.idx_opt.bucket_bits, 1, seqs, names);
+    mm_mapopt_update(&m_map_opt, m_index);
 
     int hits = 0;
     mm_reg1_t* reg = mm_map(m_index, int(target_seq.length()), target_seq.c_str(), &hits,
-                            mbuf.get(), &m_map_opt, "target");
+                            overlap_tbuf(), &m_map_opt, "target");
 
     mm_idx_destroy(m_index);
 
@@ -255,9 +275,11 @@ std::tuple<int, int, std::vector<uint8_t>> realign_moves(const std::string& quer
     EdlibAlignConfig align_config = edlibDefaultAlignConfig();
     align_config.task = EDLIB_TASK_PATH;
 
-    auto target_sequence_component =
-            target_sequence.substr(target_start, target_end - target_start);
-    auto query_sequence_component = query_sequence.substr(query_start, query_end - query_start);
+    // Views rather than copies of the overlapping regions.
+    const auto target_sequence_component =
+            std::string_view(target_sequence).substr(target_start, target_end - target_start);
+    const auto query_sequence_component =
+            std::string_view(query_sequence).substr(query_start, query_end - query_start);
 
     EdlibAlignResult edlib_result = edlibAlign(
             target_sequence_component.data(), static_cast<int>(target_sequence_component.length()),
@@ -331,17 +353,6 @@ std::tuple<int, int, std::vector<uint8_t>> realign_moves(const std::string& quer
     return {old_moves_offset, target_start - 1, new_moves};
 }
 
-std::vector<uint64_t> move_cum_sums(const std::vector<uint8_t>& moves) {
-    std::vector<uint64_t> ans(moves.size(), 0);
-    if (!moves.empty()) {
-        ans[0] = moves[0];
-    }
-    for (size_t i = 1, n = moves.size(); i < n; i++) {
-        ans[i] = ans[i - 1] + moves[i];
-    }
-    return ans;
-}
-
 // Multiversioned function dispatch doesn't work across the dorado_lib linking
 // boundary.  Without this wrapper, AVX machines still only execute the default
 // version.
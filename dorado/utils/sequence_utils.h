@@ -26,9 +26,6 @@ std::vector<uint64_t> moves_to_map(const std::vector<uint8_t>& moves,
                                    size_t signal_len,
                                    std::optional<size_t> reserve_size);
 
-// Compute cumulative sums of the move table
-std::vector<uint64_t> move_cum_sums(const std::vector<uint8_t>& moves);
-
 // Result of overlapping two reads
 using OverlapResult = std::tuple<bool, uint32_t, uint32_t, uint32_t, uint32_t>;
 
@@ -101,4 +101,28 @@ void StatsSampler::sampling_thread_fn() {
     }
 }
 
+int64_t CounterRegistry::get(Counter counter) const {
+    int64_t total = 0;
+    for (const auto& slot : m_slots) {
+        total += slot.values[size_t(counter)].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+CounterRegistry::Values CounterRegistry::get_all() const {
+    Values totals{};
+    for (const auto& slot : m_slots) {
+        for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+            totals[i] += slot.values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+size_t CounterRegistry::thread_slot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local const size_t slot = next_slot++ % NUM_SLOTS;
+    return slot;
+}
+
 }  // namespace dorado::stats
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iosfwd>
 #include <optional>
@@ -78,6 +81,49 @@ NamedStats from_obj(const T& obj) {
     return prefixed_stats;
 }
 
+// Counters which pipeline nodes add to as they work, for tracking progress.  Their values are
+// their positions, which don't change.
+enum class Counter : size_t {
+    SIMPLEX_READS_WRITTEN,
+    DUPLEX_READS_WRITTEN,
+    SIMPLEX_READS_FILTERED,
+    SIMPLEX_BASES_FILTERED,
+    DUPLEX_READS_FILTERED,
+    DUPLEX_BASES_FILTERED,
+    SIMPLEX_BASES_PROCESSED,
+    SIMPLEX_SAMPLES_PROCESSED,
+    DUPLEX_BASES_PROCESSED,
+    DUPLEX_SAMPLES_PROCESSED,
+    BARCODES_DEMUXED,
+    NUM_COUNTERS,
+};
+
+// The counters of a pipeline, which can be added to from any thread, and read at any time without
+// locking or allocating.  Each thread adds to its own slot, padded to a cache line so that threads
+// don't contend for them, and reading a counter sums it over the slots.
+class CounterRegistry {
+public:
+    static constexpr size_t NUM_COUNTERS = size_t(Counter::NUM_COUNTERS);
+    // Threads beyond this many share slots, which still gives correct counts.
+    static constexpr size_t NUM_SLOTS = 64;
+
+    using Values = std::array<int64_t, NUM_COUNTERS>;
+
+    void add(Counter counter, int64_t value) {
+        m_slots[thread_slot()].values[size_t(counter)].fetch_add(value,
+                                                                 std::memory_order_relaxed);
+    }
+    int64_t get(Counter counter) const;
+    Values get_all() const;
+
+private:
+    struct alignas(64) Slot {
+        std::array<std::atomic<int64_t>, NUM_COUNTERS> values{};
+    };
+    static size_t thread_slot();
+    std::array<Slot, NUM_SLOTS> m_slots{};
+};
+
 // Minimal timer object to facilitate recording time spans.
 // Starts a clock when constructed which can be queried in ms subsequently.
 class Timer {
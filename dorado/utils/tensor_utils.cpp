@@ -5,9 +5,14 @@
 #include <torch/csrc/jit/serialization/pickle.h>
 #include <torch/torch.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace {
@@ -63,6 +68,74 @@ __attribute__((target("avx2,f16c"))) void convert_f32_to_f16_impl(c10::Half* con
 }
 #endif
 
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void normalise_i16_to_f16_impl(c10::Half* const dest,
+                               const std::int16_t* const src,
+                               std::size_t count,
+                               float shift,
+                               float scale) {
+    for (size_t i = 0; i < count; ++i) {
+        dest[i] = c10::Half((static_cast<float>(src[i]) - shift) / scale);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("avx2,f16c"))) void normalise_i16_to_f16_impl(c10::Half* const dest,
+                                                                    const std::int16_t* const src,
+                                                                    std::size_t count,
+                                                                    float shift,
+                                                                    float scale) {
+    // Unroll to AVX register size: 16 int16s.
+    static constexpr size_t kUnroll = 16;
+
+    // Matches torch behaviour.
+    const int kRoundNearestEven = 0;
+
+    const __m256 shift_f32 = _mm256_set1_ps(shift);
+    const __m256 scale_f32 = _mm256_set1_ps(scale);
+
+    // Main vectorised loop: 16 elements per iteration, converted as two groups of 8 floats.
+    // Each group is loaded before the corresponding output is stored, so dest may alias src.
+    const auto* src_ptr = src;
+    auto* dest_ptr = dest;
+    for (size_t chunk_i = 0; chunk_i < count / kUnroll; ++chunk_i) {
+        const __m256i elems_i16 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr));
+        const __m256 lo_f32 =
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(elems_i16)));
+        const __m256 hi_f32 =
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(elems_i16, 1)));
+        const __m128i lo_f16 = _mm256_cvtps_ph(
+                _mm256_div_ps(_mm256_sub_ps(lo_f32, shift_f32), scale_f32), kRoundNearestEven);
+        const __m128i hi_f16 = _mm256_cvtps_ph(
+                _mm256_div_ps(_mm256_sub_ps(hi_f32, shift_f32), scale_f32), kRoundNearestEven);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest_ptr),
+                            _mm256_set_m128i(hi_f16, lo_f16));
+        src_ptr += kUnroll;
+        dest_ptr += kUnroll;
+    }
+
+    // Loop for final 0-15 elements.
+    const size_t remaining_count = count % kUnroll;
+    for (size_t i = 0; i < remaining_count; ++i) {
+        const __m256 elem_f32 = _mm256_set1_ps((static_cast<float>(*src_ptr) - shift) / scale);
+        const __m128i elem_f16 = _mm256_cvtps_ph(elem_f32, kRoundNearestEven);
+        *(reinterpret_cast<std::int16_t*>(dest_ptr)) =
+                static_cast<std::int16_t>(_mm_extract_epi16(elem_f16, 0));
+        ++src_ptr;
+        ++dest_ptr;
+    }
+}
+#endif
+
+// Counts of each int16 value, indexed by value - INT16_MIN.  All bins are zero between calls to
+// quantile_counting, which only has to clear the bins within the range of the signal it counted.
+std::vector<std::uint32_t>& get_thread_local_histogram() {
+    thread_local std::vector<std::uint32_t> histogram(size_t(1) << 16, 0);
+    return histogram;
+}
+
 }  // namespace
 
 namespace dorado::utils {
@@ -109,31 +182,68 @@ at::Tensor quantile(const at::Tensor t, const at::Tensor q) {
 at::Tensor quantile_counting(const at::Tensor t, const at::Tensor q) {
     assert(q.dtype() == at::ScalarType::Float);
 
-    auto p = t.data_ptr<int16_t>();
-    auto range_min = t.min().item<int16_t>();
-    auto range_max = t.max().item<int16_t>();
+    auto t_contig = t.expect_contiguous();
+    auto q_contig = q.contiguous();
+    std::vector<std::int16_t> values(q.numel());
+    quantile_counting(t_contig->data_ptr<std::int16_t>(), t.numel(), q_contig.data_ptr<float>(),
+                      values.size(), values.data());
 
-    size_t size = t.size(0);
+    auto res = at::empty_like(q);
+    auto res_contig = res.expect_contiguous();
+    std::copy(values.begin(), values.end(), res_contig->data_ptr<float>());
+    return res;
+}
 
-    std::vector<int> counts(range_max - range_min + 1, 0);
-    for (size_t i = 0; i < size; ++i) {
-        counts[p[i] - range_min]++;
+void quantile_counting(const std::int16_t* samples,
+                       std::size_t count,
+                       const float* quantiles,
+                       std::size_t num_quantiles,
+                       std::int16_t* results) {
+    if (count == 0) {
+        throw std::runtime_error("quantile_counting: no samples");
     }
-    std::partial_sum(counts.begin(), counts.end(), counts.begin());
 
-    auto res = at::empty_like(q);
+    // Single pass to histogram the samples and find their range.
+    auto& histogram = get_thread_local_histogram();
+    std::uint32_t* const counts = histogram.data() - std::numeric_limits<std::int16_t>::min();
+    int range_min = std::numeric_limits<std::int16_t>::max();
+    int range_max = std::numeric_limits<std::int16_t>::min();
+    for (size_t i = 0; i < count; ++i) {
+        const int value = samples[i];
+        ++counts[value];
+        range_min = std::min(range_min, value);
+        range_max = std::max(range_max, value);
+    }
 
-    for (size_t idx = 0; idx < size_t(q.numel()); idx++) {
-        int threshold = int(q[idx].item<float>() * (size - 1));
-        for (int i = 0; i < int(counts.size()); ++i) {
-            if (counts[i] > threshold) {
-                res[idx] = i + range_min;
-                break;
-            }
+    // The result for each quantile is the lowest value whose cumulative count exceeds its
+    // threshold.  Visit the quantiles in threshold order so the histogram is only scanned once.
+    std::vector<std::pair<std::int64_t, size_t>> thresholds(num_quantiles);
+    for (size_t idx = 0; idx < num_quantiles; ++idx) {
+        thresholds[idx] = {std::int64_t(quantiles[idx] * (count - 1)), idx};
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+
+    std::uint64_t cumulative_count = 0;
+    auto next_threshold = thresholds.begin();
+    for (int value = range_min; value <= range_max && next_threshold != thresholds.end();
+         ++value) {
+        cumulative_count += counts[value];
+        while (next_threshold != thresholds.end() &&
+               std::int64_t(cumulative_count) > next_threshold->first) {
+            results[next_threshold->second] = std::int16_t(value);
+            ++next_threshold;
         }
     }
 
-    return res;
+    std::fill(&counts[range_min], &counts[range_max] + 1, 0);
+}
+
+void normalise_i16_to_f16(c10::Half* const dest,
+                          const std::int16_t* const src,
+                          std::size_t count,
+                          float shift,
+                          float scale) {
+    return normalise_i16_to_f16_impl(dest, src, count, shift, scale);
 }
 
 // Multiversioned function dispatch doesn't work across the dorado_lib linking
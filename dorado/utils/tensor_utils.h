@@ -3,6 +3,7 @@
 #include <ATen/core/TensorBody.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -25,6 +26,22 @@ at::Tensor quantile(const at::Tensor t, const at::Tensor q);
 // Only `interpolation='lower'` is currently implemented.
 at::Tensor quantile_counting(const at::Tensor t, const at::Tensor q);
 
+// As above, for count int16 samples and num_quantiles quantiles, writing one value per quantile
+// to results.  The histogram is a reusable thread-local buffer, and the samples are only read once.
+void quantile_counting(const std::int16_t* samples,
+                       std::size_t count,
+                       const float* quantiles,
+                       std::size_t num_quantiles,
+                       std::int16_t* results);
+
+// Writes (src - shift) / scale for count int16 elements pointed to by src as half precision, with
+// the result pointed to by dest.  dest may be the same as src.
+void normalise_i16_to_f16(c10::Half* dest,
+                          const std::int16_t* src,
+                          std::size_t count,
+                          float shift,
+                          float scale);
+
 // Converts count float elements pointed to by src to half precision, with
 // the result pointed to by dest.
 void convert_f32_to_f16(c10::Half* dest, const float* src, std::size_t count);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+namespace dorado::utils {
+
+// Restricts the calling thread to run on the given logical CPUs.  Returns false, leaving the
+// thread's affinity unchanged, if the request failed or isn't supported on this platform.
+bool set_thread_affinity(const std::vector<int>& cpus);
+
+// Returns the logical CPUs this process is allowed to run on, e.g. as restricted by taskset or a
+// container's cpuset, in ascending order.  Where that can't be queried, every CPU is returned.
+std::vector<int> get_allowed_cpus();
+
+}  // namespace dorado::utils
@@ -45,6 +45,50 @@ int trim(const at::Tensor& signal, float threshold, int window_size, int min_ele
     return min_trim;
 }
 
+std::vector<std::pair<int, int>> find_open_pore_ranges(const at::Tensor& signal,
+                                                       float threshold,
+                                                       int window_size,
+                                                       int min_elements) {
+    const int num_samples = static_cast<int>(signal.size(0));
+    const int num_windows = num_samples / window_size;
+
+    // Access via raw pointers because of torch indexing overhead.
+    const auto signal_f32 = signal.to(at::ScalarType::Float);
+    assert(signal_f32.is_contiguous());
+    const float* const signal_f32_ptr = signal_f32.data_ptr<float>();
+
+    auto is_open_pore = [&](int start, int end) {
+        const auto num_too_small =
+                std::count_if(&signal_f32_ptr[start], &signal_f32_ptr[end],
+                              [threshold](float elem) { return elem <= threshold; });
+        return num_too_small <= min_elements;
+    };
+
+    std::vector<std::pair<int, int>> ranges;
+    int range_start = -1;
+    for (int pos = 0; pos < num_windows; ++pos) {
+        const int start = pos * window_size;
+        const int end = start + window_size;
+        if (is_open_pore(start, end)) {
+            if (range_start < 0) {
+                range_start = start;
+            }
+        } else if (range_start >= 0) {
+            ranges.emplace_back(range_start, start);
+            range_start = -1;
+        }
+    }
+
+    // Samples after the last full window are only included in a range which reaches them.
+    const int windowed_end = num_windows * window_size;
+    if (range_start >= 0) {
+        const bool tail_open_pore =
+                windowed_end == num_samples || is_open_pore(windowed_end, num_samples);
+        ranges.emplace_back(range_start, tail_open_pore ? num_samples : windowed_end);
+    }
+    return ranges;
+}
+
 std::string trim_sequence(const std::string& seq, const std::pair<int, int>& trim_interval) {
     if (trim_interval.first >= int(seq.length()) || trim_interval.second > int(seq.length()) ||
         trim_interval.second < trim_interval.first) {
@@ -1,6 +1,9 @@
 #pragma once
 #include <ATen/core/TensorBody.h>
 
+#include <utility>
+#include <vector>
+
 namespace dorado::utils {
 
 // Default trim settings.
@@ -11,6 +14,16 @@ constexpr int DEFAULT_TRIM_MIN_ELEMENTS = 3;
 // Read Trimming method (removes some initial part of the raw read).
 int trim(const at::Tensor& signal, float threshold, int window_size, int min_elements);
 
+// Finds open-pore (non-translocating) regions of a scaled signal, using the same windowed
+// statistics as trim(). A window is treated as open pore if no more than min_elements of its
+// samples are at or below the threshold. Returns [start, end) sample ranges of consecutive
+// open-pore windows, in order. The final range may end at the end of the signal, beyond the
+// last full window, if the trailing partial window is also above the threshold.
+std::vector<std::pair<int, int>> find_open_pore_ranges(const at::Tensor& signal,
+                                                       float threshold,
+                                                       int window_size,
+                                                       int min_elements);
+
 // Trim a sequence. The interval defines the portion of the read to keep.
 std::string trim_sequence(const std::string& seq, const std::pair<int, int>& trim_interval);
 
@@ -7,7 +7,10 @@
 #include <htslib/sam.h>
 
 #include <filesystem>
+#include <fstream>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #define TEST_GROUP "[bam_utils][hts_reader]"
 
@@ -109,3 +112,73 @@ TEST_CASE("HtsReaderTest: fetch_read_ids API w/ SAM", TEST_GROUP) {
     CHECK(read_set.find("d7500028-dfcc-4404-b636-13edae804c55") != read_set.end());
     CHECK(read_set.find("60588a89-f191-414e-b444-ad0815b7d9c9") != read_set.end());
 }
+
+TEST_CASE("HtsReaderTest: get_hts_input_files", TEST_GROUP) {
+    fs::path aligner_test_dir = fs::path(get_data_dir("bam_reader"));
+    const auto files = dorado::get_hts_input_files(
+            {aligner_test_dir.string(), (aligner_test_dir / "input.fa").string()}, false);
+    REQUIRE(files.size() == 3);
+    CHECK(fs::path(files[0]).filename() == "input.fa");
+    CHECK(fs::path(files[1]).filename() == "small.sam");
+    CHECK(fs::path(files[2]).filename() == "input.fa");
+}
+
+TEST_CASE("HtsReaderTest: MultiHtsReader reads every file", TEST_GROUP) {
+    fs::path aligner_test_dir = fs::path(get_data_dir("bam_reader"));
+    const std::vector<std::string> files{(aligner_test_dir / "input.fa").string(),
+                                         (aligner_test_dir / "small.sam").string()};
+    auto max_reads = GENERATE(0, 15);
+    CAPTURE(max_reads);
+
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> bam_records;
+    pipeline_desc.add_node<MessageSinkToVector>({}, 100, bam_records);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    dorado::MultiHtsReader reader(files, std::nullopt);
+    // The references of the aligned SAM file are in the merged header.
+    CHECK(reader.is_aligned);
+    CHECK(reader.header()->n_targets == 2);
+    reader.read(*pipeline, max_reads, 2, false);
+    pipeline.reset();
+    CHECK(bam_records.size() == (max_reads == 0 ? 21 : 15));
+}
+
+TEST_CASE("HtsReaderTest: MultiHtsReader reconciles read groups", TEST_GROUP) {
+    const auto tmp_dir = fs::temp_directory_path() / "dorado_multi_hts_reader";
+    fs::create_directories(tmp_dir);
+    auto write_sam = [&](const std::string& name, const std::string& sample) {
+        const auto path = tmp_dir / name;
+        std::ofstream sam(path);
+        sam << "@HD\tVN:1.6\tSO:unknown\n"
+            << "@RG\tID:run_model\tSM:" << sample << "\n"
+            << name << "\t4\t*\t0\t0\t*\t*\t0\t0\tACGT\t*\tRG:Z:run_model\n";
+        return path.string();
+    };
+    const std::vector<std::string> files{write_sam("a.sam", "sample_a"),
+                                         write_sam("b.sam", "sample_a"),
+                                         write_sam("c.sam", "sample_c")};
+
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> bam_records;
+    pipeline_desc.add_node<MessageSinkToVector>({}, 100, bam_records);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    dorado::MultiHtsReader reader(files, std::nullopt);
+    // The identical read groups of a.sam and b.sam are merged, and c.sam's is renamed.
+    CHECK(sam_hdr_count_lines(reader.header(), "RG") == 2);
+    auto read_groups = dorado::utils::get_read_group_info(reader.header(), "SM");
+    CHECK(read_groups["run_model"] == "sample_a");
+    CHECK(read_groups["run_model_1"] == "sample_c");
+
+    reader.read(*pipeline, 0, 3, false);
+    pipeline.reset();
+    REQUIRE(bam_records.size() == 3);
+    for (auto& message : bam_records) {
+        auto record = std::get<dorado::BamPtr>(std::move(message));
+        const std::string read_id = bam_get_qname(record.get());
+        const std::string read_group = bam_aux2Z(bam_aux_get(record.get(), "RG"));
+        CHECK(read_group == (read_id == "c.sam" ? "run_model_1" : "run_model"));
+    }
+    fs::remove_all(tmp_dir);
+}
@@ -7,7 +7,11 @@
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
 
 #define TEST_GROUP "[bam_utils][hts_writer]"
 
@@ -28,7 +32,8 @@ protected:
     void generate_bam(HtsWriter::OutputMode mode, int num_threads) {
         HtsReader reader(m_in_sam.string(), std::nullopt);
         PipelineDescriptor pipeline_desc;
-        auto writer = pipeline_desc.add_node<HtsWriter>({}, m_out_bam.string(), mode, num_threads);
+        auto writer =
+                pipeline_desc.add_node<HtsWriter>({}, m_out_bam.string(), mode, num_threads, 0);
         auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
 
         auto& writer_ref = dynamic_cast<HtsWriter&>(pipeline->get_node_ref(writer));
@@ -37,10 +42,12 @@ protected:
         reader.read(*pipeline, 1000);
         pipeline->terminate(DefaultFlushOptions());
         stats = writer_ref.sample_stats();
+        counters = pipeline->counters().get_all();
         pipeline.reset();
     }
 
     stats::NamedStats stats;
+    stats::CounterRegistry::Values counters{};
 
 private:
     fs::path m_in_sam;
@@ -66,4 +73,159 @@ TEST_CASE_METHOD(HtsWriterTestsFixture, "HtsWriter: Count reads written", TEST_G
 
     CHECK(stats.at("unique_simplex_reads_written") == 6);
     CHECK(stats.at("split_reads_written") == 2);
+    CHECK(counters[size_t(stats::Counter::SIMPLEX_READS_WRITTEN)] == 6);
+}
+
+TEST_CASE("HtsWriterTest: Write records in input order", TEST_GROUP) {
+    const auto in_sam = fs::path(get_data_dir("bam_reader")) / "small.sam";
+    const auto out_sam = fs::temp_directory_path() / "dorado_ordered_out.sam";
+    const bool drop_record = GENERATE(false, true);
+    const size_t reorder_buffer_size = GENERATE(2, 100);
+    CAPTURE(drop_record);
+    CAPTURE(reorder_buffer_size);
+
+    // The records are numbered in file order, except that the last two are both made from the
+    // tenth input record.
+    std::vector<BamPtr> records;
+    std::vector<std::string> expected_read_ids;
+    HtsReader reader(in_sam.string(), std::nullopt);
+    while (reader.read()) {
+        records.emplace_back(bam_dup1(reader.record.get()));
+    }
+    REQUIRE(records.size() == 11);
+    for (size_t i = 0; i < records.size(); ++i) {
+        const bool is_last = i == records.size() - 1;
+        utils::set_record_order(records[i].get(),
+                                {is_last ? 10 : i + 1, is_last ? 1u : 0u, i >= 9 ? 2u : 1u});
+        if (!(drop_record && i == 2)) {
+            expected_read_ids.push_back(bam_get_qname(records[i].get()));
+        }
+    }
+
+    {
+        PipelineDescriptor pipeline_desc;
+        auto writer = pipeline_desc.add_node<HtsWriter>(
+                {}, out_sam.string(), HtsWriter::OutputMode::SAM, 1, reorder_buffer_size);
+        auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+        dynamic_cast<HtsWriter&>(pipeline->get_node_ref(writer))
+                .set_and_write_header(reader.header);
+        // Push them in reverse order.
+        for (size_t i = records.size(); i-- > 0;) {
+            if (!(drop_record && i == 2)) {
+                pipeline->push_message(std::move(records[i]));
+            }
+        }
+    }
+
+    std::vector<std::string> read_ids;
+    HtsReader out_reader(out_sam.string(), std::nullopt);
+    while (out_reader.read()) {
+        read_ids.push_back(bam_get_qname(out_reader.record.get()));
+    }
+    fs::remove(out_sam);
+    if (reorder_buffer_size < records.size()) {
+        // Records can't be held back for long enough to put them all in order, but they are all
+        // still written.
+        std::sort(read_ids.begin(), read_ids.end());
+        std::sort(expected_read_ids.begin(), expected_read_ids.end());
+    }
+    CHECK(read_ids == expected_read_ids);
+}
+
+TEST_CASE("HtsWriterTest: Write sharded output", TEST_GROUP) {
+    const auto in_sam = fs::path(get_data_dir("bam_reader")) / "small.sam";
+    const auto out_dir = fs::temp_directory_path() / "dorado_sharded_out";
+    fs::remove_all(out_dir);
+    fs::create_directories(out_dir);
+    const auto assignment = GENERATE(OutputShardOptions::Assignment::ROUND_ROBIN,
+                                     OutputShardOptions::Assignment::READ_ID_HASH);
+    const size_t max_records_per_file = GENERATE(0, 2);
+    CAPTURE(assignment);
+    CAPTURE(max_records_per_file);
+
+    OutputShardOptions shard_options;
+    shard_options.num_shards = 3;
+    shard_options.assignment = assignment;
+    shard_options.max_records_per_file = max_records_per_file;
+    const auto out_bam = (out_dir / "out.bam").string();
+
+    HtsReader reader(in_sam.string(), std::nullopt);
+    {
+        PipelineDescriptor pipeline_desc;
+        auto writer = pipeline_desc.add_node<HtsWriter>({}, out_bam, HtsWriter::OutputMode::BAM, 3,
+                                                        0, shard_options);
+        auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+        dynamic_cast<HtsWriter&>(pipeline->get_node_ref(writer))
+                .set_and_write_header(reader.header);
+        reader.read(*pipeline, 1000);
+    }
+
+    // Every file is readable on its own, and between them they hold every record once.
+    size_t num_files = 0;
+    std::vector<std::string> read_ids;
+    std::map<std::string, std::string> read_id_files;
+    for (const auto& entry : fs::directory_iterator(out_dir)) {
+        ++num_files;
+        HtsReader shard_reader(entry.path().string(), std::nullopt);
+        CHECK(sam_hdr_count_lines(shard_reader.header, "SQ") == 2);
+        size_t num_records = 0;
+        while (shard_reader.read()) {
+            ++num_records;
+            const std::string read_id = bam_get_qname(shard_reader.record.get());
+            read_ids.push_back(read_id);
+            auto [it, inserted] = read_id_files.emplace(read_id, entry.path().string());
+            if (assignment == OutputShardOptions::Assignment::READ_ID_HASH) {
+                CHECK(it->second == entry.path().string());
+            }
+        }
+        CHECK(num_records > 0);
+        if (max_records_per_file > 0) {
+            CHECK(num_records <= max_records_per_file);
+        }
+    }
+    CHECK(read_ids.size() == 11);
+    CHECK(read_id_files.size() == 7);
+    CHECK(fs::exists(HtsWriter::get_shard_filename(out_bam, shard_options, 0, 0)));
+    if (assignment == OutputShardOptions::Assignment::ROUND_ROBIN) {
+        // The shards get 4, 4 and 3 records.
+        CHECK(num_files == (max_records_per_file > 0 ? 6 : 3));
+    } else if (max_records_per_file == 0) {
+        // Read IDs are hashed the same way on every platform.
+        CHECK(fs::path(read_id_files.at("d7500028-dfcc-4404-b636-13edae804c55")) ==
+              fs::path(HtsWriter::get_shard_filename(out_bam, shard_options, 1, 0)));
+    }
+    fs::remove_all(out_dir);
+}
+
+TEST_CASE("HtsWriterTest: Shard files are only opened for records", TEST_GROUP) {
+    const auto out_dir = fs::temp_directory_path() / "dorado_sharded_empty_out";
+    fs::remove_all(out_dir);
+    fs::create_directories(out_dir);
+
+    OutputShardOptions shard_options;
+    shard_options.num_shards = 4;
+    HtsReader reader((fs::path(get_data_dir("bam_reader")) / "small.sam").string(), std::nullopt);
+    {
+        HtsWriter writer((out_dir / "out.bam").string(), HtsWriter::OutputMode::BAM, 4, 0,
+                         shard_options);
+        writer.set_and_write_header(reader.header);
+    }
+    CHECK(fs::is_empty(out_dir));
+
+    CHECK_THROWS(HtsWriter((out_dir / "missing" / "out.bam").string(),
+                           HtsWriter::OutputMode::BAM, 4, 0, shard_options));
+    fs::remove_all(out_dir);
+}
+
+TEST_CASE("HtsWriterTest: Shard filenames", TEST_GROUP) {
+    OutputShardOptions shard_options;
+    CHECK(HtsWriter::get_shard_filename("calls.bam", shard_options, 0, 0) == "calls.bam");
+    shard_options.num_shards = 4;
+    CHECK(HtsWriter::get_shard_filename("calls.bam", shard_options, 3, 0) == "calls.0003.bam");
+    shard_options.max_bytes_per_file = 1000;
+    CHECK(HtsWriter::get_shard_filename("calls.bam", shard_options, 1, 12) ==
+          "calls.0001.000012.bam");
+    shard_options.num_shards = 1;
+    CHECK(HtsWriter::get_shard_filename("calls.bam", shard_options, 0, 2) == "calls.000002.bam");
+    CHECK_THROWS(HtsWriter("-", HtsWriter::OutputMode::BAM, 1, 0, shard_options));
 }
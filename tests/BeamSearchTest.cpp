@@ -0,0 +1,172 @@
+#include "basecall/decode/beam_search.h"
+#include "basecall/decode/beam_search_kernels.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#define TEST_GROUP "[beam_search]"
+
+using namespace dorado::basecall::decode;
+
+namespace {
+
+constexpr int NUM_STATE_BITS = 10;
+constexpr size_t NUM_STATES = size_t(1) << NUM_STATE_BITS;
+
+std::vector<details::BeamFrontElement> random_front(std::mt19937& rng,
+                                                    size_t size,
+                                                    uint32_t num_distinct_hashes) {
+    std::uniform_int_distribution<uint32_t> hash_dist(0, num_distinct_hashes - 1);
+    std::uniform_int_distribution<uint32_t> state_dist(0, NUM_STATES - 1);
+    std::vector<details::BeamFrontElement> front(size);
+    for (size_t i = 0; i < size; ++i) {
+        front[i] = {hash_dist(rng) * 0x9e3779b9u, details::state_t(state_dist(rng)),
+                    uint8_t(i % 256), (i % 3) == 0};
+    }
+    return front;
+}
+
+std::vector<float> random_scores(std::mt19937& rng, size_t size) {
+    std::normal_distribution<float> score_dist(0.f, 2.f);
+    std::vector<float> scores(size);
+    for (auto& score : scores) {
+        score = score_dist(rng);
+    }
+    return scores;
+}
+
+bool fronts_equal(const std::vector<details::BeamFrontElement>& a,
+                  const std::vector<details::BeamFrontElement>& b) {
+    return a.size() == b.size() &&
+           std::memcmp(a.data(), b.data(), a.size() * sizeof(details::BeamFrontElement)) == 0;
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": expand_steps matches generic implementation") {
+    std::mt19937 rng(42);
+    const auto block_scores = random_scores(rng, NUM_STATES * details::NUM_BASES);
+    const auto back_scores = random_scores(rng, NUM_STATES);
+
+    for (size_t beam_width : {1, 2, 3, 31, 32, 255, 256}) {
+        CAPTURE(beam_width);
+        const auto prev_front = random_front(rng, beam_width, 1u << 20);
+        const auto prev_scores = random_scores(rng, beam_width);
+        const size_t num_candidates = beam_width * details::NUM_BASES;
+
+        std::vector<details::BeamFrontElement> expected_front(num_candidates);
+        std::vector<float> expected_scores(num_candidates);
+        details::HashPresentBits expected_present;
+        const float expected_max = details::expand_steps_generic(
+                block_scores.data(), 1.f, back_scores.data(), NUM_STATE_BITS, prev_front.data(),
+                prev_scores.data(), beam_width, expected_front.data(), expected_scores.data(),
+                expected_present);
+
+        std::vector<details::BeamFrontElement> front(num_candidates);
+        std::vector<float> scores(num_candidates);
+        details::HashPresentBits present;
+        const float max_score = details::expand_steps(
+                block_scores.data(), 1.f, back_scores.data(), NUM_STATE_BITS, prev_front.data(),
+                prev_scores.data(), beam_width, front.data(), scores.data(), present);
+
+        CHECK(max_score == expected_max);
+        CHECK(fronts_equal(front, expected_front));
+        CHECK(scores == expected_scores);
+        CHECK(present == expected_present);
+    }
+}
+
+TEST_CASE(TEST_GROUP ": find_matching_steps matches generic implementation") {
+    std::mt19937 rng(43);
+    for (size_t beam_width : {1, 7, 8, 9, 64, 256}) {
+        CAPTURE(beam_width);
+        // Draw from a small set of hashes so that there are plenty of matches.
+        const auto front = random_front(rng, beam_width * details::NUM_BASES, 4);
+        for (int latest_base = 0; latest_base < details::NUM_BASES; ++latest_base) {
+            for (uint32_t hash_idx = 0; hash_idx < 4; ++hash_idx) {
+                const uint32_t hash = hash_idx * 0x9e3779b9u;
+                std::vector<uint16_t> expected(beam_width);
+                expected.resize(details::find_matching_steps_generic(
+                        front.data(), beam_width, latest_base, hash, expected.data()));
+                std::vector<uint16_t> matches(beam_width);
+                matches.resize(details::find_matching_steps(front.data(), beam_width,
+                                                            latest_base, hash, matches.data()));
+                CHECK(matches == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": cutoff selection matches generic implementation") {
+    std::mt19937 rng(44);
+    for (size_t num_elements : {0, 1, 5, 15, 16, 17, 160, 1280}) {
+        CAPTURE(num_elements);
+        const auto front = random_front(rng, num_elements, 1u << 20);
+        auto scores = random_scores(rng, num_elements);
+        // Merged elements have their scores set to the lowest value.
+        for (size_t i = 0; i < num_elements; i += 5) {
+            scores[i] = std::numeric_limits<float>::lowest();
+        }
+
+        for (float cutoff : {std::numeric_limits<float>::lowest(), -1.f, 0.f, 2.f, 100.f}) {
+            CAPTURE(cutoff);
+            CHECK(details::count_scores_above_cutoff(scores.data(), num_elements, cutoff) ==
+                  details::count_scores_above_cutoff_generic(scores.data(), num_elements, cutoff));
+
+            for (size_t max_count : {size_t(0), size_t(3), num_elements}) {
+                std::vector<details::BeamFrontElement> expected_front(num_elements);
+                std::vector<float> expected_scores(num_elements);
+                const size_t expected_count = details::select_above_cutoff_generic(
+                        front.data(), scores.data(), num_elements, cutoff, max_count,
+                        expected_front.data(), expected_scores.data());
+
+                std::vector<details::BeamFrontElement> selected_front(num_elements);
+                std::vector<float> selected_scores(num_elements);
+                const size_t count = details::select_above_cutoff(
+                        front.data(), scores.data(), num_elements, cutoff, max_count,
+                        selected_front.data(), selected_scores.data());
+
+                CHECK(count == expected_count);
+                CHECK(fronts_equal(selected_front, expected_front));
+                CHECK(selected_scores == expected_scores);
+            }
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": float and int8 decodes agree") {
+    // The int8 path always uses the generic kernels, so decoding the same quantised scores
+    // through both paths checks the dispatched kernels end to end.  Use a beam at least as wide
+    // as the number of states so that both paths start from the same initial beam.
+    constexpr int num_state_bits = 6;
+    constexpr int64_t num_states = 1 << num_state_bits;
+    constexpr int64_t num_blocks = 500;
+    constexpr float byte_score_scale = 0.25f;
+    const float posts_scale = static_cast<float>(1.0 / 32767.0);
+
+    at::manual_seed(42);
+    auto scores_int8 = at::randint(-128, 128, {num_blocks, num_states * 4}, at::kChar);
+    auto back_guides = at::randn({num_blocks + 1, num_states}, at::kFloat);
+    auto posts_int16 = at::randint(0, 1000, {num_blocks + 1, num_states}, at::kShort);
+
+    auto scores_float = scores_int8.to(at::kFloat) * byte_score_scale;
+    auto posts_float = posts_int16.to(at::kFloat) * posts_scale;
+
+    const auto [seq_int8, qstring_int8, moves_int8] =
+            beam_search_decode(scores_int8, back_guides, posts_int16, num_states, 1000.f, -2.f,
+                               0.f, 1.f, byte_score_scale);
+    const auto [seq_float, qstring_float, moves_float] = beam_search_decode(
+            scores_float, back_guides, posts_float, num_states, 1000.f, -2.f, 0.f, 1.f, 1.f);
+
+    CHECK(moves_float.size() == size_t(num_blocks));
+    CHECK(!seq_float.empty());
+    CHECK(seq_float == seq_int8);
+    CHECK(moves_float == moves_int8);
+    CHECK(qstring_float == qstring_int8);
+}
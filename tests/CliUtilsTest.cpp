@@ -49,6 +49,14 @@ TEST_CASE("CliUtils: Check numbers string to vector of longs conversion", TEST_G
     SECTION("convert not a number") { CHECK_THROWS(parse_string_to_sizes("1,abcd")); }
 }
 
+TEST_CASE("CliUtils: Check CPU threads per caller parsing", TEST_GROUP) {
+    SECTION("convert 1") { CHECK(parse_cpu_threads_per_caller("1") == 1); }
+    SECTION("convert 8") { CHECK(parse_cpu_threads_per_caller("8") == 8); }
+    SECTION("convert 0") { CHECK_THROWS(parse_cpu_threads_per_caller("0")); }
+    SECTION("convert negative") { CHECK_THROWS(parse_cpu_threads_per_caller("-2")); }
+    SECTION("convert not a number") { CHECK_THROWS(parse_cpu_threads_per_caller("abcd")); }
+}
+
 TEST_CASE("CliUtils: Extract tokens from dorado cmdline", TEST_GROUP) {
     std::string cmdline = "dorado basecaller model_path dataset --option1 blah";
     std::vector<std::string> expected_tokens = {"dorado",  "basecaller", "model_path",
@@ -7,12 +7,15 @@
 #include "read_pipeline/SubreadTaggerNode.h"
 #include "splitter/DuplexReadSplitter.h"
 #include "splitter/ReadSplitter.h"
+#include "splitter/SignalReadSplitter.h"
 
 #include <catch2/catch.hpp>
 #include <torch/torch.h>
 
 #include <algorithm>
 #include <filesystem>
+#include <set>
+#include <string>
 #include <vector>
 
 #define TEST_GROUP "[DuplexSplitTest]"
@@ -260,3 +263,63 @@ TEST_CASE("Test split where only one subread is generated", TEST_GROUP) {
     const auto &read_common = get_read_common_data(messages[0]);
     CHECK(read_common.parent_read_id != read_common.read_id);
 }
+
+TEST_CASE("Subreads of a signal space split are split with unique read IDs", TEST_GROUP) {
+    // Split a read in signal space, as happens ahead of basecalling, into two subreads.  The
+    // calibration is the identity, so raw values are in pA.
+    auto raw_read = make_read();
+    const std::string parent_read_id = raw_read->read_common.read_id;
+    raw_read->scaling = 1.f;
+    raw_read->offset = 0.f;
+    raw_read->read_common.num_trimmed_samples = 0;
+    raw_read->read_common.attributes.num_samples = 20000;
+    raw_read->end_sample = raw_read->start_sample + 20000;
+    auto signal = at::full({20000}, 90, at::TensorOptions().dtype(at::kShort));
+    signal.index_put_({at::indexing::Slice(8000, 8100)}, 220);
+    raw_read->read_common.raw_data = signal;
+
+    dorado::splitter::SignalReadSplitter signal_splitter(dorado::splitter::SignalSplitSettings{});
+    auto signal_subreads = signal_splitter.split(std::move(raw_read));
+    REQUIRE(signal_subreads.size() == 2);
+    const std::string unsplit_read_id = signal_subreads[1]->read_common.read_id;
+
+    // Stand in for basecalling: the first subread is called as the 4 subread read, and the second
+    // one as a read which isn't split again.
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> messages;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 3, messages);
+    auto splitter = std::make_unique<dorado::splitter::DuplexReadSplitter>(
+            dorado::splitter::DuplexSplitSettings(false));
+    pipeline_desc.add_node<dorado::ReadSplitNode>({sink}, std::move(splitter), 1, 1000);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    for (auto &signal_subread : signal_subreads) {
+        auto read = make_read();
+        if (signal_subread != signal_subreads.front()) {
+            read->read_common.seq = "AAAAAAAAAAAAAAAAAAAAAA";
+            read->read_common.qstring = std::string(read->read_common.seq.length(), '!');
+            read->read_common.moves = std::vector<uint8_t>(read->read_common.seq.length(), 1);
+            read->read_common.raw_data =
+                    at::zeros(read->read_common.seq.length() * 10).to(at::ScalarType::Half);
+        }
+        read->read_common.read_id = signal_subread->read_common.read_id;
+        read->read_common.parent_read_id = signal_subread->read_common.parent_read_id;
+        read->read_common.subread_id = signal_subread->read_common.subread_id;
+        read->read_common.split_count = signal_subread->read_common.split_count;
+        read->prev_read = signal_subread->prev_read;
+        read->next_read = signal_subread->next_read;
+        pipeline->push_message(std::move(read));
+    }
+    pipeline.reset();
+
+    auto reads = ConvertMessages<dorado::SimplexReadPtr>(std::move(messages));
+    CHECK(reads.size() == 5);
+    std::set<std::string> read_ids;
+    for (const auto &read : reads) {
+        read_ids.insert(read->read_common.read_id);
+        CHECK(read->read_common.parent_read_id == parent_read_id);
+    }
+    CHECK(read_ids.size() == reads.size());
+    // The read which wasn't split again keeps the ID from the signal space split.
+    CHECK(read_ids.count(unsplit_read_id) == 1);
+}
@@ -272,4 +272,37 @@ TEST_CASE(TEST_GROUP
     REQUIRE(header == EXPECTED_2READ_REF_FILE_HEADER);
 }
 
+TEST_CASE(TEST_GROUP " load_index beyond the limit unloads the least recently loaded index",
+          TEST_GROUP) {
+    IndexFileAccess cut{1};
+    cut.load_index(valid_reference_file(), dflt_options, 1);
+    cut.load_index(valid_2read_reference_file(), dflt_options, 1);
+
+    REQUIRE_FALSE(cut.is_index_loaded(valid_reference_file(), dflt_options));
+    REQUIRE(cut.is_index_loaded(valid_2read_reference_file(), dflt_options));
+}
+
+TEST_CASE(TEST_GROUP " load_index beyond the limit keeps indexes which are in use", TEST_GROUP) {
+    IndexFileAccess cut{1};
+    cut.load_index(valid_reference_file(), dflt_options, 1);
+    auto in_use = cut.get_index(valid_reference_file(), dflt_options);
+    cut.load_index(valid_2read_reference_file(), dflt_options, 1);
+
+    REQUIRE(cut.is_index_loaded(valid_reference_file(), dflt_options));
+    REQUIRE(cut.is_index_loaded(valid_2read_reference_file(), dflt_options));
+}
+
+TEST_CASE(TEST_GROUP " load_index returning the index keeps it loaded beyond the limit",
+          TEST_GROUP) {
+    IndexFileAccess cut{1};
+    std::shared_ptr<const Minimap2Index> loaded_index;
+    REQUIRE(cut.load_index(valid_reference_file(), dflt_options, 1, loaded_index) ==
+            IndexLoadResult::success);
+    REQUIRE(loaded_index != nullptr);
+    cut.load_index(valid_2read_reference_file(), dflt_options, 1);
+
+    REQUIRE(cut.is_index_loaded(valid_reference_file(), dflt_options));
+    REQUIRE(cut.get_index(valid_reference_file(), dflt_options) == loaded_index);
+}
+
 }  // namespace dorado::alignment::index_file_access
\ No newline at end of file
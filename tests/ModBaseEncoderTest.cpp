@@ -4,6 +4,8 @@
 
 #include <catch2/catch.hpp>
 
+#include <stdexcept>
+
 #define TEST_GROUP "[modbase_encoder]"
 
 TEST_CASE("Encode sequence for modified basecalling", TEST_GROUP) {
@@ -91,3 +93,53 @@ TEST_CASE("Encode sequence for modified basecalling", TEST_GROUP) {
     // clang-format on    
     CHECK(expected_slice2 == slice2.data);
 }
+
+TEST_CASE("Encode all contexts of a read at once", TEST_GROUP) {
+    const size_t BLOCK_STRIDE = 2;
+    const size_t SLICE_BLOCKS = 6;
+    std::string sequence{"TATTCAGTAC"};
+    auto seq_ints = dorado::utils::sequence_to_ints(sequence);
+    std::vector<uint8_t> moves{1, 1, 0, 1, 0, 0, 1, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 0};
+    auto seq_to_sig_map = dorado::utils::moves_to_map(moves, BLOCK_STRIDE,
+                                                      moves.size() * BLOCK_STRIDE, std::nullopt);
+
+    auto [bases_before, bases_after] = GENERATE(table<int, int>({{1, 1}, {4, 4}, {2, 0}}));
+    CAPTURE(bases_before, bases_after);
+    dorado::modbase::ModBaseEncoder encoder(BLOCK_STRIDE, SLICE_BLOCKS * BLOCK_STRIDE,
+                                            bases_before, bases_after);
+    encoder.init(seq_ints, seq_to_sig_map);
+    const size_t context_size = encoder.kmer_context_size();
+    CHECK(context_size == size_t(bases_before + bases_after + 1) * 4 * SLICE_BLOCKS * BLOCK_STRIDE);
+
+    // Includes a repeated position, which is allowed as long as the positions are ascending.
+    std::vector<size_t> seq_positions{0, 1, 4, 4, 5, 8, 9};
+    std::vector<dorado::modbase::ModBaseEncoder::ContextSamples> contexts(seq_positions.size());
+    std::vector<int8_t> encoded_kmers(seq_positions.size() * context_size);
+    encoder.get_contexts(seq_positions, contexts.data(), encoded_kmers.data());
+
+    for (size_t i = 0; i < seq_positions.size(); ++i) {
+        CAPTURE(seq_positions[i]);
+        const auto expected = encoder.get_context(seq_positions[i]);
+        CHECK(contexts[i].first_sample == expected.first_sample);
+        CHECK(contexts[i].num_samples == expected.num_samples);
+        CHECK(contexts[i].lead_samples_needed == expected.lead_samples_needed);
+        CHECK(contexts[i].tail_samples_needed == expected.tail_samples_needed);
+        const std::vector<int8_t> data(encoded_kmers.begin() + i * context_size,
+                                       encoded_kmers.begin() + (i + 1) * context_size);
+        CHECK(data == expected.data);
+    }
+
+    SECTION("Out of order positions are rejected") {
+        std::vector<size_t> unsorted_positions{4, 1};
+        CHECK_THROWS_AS(encoder.get_contexts(unsorted_positions, contexts.data(),
+                                             encoded_kmers.data()),
+                        std::invalid_argument);
+    }
+
+    SECTION("Out of range positions are rejected") {
+        std::vector<size_t> out_of_range_positions{sequence.size()};
+        CHECK_THROWS_AS(encoder.get_contexts(out_of_range_positions, contexts.data(),
+                                             encoded_kmers.data()),
+                        std::out_of_range);
+    }
+}
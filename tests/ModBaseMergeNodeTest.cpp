@@ -0,0 +1,114 @@
+#include "read_pipeline/ModBaseMergeNode.h"
+
+#include "TestUtils.h"
+#include "read_pipeline/read_utils.h"
+#include "utils/bam_utils.h"
+#include "utils/sequence_utils.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+#include <htslib/sam.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[read_pipeline][ModBaseMergeNode]"
+
+using namespace dorado;
+
+namespace {
+
+const std::string SEQ = "ACGTTGCA";
+
+// Makes a record of SEQ with the signal scaling tags of a basecall.
+BamPtr make_basecalled_record(uint16_t flag) {
+    auto record = make_basecalled_bam_record(SEQ, flag);
+    const float sm = 2.f;
+    const float sd = 4.f;
+    bam_aux_append(record.get(), "sm", 'f', sizeof(sm), (const uint8_t *)&sm);
+    bam_aux_append(record.get(), "sd", 'f', sizeof(sd), (const uint8_t *)&sd);
+    bam_aux_append(record.get(), "sv", 'Z', 8, (const uint8_t *)"med_mad");
+    return record;
+}
+
+SimplexReadPtr make_raw_read(int64_t num_samples) {
+    auto read = std::make_unique<SimplexRead>();
+    read->read_common.read_id = "read";
+    read->read_common.raw_data = at::arange(num_samples, at::kShort);
+    read->offset = 1.f;
+    read->scaling = 0.5f;
+    return read;
+}
+
+}  // namespace
+
+TEST_CASE("ModBaseMergeNode: restore basecall from record", TEST_GROUP) {
+    const bool reverse = GENERATE(false, true);
+    auto record = make_basecalled_record(BAM_FUNMAP | (reverse ? BAM_FREVERSE : 0));
+    auto read = make_raw_read(200);
+
+    utils::restore_basecall(*read, record.get());
+
+    const auto &read_common = read->read_common;
+    CHECK(read_common.seq == (reverse ? utils::reverse_complement(SEQ) : SEQ));
+    CHECK(read_common.qstring.size() == SEQ.size());
+    CHECK(read_common.qstring.front() == char((reverse ? 17 : 10) + 33));
+    CHECK(read_common.model_stride == 5);
+    CHECK(read_common.moves.size() == 2 * SEQ.size());
+    CHECK(read_common.num_trimmed_samples == 10);
+    CHECK(read_common.scaling_method == "med_mad");
+    REQUIRE(read_common.raw_data.scalar_type() == at::kHalf);
+    REQUIRE(read_common.raw_data.numel() == 80);
+    // Sample 10 is 5.5pA, scaled by the shift and scale in pA.
+    CHECK(read_common.raw_data[0].item<float>() == Approx((5.5f - 2.f) / 4.f));
+}
+
+TEST_CASE("ModBaseMergeNode: restore basecall rejects mismatched records", TEST_GROUP) {
+    auto record = make_basecalled_record(BAM_FUNMAP);
+
+    SECTION("signal too short") {
+        auto read = make_raw_read(50);
+        CHECK_THROWS(utils::restore_basecall(*read, record.get()));
+    }
+    SECTION("split read") {
+        bam_aux_append(record.get(), "pi", 'Z', 7, (const uint8_t *)"parent");
+        auto read = make_raw_read(200);
+        CHECK_THROWS(utils::restore_basecall(*read, record.get()));
+    }
+    SECTION("no move table") {
+        bam_aux_del(record.get(), bam_aux_get(record.get(), "mv"));
+        auto read = make_raw_read(200);
+        CHECK_THROWS(utils::restore_basecall(*read, record.get()));
+    }
+}
+
+TEST_CASE("ModBaseMergeNode: replace modbase tags", TEST_GROUP) {
+    auto record = make_basecalled_record(BAM_FUNMAP);
+    const char *old_mm = "C+m?,0;";
+    bam_aux_append(record.get(), "MM", 'Z', int(std::strlen(old_mm) + 1),
+                   (const uint8_t *)old_mm);
+    std::vector<uint8_t> old_ml{1};
+    bam_aux_update_array(record.get(), "ML", 'C', int(old_ml.size()), old_ml.data());
+
+    auto modbase_record = make_basecalled_record(BAM_FUNMAP);
+    const char *mm = "C+m.,0,1;";
+    bam_aux_append(modbase_record.get(), "MM", 'Z', int(std::strlen(mm) + 1),
+                   (const uint8_t *)mm);
+    std::vector<uint8_t> ml{200, 13};
+    bam_aux_update_array(modbase_record.get(), "ML", 'C', int(ml.size()), ml.data());
+    bam_aux_update_int(modbase_record.get(), "MN", int64_t(SEQ.size()));
+
+    ModBaseMergeNode::replace_modbase_tags(record.get(), modbase_record.get());
+
+    auto [mod_str, mod_probs] = utils::extract_modbase_info(record.get());
+    CHECK(mod_str == mm);
+    CHECK(mod_probs == ml);
+    const auto *mn_tag = bam_aux_get(record.get(), "MN");
+    REQUIRE(mn_tag);
+    CHECK(bam_aux2i(mn_tag) == int64_t(SEQ.size()));
+    // Other tags are kept.
+    CHECK(bam_aux_get(record.get(), "mv"));
+    CHECK(bam_aux_get(record.get(), "ts"));
+}
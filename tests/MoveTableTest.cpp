@@ -0,0 +1,63 @@
+#include "utils/move_table.h"
+
+#include "utils/sequence_utils.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#define TEST_GROUP "[utils][MoveTable]"
+
+namespace {
+
+std::vector<uint8_t> random_moves(size_t size, double move_probability) {
+    std::mt19937 gen{42};
+    std::bernoulli_distribution dist(move_probability);
+    std::vector<uint8_t> moves(size);
+    for (auto& move : moves) {
+        move = dist(gen) ? 1 : 0;
+    }
+    return moves;
+}
+
+}  // namespace
+
+TEST_CASE("MoveTable: empty table", TEST_GROUP) {
+    const dorado::utils::MoveTable moves(std::vector<uint8_t>{});
+    CHECK(moves.empty());
+    CHECK(moves.num_moves() == 0);
+    CHECK(moves.rank(0) == 0);
+    CHECK(moves.base_start_sample(0, 5, 7) == 7);
+}
+
+TEST_CASE("MoveTable: rank and select match the unpacked table", TEST_GROUP) {
+    // Sizes either side of word boundaries, and densities with moves more than a select sample
+    // apart.
+    const size_t size = GENERATE(1, 63, 64, 65, 128, 1000, 20000);
+    const double move_probability = GENERATE(0.0, 0.002, 0.4, 1.0);
+    const auto unpacked = random_moves(size, move_probability);
+    const dorado::utils::MoveTable moves(unpacked);
+
+    REQUIRE(moves.size() == size);
+    size_t num_moves = 0;
+    for (size_t i = 0; i < size; ++i) {
+        CHECK(moves.rank(i) == num_moves);
+        CHECK(moves[i] == (unpacked[i] == 1));
+        if (unpacked[i] == 1) {
+            CHECK(moves.select(num_moves) == i);
+            ++num_moves;
+        }
+    }
+    CHECK(moves.rank(size) == num_moves);
+    CHECK(moves.num_moves() == num_moves);
+
+    const size_t stride = 5;
+    const size_t signal_len = size * stride + 3;
+    const auto expected = dorado::utils::moves_to_map(unpacked, stride, signal_len, std::nullopt);
+    for (size_t base = 0; base <= num_moves; ++base) {
+        CHECK(moves.base_start_sample(base, stride, signal_len) == expected[base]);
+    }
+}
@@ -172,8 +172,10 @@ DEFINE_TEST(NodeSmokeTestRead, "ScalerNode") {
             GENERATE(dorado::basecall::SampleType::DNA, dorado::basecall::SampleType::RNA002,
                      dorado::basecall::SampleType::RNA004);
     auto trim_adapter = GENERATE(true, false);
+    auto trim_open_pore = GENERATE(true, false);
     CAPTURE(pipeline_restart);
     CAPTURE(model_type);
+    CAPTURE(trim_open_pore);
 
     set_pipeline_restart(pipeline_restart);
 
@@ -188,7 +190,8 @@ DEFINE_TEST(NodeSmokeTestRead, "ScalerNode") {
     config.quantile.quantile_b = 0.9f;
     config.quantile.shift_multiplier = 0.51f;
     config.quantile.scale_multiplier = 0.53f;
-    run_smoke_test<dorado::ScalerNode>(config, model_type, trim_adapter, 2, 1000);
+    run_smoke_test<dorado::ScalerNode>(config, model_type, trim_adapter, trim_open_pore, 2,
+                                       1000);
 }
 
 DEFINE_TEST(NodeSmokeTestRead, "BasecallerNode") {
@@ -196,6 +199,8 @@ DEFINE_TEST(NodeSmokeTestRead, "BasecallerNode") {
     CAPTURE(gpu);
     auto pipeline_restart = GENERATE(false, true);
     CAPTURE(pipeline_restart);
+    auto length_sorted_batching = GENERATE(false, true);
+    CAPTURE(length_sorted_batching);
     auto model_name = GENERATE("dna_r10.4.1_e8.2_400bps_fast@v4.2.0", "rna004_130bps_fast@v3.0.1");
 
     set_pipeline_restart(pipeline_restart);
@@ -245,11 +250,17 @@ DEFINE_TEST(NodeSmokeTestRead, "BasecallerNode") {
         batch_size = 8;
         runners.push_back(std::make_unique<dorado::basecall::ModelRunner>(
                 model_config, "cpu", default_params.chunksize, int(batch_size)));
+        // And one whose caller splits its batches over two pinned threads.
+        auto caller = dorado::basecall::create_cpu_caller(model_config, "cpu",
+                                                          default_params.chunksize,
+                                                          int(batch_size), {0, 1});
+        runners.push_back(std::make_unique<dorado::basecall::ModelRunner>(caller));
     }
 
     run_smoke_test<dorado::BasecallerNode>(std::move(runners),
                                            dorado::utils::default_parameters.overlap,
-                                           kBatchTimeoutMS, model_name, 1000, "BasecallerNode", 0);
+                                           kBatchTimeoutMS, model_name, 1000, "BasecallerNode", 0,
+                                           length_sorted_batching);
 }
 
 DEFINE_TEST(NodeSmokeTestRead, "ModBaseCallerNode") {
@@ -4,6 +4,9 @@
 
 #include <catch2/catch.hpp>
 
+#include <thread>
+#include <vector>
+
 #define TEST_GROUP "[Pipeline]"
 
 using dorado::MessageSink;
@@ -187,4 +190,29 @@ TEST_CASE("TerminateRestart", TEST_GROUP) {
     pipeline->push_message(std::make_unique<dorado::SimplexRead>());
     pipeline.reset();
     CHECK(messages.size() == 2);
-}
\ No newline at end of file
+}
+
+TEST_CASE("CounterRegistry", TEST_GROUP) {
+    using dorado::stats::Counter;
+    constexpr int num_threads = 8;
+    constexpr int num_adds = 10000;
+    dorado::stats::CounterRegistry counters;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&counters] {
+            for (int j = 0; j < num_adds; ++j) {
+                counters.add(Counter::SIMPLEX_READS_WRITTEN, 1);
+                counters.add(Counter::SIMPLEX_BASES_PROCESSED, 3);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(counters.get(Counter::SIMPLEX_READS_WRITTEN) == num_threads * num_adds);
+    const auto values = counters.get_all();
+    CHECK(values[size_t(Counter::SIMPLEX_READS_WRITTEN)] == num_threads * num_adds);
+    CHECK(values[size_t(Counter::SIMPLEX_BASES_PROCESSED)] == 3 * num_threads * num_adds);
+    CHECK(values[size_t(Counter::DUPLEX_READS_WRITTEN)] == 0);
+}
@@ -0,0 +1,137 @@
+#include "read_pipeline/ReadQCStatsNode.h"
+
+#include "MessageSinkUtils.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[read_pipeline][ReadQCStatsNode]"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+dorado::SimplexReadPtr make_read(const std::string& read_id, size_t length, char qchar) {
+    auto read = std::make_unique<dorado::SimplexRead>();
+    read->read_common.raw_data = at::empty(4 * int64_t(length));
+    read->read_common.sample_rate = 4000;
+    read->read_common.num_trimmed_samples = 100;
+    read->read_common.read_id = read_id;
+    read->read_common.seq = std::string(length, 'A');
+    read->read_common.qstring = std::string(length, qchar);
+    read->read_common.start_time_ms = 1000;
+    read->read_common.attributes.mux = 2;
+    read->read_common.attributes.channel_number = 5;
+    return read;
+}
+
+// Runs the reads through a pipeline, and returns the contents of the QC stats file written.
+dorado::ReadQCStatsFile run_reads(std::vector<dorado::Message> reads) {
+    const auto path = fs::temp_directory_path() / "dorado_read_qc_stats.bin";
+    std::vector<dorado::Message> messages;
+    {
+        dorado::PipelineDescriptor pipeline_desc;
+        auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+        pipeline_desc.add_node<dorado::ReadQCStatsNode>({sink}, path.string(), 100);
+        auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+        for (auto& read : reads) {
+            pipeline->push_message(std::move(read));
+        }
+    }
+    // Every read is passed on.
+    CHECK(messages.size() == reads.size());
+
+    auto result = dorado::load_read_qc_stats(path.string());
+    fs::remove(path);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("ReadQCStatsNode: per-read metrics round trip", TEST_GROUP) {
+    std::vector<dorado::Message> reads;
+    reads.emplace_back(make_read("read_1", 100, '+'));  // Q10
+
+    auto barcoded = make_read("7c2f4b46-0b42-4a38-a5b1-6e4d9cb5a0f1", 200, '5');  // Q20
+    barcoded->read_common.barcode = "barcode01";
+    barcoded->read_common.rna_poly_tail_length = 42;
+    reads.emplace_back(std::move(barcoded));
+
+    auto split = make_read("read_3", 50, '+');
+    split->read_common.parent_read_id = "read_1";
+    split->read_common.split_point = 1234;
+    split->read_common.attributes.mux = std::numeric_limits<uint32_t>::max();
+    split->is_duplex_parent = true;
+    reads.emplace_back(std::move(split));
+
+    auto duplex = std::make_unique<dorado::DuplexRead>();
+    duplex->read_common.read_id = "read_1;read_2";
+    duplex->read_common.seq = std::string(80, 'C');
+    duplex->read_common.qstring = std::string(80, '?');  // Q30
+    duplex->read_common.is_duplex = true;
+    duplex->read_common.barcode = "barcode01";
+    reads.emplace_back(std::move(duplex));
+
+    const auto result = run_reads(std::move(reads));
+    REQUIRE(result.records.size() == 4);
+
+    const auto& record = result.records[0];
+    CHECK(record.read_id == "read_1");
+    CHECK(record.start_time_ms == 1000);
+    CHECK(record.num_samples == 500);
+    CHECK(record.duration_s == Approx(500.f / 4000.f));
+    CHECK(record.sequence_length == 100);
+    CHECK(record.mean_qscore == Approx(10.f));
+    CHECK(record.channel == 5);
+    CHECK(record.mux == 2);
+    CHECK(record.flags == 0);
+    CHECK(record.barcode.empty());
+    CHECK(record.poly_tail_length == -1);
+
+    CHECK(result.records[1].read_id == "7c2f4b46-0b42-4a38-a5b1-6e4d9cb5a0f1");
+    CHECK(result.records[1].barcode == "barcode01");
+    CHECK(result.records[1].poly_tail_length == 42);
+
+    CHECK(result.records[2].flags ==
+          (dorado::ReadQCRecord::FLAG_SPLIT | dorado::ReadQCRecord::FLAG_DUPLEX_PARENT));
+    CHECK(result.records[2].split_point == 1234);
+    CHECK(result.records[2].mux == 255);
+
+    CHECK(result.records[3].flags == dorado::ReadQCRecord::FLAG_DUPLEX);
+    CHECK(result.records[3].duration_s == 0.f);
+    CHECK(result.records[3].barcode == "barcode01");
+
+    const auto& summary = result.summary;
+    CHECK(summary.num_reads == 4);
+    CHECK(summary.num_bases == 430);
+    // Reads of at least 100 bases make up over half of the 430 bases.
+    CHECK(summary.n50 == 100);
+    REQUIRE(summary.qscore_histogram.size() == dorado::ReadQCStatsNode::NUM_QSCORE_BINS);
+    CHECK(summary.qscore_histogram[10] == 2);
+    CHECK(summary.qscore_histogram[20] == 1);
+    CHECK(summary.qscore_histogram[30] == 1);
+    CHECK(summary.length_histogram[5] == 1);  // 50
+    CHECK(summary.length_histogram[6] == 2);  // 80, 100
+    CHECK(summary.length_histogram[7] == 1);  // 200
+}
+
+TEST_CASE("ReadQCStatsNode: reads spanning several blocks", TEST_GROUP) {
+    const size_t num_reads = 2 * dorado::ReadQCStatsNode::BLOCK_SIZE + 10;
+    std::vector<dorado::Message> reads;
+    for (size_t i = 0; i < num_reads; ++i) {
+        reads.emplace_back(make_read("read_" + std::to_string(i), 1 + i % 100, '+'));
+    }
+
+    const auto result = run_reads(std::move(reads));
+    REQUIRE(result.records.size() == num_reads);
+    for (size_t i = 0; i < num_reads; ++i) {
+        CHECK(result.records[i].read_id == "read_" + std::to_string(i));
+        CHECK(result.records[i].sequence_length == 1 + i % 100);
+    }
+    CHECK(result.summary.num_reads == num_reads);
+}
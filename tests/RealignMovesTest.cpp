@@ -3,6 +3,12 @@
 #include <ATen/ATen.h>
 #include <catch2/catch.hpp>
 
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 using Slice = at::indexing::Slice;
 using namespace dorado;
 
@@ -18,4 +24,61 @@ TEST_CASE("Realign Moves No Error", TEST_GROUP) {
 
     // Test that calling realign_moves does not throw any exceptions
     CHECK_NOTHROW(utils::realign_moves(query_sequence, target_sequence, moves));
-}
\ No newline at end of file
+}
+
+namespace {
+
+// A random sequence of length num_bases, a copy of it with roughly one base in 50 substituted,
+// and a move table for the first with two blocks per base.
+std::tuple<std::string, std::string, std::vector<uint8_t>> make_realignment_inputs(size_t num_bases,
+                                                                                  uint32_t seed) {
+    std::minstd_rand rng(seed);
+    const char bases[] = "ACGT";
+    std::string query_sequence(num_bases, 'A');
+    for (auto& base : query_sequence) {
+        base = bases[rng() % 4];
+    }
+    auto target_sequence = query_sequence;
+    for (auto& base : target_sequence) {
+        if (rng() % 50 == 0) {
+            base = bases[rng() % 4];
+        }
+    }
+    std::vector<uint8_t> moves;
+    for (size_t i = 0; i < num_bases; ++i) {
+        moves.insert(moves.end(), {1, 0});
+    }
+    return {query_sequence, target_sequence, moves};
+}
+
+}  // namespace
+
+TEST_CASE("Realign Moves gives the same result on every thread", TEST_GROUP) {
+    // Not a structured binding, as those can't be captured by the lambda below.
+    std::string query_sequence;
+    std::string target_sequence;
+    std::vector<uint8_t> moves;
+    std::tie(query_sequence, target_sequence, moves) = make_realignment_inputs(2000, 1);
+    const auto expected = utils::realign_moves(query_sequence, target_sequence, moves);
+    REQUIRE(std::get<0>(expected) != -1);
+    REQUIRE(!std::get<2>(expected).empty());
+
+    // Each thread uses its own minimap2 buffers, which are reused between calls.
+    std::vector<std::thread> threads;
+    std::vector<int> num_matches(4, 0);
+    for (size_t thread_id = 0; thread_id < num_matches.size(); ++thread_id) {
+        threads.emplace_back([&, thread_id] {
+            for (int i = 0; i < 10; ++i) {
+                if (utils::realign_moves(query_sequence, target_sequence, moves) == expected) {
+                    ++num_matches[thread_id];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto count : num_matches) {
+        CHECK(count == 10);
+    }
+}
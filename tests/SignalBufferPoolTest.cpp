@@ -0,0 +1,107 @@
+#include "utils/SignalBufferPool.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <memory>
+
+#define TEST_GROUP "[utils][SignalBufferPool]"
+
+using dorado::utils::SignalBufferPool;
+
+TEST_CASE("SignalBufferPool: size classes", TEST_GROUP) {
+    CHECK(SignalBufferPool::size_class(1) == SignalBufferPool::NUM_CLASSES);
+    CHECK(SignalBufferPool::size_class(SignalBufferPool::MIN_CLASS_BYTES - 1) ==
+          SignalBufferPool::NUM_CLASSES);
+    CHECK(SignalBufferPool::size_class(SignalBufferPool::MIN_CLASS_BYTES) == 0);
+    CHECK(SignalBufferPool::size_class(SignalBufferPool::MAX_CLASS_BYTES + 1) ==
+          SignalBufferPool::NUM_CLASSES);
+    CHECK(SignalBufferPool::class_bytes(SignalBufferPool::NUM_CLASSES - 1) ==
+          SignalBufferPool::MAX_CLASS_BYTES);
+    for (size_t size_class = 1; size_class < SignalBufferPool::NUM_CLASSES; ++size_class) {
+        const auto bytes = SignalBufferPool::class_bytes(size_class);
+        const auto previous_bytes = SignalBufferPool::class_bytes(size_class - 1);
+        CHECK(SignalBufferPool::size_class(bytes) == size_class);
+        CHECK(SignalBufferPool::size_class(previous_bytes + 1) == size_class);
+        // Requests are rounded up by at most a quarter.
+        CHECK(bytes * 4 <= (previous_bytes + 1) * 5);
+    }
+}
+
+TEST_CASE("SignalBufferPool: freed buffers are reused", TEST_GROUP) {
+    const bool use_huge_pages = GENERATE(false, true);
+    auto pool = std::make_shared<SignalBufferPool>(size_t{64} << 20, use_huge_pages);
+    // Large enough for huge pages to be used, if requested.
+    const int64_t num_samples = 1500000;
+
+    void* first_buffer = nullptr;
+    {
+        auto signal = pool->empty(num_samples, at::kShort);
+        CHECK(signal.scalar_type() == at::kShort);
+        CHECK(signal.numel() == num_samples);
+        CHECK(reinterpret_cast<uintptr_t>(signal.data_ptr()) % SignalBufferPool::ALIGNMENT == 0);
+        signal.fill_(7);
+        first_buffer = signal.data_ptr();
+
+        auto stats = pool->sample_stats();
+        CHECK(stats.at("misses") == 1);
+        CHECK(stats.at("bytes_in_use") >= 2 * num_samples);
+        CHECK(stats.at("fragmentation") >= 0.);
+        CHECK(stats.at("fragmentation") < 0.25);
+    }
+    CHECK(pool->sample_stats().at("bytes_in_use") == 0);
+    CHECK(pool->sample_stats().at("bytes_free") > 0);
+
+    // A buffer of the same size class, even of another type, is the one just freed.
+    auto signal = pool->empty(num_samples - 1000, at::kHalf);
+    CHECK(signal.data_ptr() == first_buffer);
+    const auto stats = pool->sample_stats();
+    CHECK(stats.at("hits") == 1);
+    CHECK(stats.at("hit_rate") == Approx(0.5));
+    CHECK(stats.at("bytes_free") == 0);
+}
+
+TEST_CASE("SignalBufferPool: small buffers aren't pooled", TEST_GROUP) {
+    auto pool = std::make_shared<SignalBufferPool>(size_t{64} << 20, false);
+    {
+        auto signal = pool->empty(100, at::kShort);
+        CHECK(signal.numel() == 100);
+        CHECK(pool->sample_stats().at("bytes_in_use") == 0);
+    }
+    const auto stats = pool->sample_stats();
+    CHECK(stats.at("misses") == 0);
+    CHECK(stats.at("unpooled_allocations") == 0);
+    CHECK(stats.at("bytes_free") == 0);
+}
+
+TEST_CASE("SignalBufferPool: limits", TEST_GROUP) {
+    // Only one buffer of the smallest class can be kept.
+    auto pool = std::make_shared<SignalBufferPool>(SignalBufferPool::MIN_CLASS_BYTES, false);
+    const auto num_samples = int64_t(SignalBufferPool::MIN_CLASS_BYTES / 2);
+
+    SECTION("free buffers beyond the limit are released") {
+        {
+            auto first = pool->empty(num_samples, at::kShort);
+            auto second = pool->empty(num_samples, at::kShort);
+        }
+        const auto stats = pool->sample_stats();
+        CHECK(stats.at("bytes_free") == SignalBufferPool::MIN_CLASS_BYTES);
+        CHECK(stats.at("released_buffers") == 1);
+    }
+
+    SECTION("oversized buffers aren't pooled") {
+        pool->empty(int64_t(SignalBufferPool::MAX_CLASS_BYTES / 2 + 1), at::kShort);
+        const auto stats = pool->sample_stats();
+        CHECK(stats.at("unpooled_allocations") == 1);
+        CHECK(stats.at("released_buffers") == 1);
+        CHECK(stats.at("bytes_free") == 0);
+    }
+
+    SECTION("tensors keep the pool alive") {
+        auto signal = pool->empty(num_samples, at::kShort);
+        pool.reset();
+        signal.fill_(1);
+        CHECK(signal.sum().item<int64_t>() == num_samples);
+    }
+}
@@ -0,0 +1,179 @@
+#include "read_pipeline/SignalCache.h"
+
+#include "MessageSinkUtils.h"
+#include "read_pipeline/ScalerNode.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#define TEST_GROUP "[read_pipeline][SignalCache]"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string KEY = "test";
+
+// A new directory for each test, so that tests run in parallel don't share caches.
+struct CacheDir {
+    explicit CacheDir(const std::string& name) {
+        std::random_device random;
+        do {
+            path = fs::temp_directory_path() /
+                   ("dorado_signal_cache_" + name + "_" + std::to_string(random()));
+        } while (!fs::create_directories(path));
+    }
+    ~CacheDir() {
+        std::error_code error;
+        fs::remove_all(path, error);
+    }
+
+    CacheDir(const CacheDir&) = delete;
+    CacheDir& operator=(const CacheDir&) = delete;
+
+    fs::path path;
+};
+
+dorado::SimplexReadPtr make_scaled_read(const std::string& read_id, int64_t num_samples) {
+    auto read = std::make_unique<dorado::SimplexRead>();
+    read->read_common.read_id = read_id;
+    read->read_common.raw_data = at::randn({num_samples}).to(at::kHalf);
+    read->read_common.shift = 90.f;
+    read->read_common.scale = 20.f;
+    read->read_common.scaling_method = "quantile";
+    read->read_common.num_trimmed_samples = 10;
+    read->read_common.excluded_signal_ranges = {{100, 2200}};
+    return read;
+}
+
+}  // namespace
+
+TEST_CASE("SignalCache: round trip", TEST_GROUP) {
+    const CacheDir cache_dir("round_trip");
+    const auto& dir = cache_dir.path;
+    std::vector<dorado::SimplexReadPtr> reads;
+    reads.push_back(make_scaled_read("read_1", 5000));
+    reads.push_back(make_scaled_read("read_2", 123));
+    reads.push_back(make_scaled_read("read_3", 0));
+
+    {
+        dorado::SignalCache cache(dir, KEY);
+        REQUIRE(cache.is_writing());
+        for (const auto& read : reads) {
+            cache.add(read->read_common);
+        }
+        // Nothing can be read back from a cache while it's being written.
+        dorado::ReadCommon read_common;
+        read_common.read_id = "read_1";
+        CHECK_FALSE(cache.load(read_common));
+        cache.finalise();
+    }
+
+    dorado::SignalCache cache(dir, KEY);
+    CHECK_FALSE(cache.is_writing());
+    CHECK(cache.size() == reads.size());
+    for (const auto& read : reads) {
+        dorado::ReadCommon read_common;
+        read_common.read_id = read->read_common.read_id;
+        REQUIRE(cache.load(read_common));
+        CHECK(read_common.raw_data.scalar_type() == at::kHalf);
+        CHECK(at::equal(read_common.raw_data, read->read_common.raw_data));
+        CHECK(read_common.shift == read->read_common.shift);
+        CHECK(read_common.scale == read->read_common.scale);
+        CHECK(read_common.scaling_method == "quantile");
+        CHECK(read_common.num_trimmed_samples == 10);
+        CHECK(read_common.excluded_signal_ranges == read->read_common.excluded_signal_ranges);
+        if (read_common.raw_data.numel() > 0) {
+            const auto address = reinterpret_cast<uintptr_t>(read_common.raw_data.data_ptr());
+            CHECK(address % dorado::SignalCache::ALIGNMENT == 0);
+        }
+    }
+
+    dorado::ReadCommon missing;
+    missing.read_id = "read_4";
+    CHECK_FALSE(cache.load(missing));
+}
+
+TEST_CASE("SignalCache: unfinished caches are discarded", TEST_GROUP) {
+    const CacheDir cache_dir("unfinished");
+    const auto& dir = cache_dir.path;
+    {
+        dorado::SignalCache cache(dir, KEY);
+        cache.add(make_scaled_read("read_1", 100)->read_common);
+        // The cache isn't complete until it's finalised.
+        CHECK(fs::exists(dir / (KEY + ".signal.tmp")));
+        CHECK_FALSE(fs::exists(dir / (KEY + ".index")));
+    }
+    CHECK(fs::is_empty(dir));
+
+    dorado::SignalCache cache(dir, KEY);
+    CHECK(cache.is_writing());
+    CHECK(cache.size() == 0);
+}
+
+TEST_CASE("SignalCache: corrupt caches are rebuilt", TEST_GROUP) {
+    const CacheDir cache_dir("corrupt");
+    const auto& dir = cache_dir.path;
+    {
+        dorado::SignalCache cache(dir, KEY);
+        cache.add(make_scaled_read("read_1", 100)->read_common);
+        cache.finalise();
+    }
+    CHECK(fs::exists(dir / (KEY + ".index")));
+    CHECK_FALSE(fs::exists(dir / (KEY + ".signal.tmp")));
+
+    std::ofstream(dir / (KEY + ".index"), std::ios::binary | std::ios::trunc) << "not an index";
+    dorado::SignalCache cache(dir, KEY);
+    CHECK(cache.is_writing());
+    CHECK(cache.size() == 0);
+}
+
+TEST_CASE("SignalCache: keys depend on scaling settings", TEST_GROUP) {
+    dorado::basecall::SignalNormalisationParams params;
+    const auto key = dorado::SignalCache::make_key(params, dorado::basecall::SampleType::DNA, true,
+                                                   false);
+    CHECK(key.size() == 16);
+    CHECK(key == dorado::SignalCache::make_key(params, dorado::basecall::SampleType::DNA, true,
+                                               false));
+    CHECK(key != dorado::SignalCache::make_key(params, dorado::basecall::SampleType::DNA, false,
+                                               false));
+    CHECK(key != dorado::SignalCache::make_key(params, dorado::basecall::SampleType::DNA, true,
+                                               true));
+    params.quantile.quantile_a = 0.1f;
+    CHECK(key != dorado::SignalCache::make_key(params, dorado::basecall::SampleType::DNA, true,
+                                               false));
+}
+
+TEST_CASE("SignalCache: ScalerNode passes cached reads on unchanged", TEST_GROUP) {
+    const CacheDir cache_dir("scaler_node");
+    auto cache = std::make_shared<dorado::SignalCache>(cache_dir.path, KEY);
+    auto read = make_scaled_read("read_1", 1000);
+    const auto signal = read->read_common.raw_data;
+
+    std::vector<dorado::Message> messages;
+    {
+        dorado::PipelineDescriptor pipeline_desc;
+        auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+        pipeline_desc.add_node<dorado::ScalerNode>(
+                {sink}, dorado::basecall::SignalNormalisationParams{},
+                dorado::basecall::SampleType::DNA, false, false, 2, 100, cache);
+        auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+        pipeline->push_message(std::move(read));
+    }
+
+    REQUIRE(messages.size() == 1);
+    const auto& result = std::get<dorado::SimplexReadPtr>(messages[0]);
+    CHECK(at::equal(result->read_common.raw_data, signal));
+    CHECK(result->read_common.num_trimmed_samples == 10);
+    // Already scaled signal isn't added to the cache again.
+    CHECK(cache->size() == 0);
+}
@@ -0,0 +1,89 @@
+#include "read_pipeline/ReadPipeline.h"
+#include "splitter/SignalReadSplitter.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[SignalSplitTest]"
+
+namespace {
+
+// Creates a read of |num_samples| baseline samples, with open-pore samples in each of |pore_ranges|.
+// Calibration is the identity, so raw values are in pA.
+auto make_read(int64_t num_samples, const std::vector<std::pair<int64_t, int64_t>>& pore_ranges) {
+    auto read = std::make_unique<dorado::SimplexRead>();
+    read->scaling = 1.f;
+    read->offset = 0.f;
+    read->read_common.sample_rate = 4000;
+    read->read_common.read_id = "1ebbe001-d735-4191-af79-bee5a2fca7dd";
+    read->read_common.num_trimmed_samples = 0;
+    read->read_common.attributes.read_number = 57296;
+    read->read_common.attributes.channel_number = 2207;
+    read->read_common.attributes.mux = 4;
+    read->read_common.attributes.start_time = "2023-08-11T02:56:14.296+00:00";
+    read->read_common.attributes.num_samples = num_samples;
+    read->read_common.read_tag = 42;
+    read->start_sample = 0;
+    read->end_sample = num_samples;
+    read->run_acquisition_start_time_ms = 0;
+    read->prev_read = "prev";
+    read->next_read = "next";
+
+    auto signal = at::full({num_samples}, 90, at::TensorOptions().dtype(at::kShort));
+    for (const auto& [start, end] : pore_ranges) {
+        signal.index_put_({at::indexing::Slice(start, end)}, 220);
+    }
+    read->read_common.raw_data = signal;
+    return read;
+}
+
+}  // namespace
+
+TEST_CASE("Split on open pore signal", TEST_GROUP) {
+    dorado::splitter::SignalReadSplitter splitter(dorado::splitter::SignalSplitSettings{});
+
+    const auto split_res = splitter.split(make_read(20000, {{8000, 8100}}));
+    REQUIRE(split_res.size() == 2);
+
+    std::vector<uint64_t> num_samples;
+    std::vector<uint32_t> split_points;
+    for (auto& r : split_res) {
+        num_samples.push_back(r->read_common.attributes.num_samples);
+        split_points.push_back(r->read_common.split_point);
+        CHECK(r->read_common.parent_read_id == "1ebbe001-d735-4191-af79-bee5a2fca7dd");
+        CHECK(r->read_common.split_count == 2);
+        CHECK(r->read_common.get_raw_data_samples() == r->read_common.attributes.num_samples);
+    }
+    // The open-pore samples aren't part of either subread.
+    CHECK(num_samples == std::vector<uint64_t>{8000, 11900});
+    CHECK(split_points == std::vector<uint32_t>{0, 8100});
+
+    CHECK(split_res[0]->prev_read == "prev");
+    CHECK(split_res[0]->next_read == split_res[1]->read_common.read_id);
+    CHECK(split_res[1]->prev_read == split_res[0]->read_common.read_id);
+    CHECK(split_res[1]->next_read == "next");
+}
+
+TEST_CASE("No split on short spikes or in the expected pore prefix", TEST_GROUP) {
+    dorado::splitter::SignalReadSplitter splitter(dorado::splitter::SignalSplitSettings{});
+
+    const auto split_res = splitter.split(make_read(20000, {{100, 400}, {12000, 12003}}));
+    REQUIRE(split_res.size() == 1);
+    CHECK(split_res[0]->read_common.read_id == "1ebbe001-d735-4191-af79-bee5a2fca7dd");
+    CHECK(split_res[0]->read_common.parent_read_id.empty());
+    CHECK(split_res[0]->read_common.get_raw_data_samples() == 20000);
+}
+
+TEST_CASE("Trailing open pore is discarded", TEST_GROUP) {
+    dorado::splitter::SignalReadSplitter splitter(dorado::splitter::SignalSplitSettings{});
+
+    const auto split_res = splitter.split(make_read(20000, {{19500, 19900}}));
+    REQUIRE(split_res.size() == 1);
+    CHECK(split_res[0]->read_common.parent_read_id == "1ebbe001-d735-4191-af79-bee5a2fca7dd");
+    CHECK(split_res[0]->read_common.read_id != split_res[0]->read_common.parent_read_id);
+    CHECK(split_res[0]->read_common.get_raw_data_samples() == 19500);
+}
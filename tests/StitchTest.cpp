@@ -77,3 +77,74 @@ TEST_CASE("Test stitch_chunks", TEST_GROUP) {
     REQUIRE(read_common.qstring == expected_qstring);
     REQUIRE(read_common.moves == expected_moves);
 }
+
+TEST_CASE("Test stitch_chunks with skipped signal", TEST_GROUP) {
+    constexpr size_t CHUNK_SIZE = 10;
+
+    // Two segments of one chunk each, with 10 samples between them which weren't called.
+    std::vector<std::unique_ptr<dorado::utils::Chunk>> called_chunks;
+    for (size_t offset : {size_t(0), size_t(20)}) {
+        auto chunk = std::make_unique<dorado::utils::Chunk>(offset, CHUNK_SIZE);
+        const size_t chunk_idx = called_chunks.size();
+        chunk->qstring = QSTR[chunk_idx];
+        chunk->seq = SEQS[chunk_idx];
+        chunk->moves = MOVES[chunk_idx];
+        called_chunks.push_back(std::move(chunk));
+    }
+    const std::vector<dorado::utils::CalledSegment> segments{{0, 10, 1}, {20, 30, 1}};
+
+    dorado::ReadCommon read_common;
+    REQUIRE_NOTHROW(dorado::utils::stitch_chunks(read_common, called_chunks, segments));
+
+    std::vector<uint8_t> expected_moves = MOVES[0];
+    expected_moves.resize(20, 0);
+    expected_moves.insert(expected_moves.end(), MOVES[1].begin(), MOVES[1].end());
+
+    CHECK(read_common.model_stride == 1);
+    CHECK(read_common.seq == "ACGTACGT");
+    CHECK(read_common.qstring == "!&.-!&.-");
+    CHECK(read_common.moves == expected_moves);
+}
+
+TEST_CASE("Test ChunkStitcher releases chunks as they are stitched", TEST_GROUP) {
+    constexpr size_t CHUNK_SIZE = 10;
+    constexpr size_t OVERLAP = 3;
+
+    // Counts the chunks which haven't been destroyed yet.
+    struct CountedChunk : dorado::utils::Chunk {
+        CountedChunk(size_t offset, size_t chunk_size, int &live_chunks)
+                : Chunk(offset, chunk_size), m_live_chunks(live_chunks) {
+            ++m_live_chunks;
+        }
+        ~CountedChunk() override { --m_live_chunks; }
+        int &m_live_chunks;
+    };
+
+    std::vector<size_t> offsets{0};
+    while (offsets.back() + CHUNK_SIZE < RAW_SIGNAL_SIZE) {
+        offsets.push_back(
+                std::min(offsets.back() + CHUNK_SIZE - OVERLAP, RAW_SIGNAL_SIZE - CHUNK_SIZE));
+    }
+
+    int live_chunks = 0;
+    dorado::utils::ChunkStitcher stitcher({{0, RAW_SIGNAL_SIZE, offsets.size()}});
+    for (size_t chunk_idx = 0; chunk_idx < offsets.size(); ++chunk_idx) {
+        CHECK_FALSE(stitcher.is_complete());
+        auto chunk = std::make_unique<CountedChunk>(offsets[chunk_idx], CHUNK_SIZE, live_chunks);
+        chunk->qstring = QSTR[chunk_idx];
+        chunk->seq = SEQS[chunk_idx];
+        chunk->moves = MOVES[chunk_idx];
+        stitcher.add_chunk(std::move(chunk));
+        // Only the most recent chunk is held back, waiting for its successor.
+        CHECK(live_chunks == (stitcher.is_complete() ? 0 : 1));
+    }
+    REQUIRE(stitcher.is_complete());
+
+    dorado::ReadCommon read_common;
+    stitcher.finalise(read_common);
+
+    // Same bases as stitching all the chunks at once, with a move for every sample of the segment.
+    CHECK(read_common.seq == "ACGTCGCGTCGTCGTCCGT");
+    CHECK(read_common.qstring == "!&.-&.&.-&.-&.-&&.-");
+    CHECK(read_common.moves.size() == RAW_SIGNAL_SIZE);
+}
@@ -0,0 +1,122 @@
+#include "read_pipeline/FakeDataLoader.h"
+#include "utils/sequence_utils.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <set>
+#include <string>
+
+#define TEST_GROUP "[synthetic_reads]"
+
+using namespace dorado;
+
+TEST_CASE(TEST_GROUP ": signal follows the kmer levels") {
+    SyntheticReadParams params;
+    // A single base "kmer" per level, with one noiseless sample per base.
+    params.kmer_levels = {-1.f, 0.f, 1.f, 2.f};
+    params.kmer_centre = 0;
+    params.noise_sd = 0.f;
+    params.samples_per_base = 1.f;
+    params.read_length_mean = 100.f;
+    params.read_length_sd = 0.f;
+    params.min_read_length = 100;
+    params.random_reference_length = 1000;
+
+    SyntheticReadGenerator generator(params);
+    auto reads = generator.next_reads();
+    REQUIRE(reads.size() == 1);
+    const auto& read = *reads[0].read;
+    const auto& sequence = reads[0].sequence;
+    REQUIRE(sequence.size() == 100);
+    REQUIRE(read.read_common.raw_data.size(0) == 100);
+
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        const float level = params.kmer_levels[utils::base_to_int(sequence[i])];
+        const float expected_pa = level * params.level_scale + params.level_shift;
+        const float raw = float(read.read_common.raw_data[i].item<int16_t>());
+        CHECK(std::abs(read.scaling * (raw + read.offset) - expected_pa) <= read.scaling);
+    }
+}
+
+TEST_CASE(TEST_GROUP ": reads have realistic metadata") {
+    SyntheticReadParams params;
+    params.random_reference_length = 100000;
+    params.read_length_mean = 2000.f;
+    params.read_length_sd = 1000.f;
+    params.min_read_length = 500;
+    params.max_read_length = 5000;
+    params.num_channels = 8;
+
+    SyntheticReadGenerator generator(params);
+    std::set<std::string> read_ids;
+    for (int i = 0; i < 50; ++i) {
+        for (auto& synthetic_read : generator.next_reads()) {
+            const auto& read = *synthetic_read.read;
+            CHECK(synthetic_read.sequence.size() >= params.min_read_length);
+            CHECK(synthetic_read.sequence.size() <= params.max_read_length);
+            CHECK(read.read_common.read_id.size() == 36);
+            CHECK(read_ids.insert(read.read_common.read_id).second);
+            CHECK(read.read_common.attributes.channel_number >= 1);
+            CHECK(read.read_common.attributes.channel_number <= params.num_channels);
+            CHECK(read.read_common.sample_rate == params.sample_rate);
+            CHECK(read.end_sample - read.start_sample ==
+                  uint64_t(read.read_common.raw_data.size(0)));
+            CHECK(read.read_common.raw_data.size(0) >= int64_t(synthetic_read.sequence.size()));
+        }
+    }
+}
+
+TEST_CASE(TEST_GROUP ": barcodes, adapters and duplex pairs") {
+    SyntheticReadParams params;
+    params.random_reference_length = 100000;
+    params.read_length_mean = 1000.f;
+    params.adapter = "CCTGTACTTCGTTCAGTTACGTATTGC";
+    params.barcodes = {"AAGAAAGTTGTCGGTGTCTTTGTG", "TCGATTCCGTTTGTAGTCGTCTGT"};
+    params.duplex_fraction = 1.f;
+
+    SyntheticReadGenerator generator(params);
+    for (int i = 0; i < 10; ++i) {
+        auto reads = generator.next_reads();
+        REQUIRE(reads.size() == 2);
+        const auto& template_read = *reads[0].read;
+        const auto& complement_read = *reads[1].read;
+
+        for (const auto& synthetic_read : reads) {
+            const auto& sequence = synthetic_read.sequence;
+            CHECK(sequence.rfind(params.adapter, 0) == 0);
+            const auto barcode = sequence.substr(params.adapter.size(), params.barcodes[0].size());
+            CHECK((barcode == params.barcodes[0] || barcode == params.barcodes[1]));
+        }
+
+        CHECK(template_read.read_common.attributes.channel_number ==
+              complement_read.read_common.attributes.channel_number);
+        CHECK(template_read.read_common.attributes.mux ==
+              complement_read.read_common.attributes.mux);
+        CHECK(complement_read.start_sample > template_read.end_sample);
+        CHECK(template_read.next_read == complement_read.read_common.read_id);
+        CHECK(complement_read.prev_read == template_read.read_common.read_id);
+    }
+}
+
+TEST_CASE(TEST_GROUP ": generation is reproducible") {
+    SyntheticReadParams params;
+    params.random_reference_length = 10000;
+    params.read_length_mean = 500.f;
+    params.min_read_length = 100;
+    params.concatemer_fraction = 0.5f;
+
+    SyntheticReadGenerator generator_a(params);
+    SyntheticReadGenerator generator_b(params);
+    for (int i = 0; i < 5; ++i) {
+        auto reads_a = generator_a.next_reads();
+        auto reads_b = generator_b.next_reads();
+        REQUIRE(reads_a.size() == reads_b.size());
+        for (size_t j = 0; j < reads_a.size(); ++j) {
+            CHECK(reads_a[j].sequence == reads_b[j].sequence);
+            CHECK(reads_a[j].read->read_common.read_id == reads_b[j].read->read_common.read_id);
+            CHECK(reads_a[j].read->read_common.raw_data.equal(
+                    reads_b[j].read->read_common.raw_data));
+        }
+    }
+}
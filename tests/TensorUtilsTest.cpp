@@ -5,6 +5,8 @@
 
 #include <cstdlib>
 #include <random>
+#include <tuple>
+#include <vector>
 
 #define CUT_TAG "[TensorUtils]"
 
@@ -58,6 +60,54 @@ TEST_CASE(CUT_TAG ": test quantiles_counting", CUT_TAG) {
     REQUIRE(torch::equal(computed, expected));
 }
 
+TEST_CASE(CUT_TAG ": test quantile_counting on raw samples", CUT_TAG) {
+    torch::manual_seed(42);
+
+    // Signals with a negative range, a single value, and a range spanning most of int16.
+    for (auto [low, high, size] : {std::tuple{-500, 1500, 4000}, std::tuple{700, 701, 10},
+                                   std::tuple{-30000, 30000, 20000}}) {
+        auto in = torch::randint(low, high, size).to(torch::kI16);
+        const std::vector<float> quantiles = {0.9f, 0.2f, 0.0f, 1.0f};
+        auto q = torch::tensor(quantiles, {torch::kFloat});
+
+        auto expected = torch::quantile(in.to(torch::kFloat), q, 0, false,
+                                        c10::string_view("lower"));
+        std::vector<int16_t> computed(quantiles.size());
+        dorado::utils::quantile_counting(in.data_ptr<int16_t>(), in.numel(), quantiles.data(),
+                                         quantiles.size(), computed.data());
+
+        for (size_t i = 0; i < quantiles.size(); ++i) {
+            CHECK(computed[i] == expected[i].item<float>());
+        }
+    }
+}
+
+TEST_CASE(CUT_TAG ": normalise_i16_to_f16", CUT_TAG) {
+    torch::manual_seed(42);
+    srand(42);
+
+    for (int i = 0; i < 10; ++i) {
+        const int num_elems = rand() % 100;
+        const float shift = float(rand() % 1000);
+        const float scale = 1.0f + float(rand() % 100);
+        const auto elems_i16 = torch::randint(-2000, 2000, {num_elems}).to(torch::kI16);
+        const auto elems_torch_f16 =
+                ((elems_i16.to(torch::kFloat) - shift) / scale).to(torch::kHalf);
+
+        auto elems_converted_f16 = torch::zeros({num_elems}, torch::kHalf);
+        dorado::utils::normalise_i16_to_f16(elems_converted_f16.data_ptr<c10::Half>(),
+                                            elems_i16.data_ptr<int16_t>(), num_elems, shift, scale);
+        CHECK(torch::equal(elems_torch_f16, elems_converted_f16));
+
+        // Converting in place gives the same result.
+        auto elems_in_place = elems_i16.clone();
+        dorado::utils::normalise_i16_to_f16(
+                reinterpret_cast<c10::Half*>(elems_in_place.data_ptr<int16_t>()),
+                elems_in_place.data_ptr<int16_t>(), num_elems, shift, scale);
+        CHECK(torch::equal(elems_torch_f16, elems_in_place.view(torch::kHalf)));
+    }
+}
+
 TEST_CASE(CUT_TAG ": convert_f32_to_f16", CUT_TAG) {
     torch::manual_seed(42);
     srand(42);
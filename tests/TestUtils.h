@@ -1,5 +1,10 @@
 #pragma once
 
+#include "utils/types.h"
+
+#include <htslib/sam.h>
+
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -39,6 +44,31 @@ inline std::vector<uint8_t> ReadFileIntoVector(const std::filesystem::path& path
     return vec;
 }
 
+// Makes a record named "read" of seq, as basecalled with a stride 5 move table holding a stay
+// after each base, from samples [10, 10 + 2 * 5 * seq.size()) of its signal.  Base i has quality
+// 10 + i % 50.
+inline dorado::BamPtr make_basecalled_bam_record(const std::string& seq, uint16_t flag) {
+    std::vector<char> qual(seq.size());
+    for (size_t i = 0; i < seq.size(); ++i) {
+        qual[i] = char(10 + i % 50);
+    }
+    dorado::BamPtr record(bam_init1());
+    const std::string read_id = "read";
+    bam_set1(record.get(), read_id.size(), read_id.c_str(), flag, -1, -1, 0, 0, nullptr, -1, -1, 0,
+             seq.size(), seq.c_str(), qual.data(), 0);
+    std::vector<uint8_t> moves{5};
+    for (size_t i = 0; i < seq.size(); ++i) {
+        moves.push_back(1);
+        moves.push_back(0);
+    }
+    bam_aux_update_array(record.get(), "mv", 'c', int(moves.size()), moves.data());
+    const int32_t ts = 10;
+    const int32_t ns = int32_t(ts + (moves.size() - 1) * 5);
+    bam_aux_append(record.get(), "ts", 'i', sizeof(ts), (const uint8_t*)&ts);
+    bam_aux_append(record.get(), "ns", 'i', sizeof(ns), (const uint8_t*)&ns);
+    return record;
+}
+
 #define get_fast5_data_dir() get_data_dir("fast5")
 
 #define get_pod5_data_dir() get_data_dir("pod5")
@@ -3,6 +3,7 @@
 #include "TestUtils.h"
 #include "demux/Trimmer.h"
 #include "read_pipeline/HtsReader.h"
+#include "utils/bam_utils.h"
 
 #include <ATen/ATen.h>
 #include <catch2/catch.hpp>
@@ -19,6 +20,17 @@ using namespace dorado;
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Makes an unaligned record with an extra tag which trimming shouldn't touch.
+BamPtr make_trim_record(const std::string &seq) {
+    auto record = make_basecalled_bam_record(seq, BAM_FUNMAP);
+    bam_aux_append(record.get(), "RG", 'Z', 4, (const uint8_t *)"run");
+    return record;
+}
+
+}  // namespace
+
 TEST_CASE("Test trim signal", TEST_GROUP) {
     constexpr int signal_len = 2000;
 
@@ -85,6 +97,52 @@ TEST_CASE("Test trim signal", TEST_GROUP) {
     }
 }
 
+TEST_CASE("Test find open pore ranges", TEST_GROUP) {
+    constexpr int signal_len = 2000;
+
+    std::mt19937 gen{42};
+    std::normal_distribution<float> rng{0, 1};
+
+    std::vector<float> signal(signal_len);
+    std::generate(signal.begin(), signal.end(), [&]() { return rng(gen); });
+
+    auto signal_tensor = at::from_blob(const_cast<float *>(signal.data()), {signal_len});
+
+    SECTION("No open pore") {
+        auto ranges = utils::find_open_pore_ranges(signal_tensor, utils::DEFAULT_TRIM_THRESHOLD,
+                                                   utils::DEFAULT_TRIM_WINDOW_SIZE,
+                                                   utils::DEFAULT_TRIM_MIN_ELEMENTS);
+        CHECK(ranges.empty());
+    }
+
+    SECTION("Internal and trailing open pore") {
+        for (int i = 400; i < 800; ++i) {
+            signal[i] += 10;
+        }
+        // Only the last two windows are entirely open pore.
+        for (int i = 1900; i < signal_len; ++i) {
+            signal[i] += 10;
+        }
+
+        auto ranges = utils::find_open_pore_ranges(signal_tensor, utils::DEFAULT_TRIM_THRESHOLD,
+                                                   utils::DEFAULT_TRIM_WINDOW_SIZE,
+                                                   utils::DEFAULT_TRIM_MIN_ELEMENTS);
+        CHECK(ranges == std::vector<std::pair<int, int>>{{400, 800}, {1920, 2000}});
+    }
+
+    SECTION("Trailing partial window") {
+        for (int i = 1600; i < signal_len; ++i) {
+            signal[i] += 10;
+        }
+
+        auto ranges = utils::find_open_pore_ranges(
+                signal_tensor.index({Slice(at::indexing::None, 1990)}),
+                utils::DEFAULT_TRIM_THRESHOLD, utils::DEFAULT_TRIM_WINDOW_SIZE,
+                utils::DEFAULT_TRIM_MIN_ELEMENTS);
+        CHECK(ranges == std::vector<std::pair<int, int>>{{1600, 1990}});
+    }
+}
+
 TEST_CASE("Test trim sequence", TEST_GROUP) {
     const std::string seq = "TEST_SEQ";
 
@@ -191,3 +249,40 @@ TEST_CASE("Test trim of reverse strand record in BAM", TEST_GROUP) {
     CHECK_THAT(bam_aux2Z(bam_aux_get(trimmed_record.get(), "MM")),
                Equals("C+h?,28,24;C+m?,28,24;"));
 }
+
+TEST_CASE("Test trim of packed BAM record", TEST_GROUP) {
+    const std::string seq = "ACGTTGCAACGTAGCTAGCTNACG";
+    auto record = make_trim_record(seq);
+
+    SECTION("Trim nothing") {
+        const auto *input_record = record.get();
+        auto trimmed_record = Trimmer::trim_sequence(std::move(record), {0, int(seq.size())});
+        // The record is passed through untouched.
+        CHECK(trimmed_record.get() == input_record);
+    }
+
+    SECTION("Trim either end") {
+        auto start = GENERATE(0, 1, 2, 5);
+        auto end = GENERATE(18, 19, 24);
+        CAPTURE(start);
+        CAPTURE(end);
+        auto trimmed_record = Trimmer::trim_sequence(std::move(record), {start, end});
+        auto *out = trimmed_record.get();
+
+        CHECK(std::string(bam_get_qname(out)) == "read");
+        CHECK(utils::extract_sequence(out) == seq.substr(start, end - start));
+        const auto qual = utils::extract_quality(out);
+        REQUIRE(qual.size() == size_t(end - start));
+        for (int i = 0; i < end - start; ++i) {
+            CHECK(qual[i] == 10 + (start + i) % 50);
+        }
+        auto [stride, moves] = utils::extract_move_table(out);
+        CHECK(stride == 5);
+        // Each base kept keeps its move and the stay after it.
+        CHECK(moves.size() == size_t(2 * (end - start)));
+        const int ts = 10 + 2 * start * 5;
+        CHECK(bam_aux2i(bam_aux_get(out, "ts")) == ts);
+        CHECK(bam_aux2i(bam_aux_get(out, "ns")) == ts + 2 * (end - start) * 5);
+        CHECK(std::string(bam_aux2Z(bam_aux_get(out, "RG"))) == "run");
+    }
+}
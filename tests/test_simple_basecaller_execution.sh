@@ -83,6 +83,26 @@ $dorado_bin basecaller ${model} $data_dir/pod5 -b ${batch} --modified-bases 5mCG
 samtools quickcheck -u $output_dir/calls.bam
 samtools view -h $output_dir/calls.bam > $output_dir/calls.sam
 
+echo dorado daemon test stage
+daemon_socket=$output_dir/daemon.sock
+$dorado_bin daemon $daemon_socket &
+daemon_pid=$!
+for i in $(seq 1 100); do
+    [ -S $daemon_socket ] && break
+    sleep 0.1
+done
+$dorado_bin aligner $output_dir/ref.fq $output_dir/calls.sam > $output_dir/calls_local.bam
+$dorado_bin aligner --daemon-socket $daemon_socket $output_dir/ref.fq $output_dir/calls.sam > $output_dir/calls_daemon.bam
+$dorado_bin aligner --daemon-socket $daemon_socket $output_dir/ref.fq < $output_dir/calls.sam > $output_dir/calls_daemon_stdin.bam
+$dorado_bin daemon --stop $daemon_socket
+wait $daemon_pid
+samtools quickcheck -u $output_dir/calls_daemon.bam $output_dir/calls_daemon_stdin.bam
+num_local=$(samtools view -c $output_dir/calls_local.bam)
+if [[ $(samtools view -c $output_dir/calls_daemon.bam) -ne $num_local || $(samtools view -c $output_dir/calls_daemon_stdin.bam) -ne $num_local ]]; then
+    echo "dorado daemon alignments don't match local alignments"
+    exit 1
+fi
+
 echo dorado aligner options test stage
 dorado_aligner_options_test() (
     set +e